@@ -0,0 +1,658 @@
+#include "audio_mixer.h"
+#include "../utils/cpu_features.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Just under full scale, so converting the mix never clips.
+const float MIXER_LIMIT = 0.98f;
+// Share of the way back to unity gain the limiter recovers each block.
+const float MIXER_RELEASE = 0.05f;
+const int MIXER_MAX_SOURCES = 4;
+// Scheduled starts go this many device buffers ahead, leaving a margin
+// for callbacks that come early.
+const double MIXER_LEAD_BUFFERS = 1.25;
+// Share of the measured error the clock anchor and frame stamps take on
+// each time, so scheduler jitter does not reach the starts.
+const double MIXER_ANCHOR_SMOOTHING = 0.05;
+const double MIXER_TICK_SMOOTHING = 0.1;
+// A frame gap longer than this restarts the frame stamps.
+const double MIXER_TICK_RESET_SECONDS = 0.25;
+
+// What the main thread asked a voice to do. serial changes with every
+// play, so the callback can tell a new play from the one it has.
+struct VoiceControl {
+    const Mix_Chunk* chunk;     // nullptr when stopped
+    Uint64 start;               // output frame it begins on
+    Uint32 frames;
+    VoiceParams sound;
+    VoiceParams effects;
+    int serial;
+};
+
+// The callback's own copy of a voice, picked up from its VoiceControl at
+// the start of each block.
+struct MixVoice {
+    const Mix_Chunk* chunk;     // nullptr when the voice is free
+    Uint64 start;
+    Uint32 frames;
+    double position;
+    VoiceParams sound;
+    VoiceParams effects;
+    int serial;
+    // Gains the previous block ended on; the next one ramps from them so
+    // volume and pan changes do not click.
+    float gain_l;
+    float gain_r;
+    bool fresh;
+};
+
+struct MixSource {
+    MixerSourceFn fn;
+    void* userdata;
+};
+
+// Under g_lock.
+static VoiceControl g_control[MIXER_MAX_VOICES];
+static int g_voice_count = MIXER_MAX_VOICES;
+static MixSource g_sources[MIXER_MAX_SOURCES];
+static int g_source_count = 0;
+static int g_next_serial = 0;
+// Held only to read or change the fields above and the clock; the callback
+// takes it once per block to copy what changed, never while mixing.
+static SDL_SpinLock g_lock = 0;
+// Held by the callback while it mixes a block. Only calls that must know
+// the callback is done with a chunk or source wait on it.
+static SDL_SpinLock g_mixing = 0;
+// Serial of the play each voice is on, or 0 once it is free. Read without
+// a lock, so asking whether voices are busy never waits on the callback.
+static SDL_atomic_t g_playing[MIXER_MAX_VOICES];
+
+// Callback only.
+static MixVoice g_voices[MIXER_MAX_VOICES];
+static MixSource g_block_sources[MIXER_MAX_SOURCES];
+static int g_block_voices = 0;
+static int g_block_source_count = 0;
+static Uint64 g_block_frame = 0;
+static bool g_ready = false;
+
+static SDL_AudioFormat g_out_format = 0;
+static int g_out_channels = 0;
+static int g_out_frame = 0;
+static int g_out_rate = 0;
+
+// Frames mixed so far, and how far the output runs ahead of the
+// performance counter counted in frames from g_counter_base. All under
+// g_lock.
+static Uint64 g_clock = 0;
+static Uint64 g_counter_base = 0;
+static double g_anchor = 0.0;
+static bool g_anchored = false;
+static int g_callback_frames = 0;
+static Uint64 g_last_callback = 0;
+static float g_callback_ms = 0.0f;
+static float g_jitter_ms = 0.0f;
+
+// Main thread only: the smoothed start of the current frame in seconds
+// from g_counter_base, the last raw one and the frame period.
+static double g_tick_time = 0.0;
+static double g_tick_raw = -1.0;
+static double g_tick_period = 0.0;
+
+static float g_mix[MIXER_BLOCK_FRAMES * 2];
+static float g_voice_buf[MIXER_BLOCK_FRAMES * 2];
+static float g_limit_gain = 1.0f;
+
+typedef void (*AccumulateFn)(float* mix, const float* src, int frames, float gl, float gr, float dl, float dr);
+typedef void (*ApplyGainFn)(float* buf, int frames, float g, float dg);
+typedef void (*ConvertS16Fn)(float* dst, const Sint16* src, int samples);
+typedef void (*StoreS16Fn)(Sint16* dst, const float* src, int samples);
+typedef float (*PeakFn)(const float* buf, int samples);
+
+static void accumulate_scalar(float* mix, const float* src, int frames, float gl, float gr, float dl, float dr) {
+    for (int i = 0; i < frames; i++) {
+        mix[2 * i] += src[2 * i] * gl;
+        mix[2 * i + 1] += src[2 * i + 1] * gr;
+        gl += dl;
+        gr += dr;
+    }
+}
+
+static void apply_gain_scalar(float* buf, int frames, float g, float dg) {
+    for (int i = 0; i < frames; i++) {
+        buf[2 * i] *= g;
+        buf[2 * i + 1] *= g;
+        g += dg;
+    }
+}
+
+static void convert_s16_scalar(float* dst, const Sint16* src, int samples) {
+    for (int i = 0; i < samples; i++) dst[i] = src[i] * (1.0f / 32768.0f);
+}
+
+static void store_s16_scalar(Sint16* dst, const float* src, int samples) {
+    for (int i = 0; i < samples; i++) {
+        float v = std::max(-1.0f, std::min(1.0f, src[i]));
+        dst[i] = (Sint16)lrintf(v * 32767.0f);
+    }
+}
+
+static float peak_scalar(const float* buf, int samples) {
+    float peak = 0.0f;
+    for (int i = 0; i < samples; i++) peak = std::max(peak, std::fabs(buf[i]));
+    return peak;
+}
+
+#ifdef BLOCKY_X86
+
+// Two stereo frames per vector.
+BLOCKY_TARGET("sse2")
+static void accumulate_sse2(float* mix, const float* src, int frames, float gl, float gr, float dl, float dr) {
+    __m128 g = _mm_setr_ps(gl, gr, gl + dl, gr + dr);
+    const __m128 step = _mm_setr_ps(2 * dl, 2 * dr, 2 * dl, 2 * dr);
+    int i = 0;
+    for (; i + 2 <= frames; i += 2) {
+        __m128 m = _mm_loadu_ps(mix + 2 * i);
+        __m128 s = _mm_loadu_ps(src + 2 * i);
+        _mm_storeu_ps(mix + 2 * i, _mm_add_ps(m, _mm_mul_ps(s, g)));
+        g = _mm_add_ps(g, step);
+    }
+    accumulate_scalar(mix + 2 * i, src + 2 * i, frames - i, gl + dl * i, gr + dr * i, dl, dr);
+}
+
+BLOCKY_TARGET("sse2")
+static void apply_gain_sse2(float* buf, int frames, float g, float dg) {
+    __m128 gv = _mm_setr_ps(g, g, g + dg, g + dg);
+    const __m128 step = _mm_set1_ps(2 * dg);
+    int i = 0;
+    for (; i + 2 <= frames; i += 2) {
+        _mm_storeu_ps(buf + 2 * i, _mm_mul_ps(_mm_loadu_ps(buf + 2 * i), gv));
+        gv = _mm_add_ps(gv, step);
+    }
+    apply_gain_scalar(buf + 2 * i, frames - i, g + dg * i, dg);
+}
+
+BLOCKY_TARGET("sse2")
+static void convert_s16_sse2(float* dst, const Sint16* src, int samples) {
+    const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+    int i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+    convert_s16_scalar(dst + i, src + i, samples - i);
+}
+
+BLOCKY_TARGET("sse2")
+static void store_s16_sse2(Sint16* dst, const float* src, int samples) {
+    const __m128 lo = _mm_set1_ps(-1.0f);
+    const __m128 hi = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(32767.0f);
+    int i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        __m128 a = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), lo), hi);
+        __m128 b = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + 4), lo), hi);
+        __m128i ia = _mm_cvtps_epi32(_mm_mul_ps(a, scale));
+        __m128i ib = _mm_cvtps_epi32(_mm_mul_ps(b, scale));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packs_epi32(ia, ib));
+    }
+    store_s16_scalar(dst + i, src + i, samples - i);
+}
+
+BLOCKY_TARGET("sse2")
+static float peak_sse2(const float* buf, int samples) {
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 p = _mm_setzero_ps();
+    int i = 0;
+    for (; i + 4 <= samples; i += 4) {
+        p = _mm_max_ps(p, _mm_and_ps(_mm_loadu_ps(buf + i), abs_mask));
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, p);
+    float peak = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+    return std::max(peak, peak_scalar(buf + i, samples - i));
+}
+
+#endif
+
+static AccumulateFn g_accumulate = accumulate_scalar;
+static ApplyGainFn g_apply_gain = apply_gain_scalar;
+static ConvertS16Fn g_convert_s16 = convert_s16_scalar;
+static StoreS16Fn g_store_s16 = store_s16_scalar;
+static PeakFn g_peak = peak_scalar;
+static const char* g_isa = "scalar";
+
+static void select_kernels() {
+    g_accumulate = accumulate_scalar;
+    g_apply_gain = apply_gain_scalar;
+    g_convert_s16 = convert_s16_scalar;
+    g_store_s16 = store_s16_scalar;
+    g_peak = peak_scalar;
+    g_isa = cpu_level_name(CPU_SCALAR);
+#ifdef BLOCKY_X86
+    if (cpu_level() >= CPU_SSE2) {
+        g_accumulate = accumulate_sse2;
+        g_apply_gain = apply_gain_sse2;
+        g_convert_s16 = convert_s16_sse2;
+        g_store_s16 = store_s16_sse2;
+        g_peak = peak_sse2;
+        g_isa = cpu_level_name(CPU_SSE2);
+    }
+#endif
+}
+
+static inline void read_frame(const Uint8* data, Uint32 frame, float* l, float* r) {
+    if (g_out_format == AUDIO_F32SYS) {
+        const float* s = (const float*)data + (size_t)frame * g_out_channels;
+        *l = s[0];
+        *r = g_out_channels > 1 ? s[1] : s[0];
+    } else {
+        const Sint16* s = (const Sint16*)data + (size_t)frame * g_out_channels;
+        *l = s[0] * (1.0f / 32768.0f);
+        *r = (g_out_channels > 1 ? s[1] : s[0]) * (1.0f / 32768.0f);
+    }
+}
+
+// Fills out with up to n frames of the voice at the given rate and
+// returns how many there were before the chunk ran out.
+static int fetch_voice(MixVoice* v, float* out, int n, float step) {
+    const Uint8* data = v->chunk->abuf;
+
+    if (step == 1.0f && g_out_format == AUDIO_S16SYS && g_out_channels == 2 &&
+        v->position == std::floor(v->position)) {
+        Uint32 start = (Uint32)v->position;
+        int count = (int)std::min<Uint32>((Uint32)n, v->frames - start);
+        g_convert_s16(out, (const Sint16*)data + (size_t)start * 2, count * 2);
+        v->position += count;
+        return count;
+    }
+
+    int k = 0;
+    for (; k < n; k++) {
+        Uint32 idx = (Uint32)v->position;
+        if (idx >= v->frames) break;
+        float frac = (float)(v->position - idx);
+        Uint32 next = idx + 1 < v->frames ? idx + 1 : idx;
+        float l0, r0, l1, r1;
+        read_frame(data, idx, &l0, &r0);
+        read_frame(data, next, &l1, &r1);
+        out[2 * k] = l0 + (l1 - l0) * frac;
+        out[2 * k + 1] = r0 + (r1 - r0) * frac;
+        v->position += step;
+    }
+    return k;
+}
+
+static void mix_voice(MixVoice* v, int n, Uint64 block) {
+    if (v->start >= block + (Uint64)n) return;
+    int skip = v->start > block ? (int)(v->start - block) : 0;
+    n -= skip;
+
+    float gain = v->sound.gain * v->effects.gain;
+    float pan = std::max(-1.0f, std::min(1.0f, v->sound.pan + v->effects.pan));
+    float gl = gain * std::min(1.0f, 1.0f - pan);
+    float gr = gain * std::min(1.0f, 1.0f + pan);
+    float step = std::max(1.0f / 16.0f, std::min(16.0f, v->sound.pitch * v->effects.pitch));
+
+    int got = fetch_voice(v, g_voice_buf, n, step);
+    if (v->fresh) {
+        v->gain_l = gl;
+        v->gain_r = gr;
+        v->fresh = false;
+    }
+    g_accumulate(g_mix + 2 * skip, g_voice_buf, got, v->gain_l, v->gain_r, (gl - v->gain_l) / n, (gr - v->gain_r) / n);
+    v->gain_l = gl;
+    v->gain_r = gr;
+    if (got < n) {
+        v->chunk = nullptr;
+        // Unless the main thread has already started something newer here.
+        SDL_AtomicCAS(&g_playing[v - g_voices], v->serial, 0);
+    }
+}
+
+// Drops the gain at once when a block would go past MIXER_LIMIT, then
+// lets it recover over the following blocks without exceeding what each
+// block allows.
+static void limit(int n) {
+    float peak = g_peak(g_mix, n * 2);
+    float allowed = peak > MIXER_LIMIT ? MIXER_LIMIT / peak : 1.0f;
+    if (allowed < g_limit_gain) {
+        g_limit_gain = allowed;
+        g_apply_gain(g_mix, n, allowed, 0.0f);
+        return;
+    }
+
+    float next = std::min(allowed, g_limit_gain + (1.0f - g_limit_gain) * MIXER_RELEASE);
+    if (next > 0.999f) next = 1.0f;
+    if (next == 1.0f && g_limit_gain == 1.0f) return;
+
+    g_apply_gain(g_mix, n, g_limit_gain, (next - g_limit_gain) / n);
+    g_limit_gain = next;
+}
+
+static void write_output(Uint8* out, int n) {
+    if (g_out_format == AUDIO_S16SYS && g_out_channels == 2) {
+        g_store_s16((Sint16*)out, g_mix, n * 2);
+        return;
+    }
+
+    // Mono gets both sides, anything wider gets them on its front pair.
+    for (int i = 0; i < n; i++) {
+        for (int c = 0; c < g_out_channels; c++) {
+            float v;
+            if (g_out_channels == 1) v = (g_mix[2 * i] + g_mix[2 * i + 1]) * 0.5f;
+            else v = c < 2 ? g_mix[2 * i + c] : 0.0f;
+            v = std::max(-1.0f, std::min(1.0f, v));
+            if (g_out_format == AUDIO_F32SYS) {
+                ((float*)out)[i * g_out_channels + c] = v;
+            } else {
+                ((Sint16*)out)[i * g_out_channels + c] = (Sint16)lrintf(v * 32767.0f);
+            }
+        }
+    }
+}
+
+static double counter_frames(Uint64 counter) {
+    return (double)(counter - g_counter_base) * g_out_rate / (double)SDL_GetPerformanceFrequency();
+}
+
+// The callback is asked for frame g_clock now. Its timing wobbles with the
+// scheduler, so each call only nudges the anchor unless it is far off.
+static void measure_callback(int frames) {
+    Uint64 counter = SDL_GetPerformanceCounter();
+    SDL_AtomicLock(&g_lock);
+    double offset = (double)g_clock - counter_frames(counter);
+    if (!g_anchored || std::fabs(offset - g_anchor) > frames) {
+        g_anchor = offset;
+        g_anchored = true;
+    } else {
+        g_anchor += (offset - g_anchor) * MIXER_ANCHOR_SMOOTHING;
+    }
+
+    if (g_last_callback != 0) {
+        float ms = (float)((double)(counter - g_last_callback) * 1000.0 / (double)SDL_GetPerformanceFrequency());
+        g_callback_ms = g_callback_ms == 0.0f ? ms : g_callback_ms + (ms - g_callback_ms) * 0.05f;
+        g_jitter_ms = std::max(std::fabs(ms - g_callback_ms), g_jitter_ms * 0.99f);
+    }
+    g_last_callback = counter;
+    g_callback_frames = frames;
+    SDL_AtomicUnlock(&g_lock);
+}
+
+// Copies what the main thread changed since the last block. Voices past
+// the count are synced too, so a stopped one cannot come back when the
+// count grows again.
+static void sync_block() {
+    SDL_AtomicLock(&g_lock);
+    for (int i = 0; i < MIXER_MAX_VOICES; i++) {
+        const VoiceControl& c = g_control[i];
+        MixVoice& v = g_voices[i];
+        if (c.serial != v.serial) {
+            v.serial = c.serial;
+            v.chunk = c.chunk;
+            v.start = c.start;
+            v.frames = c.frames;
+            v.position = 0.0;
+            v.sound = c.sound;
+            v.fresh = true;
+        }
+        if (!c.chunk) v.chunk = nullptr;
+        v.effects = c.effects;
+    }
+    g_block_voices = g_voice_count;
+    g_block_source_count = g_source_count;
+    for (int i = 0; i < g_source_count; i++) g_block_sources[i] = g_sources[i];
+    g_block_frame = g_clock;
+    SDL_AtomicUnlock(&g_lock);
+}
+
+static void mix_callback(void*, Uint8* out, int len) {
+    int total = len / g_out_frame;
+    measure_callback(total);
+
+    while (total > 0) {
+        int n = std::min(total, MIXER_BLOCK_FRAMES);
+        std::memset(g_mix, 0, sizeof(float) * 2 * n);
+
+        SDL_AtomicLock(&g_mixing);
+        sync_block();
+        for (int i = 0; i < g_block_voices; i++) {
+            if (g_voices[i].chunk) mix_voice(&g_voices[i], n, g_block_frame);
+        }
+        for (int i = 0; i < g_block_source_count; i++) {
+            g_block_sources[i].fn(g_mix, n, g_block_sources[i].userdata);
+        }
+        SDL_AtomicUnlock(&g_mixing);
+
+        SDL_AtomicLock(&g_lock);
+        g_clock += n;
+        SDL_AtomicUnlock(&g_lock);
+
+        limit(n);
+        write_output(out, n);
+        out += n * g_out_frame;
+        total -= n;
+    }
+}
+
+bool audio_mixer_init() {
+    if (g_ready) return true;
+
+    int freq = 0, channels = 0;
+    Uint16 format = 0;
+    if (!Mix_QuerySpec(&freq, &format, &channels)) return false;
+    if ((format != AUDIO_S16SYS && format != AUDIO_F32SYS) || channels < 1) return false;
+
+    g_out_format = format;
+    g_out_channels = channels;
+    g_out_frame = (SDL_AUDIO_BITSIZE(format) / 8) * channels;
+    g_out_rate = freq;
+    g_clock = 0;
+    g_counter_base = SDL_GetPerformanceCounter();
+    g_anchored = false;
+    g_callback_frames = 0;
+    g_last_callback = 0;
+    g_callback_ms = 0.0f;
+    g_jitter_ms = 0.0f;
+    g_tick_raw = -1.0;
+    g_limit_gain = 1.0f;
+    for (int i = 0; i < MIXER_MAX_VOICES; i++) {
+        g_control[i].chunk = nullptr;
+        g_control[i].serial = 0;
+        g_voices[i].chunk = nullptr;
+        g_voices[i].serial = 0;
+        SDL_AtomicSet(&g_playing[i], 0);
+    }
+    g_source_count = 0;
+    g_block_source_count = 0;
+    select_kernels();
+
+    Mix_HookMusic(mix_callback, nullptr);
+    g_ready = true;
+    return true;
+}
+
+void audio_mixer_shutdown() {
+    if (!g_ready) return;
+    // Takes the audio lock, so the callback has finished with everything.
+    Mix_HookMusic(nullptr, nullptr);
+    for (int i = 0; i < MIXER_MAX_VOICES; i++) {
+        g_control[i].chunk = nullptr;
+        g_voices[i].chunk = nullptr;
+        SDL_AtomicSet(&g_playing[i], 0);
+    }
+    g_source_count = 0;
+    g_block_source_count = 0;
+    g_ready = false;
+}
+
+bool audio_mixer_ready() {
+    return g_ready;
+}
+
+const char* audio_mixer_isa() {
+    return g_isa;
+}
+
+int audio_mixer_rate() {
+    return g_out_rate;
+}
+
+Uint64 audio_mixer_next_frame() {
+    SDL_AtomicLock(&g_lock);
+    Uint64 frame = g_clock;
+    SDL_AtomicUnlock(&g_lock);
+    return frame;
+}
+
+Uint64 audio_mixer_block_frame() {
+    return g_block_frame;
+}
+
+Uint64 audio_mixer_frame_at(Uint64 counter) {
+    SDL_AtomicLock(&g_lock);
+    bool anchored = g_anchored;
+    double anchor = g_anchor;
+    int buffer = g_callback_frames;
+    Uint64 next = g_clock;
+    SDL_AtomicUnlock(&g_lock);
+    if (!anchored) return next;
+
+    double frame = counter_frames(counter) + anchor + buffer * MIXER_LEAD_BUFFERS;
+    if (frame < (double)next) return next;
+    return (Uint64)frame;
+}
+
+void audio_mixer_begin_tick() {
+    double t = (double)(SDL_GetPerformanceCounter() - g_counter_base) / (double)SDL_GetPerformanceFrequency();
+    double interval = t - g_tick_raw;
+    if (g_tick_raw < 0.0 || interval > MIXER_TICK_RESET_SECONDS) {
+        g_tick_time = t;
+        g_tick_period = 0.0;
+    } else {
+        g_tick_period = g_tick_period == 0.0 ? interval : g_tick_period + (interval - g_tick_period) * MIXER_TICK_SMOOTHING;
+        double predicted = g_tick_time + g_tick_period;
+        double error = t - predicted;
+        g_tick_time = std::fabs(error) < g_tick_period * 0.5 ? predicted + error * MIXER_TICK_SMOOTHING : t;
+    }
+    g_tick_raw = t;
+}
+
+Uint64 audio_mixer_tick_frame() {
+    Uint64 now = SDL_GetPerformanceCounter();
+    double freq = (double)SDL_GetPerformanceFrequency();
+    // Nothing started a frame lately, e.g. a click while no script runs.
+    if (g_tick_raw < 0.0 || (double)(now - g_counter_base) / freq - g_tick_raw > MIXER_TICK_RESET_SECONDS) {
+        return audio_mixer_frame_at(now);
+    }
+    return audio_mixer_frame_at(g_counter_base + (Uint64)(g_tick_time * freq));
+}
+
+AudioTiming audio_mixer_timing() {
+    AudioTiming t;
+    SDL_AtomicLock(&g_lock);
+    t.buffer_frames = g_callback_frames;
+    t.callback_ms = g_callback_ms;
+    t.jitter_ms = g_jitter_ms;
+    SDL_AtomicUnlock(&g_lock);
+    t.latency_ms = g_out_rate > 0 ? (float)(t.buffer_frames * (1.0 + MIXER_LEAD_BUFFERS) * 1000.0 / g_out_rate) : 0.0f;
+    return t;
+}
+
+void audio_mixer_set_voice_count(int count) {
+    count = std::max(0, std::min(count, MIXER_MAX_VOICES));
+    SDL_AtomicLock(&g_lock);
+    for (int i = count; i < g_voice_count; i++) {
+        g_control[i].chunk = nullptr;
+        SDL_AtomicSet(&g_playing[i], 0);
+    }
+    g_voice_count = count;
+    SDL_AtomicUnlock(&g_lock);
+}
+
+bool audio_mixer_play(int voice, const Mix_Chunk* chunk, const VoiceParams& sound, const VoiceParams& effects,
+                      Uint64 start) {
+    if (!g_ready || !chunk || voice < 0 || voice >= MIXER_MAX_VOICES) return false;
+    Uint32 frames = chunk->alen / (Uint32)g_out_frame;
+    if (frames == 0) return false;
+
+    SDL_AtomicLock(&g_lock);
+    VoiceControl& c = g_control[voice];
+    // Skips 0, which means free in g_playing.
+    if (++g_next_serial <= 0) g_next_serial = 1;
+    c.chunk = chunk;
+    c.start = start;
+    c.frames = frames;
+    c.sound = sound;
+    c.effects = effects;
+    c.serial = g_next_serial;
+    SDL_AtomicSet(&g_playing[voice], c.serial);
+    SDL_AtomicUnlock(&g_lock);
+    return true;
+}
+
+void audio_mixer_set_effects(int voice, const VoiceParams& effects) {
+    if (voice < 0 || voice >= MIXER_MAX_VOICES) return;
+    SDL_AtomicLock(&g_lock);
+    g_control[voice].effects = effects;
+    SDL_AtomicUnlock(&g_lock);
+}
+
+void audio_mixer_stop_all() {
+    SDL_AtomicLock(&g_lock);
+    for (int i = 0; i < MIXER_MAX_VOICES; i++) {
+        g_control[i].chunk = nullptr;
+        SDL_AtomicSet(&g_playing[i], 0);
+    }
+    SDL_AtomicUnlock(&g_lock);
+}
+
+bool audio_mixer_voice_playing(int voice) {
+    if (voice < 0 || voice >= MIXER_MAX_VOICES) return false;
+    return SDL_AtomicGet(&g_playing[voice]) != 0;
+}
+
+// Waits out a block in progress, which may have picked the chunk up
+// before it was stopped; every later block sees it stopped.
+void audio_mixer_release(const Mix_Chunk* chunk) {
+    SDL_AtomicLock(&g_lock);
+    for (int i = 0; i < MIXER_MAX_VOICES; i++) {
+        if (g_control[i].chunk != chunk) continue;
+        g_control[i].chunk = nullptr;
+        SDL_AtomicSet(&g_playing[i], 0);
+    }
+    SDL_AtomicUnlock(&g_lock);
+    SDL_AtomicLock(&g_mixing);
+    SDL_AtomicUnlock(&g_mixing);
+}
+
+void audio_mixer_add_source(MixerSourceFn fn, void* userdata) {
+    SDL_AtomicLock(&g_lock);
+    if (g_source_count < MIXER_MAX_SOURCES) {
+        g_sources[g_source_count].fn = fn;
+        g_sources[g_source_count].userdata = userdata;
+        g_source_count++;
+    }
+    SDL_AtomicUnlock(&g_lock);
+}
+
+void audio_mixer_remove_source(MixerSourceFn fn, void* userdata) {
+    SDL_AtomicLock(&g_lock);
+    for (int i = 0; i < g_source_count; i++) {
+        if (g_sources[i].fn == fn && g_sources[i].userdata == userdata) {
+            g_sources[i] = g_sources[--g_source_count];
+            break;
+        }
+    }
+    SDL_AtomicUnlock(&g_lock);
+    // Once a block in progress ends, no later one calls fn.
+    SDL_AtomicLock(&g_mixing);
+    SDL_AtomicUnlock(&g_mixing);
+}
+
+void audio_mixer_accumulate(float* mix, const float* src, int frames, float gl, float gr, float dl, float dr) {
+    g_accumulate(mix, src, frames, gl, gr, dl, dr);
+}
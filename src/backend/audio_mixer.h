@@ -0,0 +1,79 @@
+#pragma once
+#include <SDL2/SDL_mixer.h>
+
+// Our own mixer for sound effects, run from SDL_mixer's music hook in
+// place of its channels. Every voice plays a Mix_Chunk with its own gain,
+// pan and pitch, so two sprites can play the same chunk differently.
+// Voices and any registered sources are summed in float stereo and passed
+// through a limiter before conversion to the device format.
+
+const int MIXER_MAX_VOICES = 64;
+// The callback works through its buffer this many frames at a time.
+const int MIXER_BLOCK_FRAMES = 512;
+
+struct VoiceParams {
+    float gain;     // 1 is unchanged
+    float pan;      // -1 left .. 1 right
+    float pitch;    // playback rate, 1 is unchanged
+
+    VoiceParams() : gain(1.0f), pan(0.0f), pitch(1.0f) {}
+};
+
+// How the output is keeping time, measured from the callbacks.
+struct AudioTiming {
+    int buffer_frames;  // what the device asks for per callback
+    float callback_ms;  // average time between callbacks
+    float jitter_ms;    // recent largest distance from that average
+    float latency_ms;   // from a scheduled start to leaving the device
+};
+
+// Adds frames of float stereo into the mix. Runs on the audio thread.
+typedef void (*MixerSourceFn)(float* mix, int frames, void* userdata);
+
+// Call after Mix_OpenAudio.
+bool audio_mixer_init();
+void audio_mixer_shutdown();
+bool audio_mixer_ready();
+const char* audio_mixer_isa();
+
+int audio_mixer_rate();
+// The first output frame the callback has not mixed yet, counted from
+// audio_mixer_init.
+Uint64 audio_mixer_next_frame();
+// For sources: the first frame of the block being mixed.
+Uint64 audio_mixer_block_frame();
+// The output frame for a moment given as a performance counter value,
+// placed a little over one device buffer ahead so it is still to be
+// mixed. Moments a given time apart get frames the same time apart; ones
+// already too late get the next frame to be mixed.
+Uint64 audio_mixer_frame_at(Uint64 counter);
+// Call once per frame before scripts run. Everything started during the
+// frame is stamped with its beginning, smoothed against the frame rate,
+// so where in the frame a script runs does not move its sounds.
+void audio_mixer_begin_tick();
+Uint64 audio_mixer_tick_frame();
+AudioTiming audio_mixer_timing();
+
+// Only the first count voices are mixed.
+void audio_mixer_set_voice_count(int count);
+
+// A voice plays with the product of both gains and pitches and the sum of
+// the pans: sound is fixed for the play, effects can change while it runs.
+// It starts on output frame start, or at once if that has passed.
+bool audio_mixer_play(int voice, const Mix_Chunk* chunk, const VoiceParams& sound, const VoiceParams& effects,
+                      Uint64 start);
+void audio_mixer_set_effects(int voice, const VoiceParams& effects);
+void audio_mixer_stop_all();
+// Never waits on the callback, so it is cheap to ask about every voice.
+bool audio_mixer_voice_playing(int voice);
+// Stops every voice playing chunk and waits until the callback cannot be
+// reading it; call before freeing it.
+void audio_mixer_release(const Mix_Chunk* chunk);
+
+void audio_mixer_add_source(MixerSourceFn fn, void* userdata);
+// Returns once the callback will not call fn again.
+void audio_mixer_remove_source(MixerSourceFn fn, void* userdata);
+
+// mix[i] += src[i] * gain for frames of float stereo, with the left and
+// right gains moving by dl and dr each frame. For use by sources.
+void audio_mixer_accumulate(float* mix, const float* src, int frames, float gl, float gr, float dl, float dr);
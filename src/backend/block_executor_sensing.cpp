@@ -1,5 +1,6 @@
 #include "block_executor_sensing.h"
 #include "sensing.h"
+#include "sprite_grid.h"
 #include "operators.h"
 #include "runtime.h"
 #include "../utils/logger.h"
@@ -28,6 +29,12 @@ bool execute_sensing_block(Block* block, ExecutionContext& ctx) {
             ctx.lastResult = ctx.lastCondition ? 1.0f : 0.0f;
             return true;
         }
+        case SENSE_TOUCHING_SPRITE: {
+            std::string target = block->args.empty() ? "" : block->args[0];
+            ctx.lastCondition = sprite_grid_touching(*ctx.sprite, target);
+            ctx.lastResult = ctx.lastCondition ? 1.0f : 0.0f;
+            return true;
+        }
         case SENSE_MOUSE_DOWN: {
             int mx, my;
             Uint32 buttons = SDL_GetMouseState(&mx, &my);
@@ -11,13 +11,13 @@ void execute_play_sound(Block* block, Sprite& sprite) {
     }
 
     log_info("Playing sound " + sound_name);
-    play_sound(sound_name, sprite.volume);
+    play_sound(sound_name, sprite);
 }
 
 void execute_stop_all_sounds(Block* block, Sprite& sprite) {
     if (!block) return;
     log_info("Stopping all sounds");
-    sound_cleanup();
+    stop_all_sounds();
 }
 
 void execute_change_volume(Block* block, Sprite& sprite) {
@@ -33,6 +33,7 @@ void execute_change_volume(Block* block, Sprite& sprite) {
     if (sprite.volume > 100) sprite.volume = 100;
 
     set_sound_volume(sprite.volume);
+    sound_apply_sprite_effects(sprite);
     log_info("Volume changed by " + std::to_string((int)delta) + " -> " + std::to_string((int)sprite.volume));
 }
 
@@ -49,5 +50,37 @@ void execute_set_volume(Block* block, Sprite& sprite) {
 
     sprite.volume = vol;
     set_sound_volume(sprite.volume);
+    sound_apply_sprite_effects(sprite);
     log_info("Volume set to " + std::to_string((int)sprite.volume));
-}
\ No newline at end of file
+}
+
+void execute_sound_effect(Block* block, Sprite& sprite) {
+    if (!block) return;
+
+    float value = 0.0f;
+    if (!block->args.empty()) {
+        value = (float)atof(block->args[0].c_str());
+    }
+
+    switch (block->type) {
+        case CMD_CHANGE_PITCH_EFFECT: sprite.pitchEffect += value; break;
+        case CMD_SET_PITCH_EFFECT:    sprite.pitchEffect = value; break;
+        case CMD_CHANGE_PAN_EFFECT:   sprite.panEffect += value; break;
+        case CMD_SET_PAN_EFFECT:      sprite.panEffect = value; break;
+        case CMD_CLEAR_SOUND_EFFECTS:
+            sprite.pitchEffect = 0.0f;
+            sprite.panEffect = 0.0f;
+            break;
+        default: return;
+    }
+
+    // Scratch's limits: three octaves either way, full left to full right.
+    if (sprite.pitchEffect < -360.0f) sprite.pitchEffect = -360.0f;
+    if (sprite.pitchEffect > 360.0f) sprite.pitchEffect = 360.0f;
+    if (sprite.panEffect < -100.0f) sprite.panEffect = -100.0f;
+    if (sprite.panEffect > 100.0f) sprite.panEffect = 100.0f;
+
+    sound_apply_sprite_effects(sprite);
+    log_info("Sound effects: pitch " + std::to_string((int)sprite.pitchEffect) +
+             ", pan " + std::to_string((int)sprite.panEffect));
+}
@@ -0,0 +1,144 @@
+#include "block_pool.h"
+#include "../utils/logger.h"
+#include <algorithm>
+
+static const uint32_t NO_SLOT = UINT32_MAX;
+
+BlockPool::~BlockPool() {
+    for (Block* slab : slabs) {
+        delete[] slab;
+    }
+    for (BlockLayout* slab : layout_slabs) {
+        delete[] slab;
+    }
+}
+
+// Back to a fresh block; the slot keeps its layout entry.
+static void reset_slot(Block& b) {
+    b = Block();
+    *b.layout = BlockLayout();
+}
+
+// A block from another pool can carry a slot number that is in range
+// here, so the slot is only trusted if it leads back to the same block.
+static uint32_t slot_of(const BlockPool& pool, const Block* b) {
+    if (!b || b->slot >= pool.alive.size()) return NO_SLOT;
+    const Block* at = &pool.slabs[b->slot / BLOCK_SLAB_SIZE][b->slot % BLOCK_SLAB_SIZE];
+    return at == b ? b->slot : NO_SLOT;
+}
+
+static void grow(BlockPool& pool) {
+    uint32_t base = (uint32_t)(pool.slabs.size() * BLOCK_SLAB_SIZE);
+    Block* slab = new Block[BLOCK_SLAB_SIZE];
+    BlockLayout* layouts = new BlockLayout[BLOCK_SLAB_SIZE];
+    for (int i = 0; i < BLOCK_SLAB_SIZE; i++) {
+        slab[i].layout = &layouts[i];
+        slab[i].slot = base + i;
+    }
+    pool.slabs.push_back(slab);
+    pool.layout_slabs.push_back(layouts);
+    pool.generations.resize(base + BLOCK_SLAB_SIZE, 0);
+    pool.alive.resize(base + BLOCK_SLAB_SIZE, 0);
+    pool.z_stamps.resize(base + BLOCK_SLAB_SIZE, 0);
+
+    // Pushed in reverse so the lowest slot is handed out first and live
+    // blocks stay packed toward the front of the slab.
+    for (int i = BLOCK_SLAB_SIZE - 1; i >= 0; i--) {
+        pool.free_slots.push_back(base + i);
+    }
+}
+
+Block* block_pool_alloc(BlockPool& pool, int id) {
+    if (pool.free_slots.empty()) {
+        grow(pool);
+    }
+
+    uint32_t slot = pool.free_slots.back();
+    pool.free_slots.pop_back();
+
+    pool.alive[slot] = 1;
+    pool.z_stamps[slot] = ++pool.z_counter;
+    pool.order.push_back(slot);
+
+    Block& b = block_pool_slot(pool, slot);
+    reset_slot(b);
+    b.id = id;
+    // Ids come from one counter, so a clash is a bug; keep the first block
+    // findable rather than silently pointing its id elsewhere.
+    bool fresh = pool.by_id.emplace(id, slot).second;
+    SDL_assert(fresh);
+    if (!fresh) log_error("Duplicate block id #" + std::to_string(id));
+    return &b;
+}
+
+static void release_slot(BlockPool& pool, uint32_t slot) {
+    Block& b = block_pool_slot(pool, slot);
+    auto it = pool.by_id.find(b.id);
+    if (it != pool.by_id.end() && it->second == slot) {
+        pool.by_id.erase(it);
+    }
+
+    reset_slot(b);
+    pool.alive[slot] = 0;
+    pool.generations[slot]++;
+    pool.free_slots.push_back(slot);
+}
+
+void block_pool_free(BlockPool& pool, Block* b) {
+    std::vector<Block*> one(1, b);
+    block_pool_free_many(pool, one);
+}
+
+void block_pool_free_many(BlockPool& pool, const std::vector<Block*>& victims) {
+    if (victims.empty()) return;
+
+    int freed = 0;
+    for (Block* b : victims) {
+        uint32_t slot = slot_of(pool, b);
+        if (slot == NO_SLOT || !pool.alive[slot]) continue;
+        release_slot(pool, slot);
+        freed++;
+    }
+
+    if (freed == 0) return;
+
+    // One compaction pass over the draw order instead of an erase per block.
+    pool.order.erase(std::remove_if(pool.order.begin(), pool.order.end(),
+                                    [&pool](uint32_t s) { return !pool.alive[s]; }),
+                     pool.order.end());
+}
+
+Block* block_pool_get(BlockPool& pool, BlockHandle h) {
+    if (h.index >= pool.alive.size()) return nullptr;
+    if (!pool.alive[h.index] || pool.generations[h.index] != h.generation) return nullptr;
+    return &block_pool_slot(pool, h.index);
+}
+
+Block* block_pool_find(BlockPool& pool, int id) {
+    auto it = pool.by_id.find(id);
+    if (it == pool.by_id.end()) return nullptr;
+    return &block_pool_slot(pool, it->second);
+}
+
+BlockHandle block_pool_handle(const BlockPool& pool, const Block* b) {
+    uint32_t slot = slot_of(pool, b);
+    if (slot == NO_SLOT || !pool.alive[slot]) return BlockHandle();
+    return BlockHandle(slot, pool.generations[slot]);
+}
+
+void block_pool_bring_to_front(BlockPool& pool, Block* b) {
+    uint32_t slot = slot_of(pool, b);
+    if (slot == NO_SLOT) return;
+
+    auto it = std::find(pool.order.begin(), pool.order.end(), slot);
+    if (it != pool.order.end()) {
+        std::rotate(it, it + 1, pool.order.end());
+    }
+    pool.z_stamps[slot] = ++pool.z_counter;
+}
+
+uint32_t block_pool_z(const BlockPool& pool, const Block* b) {
+    uint32_t slot = slot_of(pool, b);
+    if (slot == NO_SLOT) return 0;
+    return pool.z_stamps[slot];
+}
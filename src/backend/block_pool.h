@@ -0,0 +1,77 @@
+#pragma once
+#include "../common/definitions.h"
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+// Blocks live in fixed-size slabs so their addresses never move while the
+// editor and runtimes hold raw Block* links. Slots are recycled through a
+// free list; every reuse bumps the slot generation so stale handles fail.
+// Each block slab has a layout slab beside it holding the editor-only
+// fields for the same slots.
+
+const int BLOCK_SLAB_SIZE = 256;
+
+struct BlockHandle {
+    uint32_t index;
+    uint32_t generation;
+
+    BlockHandle() : index(UINT32_MAX), generation(0) {}
+    BlockHandle(uint32_t i, uint32_t g) : index(i), generation(g) {}
+};
+
+struct BlockPool {
+    std::vector<Block*> slabs;
+    std::vector<BlockLayout*> layout_slabs;
+    std::vector<uint32_t> generations;
+    std::vector<uint8_t> alive;
+    std::vector<uint32_t> free_slots;
+    std::vector<uint32_t> order;            // live slots, back-to-front draw order
+    std::unordered_map<int, uint32_t> by_id;
+    std::vector<uint32_t> z_stamps;         // higher = drawn later (on top)
+    uint32_t z_counter = 0;
+
+    template <typename BlockT, typename PoolT>
+    struct basic_iterator {
+        PoolT* pool;
+        const uint32_t* pos;
+
+        BlockT& operator*() const { return pool->slabs[*pos / BLOCK_SLAB_SIZE][*pos % BLOCK_SLAB_SIZE]; }
+        BlockT* operator->() const { return &**this; }
+        basic_iterator& operator++() { ++pos; return *this; }
+        basic_iterator& operator--() { --pos; return *this; }
+        bool operator==(const basic_iterator& o) const { return pos == o.pos; }
+        bool operator!=(const basic_iterator& o) const { return pos != o.pos; }
+    };
+
+    typedef basic_iterator<Block, BlockPool> iterator;
+    typedef basic_iterator<const Block, const BlockPool> const_iterator;
+
+    BlockPool() {}
+    ~BlockPool();
+    BlockPool(const BlockPool&) = delete;
+    BlockPool& operator=(const BlockPool&) = delete;
+
+    iterator begin() { return iterator{this, order.data()}; }
+    iterator end() { return iterator{this, order.data() + order.size()}; }
+    const_iterator begin() const { return const_iterator{this, order.data()}; }
+    const_iterator end() const { return const_iterator{this, order.data() + order.size()}; }
+
+    size_t size() const { return order.size(); }
+    bool empty() const { return order.empty(); }
+};
+
+Block* block_pool_alloc(BlockPool& pool, int id);
+void block_pool_free(BlockPool& pool, Block* b);
+void block_pool_free_many(BlockPool& pool, const std::vector<Block*>& victims);
+
+inline Block& block_pool_slot(BlockPool& pool, uint32_t index) {
+    return pool.slabs[index / BLOCK_SLAB_SIZE][index % BLOCK_SLAB_SIZE];
+}
+
+Block* block_pool_get(BlockPool& pool, BlockHandle h);
+Block* block_pool_find(BlockPool& pool, int id);
+BlockHandle block_pool_handle(const BlockPool& pool, const Block* b);
+
+void block_pool_bring_to_front(BlockPool& pool, Block* b);
+uint32_t block_pool_z(const BlockPool& pool, const Block* b);
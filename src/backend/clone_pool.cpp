@@ -0,0 +1,172 @@
+#include "clone_pool.h"
+#include "sprite_set.h"
+#include "sprite_grid.h"
+#include "../utils/logger.h"
+
+struct CloneSlot {
+    Sprite sprite;
+    SpriteEntry* owner;
+    // Neighbours in the owner's clone list; next doubles as the free list.
+    int prev;
+    int next;
+    bool alive;
+    bool dying;
+};
+
+static std::vector<CloneSlot> g_slots;
+static int g_free_head = -1;
+static bool g_full_warned = false;
+
+static std::vector<int> g_spawned;
+static std::vector<int> g_dying;
+
+void clone_pool_init() {
+    if (!g_slots.empty()) return;
+
+    g_slots.resize(CLONE_POOL_CAPACITY);
+    for (int i = 0; i < CLONE_POOL_CAPACITY; i++) {
+        g_slots[i].owner = nullptr;
+        g_slots[i].prev = -1;
+        g_slots[i].next = i + 1 < CLONE_POOL_CAPACITY ? i + 1 : -1;
+        g_slots[i].alive = false;
+        g_slots[i].dying = false;
+        g_slots[i].sprite.cloneSlot = i;
+    }
+    g_free_head = 0;
+    g_spawned.reserve(CLONE_POOL_CAPACITY);
+    g_dying.reserve(CLONE_POOL_CAPACITY);
+}
+
+static CloneSlot* slot_of(const Sprite* sprite) {
+    if (!sprite || sprite->cloneSlot < 0 || sprite->cloneSlot >= (int)g_slots.size()) return nullptr;
+    CloneSlot* slot = &g_slots[sprite->cloneSlot];
+    if (&slot->sprite != sprite || !slot->alive) return nullptr;
+    return slot;
+}
+
+static void release(int index) {
+    CloneSlot& slot = g_slots[index];
+    SpriteEntry* owner = slot.owner;
+
+    if (slot.prev >= 0) g_slots[slot.prev].next = slot.next;
+    else owner->clone_head = slot.next;
+    if (slot.next >= 0) g_slots[slot.next].prev = slot.prev;
+    else owner->clone_tail = slot.prev;
+
+    sprite_grid_remove(&slot.sprite);
+    slot.sprite.sayText.clear();
+    slot.owner = nullptr;
+    slot.alive = false;
+    slot.dying = false;
+    slot.prev = -1;
+    slot.next = g_free_head;
+    g_free_head = index;
+    g_full_warned = false;
+}
+
+Sprite* clone_pool_create(Sprite* parent) {
+    if (!parent) return nullptr;
+    clone_pool_init();
+
+    SpriteEntry* owner = clone_pool_owner(parent);
+    if (!owner) owner = sprite_set_at(sprite_set_index_of(parent));
+    if (!owner) return nullptr;
+
+    if (g_free_head < 0) {
+        if (!g_full_warned) {
+            log_warning("Clone limit of " + std::to_string(CLONE_POOL_CAPACITY) + " reached");
+            g_full_warned = true;
+        }
+        return nullptr;
+    }
+
+    int index = g_free_head;
+    CloneSlot& slot = g_slots[index];
+    g_free_head = slot.next;
+
+    // Copy-assigning into the recycled sprite keeps the vectors' and
+    // strings' capacity, so a warm slot does not touch the heap.
+    slot.sprite = *parent;
+    slot.sprite.cloneSlot = index;
+    slot.sprite.sayText.clear();
+    slot.sprite.sayDuration = -1.0f;
+    slot.sprite.penMoved = false;
+
+    slot.owner = owner;
+    slot.alive = true;
+    slot.dying = false;
+    slot.prev = owner->clone_tail;
+    slot.next = -1;
+    if (owner->clone_tail >= 0) g_slots[owner->clone_tail].next = index;
+    else owner->clone_head = index;
+    owner->clone_tail = index;
+
+    g_spawned.push_back(index);
+    return &slot.sprite;
+}
+
+bool clone_pool_delete(Sprite* clone) {
+    CloneSlot* slot = slot_of(clone);
+    if (!slot) return false;
+    if (slot->dying) return true;
+
+    slot->dying = true;
+    sprite_grid_remove(clone);
+    g_dying.push_back(clone->cloneSlot);
+    return true;
+}
+
+bool clone_pool_is_dying(const Sprite* sprite) {
+    CloneSlot* slot = slot_of(sprite);
+    return slot && slot->dying;
+}
+
+void clone_pool_collect() {
+    for (int index : g_dying) {
+        if (g_slots[index].alive) release(index);
+    }
+    g_dying.clear();
+}
+
+void clone_pool_take_spawned(std::vector<Sprite*>& out) {
+    for (int index : g_spawned) {
+        CloneSlot& slot = g_slots[index];
+        if (slot.alive && !slot.dying) out.push_back(&slot.sprite);
+    }
+    g_spawned.clear();
+}
+
+void clone_pool_delete_owner(SpriteEntry* owner) {
+    while (owner->clone_head >= 0) release(owner->clone_head);
+}
+
+void clone_pool_clear() {
+    for (int i = 0; i < (int)g_slots.size(); i++) {
+        if (g_slots[i].alive) release(i);
+    }
+    g_spawned.clear();
+    g_dying.clear();
+}
+
+SpriteEntry* clone_pool_owner(const Sprite* sprite) {
+    CloneSlot* slot = slot_of(sprite);
+    return slot ? slot->owner : nullptr;
+}
+
+Sprite* clone_pool_first(const SpriteEntry* owner) {
+    return owner->clone_head >= 0 ? &g_slots[owner->clone_head].sprite : nullptr;
+}
+
+Sprite* clone_pool_last(const SpriteEntry* owner) {
+    return owner->clone_tail >= 0 ? &g_slots[owner->clone_tail].sprite : nullptr;
+}
+
+Sprite* clone_pool_next(const Sprite* clone) {
+    CloneSlot* slot = slot_of(clone);
+    return slot && slot->next >= 0 ? &g_slots[slot->next].sprite : nullptr;
+}
+
+Sprite* clone_pool_prev(const Sprite* clone) {
+    CloneSlot* slot = slot_of(clone);
+    return slot && slot->prev >= 0 ? &g_slots[slot->prev].sprite : nullptr;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "../common/definitions.h"
+#include <vector>
+
+struct SpriteEntry;
+
+// Clones live in a fixed array of slots allocated once at startup. A freed
+// slot keeps its Sprite, so the next clone copied into it reuses the
+// costume, variable and say-text storage instead of allocating again.
+// Creating and deleting a clone are O(1).
+
+// Scratch refuses to make more than 300 clones at once; so do we.
+const int CLONE_POOL_CAPACITY = 300;
+
+void clone_pool_init();
+
+// Copies parent into a free slot and queues it for "when I start as a
+// clone". Returns nullptr when the pool is full.
+Sprite* clone_pool_create(Sprite* parent);
+
+// Takes the clone off the stage at once; its slot is reused only after
+// clone_pool_collect, once no runtime points at it. Returns false for
+// sprites that are not clones.
+bool clone_pool_delete(Sprite* clone);
+bool clone_pool_is_dying(const Sprite* sprite);
+void clone_pool_collect();
+
+// Clones created since the last call that are still alive.
+void clone_pool_take_spawned(std::vector<Sprite*>& out);
+
+// Drops clones right away. Callers must have stopped their runtimes.
+void clone_pool_delete_owner(SpriteEntry* owner);
+void clone_pool_clear();
+
+// The sprite whose scripts a clone runs, or nullptr for non-clones.
+SpriteEntry* clone_pool_owner(const Sprite* sprite);
+
+// Walks one sprite's clones oldest first; clone_pool_prev goes backwards
+// from clone_pool_last.
+Sprite* clone_pool_first(const SpriteEntry* owner);
+Sprite* clone_pool_last(const SpriteEntry* owner);
+Sprite* clone_pool_next(const Sprite* clone);
+Sprite* clone_pool_prev(const Sprite* clone);
@@ -0,0 +1,347 @@
+#include "collision.h"
+#include "../utils/logger.h"
+#include <algorithm>
+#include <cmath>
+
+static std::shared_ptr<const CollisionMask> build_mask(const Uint8* pixels, int pitch, int w, int h) {
+    auto mask = std::make_shared<CollisionMask>();
+    mask->width = w;
+    mask->height = h;
+    mask->words_per_row = (w + 63) / 64;
+    mask->bits.assign((size_t)mask->words_per_row * h, 0);
+    mask->row_first.assign(h, -1);
+    mask->row_last.assign(h, -1);
+
+    int minX = w, minY = h, maxX = -1, maxY = -1;
+    for (int y = 0; y < h; y++) {
+        const Uint8* row = pixels + (size_t)y * pitch;
+        uint64_t* out = &mask->bits[(size_t)y * mask->words_per_row];
+        for (int x = 0; x < w; x++) {
+            if (row[x * 4 + 3] >= COLLISION_ALPHA_THRESHOLD) {
+                out[x >> 6] |= 1ULL << (x & 63);
+            }
+        }
+
+        int first = -1, last = -1;
+        for (int j = 0; j < mask->words_per_row; j++) {
+            if (!out[j]) continue;
+            if (first < 0) first = j * 64 + __builtin_ctzll(out[j]);
+            last = j * 64 + 63 - __builtin_clzll(out[j]);
+        }
+        if (first < 0) continue;
+
+        mask->row_first[y] = (int16_t)first;
+        mask->row_last[y] = (int16_t)last;
+        minX = std::min(minX, first);
+        maxX = std::max(maxX, last);
+        minY = std::min(minY, y);
+        maxY = y;
+    }
+
+    if (maxX >= 0) mask->bounds = {minX, minY, maxX - minX + 1, maxY - minY + 1};
+    return mask;
+}
+
+std::shared_ptr<const CollisionMask> collision_mask_from_surface(SDL_Surface* surface) {
+    if (!surface || surface->w <= 0 || surface->h <= 0) return nullptr;
+    if (surface->w > INT16_MAX) {
+        log_warning("Collision mask: image too wide, falling back to box tests");
+        return nullptr;
+    }
+
+    SDL_Surface* rgba = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA32, 0);
+    if (!rgba) {
+        log_warning(std::string("Collision mask: cannot convert image: ") + SDL_GetError());
+        return nullptr;
+    }
+
+    SDL_LockSurface(rgba);
+    auto mask = build_mask((const Uint8*)rgba->pixels, rgba->pitch, rgba->w, rgba->h);
+    SDL_UnlockSurface(rgba);
+    SDL_FreeSurface(rgba);
+    return mask;
+}
+
+std::shared_ptr<const CollisionMask> collision_mask_from_texture(SDL_Renderer* renderer,
+                                                                 SDL_Texture* texture) {
+    if (!renderer || !texture) return nullptr;
+
+    int w = 0, h = 0;
+    SDL_QueryTexture(texture, nullptr, nullptr, &w, &h);
+    if (w <= 0 || h <= 0 || w > INT16_MAX) return nullptr;
+
+    SDL_Texture* scratch = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32,
+                                             SDL_TEXTUREACCESS_TARGET, w, h);
+    if (!scratch) return nullptr;
+
+    std::vector<Uint32> pixels((size_t)w * h);
+    SDL_BlendMode prevBlend;
+    SDL_GetTextureBlendMode(texture, &prevBlend);
+    SDL_Texture* prev = SDL_GetRenderTarget(renderer);
+
+    SDL_SetRenderTarget(renderer, scratch);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+    SDL_RenderClear(renderer);
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_NONE);
+    SDL_RenderCopy(renderer, texture, nullptr, nullptr);
+    int ok = SDL_RenderReadPixels(renderer, nullptr, SDL_PIXELFORMAT_RGBA32,
+                                  pixels.data(), w * 4);
+    SDL_SetTextureBlendMode(texture, prevBlend);
+    SDL_SetRenderTarget(renderer, prev);
+    SDL_DestroyTexture(scratch);
+
+    if (ok != 0) {
+        log_warning(std::string("Collision mask: cannot read texture: ") + SDL_GetError());
+        return nullptr;
+    }
+    return build_mask((const Uint8*)pixels.data(), w * 4, w, h);
+}
+
+const CollisionMask* sprite_collision_mask(const Sprite& sprite) {
+    int idx = sprite.currentCostumeIndex;
+    if (idx < 0 || idx >= (int)sprite.costumes.size()) return nullptr;
+
+    const Costume& costume = sprite.costumes[idx];
+    // The texture can be swapped without the index changing (the default
+    // image before costumes load), so only trust a mask that matches.
+    if (costume.texture != sprite.texture) return nullptr;
+    return costume.mask.get();
+}
+
+bool sprite_mask_placement(const Sprite& sprite, MaskPlacement* out) {
+    const CollisionMask* mask = sprite_collision_mask(sprite);
+    if (!mask || sprite.scale <= 0.0f) return false;
+
+    out->mask = mask;
+    out->cx = sprite.x;
+    out->cy = sprite.y;
+    out->scale = sprite.scale;
+    out->angle = sprite.angle;
+    return true;
+}
+
+// Affine map from mask pixel coordinates to stage coordinates.
+struct MaskTransform {
+    float ox, oy;   // stage position of mask point (0, 0)
+    float ux, uy;   // stage step per mask column
+    float vx, vy;   // stage step per mask row
+};
+
+static MaskTransform mask_transform(const MaskPlacement& p) {
+    float rad = p.angle * (float)M_PI / 180.0f;
+    float c = std::cos(rad) * p.scale;
+    float s = std::sin(rad) * p.scale;
+    float hw = p.mask->width / 2.0f;
+    float hh = p.mask->height / 2.0f;
+
+    MaskTransform t;
+    t.ux = c;
+    t.uy = s;
+    t.vx = -s;
+    t.vy = c;
+    t.ox = p.cx - hw * c + hh * s;
+    t.oy = p.cy - hw * s - hh * c;
+    return t;
+}
+
+static void stage_to_mask(const MaskPlacement& p, float x, float y, float* u, float* v) {
+    float rad = p.angle * (float)M_PI / 180.0f;
+    float c = std::cos(rad);
+    float s = std::sin(rad);
+    float dx = x - p.cx;
+    float dy = y - p.cy;
+    *u = (dx * c + dy * s) / p.scale + p.mask->width / 2.0f;
+    *v = (-dx * s + dy * c) / p.scale + p.mask->height / 2.0f;
+}
+
+static void grow(SDL_FRect& box, bool& empty, float x, float y) {
+    if (empty) {
+        box = {x, y, 0.0f, 0.0f};
+        empty = false;
+        return;
+    }
+    float right = std::max(box.x + box.w, x);
+    float bottom = std::max(box.y + box.h, y);
+    box.x = std::min(box.x, x);
+    box.y = std::min(box.y, y);
+    box.w = right - box.x;
+    box.h = bottom - box.y;
+}
+
+bool collision_mask_extents(const MaskPlacement& p, bool exact, SDL_FRect* out) {
+    const CollisionMask& m = *p.mask;
+    if (m.bounds.w <= 0) return false;
+
+    MaskTransform t = mask_transform(p);
+    SDL_FRect box = {0, 0, 0, 0};
+    bool empty = true;
+
+    auto corner = [&](float u, float v) {
+        grow(box, empty, t.ox + u * t.ux + v * t.vx, t.oy + u * t.uy + v * t.vy);
+    };
+
+    // Unrotated, the bounds already are the tightest box.
+    bool axisAligned = std::fmod(std::fabs(p.angle), 90.0f) == 0.0f;
+    if (!exact || axisAligned) {
+        float x0 = (float)m.bounds.x, x1 = (float)(m.bounds.x + m.bounds.w);
+        float y0 = (float)m.bounds.y, y1 = (float)(m.bounds.y + m.bounds.h);
+        corner(x0, y0);
+        corner(x1, y0);
+        corner(x0, y1);
+        corner(x1, y1);
+    } else {
+        // Every corner of the solid region's hull is the end of some row
+        // span, so the span ends are enough for an exact box.
+        for (int y = m.bounds.y; y < m.bounds.y + m.bounds.h; y++) {
+            if (m.row_first[y] < 0) continue;
+            float x0 = (float)m.row_first[y], x1 = (float)(m.row_last[y] + 1);
+            corner(x0, (float)y);
+            corner(x1, (float)y);
+            corner(x0, (float)(y + 1));
+            corner(x1, (float)(y + 1));
+        }
+    }
+
+    *out = box;
+    return !empty;
+}
+
+bool collision_mask_hit(const MaskPlacement& p, float x, float y) {
+    SDL_FRect box;
+    if (!collision_mask_extents(p, false, &box)) return false;
+    if (x < box.x || y < box.y || x > box.x + box.w || y > box.y + box.h) return false;
+
+    float u, v;
+    stage_to_mask(p, x, y, &u, &v);
+    return p.mask->test((int)std::floor(u), (int)std::floor(v));
+}
+
+// 64 columns of a row starting at column `bit`, which may lie outside the
+// mask; columns off either end read as clear.
+static uint64_t mask_word_at(const CollisionMask& m, int row, int bit) {
+    int k = bit >= 0 ? bit / 64 : -((-bit + 63) / 64);
+    int sh = bit - k * 64;
+    const uint64_t* words = &m.bits[(size_t)row * m.words_per_row];
+
+    uint64_t lo = (k >= 0 && k < m.words_per_row) ? words[k] : 0;
+    if (sh == 0) return lo;
+    uint64_t hi = (k + 1 >= 0 && k + 1 < m.words_per_row) ? words[k + 1] : 0;
+    return (lo >> sh) | (hi << (64 - sh));
+}
+
+static uint64_t column_range(int word, int first, int last) {
+    int lo = std::max(first, word * 64) - word * 64;
+    int hi = std::min(last, word * 64 + 63) - word * 64;
+    return (~0ULL << lo) & (~0ULL >> (63 - hi));
+}
+
+static float wrap_angle(float a) {
+    a = std::fmod(a, 360.0f);
+    return a < 0.0f ? a + 360.0f : a;
+}
+
+bool collision_masks_overlap(const MaskPlacement& a, const MaskPlacement& b) {
+    SDL_FRect boxA, boxB;
+    if (!collision_mask_extents(a, false, &boxA)) return false;
+    if (!collision_mask_extents(b, false, &boxB)) return false;
+
+    float ix0 = std::max(boxA.x, boxB.x);
+    float iy0 = std::max(boxA.y, boxB.y);
+    float ix1 = std::min(boxA.x + boxA.w, boxB.x + boxB.w);
+    float iy1 = std::min(boxA.y + boxA.h, boxB.y + boxB.h);
+    if (ix0 >= ix1 || iy0 >= iy1) return false;
+
+    const CollisionMask& ma = *a.mask;
+    const CollisionMask& mb = *b.mask;
+
+    // Rows of a that can reach the shared box.
+    float us[4], vs[4];
+    stage_to_mask(a, ix0, iy0, &us[0], &vs[0]);
+    stage_to_mask(a, ix1, iy0, &us[1], &vs[1]);
+    stage_to_mask(a, ix0, iy1, &us[2], &vs[2]);
+    stage_to_mask(a, ix1, iy1, &us[3], &vs[3]);
+    int u0 = std::max(ma.bounds.x, (int)std::floor(*std::min_element(us, us + 4)));
+    int u1 = std::min(ma.bounds.x + ma.bounds.w - 1, (int)std::floor(*std::max_element(us, us + 4)));
+    int v0 = std::max(ma.bounds.y, (int)std::floor(*std::min_element(vs, vs + 4)));
+    int v1 = std::min(ma.bounds.y + ma.bounds.h - 1, (int)std::floor(*std::max_element(vs, vs + 4)));
+    if (u0 > u1 || v0 > v1) return false;
+
+    // Same scale and rotation: b is a whole-pixel shift of a, so rows can be
+    // ANDed a word at a time.
+    if (std::fabs(a.scale - b.scale) < 1e-4f &&
+        std::fabs(wrap_angle(a.angle) - wrap_angle(b.angle)) < 1e-3f) {
+        float bu, bv;
+        stage_to_mask(a, b.cx, b.cy, &bu, &bv);
+        // Rounded the way sampling at a's pixel centres would land.
+        int dx = (int)std::ceil(bu - mb.width / 2.0f - 0.5f);
+        int dy = (int)std::ceil(bv - mb.height / 2.0f - 0.5f);
+
+        v0 = std::max(v0, dy);
+        v1 = std::min(v1, dy + mb.height - 1);
+        for (int v = v0; v <= v1; v++) {
+            if (ma.row_first[v] < 0 || mb.row_first[v - dy] < 0) continue;
+            int c0 = std::max({u0, (int)ma.row_first[v], mb.row_first[v - dy] + dx});
+            int c1 = std::min({u1, (int)ma.row_last[v], mb.row_last[v - dy] + dx});
+            if (c0 > c1) continue;
+
+            const uint64_t* rowA = &ma.bits[(size_t)v * ma.words_per_row];
+            for (int j = c0 >> 6; j <= c1 >> 6; j++) {
+                uint64_t wa = rowA[j] & column_range(j, c0, c1);
+                if (wa & mask_word_at(mb, v - dy, j * 64 - dx)) return true;
+            }
+        }
+        return false;
+    }
+
+    // Otherwise sample b under the solid pixels of a. The map from a's pixel
+    // centres to b's mask is affine, so each step is two adds.
+    MaskTransform ta = mask_transform(a);
+    float rad = b.angle * (float)M_PI / 180.0f;
+    float c = std::cos(rad) / b.scale;
+    float s = std::sin(rad) / b.scale;
+    float hwb = mb.width / 2.0f, hhb = mb.height / 2.0f;
+
+    auto to_b = [&](float u, float v, float* bu, float* bv) {
+        float dx = ta.ox + u * ta.ux + v * ta.vx - b.cx;
+        float dy = ta.oy + u * ta.uy + v * ta.vy - b.cy;
+        *bu = dx * c + dy * s + hwb;
+        *bv = -dx * s + dy * c + hhb;
+    };
+
+    float stepUx, stepUy;
+    {
+        float x0, y0, x1, y1;
+        to_b(0.0f, 0.0f, &x0, &y0);
+        to_b(1.0f, 0.0f, &x1, &y1);
+        stepUx = x1 - x0;
+        stepUy = y1 - y0;
+    }
+
+    for (int v = v0; v <= v1; v++) {
+        if (ma.row_first[v] < 0) continue;
+        int c0 = std::max(u0, (int)ma.row_first[v]);
+        int c1 = std::min(u1, (int)ma.row_last[v]);
+        if (c0 > c1) continue;
+
+        const uint64_t* rowA = &ma.bits[(size_t)v * ma.words_per_row];
+        for (int j = c0 >> 6; j <= c1 >> 6; j++) {
+            uint64_t wa = rowA[j] & column_range(j, c0, c1);
+            if (!wa) continue;
+
+            float bu, bv;
+            to_b(j * 64 + 0.5f, v + 0.5f, &bu, &bv);
+            uint64_t wb = 0;
+            for (uint64_t rest = wa; rest; rest &= rest - 1) {
+                int i = __builtin_ctzll(rest);
+                float su = bu + i * stepUx;
+                float sv = bv + i * stepUy;
+                if (su >= 0.0f && sv >= 0.0f &&
+                    mb.test((int)su, (int)sv)) {
+                    wb |= 1ULL << i;
+                }
+            }
+            if (wa & wb) return true;
+        }
+    }
+    return false;
+}
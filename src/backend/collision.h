@@ -0,0 +1,58 @@
+#pragma once
+#include "../common/definitions.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Pixels with at least this alpha count as solid for touching tests.
+const Uint8 COLLISION_ALPHA_THRESHOLD = 16;
+
+// 1-bit opacity mask of a costume image. Row y starts at word
+// y * words_per_row; bit i of word j is column j * 64 + i.
+struct CollisionMask {
+    int width;
+    int height;
+    int words_per_row;
+    std::vector<uint64_t> bits;
+    // Leftmost and rightmost solid column of each row, -1 when empty.
+    std::vector<int16_t> row_first;
+    std::vector<int16_t> row_last;
+    // Tight box around the solid pixels; empty when the image is clear.
+    SDL_Rect bounds;
+
+    CollisionMask() : width(0), height(0), words_per_row(0), bounds({0, 0, 0, 0}) {}
+
+    bool test(int x, int y) const {
+        if (x < 0 || y < 0 || x >= width || y >= height) return false;
+        return (bits[(size_t)y * words_per_row + (x >> 6)] >> (x & 63)) & 1;
+    }
+};
+
+// Where a mask sits on the stage: centred on (cx, cy), scaled, then rotated
+// clockwise by angle degrees, matching how draw_sprite places the costume.
+struct MaskPlacement {
+    const CollisionMask* mask;
+    float cx;
+    float cy;
+    float scale;
+    float angle;
+};
+
+// Built once per costume image; the pixels are not read again afterwards.
+std::shared_ptr<const CollisionMask> collision_mask_from_surface(SDL_Surface* surface);
+
+// Reads the texture back from the GPU. Meant for one-off rebuilds such as
+// after the costume editor, never per frame.
+std::shared_ptr<const CollisionMask> collision_mask_from_texture(SDL_Renderer* renderer,
+                                                                 SDL_Texture* texture);
+
+// Mask of the costume the sprite is showing, or nullptr when it has none.
+const CollisionMask* sprite_collision_mask(const Sprite& sprite);
+bool sprite_mask_placement(const Sprite& sprite, MaskPlacement* out);
+
+// Stage-space box around the placed mask's solid pixels. With exact set the
+// box is fitted to the per-row spans rather than to the rotated bounds.
+bool collision_mask_extents(const MaskPlacement& p, bool exact, SDL_FRect* out);
+
+bool collision_mask_hit(const MaskPlacement& p, float x, float y);
+bool collision_masks_overlap(const MaskPlacement& a, const MaskPlacement& b);
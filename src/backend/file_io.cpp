@@ -1,10 +1,10 @@
 #include "file_io.h"
 #include "memory.h"
+#include "sprite_set.h"
 #include "../utils/logger.h"
 #include "../frontend/block_utils.h"
 #include <fstream>
 #include <sstream>
-#include <map>
 #include <algorithm>
 #include <cstdlib>
 
@@ -40,6 +40,7 @@ std::string blocktype_to_string(BlockType type) {
 
         case SENSE_TOUCHING_MOUSE: return "SENSE_MOUSE";
         case SENSE_TOUCHING_EDGE: return "SENSE_EDGE";
+        case SENSE_TOUCHING_SPRITE: return "SENSE_TOUCHING_SPRITE";
         case SENSE_MOUSE_DOWN: return "SENSE_MOUSE_DOWN";
         case SENSE_MOUSE_X: return "SENSE_MOUSE_X";
         case SENSE_MOUSE_Y: return "SENSE_MOUSE_Y";
@@ -84,6 +85,18 @@ std::string blocktype_to_string(BlockType type) {
         case CMD_GOTO_MOUSE: return "GOTO_MOUSE";
         case CMD_IF_ON_EDGE_BOUNCE: return "IF_ON_EDGE_BOUNCE";
         case SENSE_DISTANCE_TO_MOUSE: return "SENSE_DISTANCE_MOUSE";
+        case CMD_CREATE_CLONE: return "CREATE_CLONE";
+        case CMD_CLONE_START: return "CLONE_START";
+        case CMD_DELETE_CLONE: return "DELETE_CLONE";
+        case CMD_CHANGE_PITCH_EFFECT: return "CHANGE_PITCH_EFFECT";
+        case CMD_SET_PITCH_EFFECT: return "SET_PITCH_EFFECT";
+        case CMD_CHANGE_PAN_EFFECT: return "CHANGE_PAN_EFFECT";
+        case CMD_SET_PAN_EFFECT: return "SET_PAN_EFFECT";
+        case CMD_CLEAR_SOUND_EFFECTS: return "CLEAR_SOUND_EFFECTS";
+        case CMD_PLAY_NOTE: return "PLAY_NOTE";
+        case CMD_REST: return "REST";
+        case CMD_SET_INSTRUMENT: return "SET_INSTRUMENT";
+        case CMD_SET_TEMPO: return "SET_TEMPO";
         case OP_ROUND: return "OP_ROUND";
         case OP_TAN: return "OP_TAN";
         case OP_ASIN: return "OP_ASIN";
@@ -129,6 +142,7 @@ BlockType string_to_blocktype(const std::string& str) {
 
     if (str == "SENSE_MOUSE") return SENSE_TOUCHING_MOUSE;
     if (str == "SENSE_EDGE") return SENSE_TOUCHING_EDGE;
+    if (str == "SENSE_TOUCHING_SPRITE") return SENSE_TOUCHING_SPRITE;
     if (str == "SENSE_MOUSE_DOWN") return SENSE_MOUSE_DOWN;
     if (str == "SENSE_MOUSE_X") return SENSE_MOUSE_X;
     if (str == "SENSE_MOUSE_Y") return SENSE_MOUSE_Y;
@@ -173,6 +187,18 @@ BlockType string_to_blocktype(const std::string& str) {
     if (str == "GOTO_MOUSE") return CMD_GOTO_MOUSE;
     if (str == "IF_ON_EDGE_BOUNCE") return CMD_IF_ON_EDGE_BOUNCE;
     if (str == "SENSE_DISTANCE_MOUSE") return SENSE_DISTANCE_TO_MOUSE;
+    if (str == "CREATE_CLONE") return CMD_CREATE_CLONE;
+    if (str == "CLONE_START") return CMD_CLONE_START;
+    if (str == "DELETE_CLONE") return CMD_DELETE_CLONE;
+    if (str == "CHANGE_PITCH_EFFECT") return CMD_CHANGE_PITCH_EFFECT;
+    if (str == "SET_PITCH_EFFECT") return CMD_SET_PITCH_EFFECT;
+    if (str == "CHANGE_PAN_EFFECT") return CMD_CHANGE_PAN_EFFECT;
+    if (str == "SET_PAN_EFFECT") return CMD_SET_PAN_EFFECT;
+    if (str == "CLEAR_SOUND_EFFECTS") return CMD_CLEAR_SOUND_EFFECTS;
+    if (str == "PLAY_NOTE") return CMD_PLAY_NOTE;
+    if (str == "REST") return CMD_REST;
+    if (str == "SET_INSTRUMENT") return CMD_SET_INSTRUMENT;
+    if (str == "SET_TEMPO") return CMD_SET_TEMPO;
     if (str == "OP_ROUND") return OP_ROUND;
     if (str == "OP_TAN") return OP_TAN;
     if (str == "OP_ASIN") return OP_ASIN;
@@ -193,8 +219,8 @@ static void save_block_recursive(std::ofstream& file, Block* b, int parentId, in
     file << "BLOCK "
          << b->id << " "
          << blocktype_to_string(b->type) << " "
-         << b->x << " " << b->y << " "
-         << b->width << " " << b->height << " "
+         << b->layout->x << " " << b->layout->y << " "
+         << b->layout->width << " " << b->layout->height << " "
          << parentId << " " << slot << " "
          << b->args.size();
 
@@ -213,13 +239,7 @@ static void save_block_recursive(std::ofstream& file, Block* b, int parentId, in
     save_block_recursive(file, b->next, b->id, 1);
 }
 
-bool save_project(const std::string& filename, const std::list<Block>& blocks, const Sprite& sprite) {
-    std::ofstream file(filename);
-    if (!file.is_open()) {
-        log_error("Cannot open file for writing: " + filename);
-        return false;
-    }
-
+static void save_sprite(std::ofstream& file, const BlockPool& blocks, const Sprite& sprite) {
     // 1. Save Sprite Data
     file << "SPRITE " 
          << sprite.x << " " 
@@ -233,7 +253,8 @@ bool save_project(const std::string& filename, const std::list<Block>& blocks, c
          << (int)sprite.penG << " "
          << (int)sprite.penB << " "
          << sprite.penSize << " "
-         << sprite.currentCostumeIndex << "\n";
+         << sprite.currentCostumeIndex << " "
+         << sprite.name.length() << " " << sprite.name << "\n";
 
     // 2. Save Variables
     for (const auto& var : sprite.variables) {
@@ -260,8 +281,8 @@ bool save_project(const std::string& filename, const std::list<Block>& blocks, c
         file << "BLOCK "
              << b.id << " "
              << blocktype_to_string(b.type) << " "
-             << b.x << " " << b.y << " "
-             << b.width << " " << b.height << " "
+             << b.layout->x << " " << b.layout->y << " "
+             << b.layout->width << " " << b.layout->height << " "
              << parentId << " " << slot << " "
              << b.args.size();
 
@@ -277,25 +298,81 @@ bool save_project(const std::string& filename, const std::list<Block>& blocks, c
             }
         }
     }
+}
+
+bool save_project(const std::string& filename) {
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        log_error("Cannot open file for writing: " + filename);
+        return false;
+    }
+
+    for (int i = 0; i < sprite_set_count(); i++) {
+        SpriteEntry* e = sprite_set_at(i);
+        save_sprite(file, e->blocks, e->sprite);
+    }
 
     file.close();
     log_success("Saved project to " + filename);
     return true;
 }
 
-bool load_project(const std::string& filename, std::list<Block>& blocks, Sprite& sprite, int& next_block_id) {
+struct PendingLinks {
+    std::vector<std::tuple<int, int, int>> links;
+    std::vector<std::tuple<int, int, int>> argLinks;
+};
+
+// Links are resolved once a sprite's section is complete, since a block
+// may refer to one written after it.
+static void resolve_links(BlockPool& blocks, PendingLinks& pending) {
+    for (auto& link : pending.links) {
+        int childId = std::get<0>(link);
+        int parentId = std::get<1>(link);
+        int slot = std::get<2>(link);
+
+        Block* child = block_pool_find(blocks, childId);
+        Block* parent = block_pool_find(blocks, parentId);
+        if (child && parent) {
+            child->parent = parent;
+            if (slot == 0) parent->inner = child;
+            else if (slot == 1) parent->next = child;
+        }
+    }
+
+    for (auto& link : pending.argLinks) {
+        int hostId = std::get<0>(link);
+        int slot = std::get<1>(link);
+        int childId = std::get<2>(link);
+
+        Block* host = block_pool_find(blocks, hostId);
+        Block* child = block_pool_find(blocks, childId);
+        if (host && child) {
+            if (slot >= (int)host->argBlocks.size()) {
+                host->argBlocks.resize(slot + 1, nullptr);
+            }
+            
+            host->argBlocks[slot] = child;
+            child->parent = host;
+            child->layout->is_snapped = true;
+        }
+    }
+
+    pending.links.clear();
+    pending.argLinks.clear();
+}
+
+bool load_project(const std::string& filename) {
     std::ifstream file(filename);
     if (!file.is_open()) {
         log_error("Cannot open file for reading: " + filename);
         return false;
     }
 
-    blocks.clear();
-    sprite.variables.clear();
+    sprite_set_clear();
     
-    std::map<int, Block*> idToPointer;
-    std::vector<std::tuple<int, int, int>> pendingLinks;
-    std::vector<std::tuple<int, int, int>> pendingArgLinks;
+    int maxId = 0;
+    SpriteEntry* cur = nullptr;
+    PendingLinks pending;
     std::string line;
     while (std::getline(file, line)) {
         std::stringstream ss(line);
@@ -303,6 +380,10 @@ bool load_project(const std::string& filename, std::list<Block>& blocks, Sprite&
         ss >> type;
 
         if (type == "SPRITE") {
+            if (cur) resolve_links(cur->blocks, pending);
+            cur = sprite_set_add("Cat");
+            Sprite& sprite = cur->sprite;
+
             int r, g, b;
             ss >> sprite.x >> sprite.y >> sprite.angle >> sprite.visible 
                >> sprite.scale >> sprite.volume >> sprite.isPenDown
@@ -311,11 +392,26 @@ bool load_project(const std::string& filename, std::list<Block>& blocks, Sprite&
             sprite.penR = (Uint8)r;
             sprite.penG = (Uint8)g;
             sprite.penB = (Uint8)b;
-        } 
-        else if (type == "VAR") {
+
+            // Older single-sprite files stop here.
+            size_t len;
+            if (ss >> len) {
+                ss.ignore(1);
+                std::string name(len, ' ');
+                ss.read(&name[0], len);
+                if (!name.empty()) sprite.name = name;
+            }
+            continue;
+        }
+
+        if (!cur && (type == "VAR" || type == "BLOCK" || type == "ARG_LINK")) {
+            cur = sprite_set_add("Cat");
+        }
+
+        if (type == "VAR") {
             std::string name, value;
             ss >> name >> value;
-            sprite.variables.push_back(Variable(name, value));
+            cur->sprite.variables.push_back(Variable(name, value));
         }
         else if (type == "BLOCK") {
             int id;
@@ -325,16 +421,14 @@ bool load_project(const std::string& filename, std::list<Block>& blocks, Sprite&
 
             ss >> id >> typeStr >> x >> y >> w >> h >> parentId >> slot >> argCount;
 
-            blocks.push_back(Block()); 
-            Block* b = &blocks.back();
+            Block* b = block_pool_alloc(cur->blocks, id);
             
-            b->id = id;
             b->type = string_to_blocktype(typeStr);
-            b->x = x;
-            b->y = y;
-            b->width = w;
-            b->height = h;
-            b->color = block_get_color(b->type);
+            b->layout->x = x;
+            b->layout->y = y;
+            b->layout->width = w;
+            b->layout->height = h;
+            b->layout->color = block_get_color(b->type);
             
             int expectedArgs = get_arg_count(b->type);
             if (expectedArgs > 0) b->argBlocks.resize(expectedArgs, nullptr);
@@ -349,61 +443,24 @@ bool load_project(const std::string& filename, std::list<Block>& blocks, Sprite&
                 b->args.push_back(arg);
             }
 
-            idToPointer[id] = b;
+            if (id > maxId) maxId = id;
             if (parentId != -1) {
-                pendingLinks.push_back({id, parentId, slot});
+                pending.links.push_back({id, parentId, slot});
             }
         }
         else if (type == "ARG_LINK") {
             int hostId, slot, childId;
             ss >> hostId >> slot >> childId;
-            pendingArgLinks.push_back({hostId, slot, childId});
-        }
-    }
-
-    for (auto& link : pendingLinks) {
-        int childId = std::get<0>(link);
-        int parentId = std::get<1>(link);
-        int slot = std::get<2>(link);
-
-        if (idToPointer.count(childId) && idToPointer.count(parentId)) {
-            Block* child = idToPointer[childId];
-            Block* parent = idToPointer[parentId];
-            
-            child->parent = parent;
-            if (slot == 0) parent->inner = child;
-            else if (slot == 1) parent->next = child;
-        }
-    }
-
-    for (auto& link : pendingArgLinks) {
-        int hostId = std::get<0>(link);
-        int slot = std::get<1>(link);
-        int childId = std::get<2>(link);
-
-        if (idToPointer.count(hostId) && idToPointer.count(childId)) {
-            Block* host = idToPointer[hostId];
-            Block* child = idToPointer[childId];
-            
-            if (slot >= (int)host->argBlocks.size()) {
-                host->argBlocks.resize(slot + 1, nullptr);
-            }
-            
-            host->argBlocks[slot] = child;
-            child->parent = host;
-            child->is_snapped = true;
+            pending.argLinks.push_back({hostId, slot, childId});
         }
     }
+    if (cur) resolve_links(cur->blocks, pending);
 
     file.close();
+
+    if (sprite_set_count() == 0) sprite_set_add("Cat");
     
-    if (!idToPointer.empty()) {
-        auto last = idToPointer.rbegin();
-        next_block_id = last->first + 1;
-        reset_block_counter(next_block_id);
-    } else {
-        next_block_id = 1;
-    }
+    reset_block_counter(maxId > 0 ? maxId + 1 : 1);
 
     log_success("Loaded project from " + filename);
     return true;
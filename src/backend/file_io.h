@@ -1,10 +1,13 @@
 #pragma once
 #include "../common/definitions.h"
 #include <string>
-#include <list>
+#include "block_pool.h"
 
-bool save_project(const std::string& filename, const std::list<Block>& blocks, const Sprite& sprite);
-bool load_project(const std::string& filename, std::list<Block>& blocks, Sprite& sprite, int& next_block_id);
+// Projects hold every sprite in the sprite set, each followed by its
+// variables and scripts. Loading replaces the whole set; costumes are not
+// stored, so the caller dresses the loaded sprites.
+bool save_project(const std::string& filename);
+bool load_project(const std::string& filename);
 
 std::string blocktype_to_string(BlockType type);
 BlockType string_to_blocktype(const std::string& str);
\ No newline at end of file
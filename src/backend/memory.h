@@ -1,10 +1,13 @@
 #pragma once
 #include "../common/definitions.h"
+#include "block_pool.h"
 
-Block* create_block(BlockType t);
-void delete_block(Block* b);
-void delete_chain(Block* b);
+void delete_block(BlockPool& pool, Block* b);
+void delete_chain(BlockPool& pool, Block* b);
 int count_blocks(Block* b);
+// Block ids come from this one counter for every sprite's pool, so ids
+// stay unique across the project.
 void reset_block_counter(int newValue = 1);
 int get_block_counter();
-void safe_delete_chain(Block* b, Block* parent_block);
+int take_block_id();
+void safe_delete_chain(BlockPool& pool, Block* b, Block* parent_block);
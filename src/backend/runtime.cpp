@@ -9,14 +9,28 @@
 #include "sensing.h"
 #include "block_executor_sensing.h"
 #include "block_executor_sound.h"
+#include "synth.h"
 #include "block_executor_looks.h"
 #include "custom_blocks.h"
+#include "clone_pool.h"
 #include "../frontend/pen.h"
 #include <cstdlib>
 #include <cmath>
 #include <ctime>
 #include "../frontend/block_utils.h"
 
+static void start_wait(Runtime* rt, float seconds) {
+    int ticks = (int)(seconds * rt->tickRate);
+    if (ticks < 1 && seconds > 0) ticks = 1;
+
+    rt->waitTicksRemaining = ticks;
+
+    rt->ticksSinceLastWait = 0;
+    for (size_t i = 0; i < rt->loopStack.size(); i++) {
+        rt->loopStack[i].ticksWithoutWait = 0;
+    }
+}
+
 float evaluate_block_argument(Runtime* rt, Block* host, int argIndex) {
     if (!host) return 0.0f;
 
@@ -639,16 +653,7 @@ void execute_block(Runtime* rt, Block* b, Stage* stage) {
 
         // Control:
         case CMD_WAIT: {
-            float seconds = evaluate_block_argument(rt, b, 0);
-            int ticks = (int)(seconds * rt->tickRate);
-            if (ticks < 1 && seconds > 0) ticks = 1;
-            
-            rt->waitTicksRemaining = ticks;
-
-            rt->ticksSinceLastWait = 0;
-            for (size_t i = 0; i < rt->loopStack.size(); i++) {
-                rt->loopStack[i].ticksWithoutWait = 0;
-            }
+            start_wait(rt, evaluate_block_argument(rt, b, 0));
             break;
         }
         case CMD_SAY: {
@@ -811,9 +816,7 @@ void execute_block(Runtime* rt, Block* b, Stage* stage) {
             break;
         }
         case CMD_PEN_CLEAR: {
-            if (stage && stage->renderer) {
-                pen_clear(stage->renderer);
-            }
+            pen_clear();
             log_info("Pen cleared");
             break;
         }
@@ -887,10 +890,49 @@ void execute_block(Runtime* rt, Block* b, Stage* stage) {
             execute_set_volume(b, *rt->targetSprite);
             break;
         }
+        case CMD_CHANGE_PITCH_EFFECT:
+        case CMD_SET_PITCH_EFFECT:
+        case CMD_CHANGE_PAN_EFFECT:
+        case CMD_SET_PAN_EFFECT:
+        case CMD_CLEAR_SOUND_EFFECTS: {
+            execute_sound_effect(b, *rt->targetSprite);
+            break;
+        }
+
+        // Music:
+        case CMD_PLAY_NOTE: {
+            float note = evaluate_block_argument(rt, b, 0);
+            float beats = evaluate_block_argument(rt, b, 1);
+            Sprite& sprite = *rt->targetSprite;
+            synth_play_note(&sprite, note, beats, sprite.instrument,
+                            sprite.volume / 100.0f, sprite.panEffect / 100.0f);
+            start_wait(rt, synth_beats_to_seconds(beats));
+            break;
+        }
+        case CMD_REST: {
+            float beats = evaluate_block_argument(rt, b, 0);
+            synth_rest(rt->targetSprite, beats);
+            start_wait(rt, synth_beats_to_seconds(beats));
+            break;
+        }
+        case CMD_SET_INSTRUMENT: {
+            int instrument = (int)evaluate_block_argument(rt, b, 0);
+            if (instrument < 1) instrument = 1;
+            if (instrument > SYNTH_INSTRUMENT_COUNT) instrument = SYNTH_INSTRUMENT_COUNT;
+            rt->targetSprite->instrument = instrument;
+            log_info(std::string("Instrument set to ") + synth_instrument_name(instrument));
+            break;
+        }
+        case CMD_SET_TEMPO: {
+            synth_set_tempo(evaluate_block_argument(rt, b, 0));
+            log_info("Tempo set to " + std::to_string((int)synth_get_tempo()) + " bpm");
+            break;
+        }
 
         // Sensing:
         case SENSE_TOUCHING_MOUSE:
         case SENSE_TOUCHING_EDGE:
+        case SENSE_TOUCHING_SPRITE:
         case SENSE_MOUSE_DOWN:
         case SENSE_MOUSE_X:
         case SENSE_MOUSE_Y:
@@ -1082,6 +1124,20 @@ void execute_block(Runtime* rt, Block* b, Stage* stage) {
             }
             break;
         }
+        case CMD_CREATE_CLONE: {
+            if (rt->targetSprite) clone_pool_create(rt->targetSprite);
+            break;
+        }
+        case CMD_DELETE_CLONE: {
+            // Ends this script; the scheduler drops the clone's other
+            // scripts before the slot is reused.
+            if (clone_pool_delete(rt->targetSprite)) {
+                rt->currentBlock = nullptr;
+                rt->loopStack.clear();
+                rt->state = RUNTIME_FINISHED;
+            }
+            break;
+        }
         case CMD_FOREVER: {
             if (b->inner) {
                 LoopContext ctx;
@@ -1,8 +1,57 @@
 #include "sensing.h"
+#include "collision.h"
 #include "../utils/logger.h"
 #include <cmath>
 
+// Box around what the sprite actually draws. Well inside the stage the
+// rotated bounds settle every edge test; only near an edge is the tighter
+// per-row fit worth computing.
+static SDL_FRect sprite_extents(const Sprite& sprite, const Stage& stage) {
+    SDL_FRect box = sprite_touch_bounds(sprite);
+    bool inside = box.x > stage.x && box.y > stage.y &&
+                  box.x + box.w < stage.x + stage.width &&
+                  box.y + box.h < stage.y + stage.height;
+
+    MaskPlacement p;
+    if (!inside && sprite_mask_placement(sprite, &p)) {
+        collision_mask_extents(p, true, &box);
+    }
+    return box;
+}
+
+SDL_FRect sprite_touch_bounds(const Sprite& sprite) {
+    MaskPlacement p;
+    SDL_FRect box;
+    if (sprite_mask_placement(sprite, &p)) {
+        if (collision_mask_extents(p, false, &box)) return box;
+        return {sprite.x, sprite.y, 0.0f, 0.0f};
+    }
+
+    float w = sprite.width * sprite.scale;
+    float h = sprite.height * sprite.scale;
+    return {sprite.x - w / 2.0f, sprite.y - h / 2.0f, w, h};
+}
+
+bool are_sprites_touching(const Sprite& a, const Sprite& b) {
+    if (!a.visible || !b.visible) return false;
+
+    MaskPlacement pa, pb;
+    if (sprite_mask_placement(a, &pa) && sprite_mask_placement(b, &pb)) {
+        return collision_masks_overlap(pa, pb);
+    }
+
+    SDL_FRect ra = sprite_touch_bounds(a);
+    SDL_FRect rb = sprite_touch_bounds(b);
+    return ra.x < rb.x + rb.w && rb.x < ra.x + ra.w &&
+           ra.y < rb.y + rb.h && rb.y < ra.y + ra.h;
+}
+
 bool is_sprite_touching_mouse(const Sprite& sprite, const Stage& stage, int mouseX, int mouseY) {
+    MaskPlacement p;
+    if (sprite_mask_placement(sprite, &p)) {
+        return collision_mask_hit(p, mouseX + 0.5f, mouseY + 0.5f);
+    }
+
     float halfW = (sprite.width * sprite.scale) / 2.0f;
     float halfH = (sprite.height * sprite.scale) / 2.0f;
 
@@ -15,30 +64,29 @@ bool is_sprite_touching_mouse(const Sprite& sprite, const Stage& stage, int mous
 }
 
 bool is_sprite_touching_edge(const Sprite& sprite, const Stage& stage) {
-    return is_sprite_touching_left_edge(sprite, stage)
-        || is_sprite_touching_right_edge(sprite, stage)
-        || is_sprite_touching_top_edge(sprite, stage)
-        || is_sprite_touching_bottom_edge(sprite, stage);
+    SDL_FRect box = sprite_extents(sprite, stage);
+    return box.x <= stage.x
+        || box.x + box.w >= stage.x + stage.width
+        || box.y <= stage.y
+        || box.y + box.h >= stage.y + stage.height;
 }
 
 bool is_sprite_touching_left_edge(const Sprite& sprite, const Stage& stage) {
-    float halfW = (sprite.width * sprite.scale) / 2.0f;
-    return (sprite.x - halfW) <= stage.x;
+    return sprite_extents(sprite, stage).x <= stage.x;
 }
 
 bool is_sprite_touching_right_edge(const Sprite& sprite, const Stage& stage) {
-    float halfW = (sprite.width * sprite.scale) / 2.0f;
-    return (sprite.x + halfW) >= (stage.x + stage.width);
+    SDL_FRect box = sprite_extents(sprite, stage);
+    return box.x + box.w >= stage.x + stage.width;
 }
 
 bool is_sprite_touching_top_edge(const Sprite& sprite, const Stage& stage) {
-    float halfH = (sprite.height * sprite.scale) / 2.0f;
-    return (sprite.y - halfH) <= stage.y;
+    return sprite_extents(sprite, stage).y <= stage.y;
 }
 
 bool is_sprite_touching_bottom_edge(const Sprite& sprite, const Stage& stage) {
-    float halfH = (sprite.height * sprite.scale) / 2.0f;
-    return (sprite.y + halfH) >= (stage.y + stage.height);
+    SDL_FRect box = sprite_extents(sprite, stage);
+    return box.y + box.h >= stage.y + stage.height;
 }
 
 void bounce_off_edge(Sprite& sprite, const Stage& stage) {
@@ -9,6 +9,9 @@ bool is_sprite_touching_left_edge(const Sprite& sprite, const Stage& stage);
 bool is_sprite_touching_right_edge(const Sprite& sprite, const Stage& stage);
 bool is_sprite_touching_top_edge(const Sprite& sprite, const Stage& stage);
 bool is_sprite_touching_bottom_edge(const Sprite& sprite, const Stage& stage);
+// Rotated bounds of the sprite's solid pixels (or its frame without a mask).
+SDL_FRect sprite_touch_bounds(const Sprite& sprite);
+bool are_sprites_touching(const Sprite& a, const Sprite& b);
 void bounce_off_edge(Sprite& sprite, const Stage& stage);
 void clamp_sprite_to_stage(Sprite& sprite, const Stage& stage);
 
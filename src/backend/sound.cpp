@@ -1,69 +1,143 @@
 #include "sound.h"
+#include "sound_loader.h"
+#include "sound_stream.h"
+#include "voice_pool.h"
+#include "audio_mixer.h"
+#include "sound_library.h"
+#include "synth.h"
+#include "sound_waveform.h"
 #include "../utils/logger.h"
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <cmath>
+
+// Device buffer in frames. The smaller one halves the delay twice over
+// but needs the callback to keep up on slower machines.
+const int SOUND_BUFFER_DEFAULT = 2048;
+const int SOUND_BUFFER_LOW_LATENCY = 512;
+const int SOUND_RATE = 44100;
 
 std::unordered_map<std::string, Mix_Chunk*> g_sounds;
-static int g_sound_volume = 128;
+static int g_sound_volume = 100;
+static bool g_low_latency = false;
 
 static std::vector<SoundItem> g_project_sounds;
-static std::vector<LibrarySound> g_library_sounds;
+// Library sounds loaded by a preview and not added to the project.
+static std::vector<std::string> g_previewed;
 
+// Loads in flight by sound name. A result whose ticket no longer matches
+// was superseded or removed and is dropped.
+static std::unordered_map<std::string, int> g_loading;
+// File behind each sound loaded or loading, so a new device can have them
+// all decoded again.
+static std::unordered_map<std::string, std::string> g_sound_paths;
+// Plays waiting on a load, at most one per sound with the latest effects.
+struct PendingPlay {
+    std::string name;
+    VoiceParams effects;
+    const void* owner;
+    int priority;
+};
+static std::vector<PendingPlay> g_pending_plays;
+static SoundWaitPolicy g_wait_policy = SOUND_WAIT_QUEUE;
+// Sounds played from their file instead of from g_sounds.
+static std::unordered_map<std::string, SoundStreamSource> g_stream_sources;
 
-bool sound_init() {
-    if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0) {
+static void start_sound(const std::string& name, const VoiceParams& effects, const void* owner, int priority,
+                        SoundWaitPolicy policy);
+
+// Voices read chunks directly, so they must let go before it is freed.
+static void free_chunk(Mix_Chunk* chunk) {
+    audio_mixer_release(chunk);
+    Mix_FreeChunk(chunk);
+}
+
+static VoiceParams sprite_effects(const Sprite& sprite) {
+    VoiceParams fx;
+    fx.gain = std::max(0.0f, std::min(sprite.volume, 100.0f)) / 100.0f;
+    // Scratch's units: 10 per semitone, 100 for full left or right.
+    fx.pitch = std::pow(2.0f, sprite.pitchEffect / 120.0f);
+    fx.pan = sprite.panEffect / 100.0f;
+    return fx;
+}
+
+// Opens the device and everything that mixes into it.
+static bool open_device() {
+    int buffer = g_low_latency ? SOUND_BUFFER_LOW_LATENCY : SOUND_BUFFER_DEFAULT;
+    if (Mix_OpenAudio(SOUND_RATE, MIX_DEFAULT_FORMAT, 2, buffer) < 0) {
         log_error("SDL_Mixer init failed: " + std::string(Mix_GetError()));
         return false;
     }
-    Mix_AllocateChannels(16);
+    if (audio_mixer_init()) {
+        log_info(std::string("Audio mixer using ") + audio_mixer_isa() + " kernels");
+    } else {
+        log_error("Audio mixer needs 16-bit or float output, sound effects disabled");
+    }
+    voice_pool_init();
+    if (!sound_stream_init()) {
+        log_warning("Sound streaming unavailable, long sounds will be decoded whole");
+    }
+    if (synth_init()) {
+        log_info(std::string("Synth using ") + synth_isa() + " kernels");
+    } else {
+        log_warning("Synth unavailable, music blocks will be silent");
+    }
+    return true;
+}
+
+static void close_device() {
+    sound_stream_shutdown();
+    synth_shutdown();
+    voice_pool_shutdown();
+    audio_mixer_shutdown();
+    Mix_CloseAudio();
+}
+
+bool sound_init() {
+    if (!open_device()) return false;
+    if (!sound_loader_init()) {
+        log_warning("Sound loader thread unavailable, loading on the main thread");
+    }
+    if (sound_waveform_init()) {
+        log_info(std::string("Waveform thumbnails using ") + sound_waveform_isa() + " kernels");
+    } else {
+        log_warning("Waveform thread unavailable, thumbnails computed on the main thread");
+    }
     log_info("Sound engine initialized");
-    
-    g_library_sounds.clear();
-    
-    auto addLib = [&](const char* n, const char* c, const char* p) {
-        LibrarySound ls;
-        ls.name = n;
-        ls.category = c;
-        ls.filepath = p;
-        g_library_sounds.push_back(ls);
-    };
-
-    addLib("meow", "Animals", "../assets/sounds/library/meow.wav");
-    addLib("dog bark", "Animals", "../assets/sounds/library/dog_bark.wav");
-    addLib("bird", "Animals", "../assets/sounds/library/bird.wav");
-    addLib("horse", "Animals", "../assets/sounds/library/horse.wav");
-    addLib("pop", "Effects", "../assets/sounds/library/pop.wav");
-    addLib("boing", "Effects", "../assets/sounds/library/boing.wav");
-    addLib("whoosh", "Effects", "../assets/sounds/library/whoosh.wav");
-    addLib("splash", "Effects", "../assets/sounds/library/splash.wav");
-    addLib("laser", "Effects", "../assets/sounds/library/laser.wav");
-    addLib("drum", "Music", "../assets/sounds/library/drum.wav");
-    addLib("piano", "Music", "../assets/sounds/library/piano.wav");
-    addLib("guitar", "Music", "../assets/sounds/library/guitar.wav");
-    addLib("bell", "Music", "../assets/sounds/library/bell.wav");
-    addLib("laugh", "Human", "../assets/sounds/library/laugh.wav");
-    addLib("cheer", "Human", "../assets/sounds/library/cheer.wav");
 
+    sound_library_init();
     return true;
 }
 
 void sound_cleanup() {
+    // Stops a library scan first, so shutting the loader waits one file at most.
+    sound_library_clear();
+    sound_loader_shutdown();
+    sound_waveform_shutdown();
+    close_device();
+    g_loading.clear();
+    g_sound_paths.clear();
+    g_pending_plays.clear();
+    g_stream_sources.clear();
+    g_previewed.clear();
+
     for (auto& pair : g_sounds) {
         if (pair.second) {
-            Mix_FreeChunk(pair.second);
+            free_chunk(pair.second);
         }
     }
     g_sounds.clear();
     g_project_sounds.clear();
-    g_library_sounds.clear();
     Mix_Quit();
     log_info("Sound engine cleaned up");
 }
 
 bool sound_load(const std::string& name, const std::string& path) {
+    g_loading.erase(name);
+    g_stream_sources.erase(name);
     if (g_sounds.find(name) != g_sounds.end()) {
-        Mix_FreeChunk(g_sounds[name]);
+        free_chunk(g_sounds[name]);
     }
 
     Mix_Chunk* chunk = Mix_LoadWAV(path.c_str());
@@ -73,21 +147,218 @@ bool sound_load(const std::string& name, const std::string& path) {
     }
 
     g_sounds[name] = chunk;
+    g_sound_paths[name] = path;
     log_info("Loaded sound: " + name);
     return true;
 }
 
 void sound_unload(const std::string& name) {
+    g_loading.erase(name);
+    g_sound_paths.erase(name);
+    g_stream_sources.erase(name);
+    for (size_t i = 0; i < g_pending_plays.size(); i++) {
+        if (g_pending_plays[i].name == name) {
+            g_pending_plays.erase(g_pending_plays.begin() + i);
+            break;
+        }
+    }
+
     auto it = g_sounds.find(name);
     if (it != g_sounds.end()) {
         if (it->second) {
-            Mix_FreeChunk(it->second);
+            free_chunk(it->second);
         }
         g_sounds.erase(it);
     }
 }
 
-void play_sound(const std::string& name, int volume) {
+void sound_load_async(const std::string& name, const std::string& path) {
+    g_loading[name] = sound_loader_request(name, path);
+    g_sound_paths[name] = path;
+}
+
+static float chunk_duration(const Mix_Chunk* chunk) {
+    int freq = 0, channels = 0;
+    Uint16 format = 0;
+    if (!chunk || !Mix_QuerySpec(&freq, &format, &channels)) return 0.0f;
+    int frame_bytes = (SDL_AUDIO_BITSIZE(format) / 8) * channels;
+    if (freq <= 0 || frame_bytes <= 0) return 0.0f;
+    return (float)chunk->alen / (float)(frame_bytes * freq);
+}
+
+int sound_update() {
+    voice_pool_update();
+
+    int finished = sound_library_update() ? 1 : 0;
+    SoundLoadResult r;
+    while (sound_loader_poll(&r)) {
+        auto loading = g_loading.find(r.name);
+        if (loading == g_loading.end() || loading->second != r.ticket) {
+            if (r.chunk) Mix_FreeChunk(r.chunk);
+            continue;
+        }
+        g_loading.erase(loading);
+        finished++;
+
+        SoundItem* item = sound_project_get_by_name(r.name);
+        if (r.streamed) {
+            auto old = g_sounds.find(r.name);
+            if (old != g_sounds.end()) {
+                if (old->second) free_chunk(old->second);
+                g_sounds.erase(old);
+            }
+            g_stream_sources[r.name] = r.stream;
+            if (item) {
+                item->loaded = true;
+                item->state = SOUND_READY;
+                item->duration = sound_stream_duration(r.stream);
+            }
+            log_info("Streaming sound: " + r.name);
+        } else if (!r.chunk) {
+            log_error("Failed to load sound: " + r.name + " - " + r.error);
+            if (item) item->state = SOUND_FAILED;
+        } else {
+            auto old = g_sounds.find(r.name);
+            if (old != g_sounds.end() && old->second) free_chunk(old->second);
+            g_sounds[r.name] = r.chunk;
+            g_stream_sources.erase(r.name);
+            if (item) {
+                item->loaded = true;
+                item->state = SOUND_READY;
+                item->duration = chunk_duration(r.chunk);
+            }
+            log_info("Loaded sound: " + r.name);
+        }
+
+        for (size_t i = 0; i < g_pending_plays.size(); i++) {
+            if (g_pending_plays[i].name != r.name) continue;
+            PendingPlay play = g_pending_plays[i];
+            g_pending_plays.erase(g_pending_plays.begin() + i);
+            if (r.chunk || r.streamed) start_sound(play.name, play.effects, play.owner, play.priority, SOUND_WAIT_QUEUE);
+            break;
+        }
+    }
+    return finished;
+}
+
+void sound_begin_tick() {
+    audio_mixer_begin_tick();
+}
+
+bool sound_set_low_latency(bool on) {
+    if (on == g_low_latency) return true;
+
+    int freq = 0, channels = 0;
+    Uint16 format = 0;
+    Mix_QuerySpec(&freq, &format, &channels);
+
+    // Nothing may decode against a device that is closed or half open.
+    sound_loader_pause();
+    sound_waveform_pause();
+    stop_all_sounds();
+    close_device();
+    g_low_latency = on;
+    bool opened = open_device();
+    if (!opened) {
+        // Go back to what worked rather than leave the project silent.
+        g_low_latency = !on;
+        open_device();
+    }
+    sound_waveform_resume();
+
+    // Chunks were converted for the old device, and so were loads that
+    // finished but are not collected yet; a different one needs them all
+    // decoded again. New tickets make the old results drop on arrival.
+    int new_freq = 0, new_channels = 0;
+    Uint16 new_format = 0;
+    Mix_QuerySpec(&new_freq, &new_format, &new_channels);
+    if (new_freq != freq || new_format != format || new_channels != channels) {
+        sound_end_library_preview();
+        std::vector<std::string> names;
+        for (const auto& pair : g_sounds) names.push_back(pair.first);
+        for (const auto& pair : g_loading) {
+            if (g_sounds.find(pair.first) == g_sounds.end()) names.push_back(pair.first);
+        }
+        for (const auto& name : names) {
+            auto path = g_sound_paths.find(name);
+            if (path == g_sound_paths.end()) continue;
+            auto old = g_sounds.find(name);
+            if (old != g_sounds.end()) {
+                if (old->second) free_chunk(old->second);
+                g_sounds.erase(old);
+            }
+            SoundItem* item = sound_project_get_by_name(name);
+            if (item) item->state = SOUND_LOADING;
+            sound_load_async(name, path->second);
+        }
+    }
+    sound_loader_resume();
+    if (!opened) return false;
+    log_info("Audio buffer " + std::to_string(on ? SOUND_BUFFER_LOW_LATENCY : SOUND_BUFFER_DEFAULT) + " frames");
+    return true;
+}
+
+bool sound_low_latency() {
+    return g_low_latency;
+}
+
+bool sound_is_loading(const std::string& name) {
+    return g_loading.find(name) != g_loading.end();
+}
+
+float sound_load_progress(const std::string& name) {
+    auto it = g_loading.find(name);
+    if (it == g_loading.end()) return -1.0f;
+    // A finished load waiting for sound_update reads as complete.
+    float progress = sound_loader_progress(it->second);
+    return progress < 0.0f ? 1.0f : progress;
+}
+
+void sound_set_wait_policy(SoundWaitPolicy policy) {
+    g_wait_policy = policy;
+}
+
+SoundWaitPolicy sound_wait_policy() {
+    return g_wait_policy;
+}
+
+static void start_sound(const std::string& name, const VoiceParams& effects, const void* owner, int priority,
+                        SoundWaitPolicy policy) {
+    if (sound_is_loading(name)) {
+        if (policy == SOUND_WAIT_SKIP) return;
+        for (auto& pending : g_pending_plays) {
+            if (pending.name == name) {
+                pending.effects = effects;
+                pending.owner = owner;
+                pending.priority = std::max(pending.priority, priority);
+                return;
+            }
+        }
+        PendingPlay play;
+        play.name = name;
+        play.effects = effects;
+        play.owner = owner;
+        play.priority = priority;
+        g_pending_plays.push_back(play);
+        return;
+    }
+
+    VoiceParams sound;
+    SoundItem* item = sound_project_get_by_name(name);
+    if (item) {
+        sound.gain = item->volume / 100.0f;
+        sound.pitch = std::pow(2.0f, item->pitch / 120.0f);
+        priority = std::max(priority, item->priority);
+    }
+
+    auto stream = g_stream_sources.find(name);
+    if (stream != g_stream_sources.end()) {
+        if (!sound_stream_play(stream->second, sound, effects, owner, audio_mixer_tick_frame())) {
+            log_error("Failed to play sound: " + name + " - no free stream");
+        }
+        return;
+    }
+
     auto it = g_sounds.find(name);
     if (it == g_sounds.end()) {
         log_warning("Sound not found: " + name);
@@ -95,16 +366,31 @@ void play_sound(const std::string& name, int volume) {
     }
 
     if (it->second) {
-        Mix_VolumeChunk(it->second, volume);
-        int channel = Mix_PlayChannel(-1, it->second, 0);
-        if (channel == -1) {
-            log_error("Failed to play sound: " + name + " - " + Mix_GetError());
-        }
+        voice_pool_play(it->second, sound, effects, owner, priority, audio_mixer_tick_frame());
     }
 }
 
+void play_sound(const std::string& name, int volume, int priority) {
+    VoiceParams fx;
+    fx.gain = std::max(0, std::min(volume, 100)) / 100.0f;
+    start_sound(name, fx, nullptr, priority, g_wait_policy);
+}
+
+void play_sound(const std::string& name, const Sprite& sprite) {
+    start_sound(name, sprite_effects(sprite), &sprite, VOICE_PRIORITY_NORMAL, g_wait_policy);
+}
+
+void sound_apply_sprite_effects(const Sprite& sprite) {
+    VoiceParams fx = sprite_effects(sprite);
+    voice_pool_set_effects(&sprite, fx);
+    sound_stream_set_effects(&sprite, fx);
+}
+
 void stop_all_sounds() {
-    Mix_HaltChannel(-1);
+    g_pending_plays.clear();
+    voice_pool_stop_all();
+    sound_stream_stop_all();
+    synth_stop_all();
     log_info("All sounds stopped");
 }
 
@@ -146,30 +432,47 @@ bool sound_project_add_from_file(const std::string& filepath) {
         }
     }
     
-    if (!sound_load(name, filepath)) {
-        return false;
-    }
+    sound_load_async(name, filepath);
     
     SoundItem item;
     item.name = name;
     item.filepath = filepath;
-    item.loaded = true;
     g_project_sounds.push_back(item);
     
     log_info("Added sound to project: " + name);
     return true;
 }
 
-bool sound_project_add_from_library(const std::string& library_name) {
-    const LibrarySound* lib_sound = nullptr;
-    
-    for (const auto& ls : g_library_sounds) {
-        if (ls.name == library_name) {
-            lib_sound = &ls;
-            break;
-        }
+static bool sound_present(const std::string& name) {
+    return g_sounds.find(name) != g_sounds.end() ||
+           g_stream_sources.find(name) != g_stream_sources.end() ||
+           sound_is_loading(name);
+}
+
+void sound_preview_library(const std::string& library_name) {
+    const LibrarySound* lib_sound = sound_library_find(library_name);
+    if (!lib_sound) return;
+
+    SoundItem* item = sound_project_get_by_name(library_name);
+    if (!item && !sound_present(library_name)) {
+        sound_load_async(lib_sound->name, lib_sound->filepath);
+        g_previewed.push_back(lib_sound->name);
     }
-    
+    VoiceParams fx;
+    fx.gain = get_sound_volume() / 100.0f;
+    // The click asked for it, so it plays late rather than not at all.
+    start_sound(library_name, fx, nullptr, VOICE_PRIORITY_HIGH, SOUND_WAIT_QUEUE);
+}
+
+void sound_end_library_preview() {
+    for (const auto& name : g_previewed) {
+        if (!sound_project_get_by_name(name)) sound_unload(name);
+    }
+    g_previewed.clear();
+}
+
+bool sound_project_add_from_library(const std::string& library_name) {
+    const LibrarySound* lib_sound = sound_library_find(library_name);
     if (!lib_sound) return false;
     
     for (const auto& s : g_project_sounds) {
@@ -179,14 +482,20 @@ bool sound_project_add_from_library(const std::string& library_name) {
         }
     }
     
-    if (!sound_load(lib_sound->name, lib_sound->filepath)) {
-        return false;
-    }
-    
+    // A preview may have loaded it already, or still be loading it.
+    auto previewed = std::find(g_previewed.begin(), g_previewed.end(), library_name);
+    bool reuse = previewed != g_previewed.end() && sound_present(library_name);
+    if (previewed != g_previewed.end()) g_previewed.erase(previewed);
+    if (!reuse) sound_load_async(lib_sound->name, lib_sound->filepath);
+
     SoundItem item;
     item.name = lib_sound->name;
     item.filepath = lib_sound->filepath;
-    item.loaded = true;
+    item.duration = lib_sound->duration;
+    if (reuse && !sound_is_loading(library_name)) {
+        item.loaded = true;
+        item.state = SOUND_READY;
+    }
     g_project_sounds.push_back(item);
     
     log_info("Added library sound to project: " + library_name);
@@ -241,33 +550,6 @@ std::vector<std::string> sound_project_get_names() {
     return names;
 }
 
-const std::vector<LibrarySound>& sound_library_get_all() {
-    return g_library_sounds;
-}
-
-std::vector<LibrarySound> sound_library_get_by_category(const std::string& category) {
-    std::vector<LibrarySound> result;
-    for (const auto& ls : g_library_sounds) {
-        if (category == "All" || ls.category == category) {
-            result.push_back(ls);
-        }
-    }
-    return result;
-}
-
-std::vector<std::string> sound_library_get_categories() {
-    std::vector<std::string> cats;
-    cats.push_back("All");
-    for (const auto& ls : g_library_sounds) {
-        bool found = false;
-        for (const auto& c : cats) {
-            if (c == ls.category) { found = true; break; }
-        }
-        if (!found) cats.push_back(ls.category);
-    }
-    return cats;
-}
-
 bool sound_project_save(const std::string& project_path) {
     std::string file = project_path + "/sounds.txt";
     std::ofstream f(file.c_str());
@@ -275,7 +557,7 @@ bool sound_project_save(const std::string& project_path) {
     
     f << "SOUND_COUNT=" << g_project_sounds.size() << "\n";
     for (const auto& s : g_project_sounds) {
-        f << "SOUND=" << s.name << "|" << s.filepath << "|" << s.volume << "|" << s.pitch << "\n";
+        f << "SOUND=" << s.name << "|" << s.filepath << "|" << s.volume << "|" << s.pitch << "|" << s.priority << "\n";
     }
     return true;
 }
@@ -286,7 +568,7 @@ bool sound_project_load(const std::string& project_path) {
     if (!f.is_open()) return false;
     
     for (auto& s : g_project_sounds) {
-        if (s.loaded) sound_unload(s.name);
+        sound_unload(s.name);
     }
     g_project_sounds.clear();
     
@@ -303,15 +585,14 @@ bool sound_project_load(const std::string& project_path) {
             if (parts.size() >= 2) {
                 std::string name = parts[0];
                 std::string path = parts[1];
-                if (sound_load(name, path)) {
-                    SoundItem item;
-                    item.name = name;
-                    item.filepath = path;
-                    item.loaded = true;
-                    if (parts.size() >= 3) item.volume = std::stoi(parts[2]);
-                    if (parts.size() >= 4) item.pitch = std::stoi(parts[3]);
-                    g_project_sounds.push_back(item);
-                }
+                sound_load_async(name, path);
+                SoundItem item;
+                item.name = name;
+                item.filepath = path;
+                if (parts.size() >= 3) item.volume = std::stoi(parts[2]);
+                if (parts.size() >= 4) item.pitch = std::stoi(parts[3]);
+                if (parts.size() >= 5) item.priority = std::stoi(parts[4]);
+                g_project_sounds.push_back(item);
             }
         }
     }
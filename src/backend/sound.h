@@ -5,27 +5,40 @@
 #include <vector>
 #include <unordered_map>
 #include "../common/definitions.h" 
+#include "voice_pool.h"
+#include "sound_library.h"
 #ifdef __linux__
 #include <SDL2/SDL_mixer.h>
 #else
 #include <SDL2/SDL_mixer.h>
 #endif
 
+enum SoundLoadState {
+    SOUND_LOADING,
+    SOUND_READY,
+    SOUND_FAILED
+};
+
+// What play_sound does with a sound that is still being decoded.
+enum SoundWaitPolicy {
+    SOUND_WAIT_QUEUE,   // play it once it is ready
+    SOUND_WAIT_SKIP     // drop the request
+};
+
 struct SoundItem {
     std::string name;
     std::string filepath;
     bool loaded;
+    SoundLoadState state;
     float duration;
     int volume;
     int pitch;
+    // Voice priority for every play of this sound; a play uses the higher
+    // of this and the priority it was given.
+    int priority;
 
-    SoundItem() : loaded(false), duration(0.0f), volume(100), pitch(0) {}
-};
-
-struct LibrarySound {
-    std::string name;
-    std::string category;
-    std::string filepath;
+    SoundItem() : loaded(false), state(SOUND_LOADING), duration(0.0f), volume(100), pitch(0),
+                  priority(VOICE_PRIORITY_NORMAL) {}
 };
 
 extern std::unordered_map<std::string, Mix_Chunk*> g_sounds;
@@ -34,7 +47,33 @@ bool sound_init();
 void sound_cleanup();
 bool sound_load(const std::string& name, const std::string& path);
 void sound_unload(const std::string& name); // Added specific unload
-void play_sound(const std::string& name, int volume);
+// Decodes on the loader thread; the chunk appears in g_sounds during a
+// later sound_update.
+void sound_load_async(const std::string& name, const std::string& path);
+// Publishes finished loads and plays anything queued on them. Returns the
+// number of sounds that finished, counting a finished library scan as one.
+int sound_update();
+bool sound_is_loading(const std::string& name);
+// Fraction of the file read, or -1 if the sound is not loading.
+float sound_load_progress(const std::string& name);
+void sound_set_wait_policy(SoundWaitPolicy policy);
+SoundWaitPolicy sound_wait_policy();
+// Once per frame before scripts run. Sounds and notes started during the
+// frame are placed on the output by its start time, not by when the
+// script got to them.
+void sound_begin_tick();
+// Reopens the device with a smaller buffer, or the default one. Returns
+// false if the device would not open that way; the old setting stays. If
+// the new device has another format, every sound is decoded again.
+bool sound_set_low_latency(bool on);
+bool sound_low_latency();
+// volume is 0-100.
+void play_sound(const std::string& name, int volume, int priority = VOICE_PRIORITY_NORMAL);
+// Plays with the sprite's volume, pitch and pan effects. What it plays
+// follows later changes through sound_apply_sprite_effects, except that a
+// streamed sound keeps the pitch it started with.
+void play_sound(const std::string& name, const Sprite& sprite);
+void sound_apply_sprite_effects(const Sprite& sprite);
 void stop_all_sounds();
 void set_sound_volume(int volume);
 int get_sound_volume();
@@ -49,9 +88,11 @@ SoundItem* sound_project_get_by_name(const std::string& name);
 int sound_project_count();
 std::vector<std::string> sound_project_get_names();
 
-const std::vector<LibrarySound>& sound_library_get_all();
-std::vector<LibrarySound> sound_library_get_by_category(const std::string& category);
-std::vector<std::string> sound_library_get_categories();
+// Plays a library sound, loading it first if nothing has yet. Sounds
+// loaded only for a preview stay until sound_end_library_preview.
+void sound_preview_library(const std::string& library_name);
+// Unloads previewed sounds that were not added to the project.
+void sound_end_library_preview();
 
 bool sound_project_save(const std::string& project_path);
 bool sound_project_load(const std::string& project_path);
@@ -0,0 +1,354 @@
+#include "sound_library.h"
+#include "sound_loader.h"
+#include "../utils/logger.h"
+#include "../utils/paths.h"
+#include <SDL2/SDL_mixer.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <unordered_map>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace fs = std::filesystem;
+
+const int LIBRARY_VERSION = 1;
+
+static std::vector<LibrarySound> g_library;
+
+enum ScanState {
+    SCAN_IDLE,
+    SCAN_RUNNING,
+    SCAN_DONE
+};
+
+// The scan works on its own copy of the library. The loader thread owns
+// g_scan while g_scan_state is SCAN_RUNNING and hands it back by setting
+// SCAN_DONE.
+struct LibraryScan {
+    std::string dir;
+    std::string manifest;   // where to write, or empty for nowhere
+    std::vector<LibrarySound> entries;
+    std::vector<size_t> todo;
+    std::vector<bool> failed;
+    size_t next;
+    bool write;
+};
+
+static LibraryScan g_scan;
+static SDL_atomic_t g_scan_state;
+static SDL_atomic_t g_scan_cancel;
+
+static bool is_sound_file(const fs::path& path) {
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return ext == ".wav" || ext == ".ogg" || ext == ".mp3" || ext == ".flac";
+}
+
+static bool source_stamp(const fs::path& source, Uint64* size, Sint64* mtime) {
+    std::error_code ec;
+    uintmax_t s = fs::file_size(source, ec);
+    if (ec) return false;
+    fs::file_time_type t = fs::last_write_time(source, ec);
+    if (ec) return false;
+
+    *size = (Uint64)s;
+    *mtime = (Sint64)t.time_since_epoch().count();
+    return true;
+}
+
+// Largest magnitude in a buffer of samples, as a fraction of full scale.
+static float sample_peak(const Uint8* data, Uint32 len, SDL_AudioFormat format) {
+    float peak = 0.0f;
+    if (format == AUDIO_U8) {
+        for (Uint32 i = 0; i < len; i++) {
+            peak = std::max(peak, std::fabs((data[i] - 128) / 128.0f));
+        }
+    } else if (format == AUDIO_S16LSB) {
+        const Sint16* s = (const Sint16*)data;
+        for (Uint32 i = 0; i < len / 2; i++) {
+            peak = std::max(peak, std::fabs(SDL_SwapLE16(s[i]) / 32768.0f));
+        }
+    } else if (format == AUDIO_S32LSB) {
+        const Sint32* s = (const Sint32*)data;
+        for (Uint32 i = 0; i < len / 4; i++) {
+            peak = std::max(peak, std::fabs((Sint32)SDL_SwapLE32(s[i]) / 2147483648.0f));
+        }
+    } else if (format == AUDIO_F32LSB) {
+        const float* s = (const float*)data;
+        for (Uint32 i = 0; i < len / 4; i++) {
+            peak = std::max(peak, std::fabs(SDL_SwapFloatLE(s[i])));
+        }
+    }
+    return std::min(peak, 1.0f);
+}
+
+static float buffer_duration(Uint32 len, SDL_AudioFormat format, int channels, int freq) {
+    int frame_bytes = (SDL_AUDIO_BITSIZE(format) / 8) * channels;
+    if (freq <= 0 || frame_bytes <= 0) return 0.0f;
+    return (float)len / (float)(frame_bytes * freq);
+}
+
+// Fills in duration, rate, channels and peak. WAV files keep their own
+// rate and channel count; anything else is decoded at the device's.
+static bool scan_sound(LibrarySound* ls) {
+    SDL_AudioSpec spec;
+    Uint8* buf = nullptr;
+    Uint32 len = 0;
+    if (SDL_LoadWAV(ls->filepath.c_str(), &spec, &buf, &len)) {
+        ls->sample_rate = spec.freq;
+        ls->channels = spec.channels;
+        ls->duration = buffer_duration(len, spec.format, spec.channels, spec.freq);
+        ls->peak = sample_peak(buf, len, spec.format);
+        SDL_FreeWAV(buf);
+        return true;
+    }
+
+    Mix_Chunk* chunk = Mix_LoadWAV(ls->filepath.c_str());
+    if (!chunk) {
+        log_warning("Cannot read library sound: " + ls->filepath + " - " + Mix_GetError());
+        return false;
+    }
+    int freq = 0, channels = 0;
+    Uint16 format = 0;
+    Mix_QuerySpec(&freq, &format, &channels);
+    ls->sample_rate = freq;
+    ls->channels = channels;
+    ls->duration = buffer_duration(chunk->alen, format, channels, freq);
+    ls->peak = sample_peak(chunk->abuf, chunk->alen, format);
+    Mix_FreeChunk(chunk);
+    return true;
+}
+
+// Entries name their files relative to dir.
+static std::vector<LibrarySound> read_manifest(const std::string& path, const std::string& dir) {
+    std::vector<LibrarySound> entries;
+    std::ifstream f(path.c_str());
+    if (!f.is_open()) return entries;
+
+    std::string line;
+    while (std::getline(f, line)) {
+        if (line.empty()) continue;
+        if (line.substr(0, 16) == "LIBRARY_VERSION=") {
+            if (std::atoi(line.c_str() + 16) != LIBRARY_VERSION) {
+                log_warning("Sound library manifest has an unknown version, rescanning");
+                entries.clear();
+                return entries;
+            }
+        } else if (line.substr(0, 6) == "SOUND=") {
+            std::stringstream ss(line.substr(6));
+            std::string part;
+            std::vector<std::string> parts;
+            while (std::getline(ss, part, '|')) parts.push_back(part);
+            if (parts.size() < 3) continue;
+
+            LibrarySound ls;
+            ls.name = parts[0];
+            ls.category = parts[1];
+            ls.filepath = dir + "/" + parts[2];
+            if (parts.size() >= 9) {
+                ls.file_size = std::strtoull(parts[3].c_str(), nullptr, 10);
+                ls.file_mtime = std::strtoll(parts[4].c_str(), nullptr, 10);
+                ls.duration = (float)std::atof(parts[5].c_str());
+                ls.sample_rate = std::atoi(parts[6].c_str());
+                ls.channels = std::atoi(parts[7].c_str());
+                ls.peak = (float)std::atof(parts[8].c_str());
+            }
+            entries.push_back(ls);
+        }
+    }
+    return entries;
+}
+
+static bool write_manifest(const std::string& path, const std::string& dir,
+                           const std::vector<LibrarySound>& entries) {
+    std::error_code ec;
+    fs::create_directories(fs::path(path).parent_path(), ec);
+    std::ofstream f(path.c_str());
+    if (!f.is_open()) return false;
+
+    f << "LIBRARY_VERSION=" << LIBRARY_VERSION << "\n";
+    for (const auto& ls : entries) {
+        char meta[96];
+        snprintf(meta, sizeof(meta), "%.3f|%d|%d|%.3f", ls.duration, ls.sample_rate, ls.channels, ls.peak);
+        f << "SOUND=" << ls.name << "|" << ls.category << "|"
+          << fs::path(ls.filepath).lexically_relative(dir).generic_string() << "|"
+          << (unsigned long long)ls.file_size << "|" << (long long)ls.file_mtime << "|" << meta << "\n";
+    }
+    return f.good();
+}
+
+// One file per step, so loads queued meanwhile are not held up for the
+// whole scan.
+static bool scan_step(void*) {
+    if (SDL_AtomicGet(&g_scan_cancel)) {
+        SDL_AtomicSet(&g_scan_state, SCAN_IDLE);
+        return false;
+    }
+
+    LibraryScan& scan = g_scan;
+    if (scan.next < scan.todo.size()) {
+        size_t i = scan.todo[scan.next++];
+        scan.failed[i] = !scan_sound(&scan.entries[i]);
+        return true;
+    }
+
+    std::vector<LibrarySound> kept;
+    for (size_t i = 0; i < scan.entries.size(); i++) {
+        if (!scan.failed[i]) kept.push_back(scan.entries[i]);
+    }
+    scan.entries.swap(kept);
+
+    if (scan.write && !scan.manifest.empty() && !write_manifest(scan.manifest, scan.dir, scan.entries)) {
+        log_warning("Cannot write sound library manifest " + scan.manifest);
+    }
+    log_info("Sound library: " + std::to_string(scan.entries.size()) + " sounds, " +
+             std::to_string(scan.todo.size()) + " scanned");
+    SDL_AtomicSet(&g_scan_state, SCAN_DONE);
+    return false;
+}
+
+bool sound_library_init(const std::string& dir) {
+    g_library.clear();
+    if (SDL_AtomicGet(&g_scan_state) == SCAN_RUNNING) {
+        log_warning("Sound library scan still running, not listing again");
+        return false;
+    }
+
+    std::error_code ec;
+    std::vector<fs::path> files;
+    for (fs::recursive_directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->is_regular_file(ec) && is_sound_file(it->path())) files.push_back(it->path());
+    }
+    if (ec) {
+        log_error("Cannot read sound library: " + dir + " - " + ec.message());
+        return false;
+    }
+    std::sort(files.begin(), files.end());
+
+    // The cached manifest when there is one, else the shipped seed. Its
+    // order is kept; files it does not know go after, by path.
+    std::string cache_dir = user_cache_dir();
+    std::string manifest = cache_dir.empty() ? "" : cache_dir + SOUND_LIBRARY_CACHE;
+    std::vector<LibrarySound> cached;
+    if (!manifest.empty()) cached = read_manifest(manifest, dir);
+    if (cached.empty()) cached = read_manifest(dir + "/" + SOUND_LIBRARY_MANIFEST, dir);
+    std::unordered_map<std::string, size_t> by_path;
+    for (size_t i = 0; i < cached.size(); i++) {
+        by_path[fs::path(cached[i].filepath).lexically_normal().generic_string()] = i;
+    }
+    std::vector<LibrarySound> fresh;
+    std::vector<bool> present(cached.size(), false);
+    std::vector<bool> stale_cached(cached.size(), false);
+    std::vector<bool> stale_fresh;
+
+    for (const auto& path : files) {
+        LibrarySound ls;
+        auto hit = by_path.find(path.lexically_normal().generic_string());
+        if (hit != by_path.end()) {
+            ls = cached[hit->second];
+        } else {
+            ls.name = path.stem().string();
+            std::replace(ls.name.begin(), ls.name.end(), '_', ' ');
+            fs::path sub = path.parent_path().lexically_relative(dir);
+            ls.category = (sub.empty() || sub == ".") ? "Other" : sub.begin()->string();
+        }
+        ls.filepath = path.generic_string();
+
+        // Only stat here; anything that needs decoding is left to the scan.
+        Uint64 size = 0;
+        Sint64 mtime = 0;
+        if (!source_stamp(path, &size, &mtime)) continue;
+        bool stale = size != ls.file_size || mtime != ls.file_mtime;
+        ls.file_size = size;
+        ls.file_mtime = mtime;
+
+        if (hit != by_path.end()) {
+            cached[hit->second] = ls;
+            present[hit->second] = true;
+            stale_cached[hit->second] = stale;
+        } else {
+            fresh.push_back(ls);
+            stale_fresh.push_back(stale);
+        }
+    }
+
+    std::vector<size_t> todo;
+    for (size_t i = 0; i < cached.size(); i++) {
+        if (!present[i]) continue;
+        if (stale_cached[i]) todo.push_back(g_library.size());
+        g_library.push_back(cached[i]);
+    }
+    for (size_t i = 0; i < fresh.size(); i++) {
+        if (stale_fresh[i]) todo.push_back(g_library.size());
+        g_library.push_back(fresh[i]);
+    }
+
+    bool changed = !todo.empty() || g_library.size() != cached.size();
+    if (!changed) {
+        log_info("Sound library: " + std::to_string(g_library.size()) + " sounds, none changed");
+        return true;
+    }
+
+    g_scan.dir = dir;
+    g_scan.manifest = manifest;
+    g_scan.entries = g_library;
+    g_scan.todo = todo;
+    g_scan.failed.assign(g_library.size(), false);
+    g_scan.next = 0;
+    g_scan.write = true;
+    SDL_AtomicSet(&g_scan_cancel, 0);
+    SDL_AtomicSet(&g_scan_state, SCAN_RUNNING);
+    sound_loader_run(scan_step, nullptr);
+    return true;
+}
+
+bool sound_library_update() {
+    if (SDL_AtomicGet(&g_scan_state) != SCAN_DONE) return false;
+    g_library.swap(g_scan.entries);
+    g_scan.entries.clear();
+    SDL_AtomicSet(&g_scan_state, SCAN_IDLE);
+    return true;
+}
+
+void sound_library_clear() {
+    g_library.clear();
+    if (SDL_AtomicGet(&g_scan_state) == SCAN_RUNNING) {
+        SDL_AtomicSet(&g_scan_cancel, 1);
+    } else {
+        SDL_AtomicSet(&g_scan_state, SCAN_IDLE);
+        g_scan.entries.clear();
+    }
+}
+
+const LibrarySound* sound_library_find(const std::string& name) {
+    for (const auto& ls : g_library) {
+        if (ls.name == name) return &ls;
+    }
+    return nullptr;
+}
+
+std::vector<LibrarySound> sound_library_get_by_category(const std::string& category) {
+    std::vector<LibrarySound> result;
+    for (const auto& ls : g_library) {
+        if (category == "All" || ls.category == category) {
+            result.push_back(ls);
+        }
+    }
+    return result;
+}
+
+std::vector<std::string> sound_library_get_categories() {
+    std::vector<std::string> cats;
+    cats.push_back("All");
+    for (const auto& ls : g_library) {
+        bool found = false;
+        for (const auto& c : cats) {
+            if (c == ls.category) { found = true; break; }
+        }
+        if (!found) cats.push_back(ls.category);
+    }
+    return cats;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <SDL2/SDL.h>
+#include <string>
+#include <vector>
+
+// The built-in sound library is described by a manifest, so listing it
+// never opens the sound files themselves. Each line caches a file's size
+// and modification time next to its metadata; files that are new or
+// changed since are scanned again on the sound loader thread. The manifest
+// shipped in the library folder is only read, as a seed; the up-to-date
+// one is kept in the user's cache directory.
+
+const char SOUND_LIBRARY_DEFAULT_DIR[] = "../assets/sounds/library";
+const char SOUND_LIBRARY_MANIFEST[] = "library.txt";
+const char SOUND_LIBRARY_CACHE[] = "sound_library.txt";
+
+struct LibrarySound {
+    std::string name;
+    std::string category;
+    std::string filepath;
+    // What the manifest was last checked against.
+    Uint64 file_size;
+    Sint64 file_mtime;
+    float duration;
+    int sample_rate;
+    int channels;
+    float peak;     // 0..1 of full scale
+
+    LibrarySound() : file_size(0), file_mtime(0), duration(0.0f), sample_rate(0), channels(0), peak(0.0f) {}
+};
+
+// Lists the folder against the manifest and queues a scan of whatever
+// changed; until it finishes those sounds keep their old metadata, or none
+// if they are new. Call after sound_loader_init with the audio device open,
+// since formats we cannot read directly are decoded through SDL_mixer.
+bool sound_library_init(const std::string& dir = SOUND_LIBRARY_DEFAULT_DIR);
+// Takes in a finished scan; returns true if the library changed. Once per
+// frame. Pointers from sound_library_find do not survive it.
+bool sound_library_update();
+// Also stops a scan in progress at its next file.
+void sound_library_clear();
+
+const LibrarySound* sound_library_find(const std::string& name);
+std::vector<LibrarySound> sound_library_get_by_category(const std::string& category);
+std::vector<std::string> sound_library_get_categories();
@@ -0,0 +1,234 @@
+#include "sound_loader.h"
+#include <deque>
+#include <vector>
+#include <algorithm>
+
+// Reading is the slow part for long files, so it goes in blocks and
+// reports progress as it goes; decoding then runs from memory.
+const size_t SOUND_READ_BLOCK = 64 * 1024;
+
+struct SoundJob {
+    SoundLoadResult result;
+    // Bytes read, in thousandths of the file.
+    SDL_atomic_t progress;
+};
+
+struct SoundTask {
+    SoundLoaderTask fn;
+    void* data;
+};
+
+static SDL_Thread* g_thread = nullptr;
+static SDL_mutex* g_lock = nullptr;
+static SDL_cond* g_wake = nullptr;
+static SDL_cond* g_idle = nullptr;
+static std::deque<SoundJob*> g_queue;
+static std::deque<SoundJob*> g_done;
+static std::deque<SoundTask> g_tasks;
+static SoundJob* g_current = nullptr;
+static bool g_quit = false;
+// While paused the thread takes no new work; g_working covers a load or
+// task step already under way, which sound_loader_pause waits out.
+static bool g_paused = false;
+static bool g_working = false;
+static int g_next_ticket = 1;
+
+static void load(SoundJob* job) {
+    SoundLoadResult& r = job->result;
+
+    SDL_RWops* file = SDL_RWFromFile(r.path.c_str(), "rb");
+    if (!file) {
+        r.error = SDL_GetError();
+        return;
+    }
+    Sint64 size = SDL_RWsize(file);
+    if (size >= SOUND_STREAM_THRESHOLD && sound_stream_enabled() &&
+        sound_stream_probe(r.path, &r.stream)) {
+        SDL_RWclose(file);
+        r.streamed = true;
+        return;
+    }
+
+    std::vector<Uint8> data;
+    size_t used = 0;
+    while (true) {
+        if (data.size() - used < SOUND_READ_BLOCK) {
+            data.resize(std::max<size_t>(used + SOUND_READ_BLOCK, size > 0 ? (size_t)size : 0));
+        }
+        size_t got = SDL_RWread(file, data.data() + used, 1, SOUND_READ_BLOCK);
+        if (got == 0) break;
+        used += got;
+        if (size > 0) {
+            SDL_AtomicSet(&job->progress, (int)std::min<Sint64>(999, (Sint64)used * 1000 / size));
+        }
+    }
+    SDL_RWclose(file);
+
+    if (used == 0) {
+        r.error = "empty file";
+        return;
+    }
+    r.chunk = Mix_LoadWAV_RW(SDL_RWFromConstMem(data.data(), (int)used), 1);
+    if (!r.chunk) r.error = Mix_GetError();
+}
+
+static int loader_main(void*) {
+    SDL_LockMutex(g_lock);
+    while (true) {
+        while ((g_paused || (g_queue.empty() && g_tasks.empty())) && !g_quit) SDL_CondWait(g_wake, g_lock);
+        if (g_quit) break;
+        g_working = true;
+
+        // Loads go first; a task only gets a step when none is waiting.
+        if (g_queue.empty()) {
+            SoundTask task = g_tasks.front();
+            g_tasks.pop_front();
+            SDL_UnlockMutex(g_lock);
+
+            bool more = task.fn(task.data);
+
+            SDL_LockMutex(g_lock);
+            if (more) g_tasks.push_back(task);
+        } else {
+            g_current = g_queue.front();
+            g_queue.pop_front();
+            SDL_UnlockMutex(g_lock);
+
+            load(g_current);
+
+            SDL_LockMutex(g_lock);
+            SDL_AtomicSet(&g_current->progress, 1000);
+            g_done.push_back(g_current);
+            g_current = nullptr;
+        }
+        g_working = false;
+        SDL_CondBroadcast(g_idle);
+    }
+    SDL_UnlockMutex(g_lock);
+    return 0;
+}
+
+bool sound_loader_init() {
+    if (g_thread) return true;
+
+    g_lock = SDL_CreateMutex();
+    g_wake = SDL_CreateCond();
+    g_idle = SDL_CreateCond();
+    g_quit = false;
+    g_paused = false;
+    g_thread = SDL_CreateThread(loader_main, "sound_load", nullptr);
+    return g_thread != nullptr;
+}
+
+static void free_job(SoundJob* job) {
+    if (job->result.chunk) Mix_FreeChunk(job->result.chunk);
+    delete job;
+}
+
+void sound_loader_shutdown() {
+    if (!g_lock) return;
+
+    SDL_LockMutex(g_lock);
+    g_quit = true;
+    SDL_CondBroadcast(g_wake);
+    SDL_UnlockMutex(g_lock);
+    if (g_thread) SDL_WaitThread(g_thread, nullptr);
+    g_thread = nullptr;
+
+    for (SoundJob* job : g_queue) free_job(job);
+    for (SoundJob* job : g_done) free_job(job);
+    g_queue.clear();
+    g_done.clear();
+    g_tasks.clear();
+
+    SDL_DestroyCond(g_wake);
+    SDL_DestroyCond(g_idle);
+    SDL_DestroyMutex(g_lock);
+    g_wake = nullptr;
+    g_idle = nullptr;
+    g_lock = nullptr;
+}
+
+void sound_loader_pause() {
+    if (!g_thread) return;
+    SDL_LockMutex(g_lock);
+    g_paused = true;
+    while (g_working) SDL_CondWait(g_idle, g_lock);
+    SDL_UnlockMutex(g_lock);
+}
+
+void sound_loader_resume() {
+    if (!g_thread) return;
+    SDL_LockMutex(g_lock);
+    g_paused = false;
+    SDL_CondSignal(g_wake);
+    SDL_UnlockMutex(g_lock);
+}
+
+int sound_loader_request(const std::string& name, const std::string& path) {
+    SoundJob* job = new SoundJob();
+    job->result.ticket = g_next_ticket++;
+    job->result.name = name;
+    job->result.path = path;
+    job->result.chunk = nullptr;
+    job->result.streamed = false;
+    SDL_AtomicSet(&job->progress, 0);
+
+    // Without a thread the load runs inline and is collected on the next
+    // poll, like any other.
+    if (!g_thread) {
+        load(job);
+        g_done.push_back(job);
+        return job->result.ticket;
+    }
+
+    SDL_LockMutex(g_lock);
+    g_queue.push_back(job);
+    SDL_CondSignal(g_wake);
+    SDL_UnlockMutex(g_lock);
+    return job->result.ticket;
+}
+
+bool sound_loader_poll(SoundLoadResult* out) {
+    if (g_lock) SDL_LockMutex(g_lock);
+    SoundJob* job = nullptr;
+    if (!g_done.empty()) {
+        job = g_done.front();
+        g_done.pop_front();
+    }
+    if (g_lock) SDL_UnlockMutex(g_lock);
+
+    if (!job) return false;
+    *out = job->result;
+    delete job;
+    return true;
+}
+
+float sound_loader_progress(int ticket) {
+    float progress = -1.0f;
+    if (g_lock) SDL_LockMutex(g_lock);
+    if (g_current && g_current->result.ticket == ticket) {
+        progress = SDL_AtomicGet(&g_current->progress) / 1000.0f;
+    } else {
+        for (SoundJob* job : g_queue) {
+            if (job->result.ticket == ticket) progress = 0.0f;
+        }
+    }
+    if (g_lock) SDL_UnlockMutex(g_lock);
+    return progress;
+}
+
+void sound_loader_run(SoundLoaderTask task, void* data) {
+    if (!g_thread) {
+        while (task(data)) {}
+        return;
+    }
+
+    SDL_LockMutex(g_lock);
+    SoundTask t;
+    t.fn = task;
+    t.data = data;
+    g_tasks.push_back(t);
+    SDL_CondSignal(g_wake);
+    SDL_UnlockMutex(g_lock);
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <SDL2/SDL_mixer.h>
+#include <string>
+#include "sound_stream.h"
+
+// Reads and decodes sound files on a background thread. Finished chunks
+// are handed back to the main thread through sound_loader_poll, which is
+// the only place they become visible to the rest of the program.
+
+struct SoundLoadResult {
+    int ticket;
+    std::string name;
+    std::string path;
+    // nullptr when the file could not be read or decoded, or is streamed.
+    Mix_Chunk* chunk;
+    bool streamed;
+    SoundStreamSource stream;
+    std::string error;
+};
+
+bool sound_loader_init();
+// Abandons queued loads and frees anything decoded but not yet collected.
+void sound_loader_shutdown();
+// Decoding converts to the open device's format, so the device is only
+// closed between these. Pause returns once the load or task step under
+// way has finished; nothing new starts until resume.
+void sound_loader_pause();
+void sound_loader_resume();
+
+// Returns a ticket identifying the load.
+int sound_loader_request(const std::string& name, const std::string& path);
+bool sound_loader_poll(SoundLoadResult* out);
+
+// Fraction of the file read so far, or -1 once the ticket is done.
+float sound_loader_progress(int ticket);
+
+// Background work that is not a load, done in small steps. Each step runs
+// on the loader thread while no load is waiting, and the task is queued
+// again for as long as it returns true. Without a thread it runs to the
+// end inline. Tasks still queued at shutdown are dropped without a call.
+typedef bool (*SoundLoaderTask)(void* data);
+void sound_loader_run(SoundLoaderTask task, void* data);
@@ -0,0 +1,392 @@
+#include "sound_stream.h"
+#include <algorithm>
+#include <cstring>
+
+// About 0.75s of float stereo at 44.1kHz. Must stay a power of two.
+const Uint32 SOUND_STREAM_RING = 256 * 1024;
+const size_t SOUND_STREAM_READ_BLOCK = 16 * 1024;
+const Uint32 SOUND_STREAM_REFILL_MS = 10;
+// Same range the mixer allows its voices.
+const float SOUND_STREAM_MIN_PITCH = 1.0f / 16.0f;
+const float SOUND_STREAM_MAX_PITCH = 16.0f;
+
+// A slot moves FREE -> STARTING on the main thread, STARTING -> PLAYING
+// on the feeder, PLAYING -> DRAINED/STOPPED in the audio callback and
+// back to FREE on the feeder. Each thread only leaves the states it owns,
+// so the ring is never reset while the callback reads it.
+enum StreamState {
+    STREAM_FREE,
+    STREAM_STARTING,
+    STREAM_PLAYING,
+    STREAM_DRAINED,
+    STREAM_STOPPED
+};
+
+struct Stream {
+    SDL_atomic_t state;
+    SDL_atomic_t stop;
+    SDL_atomic_t eof;
+    // Byte counters that only grow; their difference is the fill level.
+    SDL_atomic_t read_pos;
+    SDL_atomic_t write_pos;
+    Uint64 start;       // output frame it begins on
+    SoundStreamSource source;
+    Uint8* ring;
+    const void* owner;
+    // Set before the stream leaves FREE; effects also change under
+    // g_params while it plays.
+    VoiceParams sound;
+    VoiceParams effects;
+    float pitch;
+
+    // Callback only: the gains the previous block ended on.
+    float gain_l;
+    float gain_r;
+    bool fresh;
+
+    // Feeder only.
+    SDL_RWops* file;
+    SDL_AudioStream* convert;
+    Uint32 remaining;
+};
+
+static Stream g_streams[SOUND_STREAM_MAX];
+static SDL_Thread* g_thread = nullptr;
+static SDL_mutex* g_lock = nullptr;
+static SDL_cond* g_wake = nullptr;
+static bool g_quit = false;
+static Uint8 g_read_block[SOUND_STREAM_READ_BLOCK];
+// Guards Stream::effects between the main thread and the callback.
+static SDL_SpinLock g_params = 0;
+
+// The rings hold float stereo at the device rate.
+static const SDL_AudioFormat g_out_format = AUDIO_F32SYS;
+static const int g_out_channels = 2;
+static const Uint32 g_out_frame = 2 * sizeof(float);
+static int g_out_freq = 0;
+
+static Uint16 read_le16(const Uint8* p) {
+    return (Uint16)(p[0] | (p[1] << 8));
+}
+
+static Uint32 read_le32(const Uint8* p) {
+    return (Uint32)p[0] | ((Uint32)p[1] << 8) | ((Uint32)p[2] << 16) | ((Uint32)p[3] << 24);
+}
+
+static Uint32 frame_bytes(SDL_AudioFormat format, int channels) {
+    return (Uint32)(SDL_AUDIO_BITSIZE(format) / 8 * channels);
+}
+
+bool sound_stream_probe(const std::string& path, SoundStreamSource* out) {
+    SDL_RWops* f = SDL_RWFromFile(path.c_str(), "rb");
+    if (!f) return false;
+    Sint64 file_size = SDL_RWsize(f);
+
+    Uint8 riff[12];
+    bool ok = SDL_RWread(f, riff, sizeof(riff), 1) == 1 &&
+              std::memcmp(riff, "RIFF", 4) == 0 && std::memcmp(riff + 8, "WAVE", 4) == 0;
+
+    bool have_fmt = false, have_data = false;
+    Uint16 tag = 0, channels = 0, bits = 0;
+    Uint32 freq = 0;
+    while (ok && !have_data) {
+        Uint8 header[8];
+        if (SDL_RWread(f, header, sizeof(header), 1) != 1) break;
+        Uint32 size = read_le32(header + 4);
+        Sint64 body = SDL_RWtell(f);
+
+        if (std::memcmp(header, "fmt ", 4) == 0) {
+            Uint8 fmt[40] = {0};
+            if (size < 16 || SDL_RWread(f, fmt, 1, std::min<Uint32>(size, sizeof(fmt))) < 16) break;
+            tag = read_le16(fmt);
+            channels = read_le16(fmt + 2);
+            freq = read_le32(fmt + 4);
+            bits = read_le16(fmt + 14);
+            // WAVE_FORMAT_EXTENSIBLE keeps the real tag in its subformat.
+            if (tag == 0xFFFE && size >= 26) tag = read_le16(fmt + 24);
+            have_fmt = true;
+        } else if (std::memcmp(header, "data", 4) == 0) {
+            have_data = have_fmt;
+            out->data_offset = (Uint32)body;
+            out->data_length = (Uint32)std::min<Sint64>(size, file_size - body);
+            break;
+        }
+        if (SDL_RWseek(f, body + size + (size & 1), RW_SEEK_SET) < 0) break;
+    }
+    SDL_RWclose(f);
+    if (!have_data) return false;
+
+    SDL_AudioFormat format = 0;
+    if (tag == 1 && bits == 8) format = AUDIO_U8;
+    else if (tag == 1 && bits == 16) format = AUDIO_S16LSB;
+    else if (tag == 1 && bits == 32) format = AUDIO_S32LSB;
+    else if (tag == 3 && bits == 32) format = AUDIO_F32LSB;
+    if (format == 0 || (channels != 1 && channels != 2) || freq == 0) return false;
+
+    out->path = path;
+    out->format = format;
+    out->channels = channels;
+    out->freq = (int)freq;
+    out->data_length -= out->data_length % frame_bytes(format, channels);
+    return out->data_length > 0;
+}
+
+float sound_stream_duration(const SoundStreamSource& source) {
+    Uint32 frame = frame_bytes(source.format, source.channels);
+    if (frame == 0 || source.freq <= 0) return 0.0f;
+    return (float)source.data_length / (float)(frame * source.freq);
+}
+
+// Runs in the audio callback as a mixer source.
+static void mix_streams(float* mix, int frames, void*) {
+    Uint64 block = audio_mixer_block_frame();
+    for (int i = 0; i < SOUND_STREAM_MAX; i++) {
+        Stream* s = &g_streams[i];
+        if (SDL_AtomicGet(&s->state) != STREAM_PLAYING) continue;
+        if (SDL_AtomicGet(&s->stop)) {
+            SDL_AtomicSet(&s->state, STREAM_STOPPED);
+            continue;
+        }
+
+        if (s->start >= block + (Uint64)frames) continue;
+        int skip = s->start > block ? (int)(s->start - block) : 0;
+
+        // Read eof first: once it is set every byte is already in the ring.
+        bool eof = SDL_AtomicGet(&s->eof) != 0;
+        Uint32 r = (Uint32)SDL_AtomicGet(&s->read_pos);
+        Uint32 avail = (Uint32)SDL_AtomicGet(&s->write_pos) - r;
+        if (avail == 0) {
+            if (eof) SDL_AtomicSet(&s->state, STREAM_DRAINED);
+            continue;
+        }
+
+        SDL_AtomicLock(&g_params);
+        VoiceParams effects = s->effects;
+        SDL_AtomicUnlock(&g_params);
+
+        // The same gain and pan law as mix_voice, ramped across the block.
+        float gain = s->sound.gain * effects.gain;
+        float pan = std::max(-1.0f, std::min(1.0f, s->sound.pan + effects.pan));
+        float gl = gain * std::min(1.0f, 1.0f - pan);
+        float gr = gain * std::min(1.0f, 1.0f + pan);
+        if (s->fresh) {
+            s->gain_l = gl;
+            s->gain_r = gr;
+            s->fresh = false;
+        }
+
+        Uint32 want = std::min<Uint32>(avail, (Uint32)(frames - skip) * g_out_frame);
+        Uint32 pos = r & (SOUND_STREAM_RING - 1);
+        Uint32 first = std::min(want, SOUND_STREAM_RING - pos);
+        int n = (int)(want / g_out_frame);
+        int n1 = (int)(first / g_out_frame);
+        float dl = n > 0 ? (gl - s->gain_l) / n : 0.0f;
+        float dr = n > 0 ? (gr - s->gain_r) / n : 0.0f;
+        float* out = mix + skip * g_out_channels;
+        audio_mixer_accumulate(out, (const float*)(s->ring + pos), n1, s->gain_l, s->gain_r, dl, dr);
+        if (first < want) {
+            audio_mixer_accumulate(out + first / sizeof(float), (const float*)s->ring, n - n1,
+                                   s->gain_l + dl * n1, s->gain_r + dr * n1, dl, dr);
+        }
+        s->gain_l = gl;
+        s->gain_r = gr;
+        SDL_AtomicAdd(&s->read_pos, (int)want);
+    }
+    SDL_CondSignal(g_wake);
+}
+
+static void close_stream(Stream* s) {
+    if (s->file) SDL_RWclose(s->file);
+    if (s->convert) SDL_FreeAudioStream(s->convert);
+    s->file = nullptr;
+    s->convert = nullptr;
+    SDL_AtomicSet(&s->state, STREAM_FREE);
+}
+
+static bool open_stream(Stream* s) {
+    const SoundStreamSource& src = s->source;
+    s->file = SDL_RWFromFile(src.path.c_str(), "rb");
+    if (!s->file || SDL_RWseek(s->file, src.data_offset, RW_SEEK_SET) < 0) return false;
+    // Converting to a lower rate than the device's plays it back faster.
+    int rate = std::max(1, (int)((float)g_out_freq / s->pitch + 0.5f));
+    s->convert = SDL_NewAudioStream(src.format, (Uint8)src.channels, src.freq,
+                                    g_out_format, (Uint8)g_out_channels, rate);
+    s->remaining = src.data_length;
+    return s->convert != nullptr;
+}
+
+static void fill_stream(Stream* s) {
+    if (SDL_AtomicGet(&s->eof)) return;
+
+    Uint32 src_frame = frame_bytes(s->source.format, s->source.channels);
+    while (true) {
+        Uint32 w = (Uint32)SDL_AtomicGet(&s->write_pos);
+        Uint32 space = SOUND_STREAM_RING - (w - (Uint32)SDL_AtomicGet(&s->read_pos));
+        if (space < g_out_frame) return;
+
+        if (SDL_AudioStreamAvailable(s->convert) < (int)g_out_frame) {
+            if (s->remaining == 0) {
+                SDL_AtomicSet(&s->eof, 1);
+                return;
+            }
+            size_t want = std::min<size_t>(s->remaining, sizeof(g_read_block));
+            size_t got = SDL_RWread(s->file, g_read_block, 1, want);
+            got -= got % src_frame;
+            if (got == 0 || SDL_AudioStreamPut(s->convert, g_read_block, (int)got) < 0) {
+                s->remaining = 0;
+            } else {
+                s->remaining -= (Uint32)got;
+            }
+            if (s->remaining == 0) SDL_AudioStreamFlush(s->convert);
+            continue;
+        }
+
+        Uint32 pos = w & (SOUND_STREAM_RING - 1);
+        Uint32 first = std::min(space, SOUND_STREAM_RING - pos);
+        first -= first % g_out_frame;
+        int got = SDL_AudioStreamGet(s->convert, s->ring + pos, (int)first);
+        if (got <= 0) {
+            SDL_AudioStreamClear(s->convert);
+            continue;
+        }
+        SDL_AtomicAdd(&s->write_pos, got);
+    }
+}
+
+static int feeder_main(void*) {
+    SDL_LockMutex(g_lock);
+    while (!g_quit) {
+        SDL_UnlockMutex(g_lock);
+
+        for (int i = 0; i < SOUND_STREAM_MAX; i++) {
+            Stream* s = &g_streams[i];
+            switch (SDL_AtomicGet(&s->state)) {
+                case STREAM_STARTING:
+                    if (SDL_AtomicGet(&s->stop) || !open_stream(s)) {
+                        close_stream(s);
+                        break;
+                    }
+                    fill_stream(s);
+                    SDL_AtomicSet(&s->state, STREAM_PLAYING);
+                    break;
+                case STREAM_PLAYING:
+                    fill_stream(s);
+                    break;
+                case STREAM_DRAINED:
+                case STREAM_STOPPED:
+                    close_stream(s);
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        SDL_LockMutex(g_lock);
+        if (!g_quit) SDL_CondWaitTimeout(g_wake, g_lock, SOUND_STREAM_REFILL_MS);
+    }
+    SDL_UnlockMutex(g_lock);
+    return 0;
+}
+
+bool sound_stream_init() {
+    if (g_thread) return true;
+
+    Uint16 format = 0;
+    int channels = 0;
+    if (!audio_mixer_ready() || !Mix_QuerySpec(&g_out_freq, &format, &channels)) return false;
+
+    for (int i = 0; i < SOUND_STREAM_MAX; i++) {
+        Stream* s = &g_streams[i];
+        SDL_AtomicSet(&s->state, STREAM_FREE);
+        s->ring = new Uint8[SOUND_STREAM_RING];
+        s->owner = nullptr;
+        s->file = nullptr;
+        s->convert = nullptr;
+    }
+
+    g_lock = SDL_CreateMutex();
+    g_wake = SDL_CreateCond();
+    g_quit = false;
+    g_thread = SDL_CreateThread(feeder_main, "sound_stream", nullptr);
+    if (!g_thread) {
+        sound_stream_shutdown();
+        return false;
+    }
+    audio_mixer_add_source(mix_streams, nullptr);
+    return true;
+}
+
+void sound_stream_shutdown() {
+    if (!g_lock) return;
+
+    // Waits for the mixer, so the callback is done with the rings.
+    audio_mixer_remove_source(mix_streams, nullptr);
+
+    SDL_LockMutex(g_lock);
+    g_quit = true;
+    SDL_CondSignal(g_wake);
+    SDL_UnlockMutex(g_lock);
+    if (g_thread) SDL_WaitThread(g_thread, nullptr);
+    g_thread = nullptr;
+
+    for (int i = 0; i < SOUND_STREAM_MAX; i++) {
+        close_stream(&g_streams[i]);
+        delete[] g_streams[i].ring;
+        g_streams[i].ring = nullptr;
+    }
+
+    SDL_DestroyCond(g_wake);
+    SDL_DestroyMutex(g_lock);
+    g_wake = nullptr;
+    g_lock = nullptr;
+}
+
+bool sound_stream_enabled() {
+    return g_thread != nullptr;
+}
+
+bool sound_stream_play(const SoundStreamSource& source, const VoiceParams& sound, const VoiceParams& effects,
+                       const void* owner, Uint64 start) {
+    if (!g_thread) return false;
+
+    for (int i = 0; i < SOUND_STREAM_MAX; i++) {
+        Stream* s = &g_streams[i];
+        if (SDL_AtomicGet(&s->state) != STREAM_FREE) continue;
+
+        s->source = source;
+        s->owner = owner;
+        s->sound = sound;
+        s->effects = effects;
+        s->pitch = std::max(SOUND_STREAM_MIN_PITCH, std::min(SOUND_STREAM_MAX_PITCH, sound.pitch * effects.pitch));
+        s->fresh = true;
+        s->start = start;
+        SDL_AtomicSet(&s->stop, 0);
+        SDL_AtomicSet(&s->eof, 0);
+        SDL_AtomicSet(&s->read_pos, 0);
+        SDL_AtomicSet(&s->write_pos, 0);
+        SDL_AtomicSet(&s->state, STREAM_STARTING);
+        SDL_CondSignal(g_wake);
+        return true;
+    }
+    return false;
+}
+
+void sound_stream_set_effects(const void* owner, const VoiceParams& effects) {
+    if (!g_thread) return;
+    SDL_AtomicLock(&g_params);
+    for (int i = 0; i < SOUND_STREAM_MAX; i++) {
+        Stream* s = &g_streams[i];
+        if (s->owner == owner && SDL_AtomicGet(&s->state) != STREAM_FREE) s->effects = effects;
+    }
+    SDL_AtomicUnlock(&g_params);
+}
+
+void sound_stream_stop_all() {
+    if (!g_thread) return;
+    for (int i = 0; i < SOUND_STREAM_MAX; i++) {
+        if (SDL_AtomicGet(&g_streams[i].state) != STREAM_FREE) {
+            SDL_AtomicSet(&g_streams[i].stop, 1);
+        }
+    }
+    SDL_CondSignal(g_wake);
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <SDL2/SDL.h>
+#include <string>
+#include "audio_mixer.h"
+
+// Long sounds are played straight from their file instead of being
+// decoded into a Mix_Chunk. A feeder thread reads each playing stream a
+// block at a time, converts it to float stereo and keeps a small ring
+// buffer topped up; the rings are mixed as a source of the audio mixer.
+
+// Files at least this large are streamed if their format allows it.
+const Sint64 SOUND_STREAM_THRESHOLD = 2 * 1024 * 1024;
+const int SOUND_STREAM_MAX = 8;
+
+// Where the PCM data of an uncompressed WAV file is and how to read it.
+struct SoundStreamSource {
+    std::string path;
+    SDL_AudioFormat format;
+    int channels;
+    int freq;
+    Uint32 data_offset;
+    Uint32 data_length;
+};
+
+// Succeeds only for WAV layouts the feeder can convert; anything else is
+// decoded whole as before.
+bool sound_stream_probe(const std::string& path, SoundStreamSource* out);
+float sound_stream_duration(const SoundStreamSource& source);
+
+// Call after audio_mixer_init.
+bool sound_stream_init();
+void sound_stream_shutdown();
+bool sound_stream_enabled();
+
+// Plays with gain and pan like a mixer voice, and effects can change while
+// it runs. Pitch is the exception: the file is resampled for the pitch both
+// give at the start, and later pitch changes wait for the next play. owner
+// only tags the stream for sound_stream_set_effects. Starts on output
+// frame start, or as soon as the first of the file is read if that is
+// later. Returns false when every stream is busy.
+bool sound_stream_play(const SoundStreamSource& source, const VoiceParams& sound, const VoiceParams& effects,
+                       const void* owner, Uint64 start);
+void sound_stream_set_effects(const void* owner, const VoiceParams& effects);
+void sound_stream_stop_all();
@@ -0,0 +1,380 @@
+#include "sound_waveform.h"
+#include "../utils/logger.h"
+#include "../utils/cpu_features.h"
+#include <SDL2/SDL_mixer.h>
+#include <filesystem>
+#include <deque>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+
+const size_t WAVEFORM_READ_BLOCK = 64 * 1024;
+const Uint32 WAVEFORM_CONVERT_FRAMES = 16 * 1024;
+// How often a measured file is checked for changes while it is on screen.
+const Uint32 WAVEFORM_RECHECK_MS = 1000;
+
+typedef void (*MinMaxFn)(const float* buf, int samples, float* lo, float* hi);
+
+static SDL_Thread* g_thread = nullptr;
+static SDL_mutex* g_lock = nullptr;
+static SDL_cond* g_wake = nullptr;
+static SDL_cond* g_idle = nullptr;
+static bool g_quit = false;
+// As in the sound loader: no new file while paused, and g_working covers
+// the one being measured.
+static bool g_paused = false;
+static bool g_working = false;
+
+// What a path was last measured as. mtime is the file's when it was read,
+// whether or not that worked, so a file that changes is measured again.
+struct WaveformPath {
+    Uint64 hash;
+    bool measured;
+    Sint64 mtime;
+    Uint32 checked;     // SDL_GetTicks of the last look at the file
+};
+
+// All under g_lock. A path is in g_requested from its first request on,
+// so one that failed is not tried again every frame. Waveforms are never
+// removed before shutdown, which keeps returned pointers valid.
+static std::deque<std::string> g_queue;
+static std::unordered_set<std::string> g_requested;
+static std::unordered_map<std::string, WaveformPath> g_paths;
+static std::unordered_map<Uint64, SoundWaveform> g_waveforms;
+
+static void minmax_scalar(const float* buf, int samples, float* lo, float* hi) {
+    float l = *lo, h = *hi;
+    for (int i = 0; i < samples; i++) {
+        l = std::min(l, buf[i]);
+        h = std::max(h, buf[i]);
+    }
+    *lo = l;
+    *hi = h;
+}
+
+#ifdef BLOCKY_X86
+
+BLOCKY_TARGET("sse2")
+static void minmax_sse2(const float* buf, int samples, float* lo, float* hi) {
+    __m128 l = _mm_set1_ps(*lo);
+    __m128 h = _mm_set1_ps(*hi);
+    int i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        __m128 a = _mm_loadu_ps(buf + i);
+        __m128 b = _mm_loadu_ps(buf + i + 4);
+        l = _mm_min_ps(l, _mm_min_ps(a, b));
+        h = _mm_max_ps(h, _mm_max_ps(a, b));
+    }
+    for (; i + 4 <= samples; i += 4) {
+        __m128 a = _mm_loadu_ps(buf + i);
+        l = _mm_min_ps(l, a);
+        h = _mm_max_ps(h, a);
+    }
+    float ll[4], hh[4];
+    _mm_storeu_ps(ll, l);
+    _mm_storeu_ps(hh, h);
+    *lo = std::min(std::min(ll[0], ll[1]), std::min(ll[2], ll[3]));
+    *hi = std::max(std::max(hh[0], hh[1]), std::max(hh[2], hh[3]));
+    minmax_scalar(buf + i, samples - i, lo, hi);
+}
+
+#endif
+
+static MinMaxFn g_minmax = minmax_scalar;
+static const char* g_isa = "scalar";
+
+static void select_kernels() {
+    g_minmax = minmax_scalar;
+    g_isa = cpu_level_name(CPU_SCALAR);
+#ifdef BLOCKY_X86
+    if (cpu_level() >= CPU_SSE2) {
+        g_minmax = minmax_sse2;
+        g_isa = cpu_level_name(CPU_SSE2);
+    }
+#endif
+}
+
+// FNV-1a, eight bytes at a time with a byte tail.
+static Uint64 hash_bytes(const Uint8* data, size_t len) {
+    Uint64 h = 14695981039346656037ULL;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        Uint64 w;
+        SDL_memcpy(&w, data + i, 8);
+        h = (h ^ w) * 1099511628211ULL;
+    }
+    for (; i < len; i++) h = (h ^ data[i]) * 1099511628211ULL;
+    return h ^ (Uint64)len;
+}
+
+static Sint64 file_mtime(const std::string& path) {
+    std::error_code ec;
+    std::filesystem::file_time_type t = std::filesystem::last_write_time(path, ec);
+    return ec ? 0 : (Sint64)t.time_since_epoch().count();
+}
+
+static bool read_file(const std::string& path, std::vector<Uint8>* data) {
+    SDL_RWops* file = SDL_RWFromFile(path.c_str(), "rb");
+    if (!file) return false;
+    Sint64 size = SDL_RWsize(file);
+    size_t used = 0;
+    while (true) {
+        if (data->size() - used < WAVEFORM_READ_BLOCK) {
+            data->resize(std::max<size_t>(used + WAVEFORM_READ_BLOCK, size > 0 ? (size_t)size : 0));
+        }
+        size_t got = SDL_RWread(file, data->data() + used, 1, WAVEFORM_READ_BLOCK);
+        if (got == 0) break;
+        used += got;
+    }
+    SDL_RWclose(file);
+    data->resize(used);
+    return used > 0;
+}
+
+// Converts to mono float in blocks and folds each block into the buckets
+// as it comes, so a long file never needs a second copy as floats. The
+// rate is unchanged, so the frame count is known from the input.
+static bool reduce(const Uint8* buf, Uint32 len, SDL_AudioFormat format, int channels, int freq,
+                   SoundWaveform* out) {
+    Uint32 frame = (SDL_AUDIO_BITSIZE(format) / 8) * channels;
+    Sint64 total = frame > 0 ? len / frame : 0;
+    if (total == 0 || freq <= 0) return false;
+    SDL_AudioStream* convert = SDL_NewAudioStream(format, (Uint8)channels, freq, AUDIO_F32SYS, 1, freq);
+    if (!convert) return false;
+
+    for (int b = 0; b < SOUND_WAVEFORM_BUCKETS; b++) out->min[b] = out->max[b] = 0.0f;
+    out->duration = (float)total / (float)freq;
+
+    std::vector<float> block(WAVEFORM_CONVERT_FRAMES);
+    Sint64 pos = 0;
+    Uint32 offset = 0;
+    bool ok = true;
+    while (ok) {
+        if (offset < len) {
+            Uint32 put = std::min<Uint32>(len - offset, WAVEFORM_CONVERT_FRAMES * frame);
+            ok = SDL_AudioStreamPut(convert, buf + offset, (int)put) == 0;
+            offset += put;
+            if (ok && offset >= len) ok = SDL_AudioStreamFlush(convert) == 0;
+        }
+        int got = SDL_AudioStreamGet(convert, block.data(), (int)(block.size() * sizeof(float)));
+        if (got < 0) ok = false;
+        if (got <= 0) {
+            if (offset >= len) break;
+            continue;
+        }
+
+        int n = got / (int)sizeof(float);
+        for (int i = 0; i < n;) {
+            Sint64 at = pos + i;
+            int b = (int)std::min<Sint64>(at * SOUND_WAVEFORM_BUCKETS / total, SOUND_WAVEFORM_BUCKETS - 1);
+            Sint64 next = b == SOUND_WAVEFORM_BUCKETS - 1
+                              ? at + n
+                              : ((Sint64)(b + 1) * total + SOUND_WAVEFORM_BUCKETS - 1) / SOUND_WAVEFORM_BUCKETS;
+            int run = (int)std::max<Sint64>(1, std::min<Sint64>(n - i, next - at));
+            g_minmax(block.data() + i, run, &out->min[b], &out->max[b]);
+            i += run;
+        }
+        pos += n;
+    }
+    SDL_FreeAudioStream(convert);
+
+    for (int b = 0; b < SOUND_WAVEFORM_BUCKETS; b++) {
+        out->min[b] = std::max(out->min[b], -1.0f);
+        out->max[b] = std::min(out->max[b], 1.0f);
+    }
+    return ok;
+}
+
+static bool decode(const std::vector<Uint8>& data, SoundWaveform* out) {
+    SDL_AudioSpec spec;
+    Uint8* buf = nullptr;
+    Uint32 len = 0;
+    if (SDL_LoadWAV_RW(SDL_RWFromConstMem(data.data(), (int)data.size()), 1, &spec, &buf, &len)) {
+        bool ok = reduce(buf, len, spec.format, spec.channels, spec.freq, out);
+        SDL_FreeWAV(buf);
+        return ok;
+    }
+
+    Mix_Chunk* chunk = Mix_LoadWAV_RW(SDL_RWFromConstMem(data.data(), (int)data.size()), 1);
+    if (!chunk) return false;
+    int freq = 0, channels = 0;
+    Uint16 format = 0;
+    bool ok = Mix_QuerySpec(&freq, &format, &channels) &&
+              reduce(chunk->abuf, chunk->alen, format, channels, freq, out);
+    Mix_FreeChunk(chunk);
+    return ok;
+}
+
+// A failure keeps whatever the path showed before; only the stamp moves on.
+static void record(const std::string& path, Sint64 mtime, const Uint64* hash) {
+    if (g_lock) SDL_LockMutex(g_lock);
+    WaveformPath& p = g_paths.emplace(path, WaveformPath{0, false, 0, 0}).first->second;
+    p.mtime = mtime;
+    p.checked = SDL_GetTicks();
+    if (hash) {
+        p.hash = *hash;
+        p.measured = true;
+    }
+    if (g_lock) SDL_UnlockMutex(g_lock);
+}
+
+static void measure(const std::string& path) {
+    // Stamped before reading, so a write part way through is seen next time.
+    Sint64 mtime = file_mtime(path);
+    std::vector<Uint8> data;
+    if (!read_file(path, &data)) {
+        log_warning("Cannot read sound for waveform: " + path);
+        record(path, mtime, nullptr);
+        return;
+    }
+    Uint64 hash = hash_bytes(data.data(), data.size());
+
+    if (g_lock) SDL_LockMutex(g_lock);
+    bool known = g_waveforms.find(hash) != g_waveforms.end();
+    if (g_lock) SDL_UnlockMutex(g_lock);
+    if (known) {
+        record(path, mtime, &hash);
+        return;
+    }
+
+    SoundWaveform wave;
+    if (!decode(data, &wave)) {
+        log_warning("Cannot decode sound for waveform: " + path);
+        record(path, mtime, nullptr);
+        return;
+    }
+
+    if (g_lock) SDL_LockMutex(g_lock);
+    g_waveforms[hash] = wave;
+    if (g_lock) SDL_UnlockMutex(g_lock);
+    record(path, mtime, &hash);
+}
+
+static int waveform_main(void*) {
+    SDL_LockMutex(g_lock);
+    while (true) {
+        while ((g_paused || g_queue.empty()) && !g_quit) SDL_CondWait(g_wake, g_lock);
+        if (g_quit) break;
+
+        std::string path = g_queue.back();
+        g_queue.pop_back();
+        g_working = true;
+        SDL_UnlockMutex(g_lock);
+
+        measure(path);
+
+        SDL_LockMutex(g_lock);
+        g_working = false;
+        SDL_CondBroadcast(g_idle);
+    }
+    SDL_UnlockMutex(g_lock);
+    return 0;
+}
+
+bool sound_waveform_init() {
+    if (g_thread) return true;
+    select_kernels();
+
+    g_lock = SDL_CreateMutex();
+    g_wake = SDL_CreateCond();
+    g_idle = SDL_CreateCond();
+    g_quit = false;
+    g_paused = false;
+    g_thread = SDL_CreateThread(waveform_main, "sound_waveform", nullptr);
+    return g_thread != nullptr;
+}
+
+void sound_waveform_shutdown() {
+    if (g_lock) {
+        SDL_LockMutex(g_lock);
+        g_quit = true;
+        SDL_CondBroadcast(g_wake);
+        SDL_UnlockMutex(g_lock);
+    }
+    if (g_thread) SDL_WaitThread(g_thread, nullptr);
+    g_thread = nullptr;
+
+    g_queue.clear();
+    g_requested.clear();
+    g_paths.clear();
+    g_waveforms.clear();
+
+    if (g_wake) SDL_DestroyCond(g_wake);
+    if (g_idle) SDL_DestroyCond(g_idle);
+    if (g_lock) SDL_DestroyMutex(g_lock);
+    g_wake = nullptr;
+    g_idle = nullptr;
+    g_lock = nullptr;
+}
+
+void sound_waveform_pause() {
+    if (!g_thread) return;
+    SDL_LockMutex(g_lock);
+    g_paused = true;
+    while (g_working) SDL_CondWait(g_idle, g_lock);
+    SDL_UnlockMutex(g_lock);
+}
+
+void sound_waveform_resume() {
+    if (!g_thread) return;
+    SDL_LockMutex(g_lock);
+    g_paused = false;
+    SDL_CondSignal(g_wake);
+    SDL_UnlockMutex(g_lock);
+}
+
+const char* sound_waveform_isa() {
+    return g_isa;
+}
+
+// Without a thread it is measured here.
+static void queue_locked(const std::string& path, bool* inline_measure) {
+    if (g_thread) {
+        g_queue.push_back(path);
+        SDL_CondSignal(g_wake);
+    } else {
+        *inline_measure = true;
+    }
+}
+
+const SoundWaveform* sound_waveform_get(const std::string& path) {
+    const SoundWaveform* wave = nullptr;
+    bool inline_measure = false;
+    bool recheck = false;
+    Sint64 seen = 0;
+
+    if (g_lock) SDL_LockMutex(g_lock);
+    auto known = g_paths.find(path);
+    if (known != g_paths.end()) {
+        WaveformPath& p = known->second;
+        if (p.measured) wave = &g_waveforms[p.hash];
+        Uint32 now = SDL_GetTicks();
+        if (now - p.checked >= WAVEFORM_RECHECK_MS) {
+            p.checked = now;
+            seen = p.mtime;
+            recheck = true;
+        }
+    } else if (g_requested.insert(path).second) {
+        queue_locked(path, &inline_measure);
+    }
+    if (g_lock) SDL_UnlockMutex(g_lock);
+
+    // A changed file is measured again; the old waveform shows until then.
+    Sint64 mtime = recheck ? file_mtime(path) : 0;
+    if (recheck && mtime != seen) {
+        if (g_lock) SDL_LockMutex(g_lock);
+        g_paths[path].mtime = mtime;
+        queue_locked(path, &inline_measure);
+        if (g_lock) SDL_UnlockMutex(g_lock);
+    }
+
+    if (inline_measure) {
+        measure(path);
+        auto measured = g_paths.find(path);
+        if (measured != g_paths.end() && measured->second.measured) {
+            wave = &g_waveforms[measured->second.hash];
+        }
+    }
+    return wave;
+}
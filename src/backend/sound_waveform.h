@@ -0,0 +1,34 @@
+#pragma once
+#include <SDL2/SDL.h>
+#include <string>
+
+// Waveform thumbnails for the sound panel. Files are read and decoded on a
+// background thread and reduced to the smallest and largest sample in each
+// of a fixed number of buckets. Results are kept by a hash of the file's
+// bytes, so the same clip added twice is only measured once; a file that
+// changes on disk is measured again.
+
+const int SOUND_WAVEFORM_BUCKETS = 64;
+
+struct SoundWaveform {
+    // -1..1 of full scale, mono.
+    float min[SOUND_WAVEFORM_BUCKETS];
+    float max[SOUND_WAVEFORM_BUCKETS];
+    float duration;
+};
+
+// Formats other than WAV are decoded through SDL_mixer at the device's
+// format, so sound_init starts this once the device is open and
+// sound_cleanup stops it before closing it.
+bool sound_waveform_init();
+void sound_waveform_shutdown();
+// Hold off decoding while the device is reopened; see sound_loader_pause.
+void sound_waveform_pause();
+void sound_waveform_resume();
+const char* sound_waveform_isa();
+
+// The waveform of a file, or nullptr until it is ready or if the file could
+// not be read. The first call queues it; the most recently asked for goes
+// first. A returned waveform stays valid until sound_waveform_shutdown, and
+// is returned until a changed file has been measured again.
+const SoundWaveform* sound_waveform_get(const std::string& path);
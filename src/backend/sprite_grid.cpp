@@ -0,0 +1,132 @@
+#include "sprite_grid.h"
+#include "sensing.h"
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+struct CellRange {
+    int x0, y0, x1, y1;
+};
+
+struct GridEntry {
+    Sprite* sprite;
+    CellRange cells;
+};
+
+static std::unordered_map<uint64_t, std::vector<GridEntry*>> g_cells;
+static std::unordered_map<const Sprite*, GridEntry> g_entries;
+
+static inline int cell_of(float v) {
+    return (int)std::floor(v / SPRITE_CELL_SIZE);
+}
+
+static inline uint64_t cell_key(int cx, int cy) {
+    return ((uint64_t)(uint32_t)cx << 32) | (uint32_t)cy;
+}
+
+static CellRange range_of(const SDL_FRect& r) {
+    CellRange c;
+    c.x0 = cell_of(r.x);
+    c.y0 = cell_of(r.y);
+    c.x1 = cell_of(r.x + r.w);
+    c.y1 = cell_of(r.y + r.h);
+    return c;
+}
+
+static void unlink(GridEntry* entry) {
+    const CellRange& c = entry->cells;
+    for (int cy = c.y0; cy <= c.y1; cy++) {
+        for (int cx = c.x0; cx <= c.x1; cx++) {
+            auto it = g_cells.find(cell_key(cx, cy));
+            if (it == g_cells.end()) continue;
+
+            std::vector<GridEntry*>& bucket = it->second;
+            auto pos = std::find(bucket.begin(), bucket.end(), entry);
+            if (pos != bucket.end()) {
+                *pos = bucket.back();
+                bucket.pop_back();
+            }
+            if (bucket.empty()) g_cells.erase(it);
+        }
+    }
+}
+
+static void link(GridEntry* entry) {
+    const CellRange& c = entry->cells;
+    for (int cy = c.y0; cy <= c.y1; cy++) {
+        for (int cx = c.x0; cx <= c.x1; cx++) {
+            g_cells[cell_key(cx, cy)].push_back(entry);
+        }
+    }
+}
+
+void sprite_grid_update(Sprite* sprite) {
+    if (!sprite) return;
+    if (!sprite->visible) {
+        sprite_grid_remove(sprite);
+        return;
+    }
+
+    CellRange next = range_of(sprite_touch_bounds(*sprite));
+
+    auto it = g_entries.find(sprite);
+    if (it != g_entries.end()) {
+        const CellRange& prev = it->second.cells;
+        if (prev.x0 == next.x0 && prev.y0 == next.y0 &&
+            prev.x1 == next.x1 && prev.y1 == next.y1) {
+            return;
+        }
+        unlink(&it->second);
+        it->second.cells = next;
+        link(&it->second);
+    } else {
+        GridEntry& entry = g_entries[sprite];
+        entry.sprite = sprite;
+        entry.cells = next;
+        link(&entry);
+    }
+}
+
+void sprite_grid_remove(const Sprite* sprite) {
+    auto it = g_entries.find(sprite);
+    if (it == g_entries.end()) return;
+
+    unlink(&it->second);
+    g_entries.erase(it);
+}
+
+void sprite_grid_clear() {
+    g_cells.clear();
+    g_entries.clear();
+}
+
+// Calls fn once per sprite filed near r. A sprite spanning several cells is
+// reported only from the first cell it shares with the query.
+template <typename Fn>
+static bool visit_rect(const SDL_FRect& r, Fn fn) {
+    CellRange q = range_of(r);
+    for (int cy = q.y0; cy <= q.y1; cy++) {
+        for (int cx = q.x0; cx <= q.x1; cx++) {
+            auto it = g_cells.find(cell_key(cx, cy));
+            if (it == g_cells.end()) continue;
+
+            for (GridEntry* e : it->second) {
+                if (cx != std::max(q.x0, e->cells.x0) ||
+                    cy != std::max(q.y0, e->cells.y0)) continue;
+                if (fn(e->sprite)) return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool sprite_grid_touching(const Sprite& self, const std::string& name) {
+    if (!self.visible) return false;
+
+    return visit_rect(sprite_touch_bounds(self), [&](Sprite* other) {
+        if (other == &self || other->name != name) return false;
+        return are_sprites_touching(self, *other);
+    });
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include "../common/definitions.h"
+#include <string>
+
+// Uniform hash grid over stage coordinates. Each visible sprite is filed
+// under every cell its rotated costume bounds overlap, so "touching sprite"
+// only runs exact mask tests against sprites in the same cells.
+
+const int SPRITE_CELL_SIZE = 64;
+
+// Refiles the sprite after it moved, turned, resized or changed costume.
+// Cheap when it is still in the same cells.
+void sprite_grid_update(Sprite* sprite);
+void sprite_grid_remove(const Sprite* sprite);
+void sprite_grid_clear();
+
+// True if any other visible sprite called `name` overlaps `self`.
+bool sprite_grid_touching(const Sprite& self, const std::string& name);
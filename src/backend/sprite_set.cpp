@@ -0,0 +1,82 @@
+#include "sprite_set.h"
+#include "sensing.h"
+#include "sprite_grid.h"
+#include "clone_pool.h"
+#include "../utils/logger.h"
+#include <memory>
+
+static std::vector<std::unique_ptr<SpriteEntry>> g_sprites;
+
+SpriteEntry* sprite_set_add(const std::string& name) {
+    g_sprites.emplace_back(new SpriteEntry());
+    SpriteEntry* e = g_sprites.back().get();
+    e->sprite.name = name;
+    log_info("Sprite added: " + name);
+    return e;
+}
+
+void sprite_set_remove(int index) {
+    if (index < 0 || index >= (int)g_sprites.size()) return;
+    clone_pool_delete_owner(g_sprites[index].get());
+    sprite_grid_remove(&g_sprites[index]->sprite);
+    log_info("Sprite removed: " + g_sprites[index]->sprite.name);
+    g_sprites.erase(g_sprites.begin() + index);
+}
+
+void sprite_set_clear() {
+    clone_pool_clear();
+    sprite_grid_clear();
+    g_sprites.clear();
+}
+
+int sprite_set_count() {
+    return (int)g_sprites.size();
+}
+
+SpriteEntry* sprite_set_at(int index) {
+    if (index < 0 || index >= (int)g_sprites.size()) return nullptr;
+    return g_sprites[index].get();
+}
+
+int sprite_set_index_of(const Sprite* sprite) {
+    for (size_t i = 0; i < g_sprites.size(); i++) {
+        if (&g_sprites[i]->sprite == sprite) return (int)i;
+    }
+    return -1;
+}
+
+SpriteEntry* sprite_set_find(const std::string& name) {
+    for (auto& e : g_sprites) {
+        if (e->sprite.name == name) return e.get();
+    }
+    return nullptr;
+}
+
+static bool pick_hit(const Sprite& s, int x, int y) {
+    Stage stage;
+    if (!s.visible || !s.texture || clone_pool_is_dying(&s)) return false;
+    return is_sprite_touching_mouse(s, stage, x, y);
+}
+
+Sprite* sprite_set_pick(int x, int y, SpriteEntry** owner) {
+    // Each sprite draws above its own clones, the newest clone nearest.
+    for (int i = (int)g_sprites.size() - 1; i >= 0; i--) {
+        SpriteEntry* e = g_sprites[i].get();
+        Sprite* hit = pick_hit(e->sprite, x, y) ? &e->sprite : nullptr;
+        for (Sprite* c = clone_pool_last(e); c && !hit; c = clone_pool_prev(c)) {
+            if (pick_hit(*c, x, y)) hit = c;
+        }
+        if (hit) {
+            if (owner) *owner = e;
+            return hit;
+        }
+    }
+    return nullptr;
+}
+
+std::string sprite_set_unique_name(const std::string& base) {
+    for (int n = (int)g_sprites.size() + 1; ; n++) {
+        std::string name = base + std::to_string(n);
+        if (!sprite_set_find(name)) return name;
+    }
+}
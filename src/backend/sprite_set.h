@@ -0,0 +1,32 @@
+#pragma once
+#include "../common/definitions.h"
+#include "block_pool.h"
+#include <string>
+
+// Every sprite on the stage together with the scripts written for it.
+// Entries are heap-allocated so runtimes and the touch grid can keep raw
+// pointers while sprites are added. Index order is layer order: the last
+// sprite draws on top.
+
+struct SpriteEntry {
+    Sprite sprite;
+    BlockPool blocks;
+    // Clones of this sprite, oldest first, threaded through the clone pool.
+    int clone_head = -1;
+    int clone_tail = -1;
+};
+
+SpriteEntry* sprite_set_add(const std::string& name);
+void sprite_set_remove(int index);
+void sprite_set_clear();
+
+int sprite_set_count();
+SpriteEntry* sprite_set_at(int index);
+int sprite_set_index_of(const Sprite* sprite);
+SpriteEntry* sprite_set_find(const std::string& name);
+
+// Topmost visible sprite or clone whose costume covers the point, or
+// nullptr. owner receives the entry whose scripts it runs.
+Sprite* sprite_set_pick(int x, int y, SpriteEntry** owner);
+
+std::string sprite_set_unique_name(const std::string& base);
@@ -0,0 +1,446 @@
+#include "synth.h"
+#include "audio_mixer.h"
+#include "../utils/logger.h"
+#include "../utils/cpu_features.h"
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+// One cycle per table, plus a copy of the first sample so interpolation
+// never wraps. Must stay a power of two.
+const int SYNTH_TABLE_SIZE = 2048;
+const int SYNTH_QUEUE_SIZE = 256;
+const int SYNTH_MAX_HARMONICS = 12;
+// Level of a single note, leaving room for chords before the limiter.
+const float SYNTH_NOTE_GAIN = 0.3f;
+// Fade for notes cut off by stop or to free a slot for a new note, which
+// waits for the fade to finish rather than overwrite a sounding note.
+const float SYNTH_CUT_SECONDS = 0.005f;
+// How far from where the previous note ended a new one may be asked for
+// and still continue the sequence.
+const float SYNTH_CHAIN_SLACK_SECONDS = 0.1f;
+
+struct Instrument {
+    const char* name;
+    float harmonics[SYNTH_MAX_HARMONICS];
+    float attack;
+    float decay;
+    float sustain;      // 0 lets the note die away even while held
+    float release;
+};
+
+static const Instrument INSTRUMENTS[SYNTH_INSTRUMENT_COUNT] = {
+    {"Piano",    {1.0f, 0.5f, 0.3f, 0.15f, 0.1f, 0.05f},                  0.005f, 1.2f,  0.0f, 0.3f},
+    {"Organ",    {1.0f, 0.8f, 0.0f, 0.6f, 0.0f, 0.4f, 0.0f, 0.3f},        0.01f,  0.05f, 0.9f, 0.08f},
+    {"Guitar",   {1.0f, 0.6f, 0.4f, 0.25f, 0.15f, 0.1f},                  0.003f, 0.6f,  0.1f, 0.2f},
+    {"Bass",     {1.0f, 0.3f, 0.1f},                                      0.01f,  0.3f,  0.6f, 0.1f},
+    {"Flute",    {1.0f, 0.1f, 0.05f},                                     0.06f,  0.1f,  0.8f, 0.12f},
+    {"Clarinet", {1.0f, 0.0f, 0.5f, 0.0f, 0.3f, 0.0f, 0.2f, 0.0f, 0.1f},  0.03f,  0.1f,  0.8f, 0.1f},
+    {"Marimba",  {1.0f, 0.0f, 0.0f, 0.4f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.15f}, 0.002f, 0.5f, 0.0f, 0.2f},
+    {"Synth Lead", {1.0f, 0.5f, 0.333f, 0.25f, 0.2f, 0.167f, 0.143f, 0.125f, 0.111f, 0.1f, 0.091f, 0.083f},
+                                                                          0.01f,  0.2f,  0.7f, 0.15f},
+};
+
+enum NoteStage {
+    NOTE_WAITING,
+    NOTE_ATTACK,
+    NOTE_DECAY,
+    NOTE_SUSTAIN,
+    NOTE_RELEASE,
+    NOTE_DONE
+};
+
+struct NoteEvent {
+    Uint64 start;
+    Uint64 off;         // frame the key is let go
+    int instrument;     // index into INSTRUMENTS
+    float inc;          // table steps per frame
+    float gain_l;
+    float gain_r;
+    int stop_serial;
+};
+
+struct SynthNote {
+    NoteEvent ev;
+    NoteStage stage;
+    float phase;
+    float level;
+    float slope;        // level change per frame
+    Uint32 stage_left;  // frames until the next stage
+    Uint64 serial;
+    bool cut;           // fading out over SYNTH_CUT_SECONDS
+};
+
+static float g_tables[SYNTH_INSTRUMENT_COUNT][SYNTH_TABLE_SIZE + 1];
+static bool g_ready = false;
+static int g_rate = 0;
+
+// Filled by the main thread, drained by the audio callback.
+static NoteEvent g_queue[SYNTH_QUEUE_SIZE];
+static SDL_atomic_t g_queue_write;
+static SDL_atomic_t g_queue_read;
+// Bumped by synth_stop_all; notes queued before it are dropped.
+static SDL_atomic_t g_stop_serial;
+
+// Audio thread only.
+static SynthNote g_notes[SYNTH_MAX_NOTES];
+static int g_seen_stop = 0;
+static Uint64 g_note_serial = 0;
+
+// Main thread only.
+static float g_tempo = SYNTH_DEFAULT_TEMPO;
+static std::unordered_map<const void*, Uint64> g_sequence_end;
+
+typedef void (*RenderFn)(float* mix, int frames, const float* table, float* phase, float inc,
+                         float env, float denv, float gl, float gr);
+
+// Adds frames of one note into float stereo mix: the table read at phase
+// with linear interpolation, scaled by an envelope moving by denv a frame.
+static void render_scalar(float* mix, int frames, const float* table, float* phase, float inc,
+                          float env, float denv, float gl, float gr) {
+    float p = *phase;
+    for (int i = 0; i < frames; i++) {
+        int idx = (int)p;
+        float frac = p - (float)idx;
+        float v = (table[idx] + (table[idx + 1] - table[idx]) * frac) * env;
+        mix[2 * i] += v * gl;
+        mix[2 * i + 1] += v * gr;
+        env += denv;
+        p += inc;
+        if (p >= (float)SYNTH_TABLE_SIZE) p -= (float)SYNTH_TABLE_SIZE;
+    }
+    *phase = p;
+}
+
+#ifdef BLOCKY_X86
+
+// Four frames per iteration. SSE2 has no gather, so only the table reads
+// are scalar.
+BLOCKY_TARGET("sse2")
+static void render_sse2(float* mix, int frames, const float* table, float* phase, float inc,
+                        float env, float denv, float gl, float gr) {
+    const float size = (float)SYNTH_TABLE_SIZE;
+    float lanes[4];
+    for (int k = 0; k < 4; k++) lanes[k] = std::fmod(*phase + inc * (float)k, size);
+    __m128 ph = _mm_loadu_ps(lanes);
+    __m128 e = _mm_setr_ps(env, env + denv, env + 2 * denv, env + 3 * denv);
+    const __m128 ph_step = _mm_set1_ps(4 * inc);
+    const __m128 e_step = _mm_set1_ps(4 * denv);
+    const __m128 wrap = _mm_set1_ps(size);
+    const __m128 inv_wrap = _mm_set1_ps(1.0f / size);
+    const __m128 g = _mm_setr_ps(gl, gr, gl, gr);
+
+    int i = 0;
+    alignas(16) int idx[4];
+    for (; i + 4 <= frames; i += 4) {
+        __m128i vi = _mm_cvttps_epi32(ph);
+        __m128 frac = _mm_sub_ps(ph, _mm_cvtepi32_ps(vi));
+        _mm_store_si128((__m128i*)idx, vi);
+        __m128 a = _mm_setr_ps(table[idx[0]], table[idx[1]], table[idx[2]], table[idx[3]]);
+        __m128 b = _mm_setr_ps(table[idx[0] + 1], table[idx[1] + 1], table[idx[2] + 1], table[idx[3] + 1]);
+        __m128 v = _mm_mul_ps(_mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), frac)), e);
+
+        __m128 lo = _mm_unpacklo_ps(v, v);
+        __m128 hi = _mm_unpackhi_ps(v, v);
+        _mm_storeu_ps(mix + 2 * i, _mm_add_ps(_mm_loadu_ps(mix + 2 * i), _mm_mul_ps(lo, g)));
+        _mm_storeu_ps(mix + 2 * i + 4, _mm_add_ps(_mm_loadu_ps(mix + 2 * i + 4), _mm_mul_ps(hi, g)));
+
+        // A step can cover several cycles for high notes.
+        ph = _mm_add_ps(ph, ph_step);
+        __m128 cycles = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_mul_ps(ph, inv_wrap)));
+        ph = _mm_sub_ps(ph, _mm_mul_ps(cycles, wrap));
+        e = _mm_add_ps(e, e_step);
+    }
+
+    _mm_storeu_ps(lanes, ph);
+    *phase = lanes[0];
+    render_scalar(mix + 2 * i, frames - i, table, phase, inc, env + denv * i, denv, gl, gr);
+}
+
+#endif
+
+static RenderFn g_render = render_scalar;
+static const char* g_isa = "scalar";
+
+static void select_kernels() {
+    g_render = render_scalar;
+    g_isa = cpu_level_name(CPU_SCALAR);
+#ifdef BLOCKY_X86
+    if (cpu_level() >= CPU_SSE2) {
+        g_render = render_sse2;
+        g_isa = cpu_level_name(CPU_SSE2);
+    }
+#endif
+}
+
+static void build_tables() {
+    for (int n = 0; n < SYNTH_INSTRUMENT_COUNT; n++) {
+        float* table = g_tables[n];
+        float peak = 0.0f;
+        for (int i = 0; i < SYNTH_TABLE_SIZE; i++) {
+            float t = 2.0f * 3.14159265f * (float)i / (float)SYNTH_TABLE_SIZE;
+            float v = 0.0f;
+            for (int h = 0; h < SYNTH_MAX_HARMONICS; h++) {
+                v += INSTRUMENTS[n].harmonics[h] * std::sin(t * (float)(h + 1));
+            }
+            table[i] = v;
+            peak = std::max(peak, std::fabs(v));
+        }
+        for (int i = 0; i < SYNTH_TABLE_SIZE; i++) table[i] /= peak;
+        table[SYNTH_TABLE_SIZE] = table[0];
+    }
+}
+
+static Uint32 seconds_to_frames(float seconds) {
+    return std::max<Uint32>(1, (Uint32)(seconds * (float)g_rate));
+}
+
+static void enter_release(SynthNote* n, float seconds) {
+    Uint32 frames = seconds_to_frames(seconds);
+    n->stage = NOTE_RELEASE;
+    n->slope = -n->level / (float)frames;
+    n->stage_left = frames;
+}
+
+static void cut_note(SynthNote* n) {
+    enter_release(n, SYNTH_CUT_SECONDS);
+    n->cut = true;
+}
+
+static void next_stage(SynthNote* n) {
+    const Instrument& inst = INSTRUMENTS[n->ev.instrument];
+    switch (n->stage) {
+        case NOTE_WAITING:
+            n->stage = NOTE_ATTACK;
+            n->level = 0.0f;
+            n->stage_left = seconds_to_frames(inst.attack);
+            n->slope = 1.0f / (float)n->stage_left;
+            break;
+        case NOTE_ATTACK:
+            n->stage = NOTE_DECAY;
+            n->level = 1.0f;
+            n->stage_left = seconds_to_frames(inst.decay);
+            n->slope = (inst.sustain - 1.0f) / (float)n->stage_left;
+            break;
+        case NOTE_DECAY:
+            n->level = inst.sustain;
+            if (inst.sustain <= 0.0f) {
+                n->stage = NOTE_DONE;
+                break;
+            }
+            n->stage = NOTE_SUSTAIN;
+            n->slope = 0.0f;
+            n->stage_left = 0xFFFFFFFFu;
+            break;
+        default:
+            n->stage = NOTE_DONE;
+            break;
+    }
+}
+
+// Mixes the part of the note inside the block starting at frame block,
+// splitting it wherever the envelope changes course.
+static void render_note(SynthNote* n, float* mix, int frames, Uint64 block) {
+    if (n->ev.start >= block + (Uint64)frames) return;
+    int t = n->ev.start > block ? (int)(n->ev.start - block) : 0;
+    if (n->stage == NOTE_WAITING) next_stage(n);
+    const float* table = g_tables[n->ev.instrument];
+
+    while (t < frames && n->stage != NOTE_DONE) {
+        Uint64 now = block + (Uint64)t;
+        int seg = frames - t;
+        if (n->stage < NOTE_RELEASE) {
+            if (n->ev.off <= now) {
+                enter_release(n, INSTRUMENTS[n->ev.instrument].release);
+                continue;
+            }
+            if (n->ev.off - now < (Uint64)seg) seg = (int)(n->ev.off - now);
+        }
+        if (n->stage_left < (Uint32)seg) seg = (int)n->stage_left;
+
+        g_render(mix + 2 * t, seg, table, &n->phase, n->ev.inc, n->level, n->slope,
+                 n->ev.gain_l, n->ev.gain_r);
+        n->level += n->slope * (float)seg;
+        t += seg;
+        if (n->stage != NOTE_SUSTAIN) {
+            n->stage_left -= (Uint32)seg;
+            if (n->stage_left == 0) next_stage(n);
+        }
+    }
+}
+
+// A free slot, or a note not yet started. Otherwise returns nullptr and,
+// unless a slot is already on its way to free, starts cutting the note
+// that will be missed least; the caller tries again next block.
+static SynthNote* take_slot() {
+    SynthNote* best = nullptr;
+    for (int i = 0; i < SYNTH_MAX_NOTES; i++) {
+        SynthNote* n = &g_notes[i];
+        if (n->stage == NOTE_DONE) return n;
+    }
+    for (int i = 0; i < SYNTH_MAX_NOTES; i++) {
+        SynthNote* n = &g_notes[i];
+        if (n->cut) return nullptr;
+        // Prefer notes already fading, then the quietest, then the oldest.
+        if (!best) {
+            best = n;
+            continue;
+        }
+        bool n_fading = n->stage == NOTE_RELEASE;
+        bool best_fading = best->stage == NOTE_RELEASE;
+        if (n_fading != best_fading) {
+            if (n_fading) best = n;
+        } else if (n->level != best->level) {
+            if (n->level < best->level) best = n;
+        } else if (n->serial < best->serial) {
+            best = n;
+        }
+    }
+    if (best->stage == NOTE_WAITING) return best;
+    cut_note(best);
+    return nullptr;
+}
+
+static void mix_notes(float* mix, int frames, void*) {
+    Uint64 block = audio_mixer_block_frame();
+
+    int stop = SDL_AtomicGet(&g_stop_serial);
+    if (stop != g_seen_stop) {
+        g_seen_stop = stop;
+        for (int i = 0; i < SYNTH_MAX_NOTES; i++) {
+            SynthNote* n = &g_notes[i];
+            if (n->stage == NOTE_WAITING) n->stage = NOTE_DONE;
+            else if (n->stage != NOTE_DONE) cut_note(n);
+        }
+    }
+
+    int read = SDL_AtomicGet(&g_queue_read);
+    int write = SDL_AtomicGet(&g_queue_write);
+    for (; read != write; read++) {
+        const NoteEvent& ev = g_queue[read & (SYNTH_QUEUE_SIZE - 1)];
+        if (ev.stop_serial != g_seen_stop) continue;
+        SynthNote* n = take_slot();
+        // Left queued, along with everything after it, until a slot frees.
+        if (!n) break;
+        n->ev = ev;
+        n->stage = NOTE_WAITING;
+        n->phase = 0.0f;
+        n->level = 0.0f;
+        n->slope = 0.0f;
+        n->stage_left = 0;
+        n->serial = ++g_note_serial;
+        n->cut = false;
+    }
+    SDL_AtomicSet(&g_queue_read, read);
+
+    for (int i = 0; i < SYNTH_MAX_NOTES; i++) {
+        if (g_notes[i].stage != NOTE_DONE) render_note(&g_notes[i], mix, frames, block);
+    }
+}
+
+bool synth_init() {
+    if (g_ready) return true;
+    if (!audio_mixer_ready()) return false;
+
+    g_rate = audio_mixer_rate();
+    select_kernels();
+    build_tables();
+    for (int i = 0; i < SYNTH_MAX_NOTES; i++) {
+        g_notes[i].stage = NOTE_DONE;
+        g_notes[i].cut = false;
+    }
+    SDL_AtomicSet(&g_queue_write, 0);
+    SDL_AtomicSet(&g_queue_read, 0);
+    SDL_AtomicSet(&g_stop_serial, 0);
+    g_seen_stop = 0;
+    g_sequence_end.clear();
+
+    audio_mixer_add_source(mix_notes, nullptr);
+    g_ready = true;
+    return true;
+}
+
+void synth_shutdown() {
+    if (!g_ready) return;
+    audio_mixer_remove_source(mix_notes, nullptr);
+    g_sequence_end.clear();
+    g_ready = false;
+}
+
+const char* synth_isa() {
+    return g_isa;
+}
+
+// Where a note or rest of length frames from owner starts, moving the
+// owner's sequence on past it.
+static Uint64 sequence_start(const void* owner, Uint64 frames) {
+    Uint64 now = audio_mixer_tick_frame();
+    Uint64 earliest = audio_mixer_next_frame();
+    Uint64 slack = (Uint64)(SYNTH_CHAIN_SLACK_SECONDS * (float)g_rate);
+
+    Uint64 start = now;
+    auto it = g_sequence_end.find(owner);
+    if (it != g_sequence_end.end() && it->second >= earliest && it->second <= now + slack) {
+        start = it->second;
+    }
+    g_sequence_end[owner] = start + frames;
+    return start;
+}
+
+void synth_play_note(const void* owner, float note, float beats, int instrument, float gain, float pan) {
+    if (!g_ready) return;
+    note = std::max(0.0f, std::min(note, 130.0f));
+    instrument = std::max(1, std::min(instrument, SYNTH_INSTRUMENT_COUNT));
+    gain = std::max(0.0f, std::min(gain, 1.0f)) * SYNTH_NOTE_GAIN;
+    pan = std::max(-1.0f, std::min(pan, 1.0f));
+
+    Uint64 frames = (Uint64)(synth_beats_to_seconds(beats) * (float)g_rate);
+    if (frames == 0) return;
+
+    int write = SDL_AtomicGet(&g_queue_write);
+    if (write - SDL_AtomicGet(&g_queue_read) >= SYNTH_QUEUE_SIZE) {
+        log_warning("Synth note queue full, note dropped");
+        return;
+    }
+
+    // Anything above Nyquist would only alias.
+    float freq = std::min(440.0f * std::pow(2.0f, (note - 69.0f) / 12.0f), (float)g_rate * 0.5f);
+    NoteEvent& ev = g_queue[write & (SYNTH_QUEUE_SIZE - 1)];
+    ev.start = sequence_start(owner, frames);
+    ev.off = ev.start + frames;
+    ev.instrument = instrument - 1;
+    ev.inc = freq * (float)SYNTH_TABLE_SIZE / (float)g_rate;
+    ev.gain_l = gain * std::min(1.0f, 1.0f - pan);
+    ev.gain_r = gain * std::min(1.0f, 1.0f + pan);
+    ev.stop_serial = SDL_AtomicGet(&g_stop_serial);
+    SDL_AtomicSet(&g_queue_write, write + 1);
+}
+
+void synth_rest(const void* owner, float beats) {
+    if (!g_ready) return;
+    Uint64 frames = (Uint64)(synth_beats_to_seconds(beats) * (float)g_rate);
+    if (frames > 0) sequence_start(owner, frames);
+}
+
+void synth_stop_all() {
+    if (!g_ready) return;
+    SDL_AtomicAdd(&g_stop_serial, 1);
+    g_sequence_end.clear();
+}
+
+void synth_set_tempo(float bpm) {
+    g_tempo = std::max(SYNTH_MIN_TEMPO, std::min(bpm, SYNTH_MAX_TEMPO));
+}
+
+float synth_get_tempo() {
+    return g_tempo;
+}
+
+float synth_beats_to_seconds(float beats) {
+    return std::max(0.0f, beats) * 60.0f / g_tempo;
+}
+
+const char* synth_instrument_name(int instrument) {
+    instrument = std::max(1, std::min(instrument, SYNTH_INSTRUMENT_COUNT));
+    return INSTRUMENTS[instrument - 1].name;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <SDL2/SDL.h>
+
+// A small synthesizer for the music blocks. Each instrument is a wavetable
+// built from a few harmonics with an ADSR envelope, so any pitch plays
+// without a sample for it. Notes are mixed as a source of the audio mixer
+// and start and stop on exact output frames.
+
+const int SYNTH_MAX_NOTES = 32;
+const int SYNTH_INSTRUMENT_COUNT = 8;
+const float SYNTH_DEFAULT_TEMPO = 60.0f;
+const float SYNTH_MIN_TEMPO = 20.0f;
+const float SYNTH_MAX_TEMPO = 500.0f;
+
+// Call after audio_mixer_init.
+bool synth_init();
+void synth_shutdown();
+const char* synth_isa();
+
+// note is a MIDI number, 60 being middle C; instrument counts from 1 like
+// the block's menu. A note or rest from the same owner that comes about
+// when the previous one ends starts exactly where it ended, so a script
+// alternating notes and rests keeps its rhythm whatever the frame timing.
+// owner only tags the sequence and is never dereferenced.
+void synth_play_note(const void* owner, float note, float beats, int instrument, float gain, float pan);
+void synth_rest(const void* owner, float beats);
+void synth_stop_all();
+
+void synth_set_tempo(float bpm);
+float synth_get_tempo();
+float synth_beats_to_seconds(float beats);
+const char* synth_instrument_name(int instrument);
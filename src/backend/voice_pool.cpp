@@ -0,0 +1,192 @@
+#include "voice_pool.h"
+#include "../utils/logger.h"
+#include <string>
+#include <algorithm>
+
+struct Voice {
+    const void* owner;
+    int priority;
+    float gain;
+    // Order the voice started in; lower is older.
+    Uint64 serial;
+};
+
+static Voice g_voices[VOICE_POOL_MAX];
+static int g_capacity = 0;
+static Uint64 g_serial = 0;
+static VoiceStealMode g_steal_mode = VOICE_STEAL_OLDEST;
+static VoiceStats g_stats;
+// When usage last dropped low enough to shrink, or 0 while it is not.
+static Uint32 g_low_since = 0;
+// Steals and drops as of the last report.
+static Uint64 g_reported_stolen = 0;
+static Uint64 g_reported_dropped = 0;
+static Uint32 g_reported_at = 0;
+
+static void set_capacity(int capacity) {
+    audio_mixer_set_voice_count(capacity);
+    g_capacity = capacity;
+    g_stats.capacity = g_capacity;
+}
+
+static void log_stats() {
+    log_info("Voices: " + std::to_string((unsigned long long)g_stats.played) + " played, " +
+             std::to_string((unsigned long long)g_stats.stolen) + " stolen, " +
+             std::to_string((unsigned long long)g_stats.dropped) + " dropped, peak " +
+             std::to_string(g_stats.peak_active) + "/" + std::to_string(g_capacity));
+    g_reported_stolen = g_stats.stolen;
+    g_reported_dropped = g_stats.dropped;
+    g_reported_at = SDL_GetTicks();
+}
+
+bool voice_pool_init() {
+    g_stats = VoiceStats();
+    g_serial = 0;
+    g_low_since = 0;
+    g_reported_stolen = 0;
+    g_reported_dropped = 0;
+    g_reported_at = 0;
+    if (!audio_mixer_ready()) return false;
+    set_capacity(VOICE_POOL_MIN);
+    return true;
+}
+
+void voice_pool_shutdown() {
+    if (g_capacity == 0) return;
+    audio_mixer_stop_all();
+    log_stats();
+    g_capacity = 0;
+}
+
+static int count_active() {
+    int active = 0;
+    for (int i = 0; i < g_capacity; i++) {
+        if (audio_mixer_voice_playing(i)) active++;
+    }
+    return active;
+}
+
+static int find_free() {
+    for (int i = 0; i < g_capacity; i++) {
+        if (!audio_mixer_voice_playing(i)) return i;
+    }
+    return -1;
+}
+
+static bool quieter_or_older(const Voice& a, const Voice& b) {
+    if (g_steal_mode == VOICE_STEAL_QUIETEST && a.gain != b.gain) {
+        return a.gain < b.gain;
+    }
+    return a.serial < b.serial;
+}
+
+static int find_victim(int priority) {
+    int victim = -1;
+    for (int i = 0; i < g_capacity; i++) {
+        const Voice& v = g_voices[i];
+        if (v.priority > priority) continue;
+        if (victim < 0) {
+            victim = i;
+            continue;
+        }
+        const Voice& best = g_voices[victim];
+        if (v.priority < best.priority ||
+            (v.priority == best.priority && quieter_or_older(v, best))) {
+            victim = i;
+        }
+    }
+    return victim;
+}
+
+int voice_pool_play(Mix_Chunk* chunk, const VoiceParams& sound, const VoiceParams& effects,
+                    const void* owner, int priority, Uint64 start) {
+    if (!chunk || g_capacity == 0) return -1;
+
+    int voice = find_free();
+    if (voice < 0 && g_capacity < VOICE_POOL_MAX) {
+        voice = g_capacity;
+        set_capacity(std::min(g_capacity + VOICE_POOL_STEP, VOICE_POOL_MAX));
+        g_stats.grows++;
+    }
+    if (voice < 0) {
+        voice = find_victim(priority);
+        if (voice < 0) {
+            g_stats.dropped++;
+            return -1;
+        }
+        g_stats.stolen++;
+    }
+
+    if (!audio_mixer_play(voice, chunk, sound, effects, start)) return -1;
+
+    Voice& v = g_voices[voice];
+    v.owner = owner;
+    v.priority = priority;
+    v.gain = sound.gain * effects.gain;
+    v.serial = ++g_serial;
+
+    g_stats.played++;
+    int active = count_active();
+    if (active > g_stats.peak_active) g_stats.peak_active = active;
+    g_low_since = 0;
+    return voice;
+}
+
+void voice_pool_set_effects(const void* owner, const VoiceParams& effects) {
+    for (int i = 0; i < g_capacity; i++) {
+        Voice& v = g_voices[i];
+        if (v.owner != owner || !audio_mixer_voice_playing(i)) continue;
+        audio_mixer_set_effects(i, effects);
+    }
+}
+
+void voice_pool_stop_all() {
+    if (g_capacity > 0) audio_mixer_stop_all();
+}
+
+void voice_pool_update() {
+    if (g_capacity == 0) return;
+
+    // Saturation shows up while it happens, not only in the shutdown line.
+    bool pressured = g_stats.stolen != g_reported_stolen || g_stats.dropped != g_reported_dropped;
+    if (pressured && SDL_GetTicks() - g_reported_at >= VOICE_POOL_REPORT_MS) log_stats();
+
+    if (g_capacity <= VOICE_POOL_MIN) return;
+
+    // Only the top voices can be released, since shrinking cuts off
+    // whatever still plays on them.
+    int target = g_capacity - VOICE_POOL_STEP;
+    bool top_idle = true;
+    for (int i = target; i < g_capacity && top_idle; i++) {
+        if (audio_mixer_voice_playing(i)) top_idle = false;
+    }
+    g_stats.active = count_active();
+    if (!top_idle || g_stats.active > target / 2) {
+        g_low_since = 0;
+        return;
+    }
+
+    Uint32 now = SDL_GetTicks();
+    if (g_low_since == 0) {
+        g_low_since = now;
+        return;
+    }
+    if (now - g_low_since < VOICE_POOL_SHRINK_DELAY_MS) return;
+
+    set_capacity(target < VOICE_POOL_MIN ? VOICE_POOL_MIN : target);
+    g_stats.shrinks++;
+    g_low_since = 0;
+}
+
+void voice_pool_set_steal_mode(VoiceStealMode mode) {
+    g_steal_mode = mode;
+}
+
+VoiceStealMode voice_pool_steal_mode() {
+    return g_steal_mode;
+}
+
+VoiceStats voice_pool_stats() {
+    g_stats.active = count_active();
+    return g_stats;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "audio_mixer.h"
+
+// Hands out audio mixer voices for sound effects. The pool grows when
+// every voice is busy, shrinks again after a quiet spell, and once it is
+// at VOICE_POOL_MAX a new sound takes over a playing one of no higher
+// priority instead of being dropped.
+
+const int VOICE_POOL_MIN = 16;
+const int VOICE_POOL_MAX = MIXER_MAX_VOICES;
+const int VOICE_POOL_STEP = 8;
+// How long usage must stay low before the pool gives voices back.
+const Uint32 VOICE_POOL_SHRINK_DELAY_MS = 3000;
+// Steals and drops are logged at most this often while they happen.
+const Uint32 VOICE_POOL_REPORT_MS = 5000;
+
+const int VOICE_PRIORITY_LOW = 0;
+const int VOICE_PRIORITY_NORMAL = 1;
+const int VOICE_PRIORITY_HIGH = 2;
+
+// Which voice to take among those of the lowest priority.
+enum VoiceStealMode {
+    VOICE_STEAL_OLDEST,
+    VOICE_STEAL_QUIETEST
+};
+
+struct VoiceStats {
+    int capacity;
+    int active;
+    int peak_active;
+    Uint64 played;
+    Uint64 stolen;
+    // Plays refused because every voice had a higher priority.
+    Uint64 dropped;
+    int grows;
+    int shrinks;
+};
+
+bool voice_pool_init();
+void voice_pool_shutdown();
+
+// Returns the voice the chunk plays on, or -1. owner only tags the voice
+// for voice_pool_set_effects and is never dereferenced. The chunk starts
+// on output frame start.
+int voice_pool_play(Mix_Chunk* chunk, const VoiceParams& sound, const VoiceParams& effects,
+                    const void* owner, int priority, Uint64 start);
+void voice_pool_set_effects(const void* owner, const VoiceParams& effects);
+void voice_pool_stop_all();
+// Once per frame; releases voices when the pool has been oversized for
+// long enough, and logs the stats if voices were stolen or dropped.
+void voice_pool_update();
+
+void voice_pool_set_steal_mode(VoiceStealMode mode);
+VoiceStealMode voice_pool_steal_mode();
+VoiceStats voice_pool_stats();
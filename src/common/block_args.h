@@ -0,0 +1,150 @@
+#ifndef BLOCK_ARGS_H
+#define BLOCK_ARGS_H
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "inline_vec.h"
+
+// Argument text is interned: a block keeps small ids and each distinct
+// string lives once in a shared table, so the record the interpreter walks
+// holds no std::string. Entries are counted by the argument lists holding
+// them and freed, id and all, when the last one lets go; the empty string
+// is id 0 and never freed. A deque keeps references stable as the table
+// grows, but a reference from arg_text only lasts while its id is held.
+
+typedef uint32_t ArgId;
+
+struct ArgTable {
+    std::deque<std::string> text;
+    std::vector<uint32_t> refs;
+    std::vector<ArgId> free_ids;
+    std::unordered_map<std::string, ArgId> ids;
+
+    ArgTable() {
+        text.push_back("");
+        refs.push_back(0);
+        ids[""] = 0;
+    }
+};
+
+// Never destroyed, so blocks in static pools can still let go of their
+// text at exit.
+inline ArgTable& arg_table() {
+    static ArgTable* table = new ArgTable();
+    return *table;
+}
+
+// Returns a held id; pair it with arg_release.
+inline ArgId arg_intern(const std::string& s) {
+    ArgTable& t = arg_table();
+    auto it = t.ids.find(s);
+    if (it != t.ids.end()) {
+        if (it->second) t.refs[it->second]++;
+        return it->second;
+    }
+    ArgId id;
+    if (!t.free_ids.empty()) {
+        id = t.free_ids.back();
+        t.free_ids.pop_back();
+        t.text[id] = s;
+    } else {
+        id = (ArgId)t.text.size();
+        t.text.push_back(s);
+        t.refs.push_back(0);
+    }
+    t.refs[id] = 1;
+    t.ids[s] = id;
+    return id;
+}
+
+inline void arg_retain(ArgId id) {
+    if (id) arg_table().refs[id]++;
+}
+
+inline void arg_release(ArgId id) {
+    if (!id) return;
+    ArgTable& t = arg_table();
+    if (--t.refs[id] > 0) return;
+    t.ids.erase(t.text[id]);
+    std::string().swap(t.text[id]);
+    t.free_ids.push_back(id);
+}
+
+inline const std::string& arg_text(ArgId id) {
+    return arg_table().text[id];
+}
+
+// Reads like a list of strings; writes go through set and push_back.
+// Holds one reference on each id in it.
+template <int N>
+struct BlockArgList {
+    InlineVec<ArgId, N> ids;
+
+    BlockArgList() {}
+    BlockArgList(const BlockArgList& o) : ids(o.ids) {
+        for (ArgId id : ids) arg_retain(id);
+    }
+    BlockArgList(BlockArgList&& o) noexcept : ids(std::move(o.ids)) {}
+    ~BlockArgList() { clear(); }
+
+    BlockArgList& operator=(const BlockArgList& o) {
+        if (this == &o) return *this;
+        for (ArgId id : o.ids) arg_retain(id);
+        clear();
+        ids = o.ids;
+        return *this;
+    }
+
+    BlockArgList& operator=(BlockArgList&& o) noexcept {
+        if (this == &o) return *this;
+        clear();
+        ids = std::move(o.ids);
+        return *this;
+    }
+
+    size_t size() const { return ids.size(); }
+    bool empty() const { return ids.empty(); }
+    const std::string& operator[](size_t i) const { return arg_text(ids[i]); }
+    const std::string& back() const { return arg_text(ids.back()); }
+
+    struct const_iterator {
+        const ArgId* p;
+        const std::string& operator*() const { return arg_text(*p); }
+        const_iterator& operator++() { ++p; return *this; }
+        bool operator!=(const const_iterator& o) const { return p != o.p; }
+    };
+    const_iterator begin() const { return const_iterator{ids.begin()}; }
+    const_iterator end() const { return const_iterator{ids.end()}; }
+
+    void set(size_t i, const std::string& s) {
+        ArgId id = arg_intern(s);
+        arg_release(ids[i]);
+        ids[i] = id;
+    }
+    void push_back(const std::string& s) { ids.push_back(arg_intern(s)); }
+    void resize(size_t n) {
+        for (size_t i = n; i < ids.size(); i++) arg_release(ids[i]);
+        ids.resize(n, 0);
+    }
+    void clear() {
+        for (ArgId id : ids) arg_release(id);
+        ids.clear();
+    }
+
+    BlockArgList& operator=(const std::vector<std::string>& v) {
+        clear();
+        for (const std::string& s : v) ids.push_back(arg_intern(s));
+        return *this;
+    }
+
+    std::vector<std::string> to_vector() const {
+        std::vector<std::string> v;
+        for (ArgId id : ids) v.push_back(arg_text(id));
+        return v;
+    }
+};
+
+#endif
@@ -12,9 +12,13 @@
 
 #include <string>
 #include <vector>
+#include <memory>
 #include <SDL2/SDL.h>
+#include "inline_vec.h"
+#include "block_args.h"
 
 struct Runtime;
+struct CollisionMask;
 
 const int DEFAULT_TICK_RATE = 60;
 const int DEFAULT_MAX_TICKS = 60;
@@ -29,6 +33,9 @@ const int STAGE_Y      = 70;
 const int STAGE_WIDTH  = 460;
 const int STAGE_HEIGHT = 340;
 
+// Strip under the sprite panel listing every sprite.
+const int SPRITE_LIST_HEIGHT = 96;
+
 const int PALETTE_X      = 0;
 const int PALETTE_Y      = 70;
 const int PALETTE_WIDTH  = 200;
@@ -66,6 +73,7 @@ const int CONTROL_BLOCKS_COUNT = 8;
 const int LOOKS_BLOCKS_COUNT = 11;
 const int SOUND_BLOCKS_COUNT = 18;
 const int PEN_BLOCKS_COUNT = 22;
+const int MUSIC_BLOCKS_COUNT = 26;
 const int SENSING_BLOCKS_COUNT = 28;
 const int OPERATORS_BLOCKS_COUNT = 33;
 const int VARIABLE_BLOCKS_COUNT = 50;
@@ -74,17 +82,28 @@ struct Color {
     Uint8 r, g, b, a;
 };
 
+// A fresh id for a costume image; copies of a costume share theirs.
+inline Uint32 costume_next_image_id() {
+    static Uint32 next = 0;
+    return ++next;
+}
+
 struct Costume {
     std::string name;
     SDL_Texture* texture;
     int width;
     int height;
+    std::shared_ptr<const CollisionMask> mask;
+    // Identifies the pixels in texture; take a new one whenever they
+    // change. 0 for no image.
+    Uint32 image_id;
 
     Costume()
         : name("")
         , texture(nullptr)
         , width(0)
         , height(0)
+        , image_id(0)
     {}
 
     Costume(const std::string& n, SDL_Texture* tex, int w, int h)
@@ -92,6 +111,7 @@ struct Costume {
         , texture(tex)
         , width(w)
         , height(h)
+        , image_id(tex ? costume_next_image_id() : 0)
     {}
 };
 
@@ -152,6 +172,13 @@ struct Sprite {
     Uint32 sayStartTime;
     float sayDuration;
     std::vector<Variable> variables;
+    // Sound effects in Scratch's units: 10 per semitone, -100..100 pan.
+    float pitchEffect;
+    float panEffect;
+    // Synth instrument for the music blocks, counting from 1.
+    int instrument;
+    // Index into the clone pool, or -1 for a sprite the user made.
+    int cloneSlot;
 
     Sprite()
         : x(STAGE_X + STAGE_WIDTH / 2.0f)
@@ -177,6 +204,10 @@ struct Sprite {
         , sayText("")
         , sayStartTime(0)
         , sayDuration(-1.0f)
+        , pitchEffect(0.0f)
+        , panEffect(0.0f)
+        , instrument(1)
+        , cloneSlot(-1)
     {}
 };
 
@@ -214,6 +245,7 @@ enum BlockType {
     // Sensing
     SENSE_TOUCHING_MOUSE,
     SENSE_TOUCHING_EDGE,
+    SENSE_TOUCHING_SPRITE,
     SENSE_KEY_PRESSED,
     SENSE_MOUSE_DOWN,
     SENSE_MOUSE_X,
@@ -279,47 +311,118 @@ enum BlockType {
     CMD_FOREVER,
     CMD_REPEAT_UNTIL,
 
+    // Clones
+    CMD_CREATE_CLONE,
+    CMD_CLONE_START,
+    CMD_DELETE_CLONE,
+
+    // Sound effects
+    CMD_CHANGE_PITCH_EFFECT,
+    CMD_SET_PITCH_EFFECT,
+    CMD_CHANGE_PAN_EFFECT,
+    CMD_SET_PAN_EFFECT,
+    CMD_CLEAR_SOUND_EFFECTS,
+
+    // Music
+    CMD_PLAY_NOTE,
+    CMD_REST,
+    CMD_SET_INSTRUMENT,
+    CMD_SET_TEMPO,
+
 };
 
-struct Block {
-    int id;
-    BlockType type;
+struct Block;
+
+const int BLOCK_INLINE_ARGS = 3;
+
+// Editor-side record: placement and drag state, only used by the UI. The
+// block pool keeps these in slabs parallel to the blocks, indexed by the
+// same slot, so the interpreter never pulls them into cache.
+struct BlockLayout {
     float x, y;
     float width, height;
-    bool dragging;
-    bool hasBreakpoint;
     float drag_offset_x;
     float drag_offset_y;
-    std::vector<std::string> args;
-    std::vector<Block*> argBlocks;
     SDL_Color color;
-
-    Block* parent;
+    bool dragging;
     bool is_snapped;
+
+    // Filled in by spatial_grid_layout_tree whenever the script changes:
+    // the height of the block with its inner chain, and the box covering
+    // it, its arguments, inner chain and every block after it.
+    int total_height;
+    SDL_Rect bounds;
+
+    BlockLayout()
+        : x(0), y(0)
+        , width(BLOCK_WIDTH), height(BLOCK_HEIGHT)
+        , drag_offset_x(0), drag_offset_y(0)
+        , color({100, 100, 255, 255})
+        , dragging(false)
+        , is_snapped(false)
+        , total_height(BLOCK_HEIGHT)
+        , bounds({0, 0, BLOCK_WIDTH, BLOCK_HEIGHT})
+    {}
+};
+
+// Execution-side record: everything the interpreter reads or writes while a
+// script runs. Links and flags fill the first cache line; argument text is
+// interned, so the whole record is two lines. layout points at the block's
+// entry in its pool's layout slab, or at a caller's BlockLayout for a
+// block drawn outside any pool; slot is its index in the pool, or
+// UINT32_MAX outside one.
+//
+// Copying a block copies its layout values into the target's own layout
+// and leaves the target's layout pointer and slot alone.
+struct alignas(64) Block {
+    int id;
+    BlockType type;
     Block* next;
     Block* inner;
+    Block* parent;
+    BlockLayout* layout;
+    Uint32 slot;
 
     bool is_running;
     bool has_executed;
+    bool hasBreakpoint;
     Uint32 glow_start_time;
 
+    InlineVec<Block*, BLOCK_INLINE_ARGS> argBlocks;
+    BlockArgList<BLOCK_INLINE_ARGS> args;
+
     Block()
         : id(0)
         , type(CMD_NONE)
-        , x(0), y(0)
-        , width(BLOCK_WIDTH), height(BLOCK_HEIGHT)
-        , dragging(false)
-        , hasBreakpoint(false)
-        , drag_offset_x(0), drag_offset_y(0)
-        , color({100, 100, 255, 255})
-        , parent(nullptr)
-        , is_snapped(false)
         , next(nullptr)
         , inner(nullptr)
+        , parent(nullptr)
+        , layout(nullptr)
+        , slot(UINT32_MAX)
         , is_running(false)
         , has_executed(false)
+        , hasBreakpoint(false)
         , glow_start_time(0)
     {}
+
+    Block(const Block&) = delete;
+
+    Block& operator=(const Block& o) {
+        if (this == &o) return *this;
+        id = o.id;
+        type = o.type;
+        next = o.next;
+        inner = o.inner;
+        parent = o.parent;
+        is_running = o.is_running;
+        has_executed = o.has_executed;
+        hasBreakpoint = o.hasBreakpoint;
+        glow_start_time = o.glow_start_time;
+        argBlocks = o.argBlocks;
+        args = o.args;
+        if (layout && o.layout) *layout = *o.layout;
+        return *this;
+    }
 };
 
 struct PaletteItem {
@@ -399,7 +502,8 @@ enum BlockCategory {
     CAT_PEN,
     CAT_SENSING,
     CAT_OPERATORS,
-    CAT_VARIABLES
+    CAT_VARIABLES,
+    CAT_MUSIC
 };
 
 #endif
@@ -24,6 +24,7 @@ const SDL_Color COLOR_LOOKS      = {153, 102, 255, 255};
 const SDL_Color COLOR_EVENTS     = {255, 213, 0,   255};
 const SDL_Color COLOR_SOUND      = {207, 99,  207, 255};
 const SDL_Color COLOR_PEN        = {0,   171, 132, 255};
+const SDL_Color COLOR_MUSIC      = {15,  150, 190, 255};
 const SDL_Color COLOR_OPERATOR   = {76,  151, 64,  255};
 const SDL_Color COLOR_SENSING    = {255, 102, 102, 255};
 const SDL_Color COLOR_VARIABLE   = {255, 128, 0,   255};
@@ -0,0 +1,156 @@
+#ifndef INLINE_VEC_H
+#define INLINE_VEC_H
+
+#include <cstdint>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Vector with room for N elements inside the object itself. Block inputs
+// almost never exceed that, so the common case costs no heap allocation;
+// larger lists (custom block parameters) spill to the heap transparently.
+template <typename T, int N>
+struct InlineVec {
+    T* ptr;
+    uint32_t count;
+    uint32_t cap;
+    alignas(T) unsigned char local[N * sizeof(T)];
+
+    InlineVec() : ptr(local_data()), count(0), cap(N) {}
+
+    InlineVec(const InlineVec& o) : ptr(local_data()), count(0), cap(N) {
+        append_copy(o.ptr, o.count);
+    }
+
+    InlineVec(InlineVec&& o) noexcept : ptr(local_data()), count(0), cap(N) {
+        take(o);
+    }
+
+    ~InlineVec() {
+        clear();
+        release_heap();
+    }
+
+    InlineVec& operator=(const InlineVec& o) {
+        if (this != &o) {
+            clear();
+            append_copy(o.ptr, o.count);
+        }
+        return *this;
+    }
+
+    InlineVec& operator=(InlineVec&& o) noexcept {
+        if (this != &o) {
+            clear();
+            release_heap();
+            take(o);
+        }
+        return *this;
+    }
+
+    InlineVec& operator=(const std::vector<T>& v) {
+        clear();
+        append_copy(v.data(), (uint32_t)v.size());
+        return *this;
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    bool is_inline() const { return ptr == local_data(); }
+
+    T& operator[](size_t i) { return ptr[i]; }
+    const T& operator[](size_t i) const { return ptr[i]; }
+    T& back() { return ptr[count - 1]; }
+    const T& back() const { return ptr[count - 1]; }
+
+    T* begin() { return ptr; }
+    T* end() { return ptr + count; }
+    const T* begin() const { return ptr; }
+    const T* end() const { return ptr + count; }
+
+    void reserve(size_t n) {
+        if (n <= cap) return;
+        T* fresh = static_cast<T*>(::operator new(n * sizeof(T)));
+        for (uint32_t i = 0; i < count; i++) {
+            new (fresh + i) T(std::move(ptr[i]));
+            ptr[i].~T();
+        }
+        release_heap();
+        ptr = fresh;
+        cap = (uint32_t)n;
+    }
+
+    void push_back(const T& v) {
+        T tmp(v);
+        push_back(std::move(tmp));
+    }
+
+    void push_back(T&& v) {
+        if (count == cap) reserve(cap * 2);
+        new (ptr + count) T(std::move(v));
+        count++;
+    }
+
+    void resize(size_t n) { resize(n, T()); }
+
+    void resize(size_t n, const T& fill) {
+        while (count > n) {
+            ptr[--count].~T();
+        }
+        if (n > count) {
+            T tmp(fill);
+            reserve(n);
+            while (count < n) {
+                new (ptr + count) T(tmp);
+                count++;
+            }
+        }
+    }
+
+    void clear() {
+        for (uint32_t i = 0; i < count; i++) {
+            ptr[i].~T();
+        }
+        count = 0;
+    }
+
+private:
+    T* local_data() { return reinterpret_cast<T*>(local); }
+    const T* local_data() const { return reinterpret_cast<const T*>(local); }
+
+    void release_heap() {
+        if (!is_inline()) {
+            ::operator delete(ptr);
+            ptr = local_data();
+            cap = N;
+        }
+    }
+
+    void append_copy(const T* src, uint32_t n) {
+        reserve(count + n);
+        for (uint32_t i = 0; i < n; i++) {
+            new (ptr + count) T(src[i]);
+            count++;
+        }
+    }
+
+    void take(InlineVec& o) {
+        if (o.is_inline()) {
+            for (uint32_t i = 0; i < o.count; i++) {
+                new (ptr + i) T(std::move(o.ptr[i]));
+            }
+            count = o.count;
+            o.clear();
+        } else {
+            ptr = o.ptr;
+            count = o.count;
+            cap = o.cap;
+            o.ptr = o.local_data();
+            o.count = 0;
+            o.cap = N;
+        }
+    }
+};
+
+#endif
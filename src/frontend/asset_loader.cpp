@@ -0,0 +1,195 @@
+#include "asset_loader.h"
+#include "texture_cache.h"
+#include "../backend/collision.h"
+#include "../utils/logger.h"
+#include <SDL2/SDL_image.h>
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+struct AssetJob {
+    std::string path;
+    bool build_mask;
+    AssetReadyFn on_ready;
+    SDL_Surface* surface;
+    // Backs surface's pixels when they came from the texture cache.
+    MappedFile mapping;
+    std::shared_ptr<const CollisionMask> mask;
+    std::string error;
+};
+
+static std::vector<SDL_Thread*> g_workers;
+static SDL_mutex* g_lock = nullptr;
+static SDL_cond* g_wake = nullptr;
+static std::deque<AssetJob*> g_queue;
+static std::deque<AssetJob*> g_done;
+static bool g_quit = false;
+static int g_pending = 0;
+
+static SDL_Texture* g_placeholder = nullptr;
+
+// Decoding to the renderer's usual native format here saves
+// SDL_CreateTextureFromSurface a conversion on the render thread. A fresh
+// texture cache entry skips the decode altogether.
+static void decode(AssetJob* job) {
+    SDL_Surface* loaded = texture_cache_load(job->path, &job->mapping);
+    if (!loaded) {
+        loaded = IMG_Load(job->path.c_str());
+        if (!loaded) {
+            job->error = IMG_GetError();
+            return;
+        }
+        SDL_Surface* converted = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_ARGB8888, 0);
+        if (converted) {
+            SDL_FreeSurface(loaded);
+            loaded = converted;
+        }
+        texture_cache_store(job->path, loaded);
+    }
+    job->surface = loaded;
+    if (job->build_mask) job->mask = collision_mask_from_surface(loaded);
+}
+
+static int worker_main(void*) {
+    SDL_LockMutex(g_lock);
+    while (true) {
+        while (g_queue.empty() && !g_quit) SDL_CondWait(g_wake, g_lock);
+        if (g_quit) break;
+
+        AssetJob* job = g_queue.front();
+        g_queue.pop_front();
+        SDL_UnlockMutex(g_lock);
+
+        decode(job);
+
+        SDL_LockMutex(g_lock);
+        g_done.push_back(job);
+    }
+    SDL_UnlockMutex(g_lock);
+    return 0;
+}
+
+void asset_loader_init(int worker_count) {
+    if (g_lock) return;
+    texture_cache_init();
+
+    if (worker_count <= 0) worker_count = std::min(std::max(SDL_GetCPUCount() - 1, 1), 8);
+
+    g_lock = SDL_CreateMutex();
+    g_wake = SDL_CreateCond();
+    g_quit = false;
+    for (int i = 0; i < worker_count; i++) {
+        SDL_Thread* t = SDL_CreateThread(worker_main, "asset_decode", nullptr);
+        if (!t) {
+            log_warning(std::string("Asset loader: cannot start worker: ") + SDL_GetError());
+            break;
+        }
+        g_workers.push_back(t);
+    }
+    log_info("Asset loader: " + std::to_string(g_workers.size()) + " decode thread(s)");
+}
+
+static void free_job(AssetJob* job) {
+    if (job->surface) SDL_FreeSurface(job->surface);
+    mapped_file_close(&job->mapping);
+    delete job;
+}
+
+void asset_loader_shutdown() {
+    if (!g_lock) return;
+
+    SDL_LockMutex(g_lock);
+    g_quit = true;
+    SDL_CondBroadcast(g_wake);
+    SDL_UnlockMutex(g_lock);
+    for (SDL_Thread* t : g_workers) SDL_WaitThread(t, nullptr);
+    g_workers.clear();
+
+    for (AssetJob* job : g_queue) free_job(job);
+    for (AssetJob* job : g_done) free_job(job);
+    g_queue.clear();
+    g_done.clear();
+    g_pending = 0;
+
+    SDL_DestroyCond(g_wake);
+    SDL_DestroyMutex(g_lock);
+    g_wake = nullptr;
+    g_lock = nullptr;
+
+    if (g_placeholder) SDL_DestroyTexture(g_placeholder);
+    g_placeholder = nullptr;
+}
+
+void asset_load_image(const std::string& path, bool build_mask, AssetReadyFn on_ready) {
+    AssetJob* job = new AssetJob();
+    job->path = path;
+    job->build_mask = build_mask;
+    job->on_ready = on_ready;
+    job->surface = nullptr;
+    g_pending++;
+
+    // Without workers (threads unavailable, or init not run) the decode
+    // happens inline; the callback still waits for the next pump.
+    if (g_workers.empty()) {
+        decode(job);
+        g_done.push_back(job);
+        return;
+    }
+
+    SDL_LockMutex(g_lock);
+    g_queue.push_back(job);
+    SDL_CondSignal(g_wake);
+    SDL_UnlockMutex(g_lock);
+}
+
+int asset_loader_pump(SDL_Renderer* renderer) {
+    if (g_pending == 0) return 0;
+
+    std::deque<AssetJob*> ready;
+    if (g_lock) SDL_LockMutex(g_lock);
+    ready.swap(g_done);
+    if (g_lock) SDL_UnlockMutex(g_lock);
+
+    for (AssetJob* job : ready) {
+        LoadedImage image;
+        image.texture = nullptr;
+        image.surface = job->surface;
+        image.mask = job->mask;
+
+        if (job->surface) {
+            image.texture = SDL_CreateTextureFromSurface(renderer, job->surface);
+            if (image.texture) {
+                SDL_SetTextureBlendMode(image.texture, SDL_BLENDMODE_BLEND);
+            } else {
+                log_warning("Asset loader: upload failed for " + job->path + ": " + SDL_GetError());
+            }
+        } else {
+            log_warning("Asset loader: failed to load " + job->path + " - " + job->error);
+        }
+
+        if (job->on_ready) job->on_ready(renderer, image);
+        free_job(job);
+        g_pending--;
+    }
+    return (int)ready.size();
+}
+
+SDL_Texture* asset_placeholder(SDL_Renderer* renderer) {
+    if (g_placeholder) return g_placeholder;
+
+    // A faint checker, so a sprite still loading is visibly there.
+    const int n = ASSET_PLACEHOLDER_SIZE;
+    std::vector<Uint32> pixels((size_t)n * n);
+    for (int y = 0; y < n; y++) {
+        for (int x = 0; x < n; x++) {
+            bool dark = ((x / 8) + (y / 8)) & 1;
+            pixels[(size_t)y * n + x] = dark ? 0x50808080u : 0x50C0C0C0u;
+        }
+    }
+    g_placeholder = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+                                      SDL_TEXTUREACCESS_STATIC, n, n);
+    if (!g_placeholder) return nullptr;
+    SDL_UpdateTexture(g_placeholder, nullptr, pixels.data(), n * (int)sizeof(Uint32));
+    SDL_SetTextureBlendMode(g_placeholder, SDL_BLENDMODE_BLEND);
+    return g_placeholder;
+}
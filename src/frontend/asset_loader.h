@@ -0,0 +1,39 @@
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H
+#include <SDL2/SDL.h>
+#include <functional>
+#include <memory>
+#include <string>
+
+struct CollisionMask;
+
+// Decodes images on a small pool of worker threads. Workers only turn
+// files into surfaces (and collision masks when asked); the texture upload
+// and the completion callback run on the render thread in
+// asset_loader_pump, so callers never touch SDL_Renderer off-thread.
+
+struct LoadedImage {
+    // nullptr when the file could not be decoded.
+    SDL_Texture* texture;
+    // Decoded pixels, freed once the callback returns.
+    SDL_Surface* surface;
+    std::shared_ptr<const CollisionMask> mask;
+};
+
+typedef std::function<void(SDL_Renderer* renderer, const LoadedImage& image)> AssetReadyFn;
+
+// worker_count 0 picks one per core, leaving one for the render thread.
+void asset_loader_init(int worker_count = 0);
+void asset_loader_shutdown();
+
+void asset_load_image(const std::string& path, bool build_mask, AssetReadyFn on_ready);
+
+// Uploads finished images and runs their callbacks. Call once per frame;
+// returns how many completed.
+int asset_loader_pump(SDL_Renderer* renderer);
+
+// Shared stand-in drawn while an image is still decoding.
+SDL_Texture* asset_placeholder(SDL_Renderer* renderer);
+const int ASSET_PLACEHOLDER_SIZE = 64;
+
+#endif
@@ -2,6 +2,7 @@
 #include "../utils/logger.h"
 #include "../common/globals.h"
 #include "draw.h"
+#include "asset_loader.h"
 #include <cstdio>
 #include <cstring>
 #include <cmath>
@@ -59,27 +60,47 @@ void bg_menu_destroy(BackgroundMenu* menu) {
     menu->item_count = 0;
 }
 
-int bg_menu_add_image(BackgroundMenu* menu, const char* name, const char* filepath, SDL_Renderer* renderer) {
+static int g_next_load_id = 1;
+
+int bg_menu_add_image(BackgroundMenu* menu, const char* name, const char* filepath) {
     if (menu->item_count >= MAX_BACKGROUNDS) {
         log_warning("BG: max backgrounds reached");
         return -1;
     }
-    SDL_Surface* surface = IMG_Load(filepath);
-    if (!surface) {
-        log_warning("BG: failed to load " + std::string(filepath));
-        return -1;
-    }
     int idx = menu->item_count;
+    int load_id = g_next_load_id++;
     menu->items[idx].name = name;
     menu->items[idx].filepath = filepath;
-    menu->items[idx].texture = SDL_CreateTextureFromSurface(renderer, surface);
-    menu->items[idx].width = surface->w;
-    menu->items[idx].height = surface->h;
+    menu->items[idx].texture = nullptr;
+    menu->items[idx].thumbnail = nullptr;
+    menu->items[idx].width = 0;
+    menu->items[idx].height = 0;
     menu->items[idx].is_solid_color = false;
-    menu->items[idx].thumbnail = create_thumbnail(renderer, menu->items[idx].texture, BG_THUMB_SIZE);
-    SDL_FreeSurface(surface);
+    menu->items[idx].load_id = load_id;
     menu->item_count++;
-    log_info("BG: added image background: " + std::string(name));
+
+    // Items can be removed or shifted before the decode finishes, so the
+    // result is matched by load id rather than by index.
+    asset_load_image(filepath, false, [menu, load_id](SDL_Renderer* r, const LoadedImage& image) {
+        BackgroundItem* item = nullptr;
+        for (int i = 0; i < menu->item_count; i++) {
+            if (menu->items[i].load_id == load_id) item = &menu->items[i];
+        }
+        if (!item) {
+            if (image.texture) SDL_DestroyTexture(image.texture);
+            return;
+        }
+        item->load_id = 0;
+        if (!image.texture) {
+            log_warning("BG: failed to load " + item->filepath);
+            return;
+        }
+        item->texture = image.texture;
+        item->width = image.surface->w;
+        item->height = image.surface->h;
+        item->thumbnail = create_thumbnail(r, item->texture, BG_THUMB_SIZE);
+        log_info("BG: added image background: " + item->name);
+    });
     return idx;
 }
 
@@ -92,6 +113,7 @@ int bg_menu_add_solid_color(BackgroundMenu* menu, const char* name, Uint8 r, Uin
     menu->items[idx].name = name;
     menu->items[idx].filepath = "";
     menu->items[idx].is_solid_color = true;
+    menu->items[idx].load_id = 0;
     menu->items[idx].solid_r = r;
     menu->items[idx].solid_g = g;
     menu->items[idx].solid_b = b;
@@ -269,7 +291,7 @@ int bg_menu_handle_click(BackgroundMenu* menu, int mx, int my, SDL_Renderer* ren
     if (mx >= add_img_btn.x && mx <= add_img_btn.x + add_img_btn.w && my >= add_img_btn.y && my <= add_img_btn.y + add_img_btn.h) {
         char default_name[32];
         snprintf(default_name, sizeof(default_name), "BG_%d", menu->item_count + 1);
-        bg_menu_add_image(menu, default_name, "../assets/default_bg.png", renderer);
+        bg_menu_add_image(menu, default_name, "../assets/default_bg.png");
         return 1;
     }
 
@@ -21,6 +21,8 @@ struct BackgroundItem {
     int height;
     bool is_solid_color;
     Uint8 solid_r, solid_g, solid_b;
+    // Non-zero while the image is still being decoded.
+    int load_id;
 
     BackgroundItem()
         : texture(nullptr)
@@ -29,6 +31,7 @@ struct BackgroundItem {
         , height(0)
         , is_solid_color(false)
         , solid_r(255), solid_g(255), solid_b(255)
+        , load_id(0)
     {}
 };
 
@@ -56,7 +59,9 @@ struct BackgroundMenu {
 void bg_menu_init(BackgroundMenu* menu, int panel_x, int panel_y);
 void bg_menu_destroy(BackgroundMenu* menu);
 
-int  bg_menu_add_image(BackgroundMenu* menu, const char* name, const char* filepath, SDL_Renderer* renderer);
+// The item is added at once and fills in when the image has been decoded
+// in the background; the menu must outlive the load.
+int  bg_menu_add_image(BackgroundMenu* menu, const char* name, const char* filepath);
 int  bg_menu_add_solid_color(BackgroundMenu* menu, const char* name, Uint8 r, Uint8 g, Uint8 b, SDL_Renderer* renderer);
 void bg_menu_remove_item(BackgroundMenu* menu, int index);
 void bg_menu_select(BackgroundMenu* menu, int index);
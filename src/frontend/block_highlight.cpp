@@ -10,7 +10,7 @@ void draw_block_execution_highlight(SDL_Renderer* renderer, Block* block, Uint32
         block->glow_start_time = current_time;
     }
 
-    SDL_Rect rect = {(int)block->x, (int)block->y, (int)block->width, (int)block->height};
+    SDL_Rect rect = {(int)block->layout->x, (int)block->layout->y, (int)block->layout->width, (int)block->layout->height};
 
     Uint32 elapsed = current_time - block->glow_start_time;
     int alpha = 150 + (int)(105.0f * sinf(elapsed * 0.005f));
@@ -25,9 +25,9 @@ void draw_block_execution_highlight(SDL_Renderer* renderer, Block* block, Uint32
         SDL_RenderDrawRect(renderer, &glow);
     }
 
-    Uint8 bright_r = (Uint8)fmin(block->color.r + 50, 255);
-    Uint8 bright_g = (Uint8)fmin(block->color.g + 50, 255);
-    Uint8 bright_b = (Uint8)fmin(block->color.b + 50, 255);
+    Uint8 bright_r = (Uint8)fmin(block->layout->color.r + 50, 255);
+    Uint8 bright_g = (Uint8)fmin(block->layout->color.g + 50, 255);
+    Uint8 bright_b = (Uint8)fmin(block->layout->color.b + 50, 255);
 
     SDL_SetRenderDrawColor(renderer, bright_r, bright_g, bright_b, 255);
     SDL_RenderFillRect(renderer, &rect);
@@ -38,7 +38,7 @@ void draw_block_execution_highlight(SDL_Renderer* renderer, Block* block, Uint32
 void draw_block_breakpoint_marker(SDL_Renderer* renderer, Block* block) {
     if (!block || !block->hasBreakpoint) return;
 
-    SDL_Rect rect = {(int)block->x, (int)block->y, (int)block->width, (int)block->height};
+    SDL_Rect rect = {(int)block->layout->x, (int)block->layout->y, (int)block->layout->width, (int)block->layout->height};
 
     SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255);
     for (int i = 0; i < 2; i++) {
@@ -46,5 +46,5 @@ void draw_block_breakpoint_marker(SDL_Renderer* renderer, Block* block) {
         SDL_RenderDrawRect(renderer, &bp);
     }
 
-    filledCircleRGBA(renderer, rect.x + 6, rect.y + (int)(block->height / 2), 4, 255, 0, 0, 255);
+    filledCircleRGBA(renderer, rect.x + 6, rect.y + (int)(block->layout->height / 2), 4, 255, 0, 0, 255);
 }
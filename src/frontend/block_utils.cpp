@@ -32,6 +32,15 @@ std::string block_get_label(BlockType type) {
         case CMD_STOP_ALL_SOUNDS:  return "Stop all sounds";
         case CMD_CHANGE_VOLUME:    return "Change volume by";
         case CMD_SET_VOLUME:       return "Set volume to";
+        case CMD_CHANGE_PITCH_EFFECT: return "Change pitch effect by";
+        case CMD_SET_PITCH_EFFECT:    return "Set pitch effect to";
+        case CMD_CHANGE_PAN_EFFECT:   return "Change pan effect by";
+        case CMD_SET_PAN_EFFECT:      return "Set pan effect to";
+        case CMD_CLEAR_SOUND_EFFECTS: return "Clear sound effects";
+        case CMD_PLAY_NOTE:      return "Play note (60) for (0.25) beats";
+        case CMD_REST:           return "Rest for (0.25) beats";
+        case CMD_SET_INSTRUMENT: return "Set instrument to (1)";
+        case CMD_SET_TEMPO:      return "Set tempo to (60)";
         case CMD_PEN_DOWN: return "pen down";
         case CMD_PEN_UP: return "pen up";
         case CMD_PEN_CLEAR: return "clear pen";
@@ -59,6 +68,7 @@ std::string block_get_label(BlockType type) {
         case OP_STR_LEN:    return "length of ( )";
         case OP_STR_CHAR:   return "letter ( 1 ) of ( )";
         case OP_STR_CONCAT: return "join ( ) ( )";
+        case SENSE_TOUCHING_SPRITE: return "touching [Cat]?";
         case SENSE_MOUSE_DOWN: return "mouse down?";
         case SENSE_MOUSE_X:    return "mouse x";
         case SENSE_MOUSE_Y:    return "mouse y";
@@ -74,6 +84,9 @@ std::string block_get_label(BlockType type) {
         case CMD_GOTO_MOUSE: return "go to mouse";
         case CMD_IF_ON_EDGE_BOUNCE: return "if on edge, bounce";
         case SENSE_DISTANCE_TO_MOUSE: return "Dist to mouse";
+        case CMD_CREATE_CLONE: return "Create clone of myself";
+        case CMD_CLONE_START:  return "When I start as a clone";
+        case CMD_DELETE_CLONE: return "Delete this clone";
 
         default:           return "Unknown";
     }
@@ -170,6 +183,9 @@ SDL_Color block_get_color(BlockType type) {
         case CMD_REPEAT:
         case CMD_IF:
         case CMD_WAIT:
+        case CMD_CREATE_CLONE:
+        case CMD_CLONE_START:
+        case CMD_DELETE_CLONE:
             return COLOR_CONTROL;
         case CMD_SAY:
         case CMD_SWITCH_COSTUME:
@@ -187,6 +203,11 @@ SDL_Color block_get_color(BlockType type) {
         case CMD_STOP_ALL_SOUNDS:
         case CMD_CHANGE_VOLUME:
         case CMD_SET_VOLUME:
+        case CMD_CHANGE_PITCH_EFFECT:
+        case CMD_SET_PITCH_EFFECT:
+        case CMD_CHANGE_PAN_EFFECT:
+        case CMD_SET_PAN_EFFECT:
+        case CMD_CLEAR_SOUND_EFFECTS:
             return COLOR_SOUND;
 
         case CMD_PEN_CLEAR:
@@ -196,6 +217,12 @@ SDL_Color block_get_color(BlockType type) {
         case CMD_PEN_STAMP:
         case CMD_PEN_UP:
             return COLOR_PEN;
+
+        case CMD_PLAY_NOTE:
+        case CMD_REST:
+        case CMD_SET_INSTRUMENT:
+        case CMD_SET_TEMPO:
+            return COLOR_MUSIC;
         
         case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV:
         case OP_MOD: case OP_ABS: case OP_FLOOR: case OP_CEIL:
@@ -205,7 +232,7 @@ SDL_Color block_get_color(BlockType type) {
         case OP_STR_LEN: case OP_STR_CHAR: case OP_STR_CONCAT:
             return COLOR_OPERATOR;
 
-        case SENSE_TOUCHING_MOUSE: case SENSE_TOUCHING_EDGE:
+        case SENSE_TOUCHING_MOUSE: case SENSE_TOUCHING_EDGE: case SENSE_TOUCHING_SPRITE:
         case SENSE_MOUSE_DOWN: case SENSE_MOUSE_X: case SENSE_MOUSE_Y:
         case SENSE_TIMER: case SENSE_RESET_TIMER:
             return COLOR_SENSING;
@@ -244,6 +271,22 @@ std::vector<std::string> get_default_args(BlockType type) {
         case CMD_SWITCH_COSTUME: return {"1"};
         case CMD_SET_SIZE:       return {"100"};
         case CMD_CHANGE_SIZE:    return {"10"};
+
+        case CMD_PLAY_SOUND:          return {"meow"};
+        case CMD_CHANGE_VOLUME:       return {"10"};
+        case CMD_SET_VOLUME:          return {"100"};
+        case CMD_CHANGE_PITCH_EFFECT: return {"10"};
+        case CMD_SET_PITCH_EFFECT:    return {"100"};
+        case CMD_CHANGE_PAN_EFFECT:   return {"10"};
+        case CMD_SET_PAN_EFFECT:      return {"100"};
+
+        case CMD_PLAY_NOTE:      return {"60", "0.25"};
+        case CMD_REST:           return {"0.25"};
+        case CMD_SET_INSTRUMENT: return {"1"};
+        case CMD_SET_TEMPO:      return {"60"};
+
+        case CMD_PEN_SET_COLOR: return {"0"};
+        case CMD_PEN_SET_SIZE:  return {"1"};
         
         case CMD_SET_VAR:     return {"score", "0"};
         case CMD_CHANGE_VAR:  return {"score", "1"};
@@ -263,6 +306,7 @@ std::vector<std::string> get_default_args(BlockType type) {
         case CMD_CALL_BLOCK:   return {"myBlock", "10"};
 
         case CMD_EVENT_KEY:    return {"space"};
+        case SENSE_TOUCHING_SPRITE: return {"Cat"};
 
         default:           return {};
     }
@@ -284,6 +328,13 @@ int get_arg_count(BlockType type) {
         case CMD_PLAY_SOUND:
         case CMD_CHANGE_VOLUME:
         case CMD_SET_VOLUME:
+        case CMD_CHANGE_PITCH_EFFECT:
+        case CMD_SET_PITCH_EFFECT:
+        case CMD_CHANGE_PAN_EFFECT:
+        case CMD_SET_PAN_EFFECT:
+        case CMD_REST:
+        case CMD_SET_INSTRUMENT:
+        case CMD_SET_TEMPO:
         case OP_ABS:
         case OP_FLOOR:
         case OP_CEIL:
@@ -296,9 +347,11 @@ int get_arg_count(BlockType type) {
         case CMD_PEN_SET_COLOR:
         case CMD_PEN_SET_SIZE:
         case CMD_EVENT_KEY:
+        case SENSE_TOUCHING_SPRITE:
             return 1;
 
         case CMD_GOTO:
+        case CMD_PLAY_NOTE:
         case OP_ADD:
         case OP_SUB:
         case OP_MUL:
@@ -330,6 +383,10 @@ int get_arg_count(BlockType type) {
         case CMD_GOTO_MOUSE: return 0;
         case CMD_IF_ON_EDGE_BOUNCE: return 0;
         case SENSE_DISTANCE_TO_MOUSE: return 0;
+        case CMD_CREATE_CLONE: return 0;
+        case CMD_CLONE_START: return 0;
+        case CMD_DELETE_CLONE: return 0;
+        case CMD_CLEAR_SOUND_EFFECTS: return 0;
 
         default:
             return 0;
@@ -349,24 +406,24 @@ SDL_Rect get_arg_box_rect(const Block& block, int arg_index) {
     if (is_reporter_block(block.type)) {
         rect.w = argWidth;
         rect.h = argHeight;
-        rect.y = (int)block.y + (block.height - argHeight) / 2;
+        rect.y = (int)block.layout->y + (block.layout->height - argHeight) / 2;
 
         if (count == 1) {
-            rect.x = (int)block.x + (int)block.width - margin - argWidth;
+            rect.x = (int)block.layout->x + (int)block.layout->width - margin - argWidth;
         } 
         else if (count == 2) {
             if (arg_index == 0) {
-                rect.x = (int)block.x + margin;
+                rect.x = (int)block.layout->x + margin;
             } else {
-                rect.x = (int)block.x + (int)block.width - margin - argWidth;
+                rect.x = (int)block.layout->x + (int)block.layout->width - margin - argWidth;
             }
         }
         return rect;
     }
 
     // Stack blocks: Arguments are OUTSIDE (to the right of) the block
-    rect.y = (int)block.y + (BLOCK_HEIGHT - argHeight) / 2;
-    rect.x = (int)block.x + (int)block.width + 5;
+    rect.y = (int)block.layout->y + (BLOCK_HEIGHT - argHeight) / 2;
+    rect.x = (int)block.layout->x + (int)block.layout->width + 5;
     
     rect.x += arg_index * (argWidth + margin);
 
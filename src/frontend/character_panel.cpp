@@ -180,7 +180,7 @@ int cpanel_handle_click(CharacterPanel* panel, int mx, int my) {
             SDL_Rect del_btn = {tx + CPANEL_THUMB_SIZE - 11, thumb_y + 2, 10, 10};
             if (mx >= del_btn.x && mx <= del_btn.x + del_btn.w && my >= del_btn.y && my <= del_btn.y + del_btn.h) {
                 cpanel_remove(panel, i);
-                return 100;
+                return 100 + i;
             }
         }
 
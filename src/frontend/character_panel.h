@@ -36,6 +36,8 @@ void cpanel_remove(CharacterPanel* panel, int index);
 void cpanel_select(CharacterPanel* panel, int index);
 void cpanel_toggle_visibility(CharacterPanel* panel, int index);
 void cpanel_render(CharacterPanel* panel, SDL_Renderer* renderer);
+// Returns the clicked item index, 100 + index for its delete button,
+// 200 + index for its visibility toggle, 300 for the add button, else -1.
 int cpanel_handle_click(CharacterPanel* panel, int mx, int my);
 int cpanel_get_selected(CharacterPanel* panel);
 
@@ -1,12 +1,17 @@
 #include "draw.h"
 #include "block_utils.h"
 #include "text_input.h"
+#include "spatial_grid.h"
+#include "workspace.h"
+#include "text_cache.h"
+#include "geom_batch.h"
+#include "../backend/sprite_set.h"
+#include "../backend/clone_pool.h"
+#include "sprite_atlas.h"
 #include "../common/globals.h"
-#include "../gfx/SDL2_gfxPrimitives.h"
-#include <SDL2/SDL_image.h>
-#include <iostream>
 #include <cmath>
 #include <algorithm>
+#include <map>
 #include "../utils/logger.h"
 #include "palette.h"
 #include "block_utils.h"
@@ -33,7 +38,7 @@ static void draw_shadow_rounded(SDL_Renderer* renderer, int x1, int y1, int x2,
                                  int radius, int offsetX, int offsetY, int layers) {
     for (int i = layers; i >= 1; i--) {
         Uint8 a = (Uint8)(10 * (layers + 1 - i));
-        roundedBoxRGBA(renderer,
+        geom_rounded_box(renderer,
             x1 + offsetX + i, y1 + offsetY + i,
             x2 + offsetX + i, y2 + offsetY + i,
             radius + i, 0, 0, 0, a);
@@ -58,10 +63,10 @@ static void draw_notch_top(SDL_Renderer* renderer, int bx, int by, SDL_Color col
         (Sint16)(by),
         (Sint16)(by)
     };
-    filledPolygonRGBA(renderer, vx, vy, 6, col.r, col.g, col.b, col.a);
+    geom_filled_polygon(renderer, vx, vy, 6, col.r, col.g, col.b, col.a);
 
     SDL_Color dk = color_darken(col, 0.7f);
-    aapolygonRGBA(renderer, vx, vy, 6, dk.r, dk.g, dk.b, 120);
+    geom_polygon(renderer, vx, vy, 6, dk.r, dk.g, dk.b, 120);
 }
 
 static void draw_notch_bottom(SDL_Renderer* renderer, int bx, int by_bottom, SDL_Color col) {
@@ -82,20 +87,20 @@ static void draw_notch_bottom(SDL_Renderer* renderer, int bx, int by_bottom, SDL
         (Sint16)(by_bottom),
         (Sint16)(by_bottom)
     };
-    filledPolygonRGBA(renderer, vx, vy, 6, col.r, col.g, col.b, col.a);
+    geom_filled_polygon(renderer, vx, vy, 6, col.r, col.g, col.b, col.a);
 
     SDL_Color dk = color_darken(col, 0.7f);
-    aapolygonRGBA(renderer, vx, vy, 6, dk.r, dk.g, dk.b, 80);
+    geom_polygon(renderer, vx, vy, 6, dk.r, dk.g, dk.b, 80);
 }
 
 static void draw_block_3d_highlight(SDL_Renderer* renderer, int bx, int by, int bw, int bh, int radius) {
-    roundedBoxRGBA(renderer,
+    geom_rounded_box(renderer,
         bx + 2, by + 1,
         bx + bw - 2, by + (bh / 3),
         radius, 255, 255, 255, 20);
 
-    hlineRGBA(renderer, bx + radius, bx + bw - radius, by + bh - 1, 0, 0, 0, 30);
-    hlineRGBA(renderer, bx + radius, bx + bw - radius, by + 1, 255, 255, 255, 15);
+    geom_hline(renderer, bx + radius, bx + bw - radius, by + bh - 1, 0, 0, 0, 30);
+    geom_hline(renderer, bx + radius, bx + bw - radius, by + 1, 255, 255, 255, 15);
 }
 
 static void draw_text_shadowed(SDL_Renderer* renderer, int x, int y,
@@ -103,26 +108,8 @@ static void draw_text_shadowed(SDL_Renderer* renderer, int x, int y,
     if (!g_font || text.empty()) return;
 
     SDL_Color shadow = {0, 0, 0, 60};
-    SDL_Surface* sSh = TTF_RenderUTF8_Blended(g_font, text.c_str(), shadow);
-    if (sSh) {
-        SDL_Texture* tSh = SDL_CreateTextureFromSurface(renderer, sSh);
-        if (tSh) {
-            SDL_Rect dst = {x + 1, y + 1, sSh->w, sSh->h};
-            SDL_RenderCopy(renderer, tSh, nullptr, &dst);
-            SDL_DestroyTexture(tSh);
-        }
-        SDL_FreeSurface(sSh);
-    }
-
-    SDL_Surface* surface = TTF_RenderUTF8_Blended(g_font, text.c_str(), color);
-    if (!surface) return;
-    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
-    if (texture) {
-        SDL_Rect dst = {x, y, surface->w, surface->h};
-        SDL_RenderCopy(renderer, texture, nullptr, &dst);
-        SDL_DestroyTexture(texture);
-    }
-    SDL_FreeSurface(surface);
+    text_cache_draw(renderer, g_font, x + 1, y + 1, text, shadow);
+    text_cache_draw(renderer, g_font, x, y, text, color);
 }
 
 static int measure_text_width(const std::string& text) {
@@ -133,40 +120,24 @@ static int measure_text_width(const std::string& text) {
 }
 
 
-SDL_Texture* load_texture(SDL_Renderer* renderer, const std::string& path) {
-    SDL_Surface* surface = IMG_Load(path.c_str());
-    if (!surface) {
-        std::cerr << "Failed to load image: " << path << " - " << IMG_GetError() << std::endl;
-        return nullptr;
-    }
-    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
-    SDL_FreeSurface(surface);
-    if (!texture) {
-        std::cerr << "Failed to create texture: " << SDL_GetError() << std::endl;
-    }
-    return texture;
-}
-
 void draw_filled_rect(SDL_Renderer* renderer, int x, int y, int w, int h, SDL_Color color) {
-    SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
-    SDL_Rect rect = {x, y, w, h};
-    SDL_RenderFillRect(renderer, &rect);
+    if (w <= 0 || h <= 0) return;
+    geom_box(renderer, x, y, x + w - 1, y + h - 1, color.r, color.g, color.b, color.a);
 }
 
 void draw_rect_outline(SDL_Renderer* renderer, int x, int y, int w, int h, SDL_Color color) {
-    SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
-    SDL_Rect rect = {x, y, w, h};
-    SDL_RenderDrawRect(renderer, &rect);
+    if (w <= 0 || h <= 0) return;
+    geom_rectangle(renderer, x, y, x + w - 1, y + h - 1, color.r, color.g, color.b, color.a);
 }
 
 void draw_block_glow(SDL_Renderer* renderer, const Block& block) {
     if (!block.is_running) return;
 
     log_info(" glowing block: " + std::to_string(block.id));
-    int bx = (int)block.x;
-    int by = (int)block.y;
-    int bw = (int)block.width;
-    int bh = (int)block.height;
+    int bx = (int)block.layout->x;
+    int by = (int)block.layout->y;
+    int bw = (int)block.layout->width;
+    int bh = (int)block.layout->height;
 
     Uint32 elapsed = SDL_GetTicks() - block.glow_start_time;
     float pulse = 0.5f + 0.5f * sinf(elapsed * 0.005f);
@@ -176,36 +147,243 @@ void draw_block_glow(SDL_Renderer* renderer, const Block& block) {
         float layerF = 1.0f - (float)i / 11.0f;
         Uint8 la = (Uint8)(alpha * layerF);
 
-        roundedBoxRGBA(renderer,
+        geom_rounded_box(renderer,
             bx - i, by - i, bx + bw + i, by + bh + i,
             8 + i, 255, 240, 70, (Uint8)(la * 0.2f));
-        roundedRectangleRGBA(renderer,
+        geom_rounded_rectangle(renderer,
             bx - i, by - i, bx + bw + i, by + bh + i,
             8 + i, 255, 255, 130, la);
     }
 }
 
+// === Block skins ===
+// Each block colour gets one atlas texture holding a template of every
+// block shape, shadows and notches included. draw_block then stretches
+// the flat middle of a template instead of re-rasterizing the primitives.
+
+enum BlockSkinPiece {
+    SKIN_REPORTER,
+    SKIN_COMMAND,
+    SKIN_HAT,
+    SKIN_C_BODY,
+    SKIN_C_FOOTER,
+    SKIN_PIECE_COUNT
+};
+
+static const int SKIN_PAD = 8;
+static const int SKIN_TEMPLATE_W = 64;
+static const int SKIN_C_BODY_H = 40;
+static const int SKIN_FOOTER_H = 22;
+
+struct SkinSlice {
+    int left, right, top, bottom;
+};
+
+struct SkinPieceInfo {
+    int content_h;
+    SkinSlice slice;
+};
+
+// Slice widths are measured from the template edge (padding excluded).
+static const SkinPieceInfo SKIN_PIECES[SKIN_PIECE_COUNT] = {
+    {26,            {22, 16, 0, 0}},
+    {BLOCK_HEIGHT,  {40, 12, 0, 0}},
+    {BLOCK_HEIGHT,  {40, 12, 0, 0}},
+    {SKIN_C_BODY_H, {20, 20, 12, 10}},
+    {SKIN_FOOTER_H, {40, 12, 0, 0}},
+};
+
+struct BlockSkin {
+    SDL_Texture* atlas;
+    int row_y[SKIN_PIECE_COUNT];
+};
+
+static std::map<Uint32, BlockSkin> g_skins;
+static bool g_skins_unsupported = false;
+
+static int skin_row_height(int piece) {
+    return SKIN_PIECES[piece].content_h + 2 * SKIN_PAD;
+}
+
+static void bake_skin_piece(SDL_Renderer* renderer, int piece, int oy, SDL_Color base) {
+    int bx = SKIN_PAD;
+    int by = oy + SKIN_PAD;
+    int bw = SKIN_TEMPLATE_W;
+    int bh = SKIN_PIECES[piece].content_h;
+    SDL_Color dark = color_darken(base, 0.65f);
+    SDL_Color darker = color_darken(base, 0.5f);
+
+    switch (piece) {
+        case SKIN_REPORTER:
+            draw_shadow_rounded(renderer, bx, by, bx + bw, by + bh, 12, 2, 2, 3);
+            geom_rounded_box(renderer, bx, by, bx + bw, by + bh, 12, base.r, base.g, base.b, base.a);
+            geom_rounded_box(renderer, bx + 2, by + 1, bx + bw - 2, by + bh / 3, 10, 255, 255, 255, 22);
+            geom_hline(renderer, bx + 12, bx + bw - 12, by + bh - 1, 0, 0, 0, 28);
+            geom_rounded_rectangle(renderer, bx, by, bx + bw, by + bh, 12, dark.r, dark.g, dark.b, 255);
+            break;
+
+        case SKIN_COMMAND:
+        case SKIN_HAT:
+            draw_shadow_rounded(renderer, bx, by, bx + bw, by + bh, 6, 2, 3, 4);
+            geom_rounded_box(renderer, bx, by, bx + bw, by + bh, 6, base.r, base.g, base.b, base.a);
+            if (piece == SKIN_COMMAND) {
+                draw_notch_top(renderer, bx, by, base);
+            }
+            draw_notch_bottom(renderer, bx, by + bh, base);
+            draw_block_3d_highlight(renderer, bx, by, bw, bh, 6);
+            geom_rounded_rectangle(renderer, bx, by, bx + bw, by + bh, 6, dark.r, dark.g, dark.b, 200);
+            break;
+
+        case SKIN_C_BODY: {
+            SDL_Color bodyCol = color_darken(base, 0.85f);
+            geom_rounded_box(renderer, bx, by, bx + bw, by + bh, 0, bodyCol.r, bodyCol.g, bodyCol.b, 255);
+
+            int innerX = bx + 14;
+            int innerY = by + 5;
+            int innerW = bw - 28;
+            int innerH = bh - 8;
+            geom_rounded_box(renderer, innerX, innerY, innerX + innerW, innerY + innerH,
+                           5, darker.r, darker.g, darker.b, 120);
+            geom_rounded_rectangle(renderer, innerX, innerY, innerX + innerW, innerY + innerH,
+                                 5, dark.r, dark.g, dark.b, 70);
+            geom_hline(renderer, innerX + 3, innerX + innerW - 3, innerY + 1, 0, 0, 0, 25);
+
+            geom_vline(renderer, bx, by, by + bh, dark.r, dark.g, dark.b, 200);
+            geom_vline(renderer, bx + bw, by, by + bh, dark.r, dark.g, dark.b, 200);
+            break;
+        }
+
+        case SKIN_C_FOOTER:
+            geom_rounded_box(renderer, bx, by, bx + bw, by + bh, 6, base.r, base.g, base.b, base.a);
+            draw_notch_bottom(renderer, bx, by + bh, base);
+            draw_block_3d_highlight(renderer, bx, by, bw, bh, 6);
+            geom_rounded_rectangle(renderer, bx, by, bx + bw, by + bh, 6, dark.r, dark.g, dark.b, 200);
+            break;
+    }
+}
+
+// Bakes on first use, so a colour dropped by draw_clear_block_skins is
+// rebuilt here the next time it is drawn.
+static const BlockSkin* get_block_skin(SDL_Renderer* renderer, SDL_Color base) {
+    if (g_skins_unsupported) return nullptr;
+
+    Uint32 key = ((Uint32)base.r << 24) | ((Uint32)base.g << 16) | ((Uint32)base.b << 8) | base.a;
+    auto it = g_skins.find(key);
+    if (it != g_skins.end()) return &it->second;
+
+    BlockSkin skin;
+    int h = 0;
+    for (int p = 0; p < SKIN_PIECE_COUNT; p++) {
+        skin.row_y[p] = h;
+        h += skin_row_height(p);
+    }
+    int w = SKIN_TEMPLATE_W + 2 * SKIN_PAD + 1;
+
+    skin.atlas = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888,
+                                   SDL_TEXTUREACCESS_TARGET, w, h);
+    if (!skin.atlas) {
+        log_warning("Block skins disabled - render targets unavailable: " + std::string(SDL_GetError()));
+        g_skins_unsupported = true;
+        return nullptr;
+    }
+    SDL_SetTextureBlendMode(skin.atlas, SDL_BLENDMODE_BLEND);
+
+    // Baking must not inherit the coding-area camera or clip.
+    geom_flush(renderer);
+    SDL_Texture* prevTarget = SDL_GetRenderTarget(renderer);
+    float sx, sy;
+    SDL_RenderGetScale(renderer, &sx, &sy);
+    SDL_Rect prevViewport;
+    SDL_RenderGetViewport(renderer, &prevViewport);
+    bool hadClip = SDL_RenderIsClipEnabled(renderer);
+    SDL_Rect prevClip;
+    SDL_RenderGetClipRect(renderer, &prevClip);
+    SDL_BlendMode prevBlend;
+    SDL_GetRenderDrawBlendMode(renderer, &prevBlend);
+    Uint8 pr, pg, pb, pa;
+    SDL_GetRenderDrawColor(renderer, &pr, &pg, &pb, &pa);
+
+    SDL_SetRenderTarget(renderer, skin.atlas);
+    SDL_RenderSetScale(renderer, 1.0f, 1.0f);
+    SDL_RenderSetViewport(renderer, nullptr);
+    SDL_RenderSetClipRect(renderer, nullptr);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+    SDL_RenderClear(renderer);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+
+    for (int p = 0; p < SKIN_PIECE_COUNT; p++) {
+        bake_skin_piece(renderer, p, skin.row_y[p], base);
+    }
+    geom_flush(renderer);
+
+    SDL_SetRenderTarget(renderer, prevTarget);
+    SDL_RenderSetScale(renderer, sx, sy);
+    SDL_RenderSetViewport(renderer, &prevViewport);
+    SDL_RenderSetClipRect(renderer, hadClip ? &prevClip : nullptr);
+    SDL_SetRenderDrawBlendMode(renderer, prevBlend);
+    SDL_SetRenderDrawColor(renderer, pr, pg, pb, pa);
+
+    return &g_skins.emplace(key, skin).first->second;
+}
+
+// Stretches the centre of a template to (x, y, w, h); corners and edges
+// keep their size. Pieces without vertical slices only stretch sideways.
+static void draw_skin_piece(SDL_Renderer* renderer, const BlockSkin& skin, int piece,
+                            int x, int y, int w, int h) {
+    const SkinSlice& sl = SKIN_PIECES[piece].slice;
+    int th = SKIN_PIECES[piece].content_h;
+    int tw = SKIN_TEMPLATE_W;
+    int oy = skin.row_y[piece];
+
+    int srcX[4] = {0, SKIN_PAD + sl.left, SKIN_PAD + tw - sl.right, tw + 2 * SKIN_PAD + 1};
+    int dstX[4] = {x - SKIN_PAD, x + sl.left, x + w - sl.right, x + w + SKIN_PAD + 1};
+
+    int srcY[4], dstY[4];
+    if (sl.top == 0 && sl.bottom == 0) {
+        srcY[0] = oy; srcY[1] = oy; srcY[2] = oy + th + 2 * SKIN_PAD; srcY[3] = srcY[2];
+        dstY[0] = y - SKIN_PAD; dstY[1] = dstY[0]; dstY[2] = y + h + SKIN_PAD; dstY[3] = dstY[2];
+    } else {
+        srcY[0] = oy;
+        srcY[1] = oy + SKIN_PAD + sl.top;
+        srcY[2] = oy + SKIN_PAD + th - sl.bottom;
+        srcY[3] = oy + th + 2 * SKIN_PAD;
+        dstY[0] = y - SKIN_PAD;
+        dstY[1] = y + sl.top;
+        dstY[2] = y + h - sl.bottom;
+        dstY[3] = y + h + SKIN_PAD;
+    }
+
+    for (int row = 0; row < 3; row++) {
+        for (int col = 0; col < 3; col++) {
+            SDL_Rect src = {srcX[col], srcY[row], srcX[col + 1] - srcX[col], srcY[row + 1] - srcY[row]};
+            SDL_Rect dst = {dstX[col], dstY[row], dstX[col + 1] - dstX[col], dstY[row + 1] - dstY[row]};
+            if (src.w <= 0 || src.h <= 0 || dst.w <= 0 || dst.h <= 0) continue;
+            geom_texture(renderer, skin.atlas, &src, &dst);
+        }
+    }
+}
+
+void draw_clear_block_skins() {
+    for (auto& entry : g_skins) {
+        SDL_DestroyTexture(entry.second.atlas);
+    }
+    g_skins.clear();
+}
+
 void draw_text(SDL_Renderer* renderer, int x, int y, const std::string& text, SDL_Color color) {
     if (!g_font || text.empty()) return;
-    SDL_Surface* surface = TTF_RenderUTF8_Blended(g_font, text.c_str(), color);
-    if (!surface) return;
-    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
-    if (texture) {
-        SDL_Rect dst = {x, y, surface->w, surface->h};
-        SDL_RenderCopy(renderer, texture, nullptr, &dst);
-        SDL_DestroyTexture(texture);
-    }
-    SDL_FreeSurface(surface);
+    text_cache_draw(renderer, g_font, x, y, text, color);
 }
 
 void draw_block(SDL_Renderer* renderer, const Block& block, const std::string& label) {
-    int bx = (int)block.x;
-    int by = (int)block.y;
-    int bw = (int)block.width;
+    int bx = (int)block.layout->x;
+    int by = (int)block.layout->y;
+    int bw = (int)block.layout->width;
     bool isReporter = is_reporter_block(block.type);
     int bh = isReporter ? 26 : BLOCK_HEIGHT;
 
-    SDL_Color base = block.color;
+    SDL_Color base = block.layout->color;
     if (block.is_running) {
         base = color_lighten(base, 50);
     }
@@ -218,20 +396,26 @@ void draw_block(SDL_Renderer* renderer, const Block& block, const std::string& l
 
     std::string textToDraw = label.empty() ? block_get_label(block.type) : label;
 
+    const BlockSkin* skin = get_block_skin(renderer, base);
+
     if (isReporter) {
-        draw_shadow_rounded(renderer, bx, by, bx + bw, by + bh, 12, 2, 2, 3);
+        if (skin) {
+            draw_skin_piece(renderer, *skin, SKIN_REPORTER, bx, by, bw, bh);
+        } else {
+            draw_shadow_rounded(renderer, bx, by, bx + bw, by + bh, 12, 2, 2, 3);
 
-        roundedBoxRGBA(renderer, bx, by, bx + bw, by + bh, 12, r, g, b, base.a);
+            geom_rounded_box(renderer, bx, by, bx + bw, by + bh, 12, r, g, b, base.a);
 
-        roundedBoxRGBA(renderer,
-            bx + 2, by + 1,
-            bx + bw - 2, by + bh / 3,
-            10, 255, 255, 255, 22);
+            geom_rounded_box(renderer,
+                bx + 2, by + 1,
+                bx + bw - 2, by + bh / 3,
+                10, 255, 255, 255, 22);
 
-        hlineRGBA(renderer, bx + 12, bx + bw - 12, by + bh - 1, 0, 0, 0, 28);
+            geom_hline(renderer, bx + 12, bx + bw - 12, by + bh - 1, 0, 0, 0, 28);
 
-        roundedRectangleRGBA(renderer, bx, by, bx + bw, by + bh, 12,
-                             dark.r, dark.g, dark.b, 255);
+            geom_rounded_rectangle(renderer, bx, by, bx + bw, by + bh, 12,
+                                 dark.r, dark.g, dark.b, 255);
+        }
 
         std::string opLabel = get_header_label(block.type);
         int tW = measure_text_width(opLabel);
@@ -245,32 +429,51 @@ void draw_block(SDL_Renderer* renderer, const Block& block, const std::string& l
         return;
     }
 
-    draw_shadow_rounded(renderer, bx, by, bx + bw, by + bh, 6, 2, 3, 4);
+    bool isEvent = (block.type == CMD_START || block.type == CMD_EVENT_CLICK ||
+                    block.type == CMD_CLONE_START);
+
+    if (skin) {
+        draw_skin_piece(renderer, *skin, isEvent ? SKIN_HAT : SKIN_COMMAND, bx, by, bw, bh);
+    } else {
+        draw_shadow_rounded(renderer, bx, by, bx + bw, by + bh, 6, 2, 3, 4);
 
-    roundedBoxRGBA(renderer, bx, by, bx + bw, by + bh, 6, r, g, b, base.a);
+        geom_rounded_box(renderer, bx, by, bx + bw, by + bh, 6, r, g, b, base.a);
 
-    bool isEvent = (block.type == CMD_START || block.type == CMD_EVENT_CLICK);
-    if (!isEvent) {
-        draw_notch_top(renderer, bx, by, base);
-    }
-    draw_notch_bottom(renderer, bx, by + bh, base);
+        if (!isEvent) {
+            draw_notch_top(renderer, bx, by, base);
+        }
+        draw_notch_bottom(renderer, bx, by + bh, base);
 
-    draw_block_3d_highlight(renderer, bx, by, bw, bh, 6);
+        draw_block_3d_highlight(renderer, bx, by, bw, bh, 6);
 
-    roundedRectangleRGBA(renderer, bx, by, bx + bw, by + bh, 6,
-                         dark.r, dark.g, dark.b, 200);
+        geom_rounded_rectangle(renderer, bx, by, bx + bw, by + bh, 6,
+                             dark.r, dark.g, dark.b, 200);
+    }
 
     std::string headerText = get_header_label(block.type);
     draw_text_shadowed(renderer, bx + 10, by + 10, headerText, COLOR_WHITE);
 
-    int totalH = get_total_height((Block*)&block);
+    int totalH = block.layout->total_height;
     int bodyY = by + bh;
     int bodyH = totalH - bh;
 
-    if (bodyH > 0) {
+    const SkinSlice& bodySlice = SKIN_PIECES[SKIN_C_BODY].slice;
+    int footerH = 22;
+
+    if (skin && bodyH - footerH >= bodySlice.top + bodySlice.bottom) {
+        int footerY = bodyY + bodyH - footerH;
+
+        draw_skin_piece(renderer, *skin, SKIN_C_BODY, bx, bodyY, bw, bodyH - footerH);
+        draw_skin_piece(renderer, *skin, SKIN_C_FOOTER, bx, footerY, bw, footerH);
+
+        int argCount = get_arg_count(block.type);
+        if (block.inner && argCount > 0) {
+            geom_hline(renderer, bx + 14, bx + bw - 14, bodyY, dark.r, dark.g, dark.b, 100);
+        }
+    } else if (bodyH > 0) {
         SDL_Color bodyCol = color_darken(base, 0.85f);
 
-        roundedBoxRGBA(renderer, bx, bodyY, bx + bw, bodyY + bodyH, 0,
+        geom_rounded_box(renderer, bx, bodyY, bx + bw, bodyY + bodyH, 0,
                        bodyCol.r, bodyCol.g, bodyCol.b, 255);
 
         int innerX = bx + 14;
@@ -278,39 +481,37 @@ void draw_block(SDL_Renderer* renderer, const Block& block, const std::string& l
         int innerW = bw - 28;
         int innerH = bodyH - 30;
         if (innerH > 6) {
-            roundedBoxRGBA(renderer,
+            geom_rounded_box(renderer,
                 innerX, innerY, innerX + innerW, innerY + innerH,
                 5, darker.r, darker.g, darker.b, 120);
 
-            roundedRectangleRGBA(renderer,
+            geom_rounded_rectangle(renderer,
                 innerX, innerY, innerX + innerW, innerY + innerH,
                 5, dark.r, dark.g, dark.b, 70);
 
-            hlineRGBA(renderer, innerX + 3, innerX + innerW - 3, innerY + 1, 0, 0, 0, 25);
+            geom_hline(renderer, innerX + 3, innerX + innerW - 3, innerY + 1, 0, 0, 0, 25);
         }
 
-        vlineRGBA(renderer, bx, bodyY, bodyY + bodyH, dark.r, dark.g, dark.b, 200);
-        vlineRGBA(renderer, bx + bw, bodyY, bodyY + bodyH, dark.r, dark.g, dark.b, 200);
+        geom_vline(renderer, bx, bodyY, bodyY + bodyH, dark.r, dark.g, dark.b, 200);
+        geom_vline(renderer, bx + bw, bodyY, bodyY + bodyH, dark.r, dark.g, dark.b, 200);
 
-        int footerH = 22;
         int footerY = bodyY + bodyH - footerH;
 
-        roundedBoxRGBA(renderer, bx, footerY, bx + bw, bodyY + bodyH,
+        geom_rounded_box(renderer, bx, footerY, bx + bw, bodyY + bodyH,
                        6, r, g, b, base.a);
 
         draw_notch_bottom(renderer, bx, bodyY + bodyH, base);
 
         draw_block_3d_highlight(renderer, bx, footerY, bw, footerH, 6);
 
-        roundedRectangleRGBA(renderer, bx, footerY, bx + bw, bodyY + bodyH,
+        geom_rounded_rectangle(renderer, bx, footerY, bx + bw, bodyY + bodyH,
                              6, dark.r, dark.g, dark.b, 200);
 
         int argCount = get_arg_count(block.type);
         if (block.inner && argCount > 0) {
             int argAreaH = 0;
             int lineY = bodyY + argAreaH;
-            SDL_SetRenderDrawColor(renderer, dark.r, dark.g, dark.b, 100);
-            SDL_RenderDrawLine(renderer, bx + 14, lineY, bx + bw - 14, lineY);
+            geom_hline(renderer, bx + 14, bx + bw - 14, lineY, dark.r, dark.g, dark.b, 100);
         }
     }
 
@@ -319,100 +520,121 @@ void draw_block(SDL_Renderer* renderer, const Block& block, const std::string& l
     }
 }
 
-static void draw_block_tree(SDL_Renderer* renderer, Block* block, const TextInputState& state) {
-    if (!block) return;
+// Positions, heights and bounds were cached by spatial_grid_layout_tree when
+// the script last changed, so drawing only reads them and skips any inner
+// or next chain whose bounds miss the view.
+static void draw_block_tree(SDL_Renderer* renderer, const Block* block, const TextInputState& state,
+                            const SDL_Rect* view) {
+    while (block) {
+        if (view && !SDL_HasIntersection(&block->layout->bounds, view)) return;
 
-    std::string label = block_get_label(block->type);
+        SDL_Rect footprint = spatial_grid_footprint(*block);
+        if (!view || SDL_HasIntersection(&footprint, view)) {
+            std::string label = block_get_label(block->type);
 
-    draw_block_glow(renderer, *block);
-    draw_block(renderer, *block, label);
+            draw_block_glow(renderer, *block);
+            draw_block(renderer, *block, label);
 
-    draw_arg_boxes(renderer, *block, state);
-
-    if (block->inner) {
-        int innerY = block->y + BLOCK_HEIGHT + 5;
-        Block* child = block->inner;
-        while (child) {
-            child->x = block->x + 15;
-            child->y = innerY;
-            draw_block_tree(renderer, child, state);
-            innerY += get_total_height(child);
-            child = child->next;
+            draw_arg_boxes(renderer, *block, state);
         }
-    }
 
-    if (block->next) {
-        block->next->x = block->x;
-        block->next->y = block->y + get_total_height(block);
-        draw_block_tree(renderer, block->next, state);
+        draw_block_tree(renderer, block->inner, state, view);
+        block = block->next;
     }
 }
 
-void draw_all_blocks(SDL_Renderer* renderer, const std::list<Block>& blocks, const TextInputState& state) {
-    std::list<Block>& mutable_blocks = const_cast<std::list<Block>&>(blocks);
-    for (auto& block : mutable_blocks) {
-        if (block.parent == nullptr) {
-            draw_block_tree(renderer, &block, state);
-        }
+void draw_all_blocks(SDL_Renderer* renderer, const BlockPool& blocks, const Block* dragged,
+                     const TextInputState& state) {
+    SDL_Rect view = workspace_visible_world_rect();
+
+    // Only scripts with at least one block inside the view are walked.
+    std::vector<Block*> visible;
+    spatial_grid_query_rect(view, visible);
+
+    std::vector<const Block*> roots;
+    for (const Block* b : visible) {
+        while (b->parent) b = b->parent;
+        if (!b->layout->dragging) roots.push_back(b);
     }
+    std::sort(roots.begin(), roots.end());
+    roots.erase(std::unique(roots.begin(), roots.end()), roots.end());
+    std::sort(roots.begin(), roots.end(), [&](const Block* a, const Block* b) {
+        return block_pool_z(blocks, a) < block_pool_z(blocks, b);
+    });
+
+    geom_begin(renderer);
+    workspace_begin_render(renderer, true);
+    for (const Block* root : roots) {
+        draw_block_tree(renderer, root, state, &view);
+    }
+
+    // The script being dragged is drawn unclipped so it stays visible
+    // while it crosses the palette on its way to being deleted.
+    if (dragged && !dragged->parent) {
+        workspace_begin_render(renderer, false);
+        draw_block_tree(renderer, dragged, state, nullptr);
+    }
+    workspace_end_render(renderer);
+    geom_end(renderer);
 }
 
 void draw_toolbar(SDL_Renderer* renderer, bool is_running) {
+    geom_begin(renderer);
+
     for (int row = TOOLBAR_Y; row < TOOLBAR_Y + TOOLBAR_HEIGHT; row++) {
         float t = (float)(row - TOOLBAR_Y) / (float)TOOLBAR_HEIGHT;
         float curve = t * t;
         Uint8 shade = (Uint8)(44 + curve * 22);
-        SDL_SetRenderDrawColor(renderer, shade, shade, (Uint8)(shade + 10), 255);
-        SDL_RenderDrawLine(renderer, TOOLBAR_X, row, TOOLBAR_X + TOOLBAR_WIDTH, row);
+        geom_hline(renderer, TOOLBAR_X, TOOLBAR_X + TOOLBAR_WIDTH, row, shade, shade, (Uint8)(shade + 10), 255);
     }
 
-    hlineRGBA(renderer, TOOLBAR_X, TOOLBAR_X + TOOLBAR_WIDTH, TOOLBAR_Y, 65, 65, 80, 100);
-    hlineRGBA(renderer, TOOLBAR_X, TOOLBAR_X + TOOLBAR_WIDTH, TOOLBAR_Y + TOOLBAR_HEIGHT - 1, 80, 80, 100, 220);
+    geom_hline(renderer, TOOLBAR_X, TOOLBAR_X + TOOLBAR_WIDTH, TOOLBAR_Y, 65, 65, 80, 100);
+    geom_hline(renderer, TOOLBAR_X, TOOLBAR_X + TOOLBAR_WIDTH, TOOLBAR_Y + TOOLBAR_HEIGHT - 1, 80, 80, 100, 220);
 
     int startCY = TOOLBAR_Y + TOOLBAR_HEIGHT / 2;
     int btnR = 15;
 
     int sndCX = TOOLBAR_WIDTH - 140;
-    filledCircleRGBA(renderer, sndCX + 2, startCY + 3, btnR + 2, 0, 0, 0, 50);
-    filledCircleRGBA(renderer, sndCX, startCY, btnR + 2, 140, 70, 180, 255);
-    filledCircleRGBA(renderer, sndCX, startCY, btnR, 180, 100, 200, 255);
-    filledCircleRGBA(renderer, sndCX, startCY - 4, btnR - 5, 220, 150, 240, 55);
-    aacircleRGBA(renderer, sndCX, startCY, btnR + 2, 120, 60, 160, 255);
-    aacircleRGBA(renderer, sndCX, startCY, btnR, 200, 120, 220, 120);
+    geom_filled_circle(renderer, sndCX + 2, startCY + 3, btnR + 2, 0, 0, 0, 50);
+    geom_filled_circle(renderer, sndCX, startCY, btnR + 2, 140, 70, 180, 255);
+    geom_filled_circle(renderer, sndCX, startCY, btnR, 180, 100, 200, 255);
+    geom_filled_circle(renderer, sndCX, startCY - 4, btnR - 5, 220, 150, 240, 55);
+    geom_circle(renderer, sndCX, startCY, btnR + 2, 120, 60, 160, 255);
+    geom_circle(renderer, sndCX, startCY, btnR, 200, 120, 220, 120);
 
     Sint16 triX[3] = { (Sint16)(sndCX - 4), (Sint16)(sndCX - 4), (Sint16)(sndCX + 3) };
     Sint16 triY[3] = { (Sint16)(startCY - 5), (Sint16)(startCY + 5), (Sint16)(startCY) };
-    filledPolygonRGBA(renderer, triX, triY, 3, 255, 255, 255, 245);
+    geom_filled_polygon(renderer, triX, triY, 3, 255, 255, 255, 245);
     
-    aacircleRGBA(renderer, sndCX + 5, startCY, 4, 255, 255, 255, 180);
-    aacircleRGBA(renderer, sndCX + 8, startCY, 7, 255, 255, 255, 140);
+    geom_circle(renderer, sndCX + 5, startCY, 4, 255, 255, 255, 180);
+    geom_circle(renderer, sndCX + 8, startCY, 7, 255, 255, 255, 140);
 
     int startCX = TOOLBAR_WIDTH - 95;
 
-    filledCircleRGBA(renderer, startCX + 2, startCY + 3, btnR + 2, 0, 0, 0, 50);
+    geom_filled_circle(renderer, startCX + 2, startCY + 3, btnR + 2, 0, 0, 0, 50);
 
     if (is_running) {
-        filledCircleRGBA(renderer, startCX, startCY, btnR + 2, 200, 140, 30, 255);
-        filledCircleRGBA(renderer, startCX, startCY, btnR, 255, 180, 40, 255);
-        filledCircleRGBA(renderer, startCX, startCY - 4, btnR - 5, 255, 220, 100, 55);
-        aacircleRGBA(renderer, startCX, startCY, btnR + 2, 180, 120, 20, 255);
-        aacircleRGBA(renderer, startCX, startCY, btnR, 255, 200, 80, 120);
-
-        boxRGBA(renderer, startCX - 6, startCY - 7, startCX - 1, startCY + 7, 255, 255, 255, 245);
-        boxRGBA(renderer, startCX + 1, startCY - 7, startCX + 6, startCY + 7, 255, 255, 255, 245);
+        geom_filled_circle(renderer, startCX, startCY, btnR + 2, 200, 140, 30, 255);
+        geom_filled_circle(renderer, startCX, startCY, btnR, 255, 180, 40, 255);
+        geom_filled_circle(renderer, startCX, startCY - 4, btnR - 5, 255, 220, 100, 55);
+        geom_circle(renderer, startCX, startCY, btnR + 2, 180, 120, 20, 255);
+        geom_circle(renderer, startCX, startCY, btnR, 255, 200, 80, 120);
+
+        geom_box(renderer, startCX - 6, startCY - 7, startCX - 1, startCY + 7, 255, 255, 255, 245);
+        geom_box(renderer, startCX + 1, startCY - 7, startCX + 6, startCY + 7, 255, 255, 255, 245);
     } else {
-    filledCircleRGBA(renderer, startCX, startCY, btnR + 2, 40, 155, 40, 255);
-    filledCircleRGBA(renderer, startCX, startCY, btnR, 75, 200, 75, 255);
-    filledCircleRGBA(renderer, startCX, startCY - 4, btnR - 5, 120, 230, 120, 55);
-    aacircleRGBA(renderer, startCX, startCY, btnR + 2, 30, 130, 30, 255);
-    aacircleRGBA(renderer, startCX, startCY, btnR, 90, 215, 90, 120);
+    geom_filled_circle(renderer, startCX, startCY, btnR + 2, 40, 155, 40, 255);
+    geom_filled_circle(renderer, startCX, startCY, btnR, 75, 200, 75, 255);
+    geom_filled_circle(renderer, startCX, startCY - 4, btnR - 5, 120, 230, 120, 55);
+    geom_circle(renderer, startCX, startCY, btnR + 2, 30, 130, 30, 255);
+    geom_circle(renderer, startCX, startCY, btnR, 90, 215, 90, 120);
 
-    filledTrigonRGBA(renderer,
+    geom_filled_trigon(renderer,
         startCX - 5, startCY - 8,
         startCX - 5, startCY + 8,
         startCX + 8, startCY,
         255, 255, 255, 245);
-    aatrigonRGBA(renderer,
+    geom_trigon(renderer,
         startCX - 5, startCY - 8,
         startCX - 5, startCY + 8,
         startCX + 8, startCY,
@@ -421,75 +643,104 @@ void draw_toolbar(SDL_Renderer* renderer, bool is_running) {
 
     int stopCX = TOOLBAR_WIDTH - 50;
 
-    filledCircleRGBA(renderer, stopCX + 2, startCY + 3, btnR + 2, 0, 0, 0, 50);
-    filledCircleRGBA(renderer, stopCX, startCY, btnR + 2, 175, 35, 30, 255);
-    filledCircleRGBA(renderer, stopCX, startCY, btnR, 220, 62, 52, 255);
-    filledCircleRGBA(renderer, stopCX, startCY - 4, btnR - 5, 245, 105, 95, 50);
-    aacircleRGBA(renderer, stopCX, startCY, btnR + 2, 145, 25, 20, 255);
-    aacircleRGBA(renderer, stopCX, startCY, btnR, 235, 80, 70, 120);
+    geom_filled_circle(renderer, stopCX + 2, startCY + 3, btnR + 2, 0, 0, 0, 50);
+    geom_filled_circle(renderer, stopCX, startCY, btnR + 2, 175, 35, 30, 255);
+    geom_filled_circle(renderer, stopCX, startCY, btnR, 220, 62, 52, 255);
+    geom_filled_circle(renderer, stopCX, startCY - 4, btnR - 5, 245, 105, 95, 50);
+    geom_circle(renderer, stopCX, startCY, btnR + 2, 145, 25, 20, 255);
+    geom_circle(renderer, stopCX, startCY, btnR, 235, 80, 70, 120);
 
-    roundedBoxRGBA(renderer,
+    geom_rounded_box(renderer,
         stopCX - 5, startCY - 5,
         stopCX + 5, startCY + 5,
         2, 255, 255, 255, 245);
+
+    geom_end(renderer);
 }
 
 void draw_coding_area(SDL_Renderer* renderer) {
-    for (int row = CODING_AREA_Y; row < CODING_AREA_Y + CODING_AREA_HEIGHT; row++) {
-        float t = (float)(row - CODING_AREA_Y) / (float)CODING_AREA_HEIGHT;
-        Uint8 base = (Uint8)(24 + t * 12);
-        SDL_SetRenderDrawColor(renderer, base, base, (Uint8)(base + 10), 255);
-        SDL_RenderDrawLine(renderer, CODING_AREA_X, row,
-                           CODING_AREA_X + CODING_AREA_WIDTH, row);
-    }
+    geom_begin(renderer);
+
+    geom_gradient_box(renderer,
+        CODING_AREA_X, CODING_AREA_Y,
+        CODING_AREA_X + CODING_AREA_WIDTH, CODING_AREA_Y + CODING_AREA_HEIGHT - 1,
+        {24, 24, 34, 255}, {36, 36, 46, 255});
 
-    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
     int dotSpacing = 24;
     for (int gx = CODING_AREA_X + 12; gx < CODING_AREA_X + CODING_AREA_WIDTH; gx += dotSpacing) {
         for (int gy = CODING_AREA_Y + 12; gy < CODING_AREA_Y + CODING_AREA_HEIGHT; gy += dotSpacing) {
-            hlineRGBA(renderer, gx - 1, gx + 1, gy, 58, 58, 78, 50);
-            vlineRGBA(renderer, gx, gy - 1, gy + 1, 58, 58, 78, 50);
+            geom_hline(renderer, gx - 1, gx + 1, gy, 58, 58, 78, 50);
+            geom_vline(renderer, gx, gy - 1, gy + 1, 58, 58, 78, 50);
         }
     }
 
     for (int i = 0; i < 3; i++) {
         Uint8 sa = (Uint8)(50 - i * 15);
-        hlineRGBA(renderer,
+        geom_hline(renderer,
             CODING_AREA_X, CODING_AREA_X + CODING_AREA_WIDTH,
             CODING_AREA_Y + i, 0, 0, 0, sa);
-        vlineRGBA(renderer,
+        geom_vline(renderer,
             CODING_AREA_X + i, CODING_AREA_Y, CODING_AREA_Y + CODING_AREA_HEIGHT,
             0, 0, 0, (Uint8)(sa * 0.7f));
     }
 
-    rectangleRGBA(renderer,
+    geom_rectangle(renderer,
         CODING_AREA_X, CODING_AREA_Y,
         CODING_AREA_X + CODING_AREA_WIDTH, CODING_AREA_Y + CODING_AREA_HEIGHT,
         42, 42, 55, 180);
+
+    geom_end(renderer);
 }
 
-void draw_stage(SDL_Renderer* renderer, Sprite& sprite) {
+static void draw_say_bubble(SDL_Renderer* renderer, const Sprite& sprite);
+
+void draw_stage(SDL_Renderer* renderer) {
     int sx = STAGE_X;
     int sy = STAGE_Y;
     int sw = STAGE_WIDTH;
     int sh = STAGE_HEIGHT;
     int radius = 10;
 
+    geom_begin(renderer);
+
     for (int i = 6; i >= 1; i--) {
         Uint8 a = (Uint8)(10 * (7 - i));
-        roundedBoxRGBA(renderer,
+        geom_rounded_box(renderer,
             sx + i + 1, sy + i + 2,
             sx + sw + i + 1, sy + sh + i + 2,
             radius + i, 0, 0, 0, a);
     }
 
-    roundedBoxRGBA(renderer, sx, sy, sx + sw, sy + sh, radius,
+    geom_rounded_box(renderer, sx, sy, sx + sw, sy + sh, radius,
                    COLOR_STAGE_BG.r, COLOR_STAGE_BG.g, COLOR_STAGE_BG.b, 255);
 
-    hlineRGBA(renderer, sx + 14, sx + sw - 14, sy + 1, 255, 255, 255, 22);
+    geom_hline(renderer, sx + 14, sx + sw - 14, sy + 1, 255, 255, 255, 22);
 
     draw_stage_border(renderer);
-    draw_sprite(renderer, sprite);
+
+    // Back to front: each sprite's clones, oldest first, then the sprite.
+    static std::vector<Sprite*> order;
+    order.clear();
+    for (int i = 0; i < sprite_set_count(); i++) {
+        SpriteEntry* e = sprite_set_at(i);
+        for (Sprite* c = clone_pool_first(e); c; c = clone_pool_next(c)) {
+            if (!clone_pool_is_dying(c)) order.push_back(c);
+        }
+        order.push_back(&e->sprite);
+    }
+
+    // Consecutive quads from the same atlas page share one submission, so
+    // a stage of packed costumes draws in a single call. Speech bubbles go
+    // over every sprite.
+    SDL_Rect stageClip = {STAGE_X, STAGE_Y, STAGE_WIDTH, STAGE_HEIGHT};
+    geom_flush(renderer);
+    SDL_RenderSetClipRect(renderer, &stageClip);
+    for (Sprite* s : order) draw_sprite(renderer, *s);
+    for (Sprite* s : order) draw_say_bubble(renderer, *s);
+    geom_flush(renderer);
+    SDL_RenderSetClipRect(renderer, nullptr);
+
+    geom_end(renderer);
 }
 
 void draw_stage_border(SDL_Renderer* renderer) {
@@ -498,20 +749,15 @@ void draw_stage_border(SDL_Renderer* renderer) {
     int sw = STAGE_WIDTH;
     int sh = STAGE_HEIGHT;
 
-    roundedRectangleRGBA(renderer, sx, sy, sx + sw, sy + sh, 10,
+    geom_rounded_rectangle(renderer, sx, sy, sx + sw, sy + sh, 10,
                          COLOR_STAGE_BORDER.r, COLOR_STAGE_BORDER.g,
                          COLOR_STAGE_BORDER.b, COLOR_STAGE_BORDER.a);
 
-    roundedRectangleRGBA(renderer, sx + 1, sy + 1, sx + sw - 1, sy + sh - 1, 9,
+    geom_rounded_rectangle(renderer, sx + 1, sy + 1, sx + sw - 1, sy + sh - 1, 9,
                          255, 255, 255, 12);
 }
 
-void draw_sprite(SDL_Renderer* renderer, Sprite& sprite) {
-    if (!sprite.visible || !sprite.texture) return;
-
-    int w, h;
-    SDL_QueryTexture(sprite.texture, nullptr, nullptr, &w, &h);
-
+static SDL_Rect sprite_dest(const Sprite& sprite, int w, int h) {
     int draw_w = (int)(w * sprite.scale);
     int draw_h = (int)(h * sprite.scale);
 
@@ -520,36 +766,74 @@ void draw_sprite(SDL_Renderer* renderer, Sprite& sprite) {
     dest.y = (int)(sprite.y - draw_h / 2.0f);
     dest.w = draw_w;
     dest.h = draw_h;
+    return dest;
+}
 
-    SDL_Rect stageClip = {STAGE_X, STAGE_Y, STAGE_WIDTH, STAGE_HEIGHT};
-    SDL_RenderSetClipRect(renderer, &stageClip);
-    SDL_RenderCopyEx(renderer, sprite.texture, nullptr, &dest, sprite.angle, nullptr, SDL_FLIP_NONE);
-    
-    if (!sprite.sayText.empty()) {
-        int padding = 10;
-        int bubbleH = 30;
-        int textW = sprite.sayText.length() * 8;
-        int bubbleW = textW + padding * 2;
+void draw_sprite(SDL_Renderer* renderer, Sprite& sprite) {
+    if (!sprite.visible || !sprite.texture) return;
 
-        int bubbleX = dest.x + dest.w / 2 - bubbleW / 2;
-        int bubbleY = dest.y - bubbleH - 10;
+    SDL_Texture* texture = sprite.texture;
+    SDL_FRect uv = {0.0f, 0.0f, 1.0f, 1.0f};
+    int w, h;
+    if (const AtlasRegion* region = sprite_atlas_find(sprite.texture)) {
+        texture = region->page;
+        uv = region->uv;
+        w = region->w;
+        h = region->h;
+    } else if (SDL_QueryTexture(sprite.texture, nullptr, nullptr, &w, &h) != 0) {
+        return;
+    }
+
+    // Same placement as SDL_RenderCopyEx: rotate clockwise about the centre
+    // of the destination rectangle.
+    SDL_Rect dest = sprite_dest(sprite, w, h);
+    float cx = dest.x + dest.w / 2.0f;
+    float cy = dest.y + dest.h / 2.0f;
+    float hw = dest.w / 2.0f;
+    float hh = dest.h / 2.0f;
+    float rad = sprite.angle * 3.14159265f / 180.0f;
+    float c = cosf(rad);
+    float s = sinf(rad);
+
+    const float offsets[4][2] = {{-hw, -hh}, {hw, -hh}, {hw, hh}, {-hw, hh}};
+    SDL_FPoint corners[4];
+    for (int i = 0; i < 4; i++) {
+        corners[i].x = cx + offsets[i][0] * c - offsets[i][1] * s;
+        corners[i].y = cy + offsets[i][0] * s + offsets[i][1] * c;
+    }
+    geom_texture_quad(renderer, texture, uv, corners);
+}
 
-        if (bubbleY < STAGE_Y) bubbleY = STAGE_Y + 5;
-        if (bubbleX < STAGE_X) bubbleX = STAGE_X + 5;
+static void draw_say_bubble(SDL_Renderer* renderer, const Sprite& sprite) {
+    if (!sprite.visible || !sprite.texture || sprite.sayText.empty()) return;
 
-        roundedBoxRGBA(renderer, bubbleX, bubbleY, bubbleX + bubbleW, bubbleY + bubbleH, 5, 255, 255, 255, 255);
-        roundedRectangleRGBA(renderer, bubbleX, bubbleY, bubbleX + bubbleW, bubbleY + bubbleH, 5, 0, 0, 0, 255);
-        draw_text(renderer, bubbleX + padding, bubbleY + 8, sprite.sayText, COLOR_BLACK);
+    int w = sprite.width, h = sprite.height;
+    if (const AtlasRegion* region = sprite_atlas_find(sprite.texture)) {
+        w = region->w;
+        h = region->h;
+    } else {
+        SDL_QueryTexture(sprite.texture, nullptr, nullptr, &w, &h);
     }
+    SDL_Rect dest = sprite_dest(sprite, w, h);
 
-    SDL_RenderSetClipRect(renderer, nullptr);
+    int padding = 10;
+    int bubbleH = 30;
+    int textW = sprite.sayText.length() * 8;
+    int bubbleW = textW + padding * 2;
+
+    int bubbleX = dest.x + dest.w / 2 - bubbleW / 2;
+    int bubbleY = dest.y - bubbleH - 10;
+
+    if (bubbleY < STAGE_Y) bubbleY = STAGE_Y + 5;
+    if (bubbleX < STAGE_X) bubbleX = STAGE_X + 5;
+
+    geom_rounded_box(renderer, bubbleX, bubbleY, bubbleX + bubbleW, bubbleY + bubbleH, 5, 255, 255, 255, 255);
+    geom_rounded_rectangle(renderer, bubbleX, bubbleY, bubbleX + bubbleW, bubbleY + bubbleH, 5, 0, 0, 0, 255);
+    draw_text(renderer, bubbleX + padding, bubbleY + 8, sprite.sayText, COLOR_BLACK);
 }
 
 void draw_cursor(SDL_Renderer* renderer, int x, int y, int height, SDL_Color color) {
-    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
-    SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
-    SDL_RenderDrawLine(renderer, x, y, x, y + height);
-    SDL_RenderDrawLine(renderer, x + 1, y, x + 1, y + height);
+    geom_box(renderer, x, y, x + 1, y + height, color.r, color.g, color.b, color.a);
 }
 
 void draw_arg_boxes(SDL_Renderer* renderer, const Block& block, const TextInputState& state) {
@@ -568,11 +852,8 @@ void draw_arg_boxes(SDL_Renderer* renderer, const Block& block, const TextInputS
         bool has_block = (i < (int)block.argBlocks.size() && block.argBlocks[i] != nullptr);
 
         if (has_block) {
-            Block* sub = block.argBlocks[i];
-            sub->x = box.x;
-            sub->y = box.y;
-            // sub->width and sub->height remain their natural values
-            
+            const Block* sub = block.argBlocks[i];
+
             // Draw the sub-block
             draw_block_glow(renderer, *sub);
             draw_block(renderer, *sub, block_get_label(sub->type));
@@ -582,26 +863,26 @@ void draw_arg_boxes(SDL_Renderer* renderer, const Block& block, const TextInputS
         } else {
             bool is_editing = (state.active && state.block_id == block.id && state.arg_index == i);
 
-            roundedBoxRGBA(renderer,
+            geom_rounded_box(renderer,
                 box.x, box.y, box.x + box.w, box.y + box.h,
                 5, 248, 248, 252, 255);
 
-            hlineRGBA(renderer, box.x + 4, box.x + box.w - 4, box.y + 1, 0, 0, 0, 18);
+            geom_hline(renderer, box.x + 4, box.x + box.w - 4, box.y + 1, 0, 0, 0, 18);
 
             if (is_editing) {
-                roundedRectangleRGBA(renderer,
+                geom_rounded_rectangle(renderer,
                     box.x - 2, box.y - 2,
                     box.x + box.w + 2, box.y + box.h + 2,
                     7, 60, 130, 255, 70);
-                roundedRectangleRGBA(renderer,
+                geom_rounded_rectangle(renderer,
                     box.x - 1, box.y - 1,
                     box.x + box.w + 1, box.y + box.h + 1,
                     6, 65, 140, 255, 255);
-                roundedRectangleRGBA(renderer,
+                geom_rounded_rectangle(renderer,
                     box.x, box.y, box.x + box.w, box.y + box.h,
                     5, 80, 155, 255, 180);
             } else {
-                roundedRectangleRGBA(renderer,
+                geom_rounded_rectangle(renderer,
                     box.x, box.y, box.x + box.w, box.y + box.h,
                     5, 170, 170, 182, 255);
             }
@@ -639,17 +920,19 @@ void draw_category_bar(SDL_Renderer* renderer, const std::vector<CategoryItem>&
     int totalWidth = STAGE_X;
     int buttonWidth = totalWidth / (int)categories.size();
 
-    boxRGBA(renderer,
+    geom_begin(renderer);
+
+    geom_box(renderer,
         PALETTE_X, CATEGORY_BAR_Y,
         PALETTE_X + totalWidth, CATEGORY_BAR_Y + CATEGORY_BAR_HEIGHT,
         38, 38, 48, 255);
 
     for (int row = CATEGORY_BAR_Y; row < CATEGORY_BAR_Y + 3; row++) {
         Uint8 a = (Uint8)(30 - (row - CATEGORY_BAR_Y) * 10);
-        hlineRGBA(renderer, PALETTE_X, PALETTE_X + totalWidth, row, 0, 0, 0, a);
+        geom_hline(renderer, PALETTE_X, PALETTE_X + totalWidth, row, 0, 0, 0, a);
     }
 
-    hlineRGBA(renderer,
+    geom_hline(renderer,
         PALETTE_X, PALETTE_X + totalWidth,
         CATEGORY_BAR_Y + CATEGORY_BAR_HEIGHT - 1,
         55, 55, 70, 220);
@@ -664,17 +947,17 @@ void draw_category_bar(SDL_Renderer* renderer, const std::vector<CategoryItem>&
         if ((int)i == selected_index) {
             SDL_Color bright = color_lighten(col, 30);
 
-            roundedBoxRGBA(renderer,
+            geom_rounded_box(renderer,
                 x + 1, y + 2,
                 x + buttonWidth - 1, y + CATEGORY_BAR_HEIGHT,
                 4, bright.r, bright.g, bright.b, 255);
 
-            roundedBoxRGBA(renderer,
+            geom_rounded_box(renderer,
                 x + 2, y + 3,
                 x + buttonWidth - 2, y + CATEGORY_BAR_HEIGHT / 2,
                 3, 255, 255, 255, 28);
 
-            boxRGBA(renderer,
+            geom_box(renderer,
                 x + 6, y + CATEGORY_BAR_HEIGHT - 3,
                 x + buttonWidth - 6, y + CATEGORY_BAR_HEIGHT,
                 255, 255, 255, 200);
@@ -684,7 +967,7 @@ void draw_category_bar(SDL_Renderer* renderer, const std::vector<CategoryItem>&
             draw_text_shadowed(renderer, tx, y + 11, cat.name.c_str(), COLOR_WHITE);
 
         } else {
-            roundedBoxRGBA(renderer,
+            geom_rounded_box(renderer,
                 x + 2, y + 5,
                 x + buttonWidth - 2, y + CATEGORY_BAR_HEIGHT - 2,
                 3, col.r, col.g, col.b, 120);
@@ -695,10 +978,12 @@ void draw_category_bar(SDL_Renderer* renderer, const std::vector<CategoryItem>&
         }
 
         if (i < categories.size() - 1) {
-            vlineRGBA(renderer,
+            geom_vline(renderer,
                 x + buttonWidth,
                 y + 8, y + CATEGORY_BAR_HEIGHT - 8,
                 65, 65, 80, 90);
         }
     }
+
+    geom_end(renderer);
 }
@@ -4,25 +4,30 @@
 #include <SDL2/SDL.h>
 #include <string>
 #include <vector>
-#include <list>
+#include "../backend/block_pool.h"
 #include "text_input.h"
 
 #include "palette.h"
 
-SDL_Texture* load_texture(SDL_Renderer* renderer, const std::string& path);
-
 void draw_filled_rect(SDL_Renderer* renderer, int x, int y, int w, int h, SDL_Color color);
 void draw_rect_outline(SDL_Renderer* renderer, int x, int y, int w, int h, SDL_Color color);
 
 void draw_block(SDL_Renderer* renderer, const Block& block, const std::string& label);
-void draw_all_blocks(SDL_Renderer* renderer, const std::list<Block>& blocks, const TextInputState& state);
+void draw_all_blocks(SDL_Renderer* renderer, const BlockPool& blocks, const Block* dragged,
+                     const TextInputState& state);
 void draw_block_glow(SDL_Renderer* renderer, const Block& block);
+// Block skins are baked into render targets, whose contents the driver
+// may drop; call this on a targets or device reset and each colour is
+// baked again the next time a block of that colour is drawn.
+void draw_clear_block_skins();
 
 void draw_toolbar(SDL_Renderer* renderer, bool is_running);
 void draw_coding_area(SDL_Renderer* renderer);
-void draw_stage(SDL_Renderer* renderer, Sprite& sprite);
+void draw_stage(SDL_Renderer* renderer);
 void draw_stage_border(SDL_Renderer* renderer);
 
+// Queues the sprite's rotated quad in the current geometry batch; the
+// caller sets the stage clip and flushes.
 void draw_sprite(SDL_Renderer* renderer, Sprite& sprite);
 
 void draw_text(SDL_Renderer* renderer, int x, int y, const std::string& text, SDL_Color color);
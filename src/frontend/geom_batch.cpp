@@ -0,0 +1,468 @@
+#include "geom_batch.h"
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+struct GeomBatch {
+    SDL_Renderer* renderer = nullptr;
+    SDL_Texture* texture = nullptr;
+    std::vector<SDL_Vertex> verts;
+    std::vector<int> indices;
+    int depth = 0;
+};
+
+static GeomBatch g_batch;
+
+struct Pt {
+    float x, y;
+};
+
+static const float GEOM_PI = 3.14159265f;
+
+void geom_flush(SDL_Renderer* renderer) {
+    if (g_batch.indices.empty()) return;
+    if (!renderer) renderer = g_batch.renderer;
+
+    if (g_batch.texture) {
+        SDL_RenderGeometry(renderer, g_batch.texture,
+                           g_batch.verts.data(), (int)g_batch.verts.size(),
+                           g_batch.indices.data(), (int)g_batch.indices.size());
+    } else {
+        // Untextured geometry uses the draw blend mode; SDL2_gfx blended
+        // whenever alpha was below 255, which BLEND does for every alpha.
+        SDL_BlendMode prev;
+        SDL_GetRenderDrawBlendMode(renderer, &prev);
+        SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+        SDL_RenderGeometry(renderer, nullptr,
+                           g_batch.verts.data(), (int)g_batch.verts.size(),
+                           g_batch.indices.data(), (int)g_batch.indices.size());
+        SDL_SetRenderDrawBlendMode(renderer, prev);
+    }
+
+    g_batch.verts.clear();
+    g_batch.indices.clear();
+}
+
+void geom_begin(SDL_Renderer* renderer) {
+    if (g_batch.depth == 0 && g_batch.renderer != renderer) {
+        geom_flush(g_batch.renderer);
+    }
+    g_batch.renderer = renderer;
+    g_batch.depth++;
+}
+
+void geom_end(SDL_Renderer* renderer) {
+    if (g_batch.depth > 0) g_batch.depth--;
+    if (g_batch.depth == 0) geom_flush(renderer);
+}
+
+// Switches the pending batch to (renderer, texture), flushing on change.
+static void use_state(SDL_Renderer* renderer, SDL_Texture* texture) {
+    if (g_batch.renderer != renderer || g_batch.texture != texture) {
+        geom_flush(g_batch.renderer);
+        g_batch.renderer = renderer;
+        g_batch.texture = texture;
+    }
+}
+
+static void submit_if_unbatched(SDL_Renderer* renderer) {
+    if (g_batch.depth == 0) geom_flush(renderer);
+}
+
+static int push_vertex(float x, float y, SDL_Color c, float u = 0.0f, float v = 0.0f) {
+    SDL_Vertex vert;
+    vert.position.x = x;
+    vert.position.y = y;
+    vert.color = c;
+    vert.tex_coord.x = u;
+    vert.tex_coord.y = v;
+    g_batch.verts.push_back(vert);
+    return (int)g_batch.verts.size() - 1;
+}
+
+static void push_triangle(int a, int b, int c) {
+    g_batch.indices.push_back(a);
+    g_batch.indices.push_back(b);
+    g_batch.indices.push_back(c);
+}
+
+static void push_quad(float x0, float y0, float x1, float y1, SDL_Color top, SDL_Color bottom) {
+    int a = push_vertex(x0, y0, top);
+    int b = push_vertex(x1, y0, top);
+    int c = push_vertex(x1, y1, bottom);
+    int d = push_vertex(x0, y1, bottom);
+    push_triangle(a, b, c);
+    push_triangle(a, c, d);
+}
+
+// Convex outline as a fan around its first point.
+static void push_convex(const std::vector<Pt>& pts, SDL_Color c) {
+    if (pts.size() < 3) return;
+    int first = push_vertex(pts[0].x, pts[0].y, c);
+    int prev = push_vertex(pts[1].x, pts[1].y, c);
+    for (size_t i = 2; i < pts.size(); i++) {
+        int cur = push_vertex(pts[i].x, pts[i].y, c);
+        push_triangle(first, prev, cur);
+        prev = cur;
+    }
+}
+
+// Strokes a polyline with mitred joins, so a closed outline is one strip
+// with no overlapping quads to double-blend at the corners.
+static void push_stroke(const std::vector<Pt>& pts, bool closed, float width, SDL_Color c) {
+    int n = (int)pts.size();
+    if (n < 2) return;
+
+    float half = width * 0.5f;
+    int base = (int)g_batch.verts.size();
+
+    for (int i = 0; i < n; i++) {
+        bool hasPrev = closed || i > 0;
+        bool hasNext = closed || i < n - 1;
+        const Pt& p = pts[i];
+        const Pt& a = pts[(i - 1 + n) % n];
+        const Pt& b = pts[(i + 1) % n];
+
+        float nx = 0.0f, ny = 0.0f;
+        float inx = 0.0f, iny = 0.0f;
+        if (hasPrev) {
+            float dx = p.x - a.x, dy = p.y - a.y;
+            float len = std::sqrt(dx * dx + dy * dy);
+            if (len > 0.0f) { inx = -dy / len; iny = dx / len; }
+        }
+        float onx = inx, ony = iny;
+        if (hasNext) {
+            float dx = b.x - p.x, dy = b.y - p.y;
+            float len = std::sqrt(dx * dx + dy * dy);
+            if (len > 0.0f) { onx = -dy / len; ony = dx / len; }
+            if (!hasPrev) { inx = onx; iny = ony; }
+        }
+
+        nx = inx + onx;
+        ny = iny + ony;
+        float len = std::sqrt(nx * nx + ny * ny);
+        float scale = half;
+        if (len > 1e-4f) {
+            nx /= len;
+            ny /= len;
+            float cosHalf = nx * onx + ny * ony;
+            scale = half / std::max(cosHalf, 0.5f);
+        } else {
+            nx = onx;
+            ny = ony;
+        }
+
+        push_vertex(p.x + nx * scale, p.y + ny * scale, c);
+        push_vertex(p.x - nx * scale, p.y - ny * scale, c);
+    }
+
+    int segs = closed ? n : n - 1;
+    for (int i = 0; i < segs; i++) {
+        int j = (i + 1) % n;
+        int a0 = base + i * 2, a1 = a0 + 1;
+        int b0 = base + j * 2, b1 = b0 + 1;
+        push_triangle(a0, b0, b1);
+        push_triangle(a0, b1, a1);
+    }
+}
+
+static int arc_segments(float rad) {
+    int n = (int)(rad * 0.5f) + 2;
+    return std::min(n, 16);
+}
+
+static void append_arc(std::vector<Pt>& out, float cx, float cy, float rad, float a0, float a1) {
+    int segs = arc_segments(rad);
+    for (int i = 0; i <= segs; i++) {
+        float t = a0 + (a1 - a0) * (float)i / (float)segs;
+        out.push_back({cx + std::cos(t) * rad, cy + std::sin(t) * rad});
+    }
+}
+
+// Clockwise (in screen space) outline of a rounded rectangle.
+static void rounded_rect_path(std::vector<Pt>& out, float l, float t, float r, float b, float rad) {
+    out.clear();
+    rad = std::min(rad, std::min(r - l, b - t) * 0.5f);
+    if (rad <= 0.0f) {
+        out.push_back({l, t});
+        out.push_back({r, t});
+        out.push_back({r, b});
+        out.push_back({l, b});
+        return;
+    }
+    append_arc(out, r - rad, t + rad, rad, -GEOM_PI * 0.5f, 0.0f);
+    append_arc(out, r - rad, b - rad, rad, 0.0f, GEOM_PI * 0.5f);
+    append_arc(out, l + rad, b - rad, rad, GEOM_PI * 0.5f, GEOM_PI);
+    append_arc(out, l + rad, t + rad, rad, GEOM_PI, GEOM_PI * 1.5f);
+}
+
+static void circle_path(std::vector<Pt>& out, float cx, float cy, float rad) {
+    out.clear();
+    int segs = std::max(12, std::min(64, (int)(rad * 2.0f) + 8));
+    for (int i = 0; i < segs; i++) {
+        float t = 2.0f * GEOM_PI * (float)i / (float)segs;
+        out.push_back({cx + std::cos(t) * rad, cy + std::sin(t) * rad});
+    }
+}
+
+static float cross(const Pt& o, const Pt& a, const Pt& b) {
+    return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+}
+
+static bool inside_triangle(const Pt& p, const Pt& a, const Pt& b, const Pt& c) {
+    float d1 = cross(a, b, p), d2 = cross(b, c, p), d3 = cross(c, a, p);
+    bool neg = d1 < 0.0f || d2 < 0.0f || d3 < 0.0f;
+    bool pos = d1 > 0.0f || d2 > 0.0f || d3 > 0.0f;
+    return !(neg && pos);
+}
+
+// Ear clipping for simple polygons. The block notches are concave and
+// have collinear runs, which a plain fan would fill outside the outline.
+static void push_polygon(const std::vector<Pt>& pts, SDL_Color c) {
+    int n = (int)pts.size();
+    if (n < 3) return;
+
+    float area = 0.0f;
+    for (int i = 0; i < n; i++) {
+        const Pt& p = pts[i];
+        const Pt& q = pts[(i + 1) % n];
+        area += p.x * q.y - q.x * p.y;
+    }
+    float winding = area >= 0.0f ? 1.0f : -1.0f;
+
+    int base = (int)g_batch.verts.size();
+    for (const Pt& p : pts) push_vertex(p.x, p.y, c);
+
+    std::vector<int> ring(n);
+    for (int i = 0; i < n; i++) ring[i] = i;
+
+    int guard = n * n;
+    while (ring.size() > 3 && guard-- > 0) {
+        int m = (int)ring.size();
+        bool clipped = false;
+        for (int i = 0; i < m; i++) {
+            int ia = ring[(i - 1 + m) % m], ib = ring[i], ic = ring[(i + 1) % m];
+            float turn = cross(pts[ia], pts[ib], pts[ic]) * winding;
+
+            if (std::fabs(turn) < 1e-6f) {
+                ring.erase(ring.begin() + i);
+                clipped = true;
+                break;
+            }
+            if (turn < 0.0f) continue;
+
+            bool ear = true;
+            for (int k : ring) {
+                if (k == ia || k == ib || k == ic) continue;
+                if (inside_triangle(pts[k], pts[ia], pts[ib], pts[ic])) {
+                    ear = false;
+                    break;
+                }
+            }
+            if (!ear) continue;
+
+            push_triangle(base + ia, base + ib, base + ic);
+            ring.erase(ring.begin() + i);
+            clipped = true;
+            break;
+        }
+        if (!clipped) break;
+    }
+    if (ring.size() == 3) {
+        push_triangle(base + ring[0], base + ring[1], base + ring[2]);
+    }
+}
+
+static SDL_Color rgba(Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
+    SDL_Color c = {r, g, b, a};
+    return c;
+}
+
+void geom_box(SDL_Renderer* renderer, int x1, int y1, int x2, int y2,
+              Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
+    if (x1 > x2) std::swap(x1, x2);
+    if (y1 > y2) std::swap(y1, y2);
+    use_state(renderer, nullptr);
+    SDL_Color c = rgba(r, g, b, a);
+    push_quad((float)x1, (float)y1, (float)(x2 + 1), (float)(y2 + 1), c, c);
+    submit_if_unbatched(renderer);
+}
+
+void geom_hline(SDL_Renderer* renderer, int x1, int x2, int y,
+                Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
+    geom_box(renderer, x1, y, x2, y, r, g, b, a);
+}
+
+void geom_vline(SDL_Renderer* renderer, int x, int y1, int y2,
+                Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
+    geom_box(renderer, x, y1, x, y2, r, g, b, a);
+}
+
+void geom_rectangle(SDL_Renderer* renderer, int x1, int y1, int x2, int y2,
+                    Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
+    if (x1 > x2) std::swap(x1, x2);
+    if (y1 > y2) std::swap(y1, y2);
+    use_state(renderer, nullptr);
+    SDL_Color c = rgba(r, g, b, a);
+    float l = (float)x1, t = (float)y1, rr = (float)(x2 + 1), bb = (float)(y2 + 1);
+    push_quad(l, t, rr, t + 1.0f, c, c);
+    if (y2 > y1) push_quad(l, bb - 1.0f, rr, bb, c, c);
+    if (y2 - y1 > 1) {
+        push_quad(l, t + 1.0f, l + 1.0f, bb - 1.0f, c, c);
+        if (x2 > x1) push_quad(rr - 1.0f, t + 1.0f, rr, bb - 1.0f, c, c);
+    }
+    submit_if_unbatched(renderer);
+}
+
+void geom_gradient_box(SDL_Renderer* renderer, int x1, int y1, int x2, int y2,
+                       SDL_Color top, SDL_Color bottom) {
+    if (x1 > x2) std::swap(x1, x2);
+    if (y1 > y2) std::swap(y1, y2);
+    use_state(renderer, nullptr);
+    push_quad((float)x1, (float)y1, (float)(x2 + 1), (float)(y2 + 1), top, bottom);
+    submit_if_unbatched(renderer);
+}
+
+void geom_rounded_box(SDL_Renderer* renderer, int x1, int y1, int x2, int y2, int rad,
+                      Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
+    if (x1 > x2) std::swap(x1, x2);
+    if (y1 > y2) std::swap(y1, y2);
+    use_state(renderer, nullptr);
+
+    static std::vector<Pt> path;
+    rounded_rect_path(path, (float)x1, (float)y1, (float)(x2 + 1), (float)(y2 + 1), (float)rad);
+    push_convex(path, rgba(r, g, b, a));
+    submit_if_unbatched(renderer);
+}
+
+void geom_rounded_rectangle(SDL_Renderer* renderer, int x1, int y1, int x2, int y2, int rad,
+                            Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
+    if (x1 > x2) std::swap(x1, x2);
+    if (y1 > y2) std::swap(y1, y2);
+    if (rad <= 0) {
+        geom_rectangle(renderer, x1, y1, x2, y2, r, g, b, a);
+        return;
+    }
+    use_state(renderer, nullptr);
+
+    // The stroke runs through pixel centres, as the line-based outline did.
+    static std::vector<Pt> path;
+    rounded_rect_path(path, x1 + 0.5f, y1 + 0.5f, x2 + 0.5f, y2 + 0.5f, (float)rad);
+    push_stroke(path, true, 1.0f, rgba(r, g, b, a));
+    submit_if_unbatched(renderer);
+}
+
+void geom_filled_circle(SDL_Renderer* renderer, int cx, int cy, int rad,
+                        Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
+    if (rad < 0) return;
+    use_state(renderer, nullptr);
+
+    static std::vector<Pt> path;
+    circle_path(path, cx + 0.5f, cy + 0.5f, rad + 0.5f);
+    push_convex(path, rgba(r, g, b, a));
+    submit_if_unbatched(renderer);
+}
+
+void geom_circle(SDL_Renderer* renderer, int cx, int cy, int rad,
+                 Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
+    if (rad < 0) return;
+    use_state(renderer, nullptr);
+
+    static std::vector<Pt> path;
+    circle_path(path, cx + 0.5f, cy + 0.5f, (float)rad);
+    push_stroke(path, true, 1.0f, rgba(r, g, b, a));
+    submit_if_unbatched(renderer);
+}
+
+void geom_filled_polygon(SDL_Renderer* renderer, const Sint16* vx, const Sint16* vy, int n,
+                         Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
+    if (n < 3) return;
+    use_state(renderer, nullptr);
+
+    std::vector<Pt> pts(n);
+    for (int i = 0; i < n; i++) pts[i] = {vx[i] + 0.5f, vy[i] + 0.5f};
+    push_polygon(pts, rgba(r, g, b, a));
+    submit_if_unbatched(renderer);
+}
+
+void geom_polygon(SDL_Renderer* renderer, const Sint16* vx, const Sint16* vy, int n,
+                  Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
+    if (n < 2) return;
+    use_state(renderer, nullptr);
+
+    std::vector<Pt> pts(n);
+    for (int i = 0; i < n; i++) pts[i] = {vx[i] + 0.5f, vy[i] + 0.5f};
+    push_stroke(pts, true, 1.0f, rgba(r, g, b, a));
+    submit_if_unbatched(renderer);
+}
+
+void geom_filled_trigon(SDL_Renderer* renderer, int x1, int y1, int x2, int y2, int x3, int y3,
+                        Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
+    Sint16 vx[3] = {(Sint16)x1, (Sint16)x2, (Sint16)x3};
+    Sint16 vy[3] = {(Sint16)y1, (Sint16)y2, (Sint16)y3};
+    geom_filled_polygon(renderer, vx, vy, 3, r, g, b, a);
+}
+
+void geom_trigon(SDL_Renderer* renderer, int x1, int y1, int x2, int y2, int x3, int y3,
+                 Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
+    Sint16 vx[3] = {(Sint16)x1, (Sint16)x2, (Sint16)x3};
+    Sint16 vy[3] = {(Sint16)y1, (Sint16)y2, (Sint16)y3};
+    geom_polygon(renderer, vx, vy, 3, r, g, b, a);
+}
+
+void geom_thick_line(SDL_Renderer* renderer, float x1, float y1, float x2, float y2, float width,
+                     Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
+    if (width <= 0.0f) return;
+    use_state(renderer, nullptr);
+
+    std::vector<Pt> pts = {{x1, y1}, {x2, y2}};
+    if (x1 == x2 && y1 == y2) pts[1].x += 0.01f;
+    push_stroke(pts, false, width, rgba(r, g, b, a));
+    submit_if_unbatched(renderer);
+}
+
+void geom_texture(SDL_Renderer* renderer, SDL_Texture* texture,
+                  const SDL_Rect* src, const SDL_Rect* dst) {
+    if (!texture) return;
+
+    int tw, th;
+    if (SDL_QueryTexture(texture, nullptr, nullptr, &tw, &th) != 0 || tw <= 0 || th <= 0) return;
+
+    SDL_Rect s = src ? *src : SDL_Rect{0, 0, tw, th};
+    SDL_Rect d = dst ? *dst : s;
+
+    use_state(renderer, texture);
+
+    SDL_Color white = {255, 255, 255, 255};
+    float u0 = (float)s.x / tw, v0 = (float)s.y / th;
+    float u1 = (float)(s.x + s.w) / tw, v1 = (float)(s.y + s.h) / th;
+    float x0 = (float)d.x, y0 = (float)d.y;
+    float x1 = (float)(d.x + d.w), y1 = (float)(d.y + d.h);
+
+    int a = push_vertex(x0, y0, white, u0, v0);
+    int b = push_vertex(x1, y0, white, u1, v0);
+    int c = push_vertex(x1, y1, white, u1, v1);
+    int e = push_vertex(x0, y1, white, u0, v1);
+    push_triangle(a, b, c);
+    push_triangle(a, c, e);
+    submit_if_unbatched(renderer);
+}
+
+void geom_texture_quad(SDL_Renderer* renderer, SDL_Texture* texture,
+                       const SDL_FRect& uv, const SDL_FPoint corners[4]) {
+    if (!texture) return;
+
+    use_state(renderer, texture);
+
+    SDL_Color white = {255, 255, 255, 255};
+    float u0 = uv.x, v0 = uv.y;
+    float u1 = uv.x + uv.w, v1 = uv.y + uv.h;
+
+    int a = push_vertex(corners[0].x, corners[0].y, white, u0, v0);
+    int b = push_vertex(corners[1].x, corners[1].y, white, u1, v0);
+    int c = push_vertex(corners[2].x, corners[2].y, white, u1, v1);
+    int e = push_vertex(corners[3].x, corners[3].y, white, u0, v1);
+    push_triangle(a, b, c);
+    push_triangle(a, c, e);
+    submit_if_unbatched(renderer);
+}
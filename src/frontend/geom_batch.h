@@ -0,0 +1,65 @@
+#ifndef GEOM_BATCH_H
+#define GEOM_BATCH_H
+#include <SDL2/SDL.h>
+
+// Batched replacements for the SDL2_gfx primitives. Shapes are tessellated
+// into triangles and queued; the queue goes out as one SDL_RenderGeometry
+// call each time the texture changes or the batch is flushed.
+//
+// Coordinates follow SDL2_gfx: corners are inclusive pixel positions.
+//
+// Between geom_begin and geom_end primitives accumulate. Code that changes
+// the target, viewport, scale or clip rect inside a batch, or draws with
+// plain SDL calls, must call geom_flush first. Outside a batch every
+// primitive is submitted immediately, so unconverted callers keep their
+// draw order.
+
+void geom_begin(SDL_Renderer* renderer);
+void geom_end(SDL_Renderer* renderer);
+void geom_flush(SDL_Renderer* renderer);
+
+void geom_box(SDL_Renderer* renderer, int x1, int y1, int x2, int y2,
+              Uint8 r, Uint8 g, Uint8 b, Uint8 a);
+void geom_hline(SDL_Renderer* renderer, int x1, int x2, int y,
+                Uint8 r, Uint8 g, Uint8 b, Uint8 a);
+void geom_vline(SDL_Renderer* renderer, int x, int y1, int y2,
+                Uint8 r, Uint8 g, Uint8 b, Uint8 a);
+void geom_rectangle(SDL_Renderer* renderer, int x1, int y1, int x2, int y2,
+                    Uint8 r, Uint8 g, Uint8 b, Uint8 a);
+void geom_gradient_box(SDL_Renderer* renderer, int x1, int y1, int x2, int y2,
+                       SDL_Color top, SDL_Color bottom);
+
+void geom_rounded_box(SDL_Renderer* renderer, int x1, int y1, int x2, int y2, int rad,
+                      Uint8 r, Uint8 g, Uint8 b, Uint8 a);
+void geom_rounded_rectangle(SDL_Renderer* renderer, int x1, int y1, int x2, int y2, int rad,
+                            Uint8 r, Uint8 g, Uint8 b, Uint8 a);
+
+void geom_filled_circle(SDL_Renderer* renderer, int cx, int cy, int rad,
+                        Uint8 r, Uint8 g, Uint8 b, Uint8 a);
+void geom_circle(SDL_Renderer* renderer, int cx, int cy, int rad,
+                 Uint8 r, Uint8 g, Uint8 b, Uint8 a);
+
+void geom_filled_polygon(SDL_Renderer* renderer, const Sint16* vx, const Sint16* vy, int n,
+                         Uint8 r, Uint8 g, Uint8 b, Uint8 a);
+void geom_polygon(SDL_Renderer* renderer, const Sint16* vx, const Sint16* vy, int n,
+                  Uint8 r, Uint8 g, Uint8 b, Uint8 a);
+void geom_filled_trigon(SDL_Renderer* renderer, int x1, int y1, int x2, int y2, int x3, int y3,
+                        Uint8 r, Uint8 g, Uint8 b, Uint8 a);
+void geom_trigon(SDL_Renderer* renderer, int x1, int y1, int x2, int y2, int x3, int y3,
+                 Uint8 r, Uint8 g, Uint8 b, Uint8 a);
+
+void geom_thick_line(SDL_Renderer* renderer, float x1, float y1, float x2, float y2, float width,
+                     Uint8 r, Uint8 g, Uint8 b, Uint8 a);
+
+// Textured quad; src may be null for the whole texture. Consecutive quads
+// from the same texture (a skin atlas, say) share one submission.
+void geom_texture(SDL_Renderer* renderer, SDL_Texture* texture,
+                  const SDL_Rect* src, const SDL_Rect* dst);
+
+// Textured quad with arbitrary corners (top-left, top-right, bottom-right,
+// bottom-left of the source) and normalised texture coordinates, for
+// rotated sprites drawn from an atlas page.
+void geom_texture_quad(SDL_Renderer* renderer, SDL_Texture* texture,
+                       const SDL_FRect& uv, const SDL_FPoint corners[4]);
+
+#endif
@@ -8,33 +8,59 @@
 #include "text_input.h"
 #include "../backend/logic.h"
 #include "../backend/memory.h"
-#include <set>
+#include "spatial_grid.h"
+#include "workspace.h"
 
 static bool is_container_block(BlockType type) {
     return type == CMD_IF || type == CMD_REPEAT || type == CMD_DEFINE_BLOCK;
 }
 
 static bool is_hat_block(BlockType type) {
-    return type == CMD_START || type == CMD_EVENT_CLICK || type == CMD_EVENT_KEY;
+    return type == CMD_START || type == CMD_EVENT_CLICK || type == CMD_EVENT_KEY ||
+           type == CMD_CLONE_START;
 }
 
-static Block* find_block_by_id(std::list<Block>& blocks, int id) {
-    for (auto& b : blocks) {
-        if (b.id == id) return &b;
-    }
-    return nullptr;
+static BlockHandle g_drag_handle;
+
+static Block* find_block_by_id(BlockPool& blocks, int id) {
+    return block_pool_find(blocks, id);
 }
 
-static void try_snap_to_argument(std::list<Block>& blocks, Block& dropped) {
-    for (auto& target : blocks) {
+// Each z is read once into a key before sorting, not on every comparison.
+static void sort_by_z(BlockPool& blocks, std::vector<Block*>& candidates, bool topmost_first) {
+    std::vector<std::pair<uint32_t, Block*>> keyed;
+    keyed.reserve(candidates.size());
+    for (Block* b : candidates) keyed.push_back(std::make_pair(block_pool_z(blocks, b), b));
+
+    std::sort(keyed.begin(), keyed.end(),
+              [topmost_first](const std::pair<uint32_t, Block*>& a, const std::pair<uint32_t, Block*>& b) {
+                  return topmost_first ? a.first > b.first : a.first < b.first;
+              });
+    for (size_t i = 0; i < keyed.size(); i++) candidates[i] = keyed[i].second;
+}
+
+static void layout_script(Block* block) {
+    Block* root = block;
+    while (root->parent) root = root->parent;
+    spatial_grid_layout_tree(root);
+}
+
+static void try_snap_to_argument(BlockPool& blocks, Block& dropped) {
+    std::vector<Block*> candidates;
+    spatial_grid_query_point((int)(dropped.layout->x + dropped.layout->width / 2),
+                             (int)(dropped.layout->y + dropped.layout->height / 2), candidates);
+    sort_by_z(blocks, candidates, false);
+
+    for (Block* cand : candidates) {
+        Block& target = *cand;
         if (target.id == dropped.id) continue;
 
         int argCount = get_arg_count(target.type);
         for (int i = 0; i < argCount; i++) {
             SDL_Rect r = get_arg_box_rect(target, i);
 
-            float cx = dropped.x + dropped.width / 2;
-            float cy = dropped.y + dropped.height / 2;
+            float cx = dropped.layout->x + dropped.layout->width / 2;
+            float cy = dropped.layout->y + dropped.layout->height / 2;
 
             if (cx >= r.x && cx <= r.x + r.w && cy >= r.y && cy <= r.y + r.h) {
                 
@@ -50,10 +76,10 @@ static void try_snap_to_argument(std::list<Block>& blocks, Block& dropped) {
 
                     target.argBlocks[i] = &dropped;
                     dropped.parent = &target;
-                    dropped.is_snapped = true;
+                    dropped.layout->is_snapped = true;
 
-                    dropped.x = r.x;
-                    dropped.y = r.y;
+                    dropped.layout->x = r.x;
+                    dropped.layout->y = r.y;
                     
                     log_info("Snapped block #" + std::to_string(dropped.id) + " into arg slot " + std::to_string(i) + " of #" + std::to_string(target.id));
                     return;
@@ -71,13 +97,13 @@ static void reposition_chain(Block& head) {
     Block* current = &head;
     while (current->next) {
         Block* c = current->next;
-        c->x = current->x;
-        c->y = current->y + current->height;
+        c->layout->x = current->layout->x;
+        c->layout->y = current->layout->y + current->layout->height;
         current = c;
     }
 }
 
-static void unsnap_from_parent(std::list<Block>& blocks, Block& block) {
+static void unsnap_from_parent(BlockPool& blocks, Block& block) {
     if (!block.parent) return;
 
     Block* p = find_block_by_id(blocks, block.parent->id);
@@ -93,38 +119,25 @@ static void unsnap_from_parent(std::list<Block>& blocks, Block& block) {
         }
     }
     block.parent = nullptr;
-    block.is_snapped = false;
+    block.layout->is_snapped = false;
     log_debug("Unsnapped block #" + std::to_string(block.id));
 }
 
-static void bring_to_front(std::list<Block>& blocks, Block& block) {
-    for (auto it = blocks.begin(); it != blocks.end(); ++it) {
-        if (&(*it) == &block) {
-            blocks.splice(blocks.end(), blocks, it);
-            return;
-        }
-    }
-}
-
-static void collect_chain_ids_recursive(Block* head, std::set<int>& ids) {
-    if(!head) return;
-
-    ids.insert(head->id);
-    collect_chain_ids_recursive(head->next, ids);
-    collect_chain_ids_recursive(head->inner, ids);
+static void bring_to_front(BlockPool& blocks, Block& block) {
+    block_pool_bring_to_front(blocks, &block);
 }
 
 static void move_block_tree(Block* head, float dx, float dy) {
     if (!head) return;
-    head->x += dx;
-    head->y += dy;
+    head->layout->x += dx;
+    head->layout->y += dy;
     move_block_tree(head->next, dx, dy);
     move_block_tree(head->inner, dx, dy);
 }
 
-void handle_mouse_down(SDL_Event& event, std::list<Block>& blocks,
+void handle_mouse_down(SDL_Event& event, BlockPool& blocks,
                        std::vector<PaletteItem>& palette_items,
-                       int& next_block_id, int palette_scroll_offset,
+                       int palette_scroll_offset,
                        TextInputState& state) {
     int mx = event.button.x;
     int my = event.button.y;
@@ -133,35 +146,47 @@ void handle_mouse_down(SDL_Event& event, std::list<Block>& blocks,
         float item_y = item.y - (float)palette_scroll_offset;
 
         if (is_point_in_rect(mx, my, item.x, item_y, item.width, item.height)) {
-            Block new_block;
-            new_block.id = next_block_id++;
-            new_block.type = item.type;
-            new_block.x = (float)item.x;
-            new_block.y = (float)item_y;
-            new_block.width = item.width;
-            new_block.height = item.height;
-            new_block.color = item.color;
-            new_block.dragging = true;
-            new_block.drag_offset_x = mx - item.x;
-            new_block.drag_offset_y = my - item_y;
-
-            auto defs = get_default_args(new_block.type);
-            new_block.args = defs;
-
-            std::string lbl = block_get_label(new_block.type);
+            int wx, wy, item_wx, item_wy;
+            workspace_screen_to_world(mx, my, wx, wy);
+            workspace_screen_to_world((int)item.x, (int)item_y, item_wx, item_wy);
+
+            Block* created = block_pool_alloc(blocks, take_block_id());
+            BlockLayout& layout = *created->layout;
+            created->type = item.type;
+            layout.x = (float)item_wx;
+            layout.y = (float)item_wy;
+            layout.width = item.width;
+            layout.height = item.height;
+            layout.color = item.color;
+            layout.dragging = true;
+            layout.drag_offset_x = wx - layout.x;
+            layout.drag_offset_y = wy - layout.y;
+
+            auto defs = get_default_args(created->type);
+            created->args = defs;
+
+            std::string lbl = block_get_label(created->type);
             float min_width = lbl.size() * 8.0f + 20.0f;
-            if (new_block.width < min_width) new_block.width = min_width;
+            if (layout.width < min_width) layout.width = min_width;
 
-            blocks.push_back(new_block);
-            log_info("Created block #" + std::to_string(new_block.id) + " from palette");
+            spatial_grid_layout_tree(created);
+            g_drag_handle = block_pool_handle(blocks, created);
+            log_info("Created block #" + std::to_string(created->id) + " from palette");
             return;
         }
     }
 
-    for (auto it = blocks.rbegin(); it != blocks.rend(); ++it) {
-        Block& b = *it;
+    if (!workspace_contains_screen(mx, my)) return;
+    workspace_screen_to_world(mx, my, mx, my);
 
-        if (b.parent && b.is_snapped) {
+    std::vector<Block*> candidates;
+    spatial_grid_query_point(mx, my, candidates);
+    sort_by_z(blocks, candidates, true);
+
+    for (Block* cand : candidates) {
+        Block& b = *cand;
+
+        if (b.parent && b.layout->is_snapped) {
             bool isArg = false;
             for (auto& ab : b.parent->argBlocks) {
                 if (ab == &b) {
@@ -170,38 +195,45 @@ void handle_mouse_down(SDL_Event& event, std::list<Block>& blocks,
                 }
             }
             if (isArg) {
-                if (is_point_in_rect(mx, my, b.x, b.y, b.width, b.height)) {
-                    for (auto& ab : b.parent->argBlocks) {
+                if (is_point_in_rect(mx, my, b.layout->x, b.layout->y, b.layout->width, b.layout->height)) {
+                    Block* host = b.parent;
+                    for (auto& ab : host->argBlocks) {
                         if (ab == &b) ab = nullptr;
                     }
                     b.parent = nullptr;
-                    b.is_snapped = false;
+                    b.layout->is_snapped = false;
                     
-                    b.width = BLOCK_WIDTH;
-                    
-                    b.dragging = true;
-                    b.drag_offset_x = mx - b.x;
-                    b.drag_offset_y = my - b.y;
+                    b.layout->width = BLOCK_WIDTH;
+                    layout_script(host);
+                    layout_script(&b);
+
+                    b.layout->dragging = true;
+                    b.layout->drag_offset_x = mx - b.layout->x;
+                    b.layout->drag_offset_y = my - b.layout->y;
                     
                     bring_to_front(blocks, b);
+                    g_drag_handle = block_pool_handle(blocks, &b);
                     return;
                 }
             }
         }
 
-        int headerY = (int)b.y;
+        int headerY = (int)b.layout->y;
         int headerH = BLOCK_HEIGHT;
 
-        if (is_point_in_rect(mx, my, b.x, b.y, b.width, BLOCK_HEIGHT)) {
+        if (is_point_in_rect(mx, my, b.layout->x, b.layout->y, b.layout->width, BLOCK_HEIGHT)) {
+            Block* host = b.parent;
             unsnap_from_parent(blocks, b);
+            if (host) layout_script(host);
 
-            b.dragging = true;
-            b.drag_offset_x = mx - b.x;
-            b.drag_offset_y = my - b.y;
+            b.layout->dragging = true;
+            b.layout->drag_offset_x = mx - b.layout->x;
+            b.layout->drag_offset_y = my - b.layout->y;
+            g_drag_handle = block_pool_handle(blocks, &b);
             return;
         }
         int totalH = get_total_height(&b);
-        if (is_point_in_rect(mx, my, b.x, b.y, b.width, totalH)) {
+        if (is_point_in_rect(mx, my, b.layout->x, b.layout->y, b.layout->width, totalH)) {
             if (try_click_arg(b, mx, my, state)) {
                 return;
             }
@@ -209,86 +241,85 @@ void handle_mouse_down(SDL_Event& event, std::list<Block>& blocks,
     }
 }
 
-void handle_mouse_up(SDL_Event& event, std::list<Block>& blocks) {
-    int dragged_id = -1;
+void handle_mouse_up(SDL_Event& event, BlockPool& blocks) {
+    Block* dropped = block_pool_get(blocks, g_drag_handle);
+    g_drag_handle = BlockHandle();
 
-    for (auto& block : blocks) {
-        if (block.dragging) {
-            dragged_id = block.id;
-            block.dragging = false;
-            break;
-        }
-    }
+    if (!dropped || !dropped->layout->dragging) return;
+    dropped->layout->dragging = false;
 
-    if (dragged_id < 0) return;
+    int screen_x, screen_y;
+    workspace_world_to_screen(dropped->layout->x, dropped->layout->y, screen_x, screen_y);
 
-    Block* dropped = find_block_by_id(blocks, dragged_id);
-    if (!dropped) return;
-
-    if (dropped->x < PALETTE_WIDTH) {
+    if (screen_x < PALETTE_WIDTH) {
         log_info("Block #" + std::to_string(dropped->id) + " returned to palette - deleting");
-        std::set<int> ids_to_remove;
-
-        collect_chain_ids_recursive(dropped, ids_to_remove);
-
-        for(auto it = blocks.begin(); it != blocks.end(); ) {
-            if (ids_to_remove.count(it->id) > 0) {
-                it = blocks.erase(it);
-            } else {
-                ++it;
-            }
-        }
+        spatial_grid_remove_tree(dropped);
+        safe_delete_chain(blocks, dropped, dropped->parent);
         return;
     }
 
+    spatial_grid_layout_tree(dropped);
+
     try_snap_to_argument(blocks, *dropped);
-    if (dropped->is_snapped) return;
+    if (dropped->layout->is_snapped) {
+        layout_script(dropped);
+        return;
+    }
 
     try_snap_blocks(blocks, *dropped);
+    layout_script(dropped);
 
     log_debug("Dropped block #" + std::to_string(dropped->id));
 }
 
-void handle_mouse_motion(SDL_Event& event, std::list<Block>& blocks) {
-    int mx = event.motion.x;
-    int my = event.motion.y;
-
-    for (auto& block : blocks) {
-        if (!block.dragging) continue;
-
-        float prev_x = block.x;
-        float prev_y = block.y;
+Block* get_dragged_block(BlockPool& blocks) {
+    Block* b = block_pool_get(blocks, g_drag_handle);
+    return (b && b->layout->dragging) ? b : nullptr;
+}
 
-        block.x = mx - block.drag_offset_x;
-        block.y = my - block.drag_offset_y;
+void handle_mouse_motion(SDL_Event& event, BlockPool& blocks) {
+    int mx, my;
+    workspace_screen_to_world(event.motion.x, event.motion.y, mx, my);
 
-        float dx = block.x - prev_x;
-        float dy = block.y - prev_y;
+    Block* dragged = get_dragged_block(blocks);
+    if (dragged) {
+        Block& block = *dragged;
 
-        move_block_tree(block.inner, dx, dy);
-        move_block_tree(block.next, dx, dy);
-        break;
+        block.layout->x = mx - block.layout->drag_offset_x;
+        block.layout->y = my - block.layout->drag_offset_y;
+        spatial_grid_layout_tree(&block);
     }
 }
 
-void try_snap_blocks(std::list<Block>& blocks, Block& dropped_block) {
+void try_snap_blocks(BlockPool& blocks, Block& dropped_block) {
     int dropped_id = dropped_block.id;
     
-    dropped_block.height = get_total_height(&dropped_block);
+    dropped_block.layout->height = get_total_height(&dropped_block);
+
+    // Inner snapping accepts a 60px horizontal miss around the mouth of a
+    // C-block, next snapping a 2 * SNAP_DISTANCE radius around the bottom.
+    const int reach = SNAP_DISTANCE * 2;
+    SDL_Rect area = {(int)dropped_block.layout->x - 75, (int)dropped_block.layout->y - reach,
+                     75 + 60, reach * 2};
+
+    std::vector<Block*> candidates;
+    spatial_grid_query_rect(area, candidates);
+    sort_by_z(blocks, candidates, false);
 
-    for (auto& target : blocks) {
+    for (Block* cand : candidates) {
+        Block& target = *cand;
         if (target.id == dropped_id) continue;
         
-        target.height = get_total_height(&target);
+        target.layout->height = get_total_height(&target);
 
         if (is_container_block(target.type) && !target.inner) {
             float container_height = get_total_height(&target);
-            float snap_x = target.x + 15;
-            float snap_y = target.y + BLOCK_HEIGHT + 5;
+            float snap_x = target.layout->x + 15;
+            float snap_y = target.layout->y + BLOCK_HEIGHT + 5;
 
-            bool x_aligned = std::abs(dropped_block.x - snap_x) < 60;
+            bool x_aligned = std::abs(dropped_block.layout->x - snap_x) < 60;
             
-            bool y_overlapping = dropped_block.y < target.y + container_height;
+            bool y_overlapping = dropped_block.layout->y < target.layout->y + container_height;
 
             if (x_aligned && y_overlapping) {
                 if (dropped_block.type == CMD_DEFINE_BLOCK || is_hat_block(dropped_block.type)) {
@@ -298,11 +329,11 @@ void try_snap_blocks(std::list<Block>& blocks, Block& dropped_block) {
                 Block* dropped = find_block_by_id(blocks, dropped_id);
                 if (!dropped) return;
 
-                float offset_x = snap_x - dropped->x;
-                float offset_y = snap_y - dropped->y;
+                float offset_x = snap_x - dropped->layout->x;
+                float offset_y = snap_y - dropped->layout->y;
                 
-                dropped->x += offset_x;
-                dropped->y += offset_y;
+                dropped->layout->x += offset_x;
+                dropped->layout->y += offset_y;
 
                 move_block_tree(dropped->inner, offset_x, offset_y);
                 move_block_tree(dropped->next, offset_x, offset_y);
@@ -322,22 +353,22 @@ void try_snap_blocks(std::list<Block>& blocks, Block& dropped_block) {
                 continue;
             }
 
-            float snap_x = target.x;
-            float snap_y = target.y + get_total_height(&target);
+            float snap_x = target.layout->x;
+            float snap_y = target.layout->y + get_total_height(&target);
 
-            float dx = std::abs(dropped_block.x - snap_x);
-            float dy = std::abs(dropped_block.y - snap_y);
+            float dx = std::abs(dropped_block.layout->x - snap_x);
+            float dy = std::abs(dropped_block.layout->y - snap_y);
             float dist = std::sqrt(dx * dx + dy * dy);
 
             if (dist < SNAP_DISTANCE * 2) {
                 Block* dropped = find_block_by_id(blocks, dropped_id);
                 if (!dropped) return;
 
-                float offset_x = snap_x - dropped->x;
-                float offset_y = snap_y - dropped->y;
+                float offset_x = snap_x - dropped->layout->x;
+                float offset_y = snap_y - dropped->layout->y;
 
-                dropped->x = snap_x;
-                dropped->y = snap_y;
+                dropped->layout->x = snap_x;
+                dropped->layout->y = snap_y;
 
                 move_block_tree(dropped->next, offset_x, offset_y);
                 move_block_tree(dropped->inner, offset_x, offset_y);
@@ -352,7 +383,7 @@ void try_snap_blocks(std::list<Block>& blocks, Block& dropped_block) {
 
 void unsnap_block(Block& block) {
     disconnect_from_parent(&block);
-    block.is_snapped = false;
+    block.layout->is_snapped = false;
     log_debug("Unsnapped block #" + std::to_string(block.id));
 }
 
@@ -3,19 +3,20 @@
 #include "../common/definitions.h"
 #include <SDL2/SDL.h>
 #include <vector>
-#include <list>
+#include "../backend/block_pool.h"
 
 #include "text_input.h" 
 bool is_point_in_rect(int px, int py, float rx, float ry, float rw, float rh);
 
-void handle_mouse_down(SDL_Event& event, std::list<Block>& blocks,
+void handle_mouse_down(SDL_Event& event, BlockPool& blocks,
                        std::vector<PaletteItem>& palette_items,
-                       int& next_block_id, int palette_scroll_offset,
+                       int palette_scroll_offset,
                        TextInputState& state);
 
-void handle_mouse_up(SDL_Event& event, std::list<Block>& blocks);
-void handle_mouse_motion(SDL_Event& event, std::list<Block>& blocks);
-void try_snap_blocks(std::list<Block>& blocks, Block& dropped_block);
+void handle_mouse_up(SDL_Event& event, BlockPool& blocks);
+void handle_mouse_motion(SDL_Event& event, BlockPool& blocks);
+Block* get_dragged_block(BlockPool& blocks);
+void try_snap_blocks(BlockPool& blocks, Block& dropped_block);
 void unsnap_block(Block& block);
 bool try_click_arg(const Block& block, int mx, int my, TextInputState& state);
 
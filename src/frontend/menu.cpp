@@ -2,6 +2,7 @@
 #include "../common/definitions.h"
 #include "../common/globals.h"
 #include "draw.h"
+#include "geom_batch.h"
 #include <cstring>
 static MenuAction g_last_action = MENU_ACTION_NONE;
 
@@ -41,6 +42,7 @@ void menu_init() {
     g_menus[1].items.clear();
     g_menus[1].items.push_back(MenuItem("System Logger", MENU_ACTION_SYSTEM_LOGGER)); 
     g_menus[1].items.push_back(MenuItem("Debug Info",    MENU_ACTION_DEBUG_INFO));    
+    g_menus[1].items.push_back(MenuItem("Low Latency Audio", MENU_ACTION_LOW_LATENCY_AUDIO));
     g_menus[1].items.push_back(MenuItem("About",         MENU_ACTION_ABOUT));       
 }
 
@@ -137,20 +139,16 @@ void menu_handle_mouse_up(int mx, int my) {
 
 void menu_render(SDL_Renderer* renderer)
 {
-    SDL_SetRenderDrawColor(renderer, 45, 45, 48, 255);
-    SDL_Rect bar = { 0, 0, WINDOW_WIDTH, MENU_BAR_OFFSET };
-    SDL_RenderFillRect(renderer, &bar);
+    geom_begin(renderer);
 
-    SDL_SetRenderDrawColor(renderer, 70, 70, 75, 255);
-    SDL_RenderDrawLine(renderer, 0, MENU_BAR_OFFSET - 1, WINDOW_WIDTH, MENU_BAR_OFFSET - 1);
+    geom_box(renderer, 0, 0, WINDOW_WIDTH - 1, MENU_BAR_OFFSET - 1, 45, 45, 48, 255);
+    geom_hline(renderer, 0, WINDOW_WIDTH, MENU_BAR_OFFSET - 1, 70, 70, 75, 255);
 
     for (int i = 0; i < g_menu_count; i++) {
         Menu& m = g_menus[i];
 
         if (m.title_highlighted || m.is_open) {
-            SDL_SetRenderDrawColor(renderer, 70, 70, 78, 255);
-            SDL_Rect hl = { m.x, m.y, m.width, m.height };
-            SDL_RenderFillRect(renderer, &hl);
+            draw_filled_rect(renderer, m.x, m.y, m.width, m.height, {70, 70, 78, 255});
         }
 
         int text_y = (MENU_BAR_OFFSET - 14) / 2;
@@ -161,24 +159,21 @@ void menu_render(SDL_Renderer* renderer)
             int dropdown_y = m.y + m.height;
             int dropdown_h = (int)m.items.size() * m.item_height;
 
-            SDL_SetRenderDrawColor(renderer, 50, 50, 55, 255);
-            SDL_Rect dd = { dropdown_x, dropdown_y, m.item_width, dropdown_h };
-            SDL_RenderFillRect(renderer, &dd);
-
-            SDL_SetRenderDrawColor(renderer, 80, 80, 88, 255);
-            SDL_RenderDrawRect(renderer, &dd);
+            draw_filled_rect(renderer, dropdown_x, dropdown_y, m.item_width, dropdown_h, {50, 50, 55, 255});
+            draw_rect_outline(renderer, dropdown_x, dropdown_y, m.item_width, dropdown_h, {80, 80, 88, 255});
 
             for (int k = 0; k < (int)m.items.size(); k++) {
                 int item_y = dropdown_y + k * m.item_height;
 
                 if (m.items[k].highlighted) {
-                    SDL_SetRenderDrawColor(renderer, 75, 110, 175, 255);
-                    SDL_Rect ih = { dropdown_x + 1, item_y, m.item_width - 2, m.item_height };
-                    SDL_RenderFillRect(renderer, &ih);
+                    draw_filled_rect(renderer, dropdown_x + 1, item_y, m.item_width - 2, m.item_height,
+                                     {75, 110, 175, 255});
                 }
 
                 draw_text(renderer, dropdown_x + 10, item_y + 5, m.items[k].label, COLOR_WHITE);
             }
         }
     }
+
+    geom_end(renderer);
 }
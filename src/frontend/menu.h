@@ -17,6 +17,7 @@ enum MenuAction {
     // Help menu
     MENU_ACTION_SYSTEM_LOGGER,
     MENU_ACTION_DEBUG_INFO,
+    MENU_ACTION_LOW_LATENCY_AUDIO,
     MENU_ACTION_ABOUT
 };
 
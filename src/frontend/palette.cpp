@@ -1,5 +1,6 @@
 #include "palette.h"
 #include "draw.h"
+#include "geom_batch.h"
 #include "block_utils.h"
 #include "../common/globals.h"
 
@@ -30,6 +31,9 @@ BlockCategory get_block_category(BlockType type) {
         case CMD_REPEAT:
         case CMD_IF:
         case CMD_WAIT:
+        case CMD_CREATE_CLONE:
+        case CMD_CLONE_START:
+        case CMD_DELETE_CLONE:
             return CAT_CONTROL;
 
         // === LOOKS ===
@@ -47,6 +51,11 @@ BlockCategory get_block_category(BlockType type) {
         case CMD_STOP_ALL_SOUNDS:
         case CMD_CHANGE_VOLUME:
         case CMD_SET_VOLUME:
+        case CMD_CHANGE_PITCH_EFFECT:
+        case CMD_SET_PITCH_EFFECT:
+        case CMD_CHANGE_PAN_EFFECT:
+        case CMD_SET_PAN_EFFECT:
+        case CMD_CLEAR_SOUND_EFFECTS:
             return CAT_SOUND;
 
         // === PEN ===
@@ -58,9 +67,17 @@ BlockCategory get_block_category(BlockType type) {
         case CMD_PEN_STAMP:
             return CAT_PEN;
 
+        // === MUSIC ===
+        case CMD_PLAY_NOTE:
+        case CMD_REST:
+        case CMD_SET_INSTRUMENT:
+        case CMD_SET_TEMPO:
+            return CAT_MUSIC;
+
         // === SENSING ===
         case SENSE_TOUCHING_MOUSE:
         case SENSE_TOUCHING_EDGE:
+        case SENSE_TOUCHING_SPRITE:
         case SENSE_MOUSE_DOWN:
         case SENSE_MOUSE_X:
         case SENSE_MOUSE_Y:
@@ -117,6 +134,7 @@ void init_categories() {
     g_categories.push_back({CAT_LOOKS,     "Looks",     COLOR_LOOKS,    LOOKS_BLOCKS_COUNT * BLOCK_HEIGHT});
     g_categories.push_back({CAT_SOUND,     "Sound",     COLOR_SOUND,    SOUND_BLOCKS_COUNT * BLOCK_HEIGHT});
     g_categories.push_back({CAT_PEN,       "Pen",       COLOR_PEN,      PEN_BLOCKS_COUNT * BLOCK_HEIGHT});
+    g_categories.push_back({CAT_MUSIC,     "Music",     COLOR_MUSIC,    MUSIC_BLOCKS_COUNT * BLOCK_HEIGHT});
     g_categories.push_back({CAT_SENSING,   "Sensing",   COLOR_SENSING,  SENSING_BLOCKS_COUNT * BLOCK_HEIGHT});
     g_categories.push_back({CAT_OPERATORS, "Operators", COLOR_OPERATOR, OPERATORS_BLOCKS_COUNT * BLOCK_HEIGHT});
     g_categories.push_back({CAT_VARIABLES, "Variables", COLOR_VARIABLE, VARIABLE_BLOCKS_COUNT * BLOCK_HEIGHT});
@@ -169,6 +187,9 @@ void init_palette(std::vector<PaletteItem>& items) {
         {CMD_REPEAT,        "Repeat (10)"},
         {CMD_IF,            "If <> then"},
         {CMD_WAIT,          "Wait (1) secs"},
+        {CMD_CREATE_CLONE,  "Create clone of myself"},
+        {CMD_CLONE_START,   "When I start as a clone"},
+        {CMD_DELETE_CLONE,  "Delete this clone"},
 
         // === LOOKS ===
         {CMD_SAY,           "Say [Hello!]"},
@@ -184,6 +205,11 @@ void init_palette(std::vector<PaletteItem>& items) {
         {CMD_STOP_ALL_SOUNDS,"Stop all sounds"},
         {CMD_CHANGE_VOLUME, "Change volume by (10)"},
         {CMD_SET_VOLUME,    "Set volume to (100)"},
+        {CMD_CHANGE_PITCH_EFFECT, "Change pitch effect by (10)"},
+        {CMD_SET_PITCH_EFFECT,    "Set pitch effect to (100)"},
+        {CMD_CHANGE_PAN_EFFECT,   "Change pan effect by (10)"},
+        {CMD_SET_PAN_EFFECT,      "Set pan effect to (100)"},
+        {CMD_CLEAR_SOUND_EFFECTS, "Clear sound effects"},
 
         // === PEN ===
         {CMD_PEN_DOWN,      "Pen down"},
@@ -193,7 +219,14 @@ void init_palette(std::vector<PaletteItem>& items) {
         {CMD_PEN_SET_SIZE,  "Set pen size to (1)"},
         {CMD_PEN_STAMP,     "Stamp"},
 
+        // === MUSIC ===
+        {CMD_PLAY_NOTE,      "Play note (60) for (0.25) beats"},
+        {CMD_REST,           "Rest for (0.25) beats"},
+        {CMD_SET_INSTRUMENT, "Set instrument to (1)"},
+        {CMD_SET_TEMPO,      "Set tempo to (60)"},
+
         // === SENSING ===
+        {SENSE_TOUCHING_SPRITE, "touching [Cat]?"},
         {SENSE_MOUSE_DOWN,  "mouse down?"},
         {SENSE_MOUSE_X,     "mouse x"},
         {SENSE_MOUSE_Y,     "mouse y"},
@@ -267,9 +300,11 @@ int get_palette_total_height(const std::vector<PaletteItem>& items) {
 }
 
 void draw_palette(SDL_Renderer* renderer, const std::vector<PaletteItem>& items, int scroll_offset) {
+    geom_begin(renderer);
     draw_filled_rect(renderer, PALETTE_X, PALETTE_Y, PALETTE_WIDTH, PALETTE_HEIGHT, COLOR_PALETTE_BG);
 
     SDL_Rect clip_rect = {PALETTE_X, PALETTE_Y, PALETTE_WIDTH, PALETTE_HEIGHT};
+    geom_flush(renderer);
     SDL_RenderSetClipRect(renderer, &clip_rect);
 
     for (const auto& item : items) {
@@ -279,14 +314,18 @@ void draw_palette(SDL_Renderer* renderer, const std::vector<PaletteItem>& items,
         if (draw_y > (float)(PALETTE_Y + PALETTE_HEIGHT)) continue;
 
         Block temp;
+        BlockLayout temp_layout;
+        temp.layout = &temp_layout;
         temp.type = item.type;
-        temp.x = item.x;
-        temp.y = draw_y;
-        temp.width = item.width;
-        temp.height = item.height;
-        temp.color = item.color;
+        temp_layout.x = item.x;
+        temp_layout.y = draw_y;
+        temp_layout.width = item.width;
+        temp_layout.height = item.height;
+        temp_layout.color = item.color;
         draw_block(renderer, temp, item.label);
     }
 
+    geom_flush(renderer);
     SDL_RenderSetClipRect(renderer, nullptr);
+    geom_end(renderer);
 }
@@ -0,0 +1,142 @@
+#include "panel_cache.h"
+#include "geom_batch.h"
+#include "../utils/logger.h"
+
+struct PanelSlot {
+    SDL_Rect area;
+    Uint64 signature;
+    bool valid;
+};
+
+static SDL_Texture* g_layer = nullptr;
+static int g_layer_w = 0;
+static int g_layer_h = 0;
+static bool g_unsupported = false;
+static bool g_drawing_direct = false;
+
+static PanelSlot g_panels[PANEL_COUNT] = {};
+
+// A panel redrawn this frame forces a redraw of later panels it overlaps,
+// because its background fill wipes their pixels in the shared layer.
+static SDL_Rect g_wiped[2 * PANEL_COUNT];
+static int g_wiped_count = 0;
+static int g_last_panel = PANEL_COUNT;
+
+static bool ensure_layer(SDL_Renderer* renderer) {
+    if (g_unsupported) return false;
+
+    int w, h;
+    if (SDL_GetRendererOutputSize(renderer, &w, &h) != 0) return false;
+    if (g_layer && w == g_layer_w && h == g_layer_h) return true;
+
+    if (g_layer) {
+        SDL_DestroyTexture(g_layer);
+        g_layer = nullptr;
+    }
+
+    if (!SDL_RenderTargetSupported(renderer)) {
+        log_warning("Panel cache: render targets unsupported, drawing panels directly");
+        g_unsupported = true;
+        return false;
+    }
+
+    g_layer = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888,
+                                SDL_TEXTUREACCESS_TARGET, w, h);
+    if (!g_layer) {
+        log_warning(std::string("Panel cache: cannot create layer: ") + SDL_GetError());
+        g_unsupported = true;
+        return false;
+    }
+    SDL_SetTextureBlendMode(g_layer, SDL_BLENDMODE_BLEND);
+    g_layer_w = w;
+    g_layer_h = h;
+
+    SDL_Texture* prev = SDL_GetRenderTarget(renderer);
+    SDL_SetRenderTarget(renderer, g_layer);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+    SDL_RenderClear(renderer);
+    SDL_SetRenderTarget(renderer, prev);
+
+    panel_cache_invalidate_all();
+    return true;
+}
+
+bool panel_cache_begin(SDL_Renderer* renderer, CachedPanel panel,
+                       const SDL_Rect& area, Uint64 signature) {
+    if (!ensure_layer(renderer)) {
+        g_drawing_direct = true;
+        return true;
+    }
+    g_drawing_direct = false;
+    geom_flush(renderer);
+
+    // Panels are visited in order, so returning to an earlier one means a
+    // new frame has started.
+    if ((int)panel <= g_last_panel) g_wiped_count = 0;
+    g_last_panel = panel;
+
+    PanelSlot& slot = g_panels[panel];
+    bool dirty = !slot.valid || slot.signature != signature ||
+                 !SDL_RectEquals(&slot.area, &area);
+
+    for (int i = 0; i < g_wiped_count && !dirty; i++) {
+        if (SDL_HasIntersection(&g_wiped[i], &area)) dirty = true;
+    }
+    if (!dirty) return false;
+
+    if (slot.valid && !SDL_RectEquals(&slot.area, &area)) {
+        g_wiped[g_wiped_count++] = slot.area;
+    }
+    slot.area = area;
+    slot.signature = signature;
+    slot.valid = true;
+    g_wiped[g_wiped_count++] = area;
+
+    SDL_SetRenderTarget(renderer, g_layer);
+    SDL_RenderSetClipRect(renderer, &area);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+    SDL_SetRenderDrawColor(renderer, 30, 30, 30, 255);
+    SDL_RenderFillRect(renderer, &area);
+    return true;
+}
+
+void panel_cache_end(SDL_Renderer* renderer) {
+    if (g_drawing_direct) return;
+
+    geom_flush(renderer);
+    SDL_RenderSetClipRect(renderer, nullptr);
+    SDL_SetRenderTarget(renderer, nullptr);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+}
+
+void panel_cache_blit(SDL_Renderer* renderer) {
+    if (!g_layer || g_unsupported) return;
+    SDL_RenderCopy(renderer, g_layer, nullptr, nullptr);
+}
+
+void panel_cache_invalidate_all() {
+    for (PanelSlot& slot : g_panels) slot.valid = false;
+}
+
+void panel_cache_destroy() {
+    if (g_layer) SDL_DestroyTexture(g_layer);
+    g_layer = nullptr;
+    g_layer_w = g_layer_h = 0;
+    panel_cache_invalidate_all();
+}
+
+Uint64 panel_cache_hash(Uint64 h, const void* data, size_t len) {
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+Uint64 panel_cache_hash(Uint64 h, const std::string& s) {
+    size_t len = s.size();
+    h = panel_cache_hash(h, &len, sizeof(len));
+    return panel_cache_hash(h, s.data(), len);
+}
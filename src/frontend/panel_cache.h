@@ -0,0 +1,38 @@
+#ifndef PANEL_CACHE_H
+#define PANEL_CACHE_H
+#include <SDL2/SDL.h>
+#include <string>
+
+// Retained layer for the static UI panels. All panels share one
+// window-sized render target; each owns a rectangle of it and is redrawn
+// only when its signature (a hash of whatever the panel reads) changes.
+// Panels must be visited in back-to-front order every frame, since
+// redrawing one also redraws any later panel that overlaps it.
+
+enum CachedPanel {
+    PANEL_TOOLBAR,
+    PANEL_CATEGORY_BAR,
+    PANEL_PALETTE,
+    PANEL_CODING_AREA,
+    PANEL_SPRITE_PANEL,
+    PANEL_SPRITE_LIST,
+    PANEL_COUNT
+};
+
+// Returns true when the caller must draw the panel now. Drawing then goes
+// into the cached layer (or straight to the screen if render targets are
+// unavailable) and must be followed by panel_cache_end.
+bool panel_cache_begin(SDL_Renderer* renderer, CachedPanel panel,
+                       const SDL_Rect& area, Uint64 signature);
+void panel_cache_end(SDL_Renderer* renderer);
+
+// Composites the cached panels onto the current target.
+void panel_cache_blit(SDL_Renderer* renderer);
+
+void panel_cache_invalidate_all();
+void panel_cache_destroy();
+
+Uint64 panel_cache_hash(Uint64 h, const void* data, size_t len);
+Uint64 panel_cache_hash(Uint64 h, const std::string& s);
+
+#endif
@@ -1,21 +1,65 @@
 #include "pen.h"
-#include "../gfx/SDL2_gfxPrimitives.h"
+#include "geom_batch.h"
+#include "pen_raster.h"
+#include "../utils/logger.h"
 
 #include <cmath>
+#include <vector>
+#include <cstring>
+#include <unordered_map>
+
+enum PenBackend {
+    PEN_BACKEND_GPU,
+    PEN_BACKEND_CPU
+};
+
+enum PenCommandType {
+    PEN_CMD_CLEAR,
+    PEN_CMD_LINE,
+    PEN_CMD_STAMP
+};
+
+// Pen operations are queued while scripts run and drawn into the canvas
+// in one pass per frame, instead of switching render targets per segment.
+struct PenCommand {
+    PenCommandType type;
+    float x1, y1, x2, y2;
+    float width;
+    SDL_Color color;
+    SDL_Texture* texture;
+    Uint32 image_id;
+    SDL_Rect dst;
+    double angle;
+};
+
+// Bounds memory when a script draws far more than one frame's worth.
+const size_t PEN_QUEUE_LIMIT = 65536;
 
 static SDL_Texture* pen_canvas = nullptr;
 static Uint8 pen_r = 0, pen_g = 0, pen_b = 200, pen_a = 255;
 static int pen_thickness = 2;
 static bool initialized = false;
+static std::vector<PenCommand> pen_queue;
+static PenBackend pen_backend = PEN_BACKEND_GPU;
 
-void pen_init(SDL_Renderer* renderer) {
-    if (pen_canvas) {
-        SDL_DestroyTexture(pen_canvas);
-    }
+// Premultiplied copies of stamped costumes, read back once per costume
+// image. Keyed by Costume::image_id rather than the texture, whose address
+// can come back for a different image once the old one is destroyed.
+struct StampImage {
+    int w, h;
+    std::vector<Uint32> pixels;
+};
+static std::unordered_map<Uint32, StampImage> stamp_images;
+static StampImage stamp_uncached;
+static bool stamp_unsupported = false;
+const size_t STAMP_CACHE_LIMIT = 32;
+
+static bool create_gpu_canvas(SDL_Renderer* renderer) {
     pen_canvas = SDL_CreateTexture(renderer,
         SDL_PIXELFORMAT_RGBA8888,
         SDL_TEXTUREACCESS_TARGET,
         STAGE_WIDTH, STAGE_HEIGHT);
+    if (!pen_canvas) return false;
     SDL_SetTextureBlendMode(pen_canvas, SDL_BLENDMODE_BLEND);
 
     SDL_Texture* prev = SDL_GetRenderTarget(renderer);
@@ -23,11 +67,65 @@ void pen_init(SDL_Renderer* renderer) {
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
     SDL_RenderClear(renderer);
     SDL_SetRenderTarget(renderer, prev);
+    return true;
+}
+
+static bool create_cpu_canvas(SDL_Renderer* renderer) {
+    if (!pen_raster_init(STAGE_WIDTH, STAGE_HEIGHT)) return false;
+
+    pen_canvas = SDL_CreateTexture(renderer,
+        SDL_PIXELFORMAT_RGBA32,
+        SDL_TEXTUREACCESS_STREAMING,
+        STAGE_WIDTH, STAGE_HEIGHT);
+    if (!pen_canvas) {
+        pen_raster_shutdown();
+        return false;
+    }
+
+    // The raster holds premultiplied colour.
+    SDL_BlendMode premultiplied = SDL_ComposeCustomBlendMode(
+        SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD,
+        SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD);
+    if (SDL_SetTextureBlendMode(pen_canvas, premultiplied) != 0) {
+        SDL_SetTextureBlendMode(pen_canvas, SDL_BLENDMODE_BLEND);
+    }
+    return true;
+}
+
+void pen_init(SDL_Renderer* renderer) {
+    if (pen_canvas) {
+        SDL_DestroyTexture(pen_canvas);
+        pen_canvas = nullptr;
+    }
+    pen_raster_shutdown();
+    stamp_images.clear();
+    stamp_unsupported = false;
+    pen_queue.clear();
+
+    const char* env = SDL_getenv("BLOCKY_PEN_BACKEND");
+    if (env && std::strcmp(env, "cpu") == 0) {
+        pen_backend = PEN_BACKEND_CPU;
+    }
 
-    initialized = true;
+    if (pen_backend == PEN_BACKEND_GPU && !create_gpu_canvas(renderer)) {
+        log_warning("Pen: render target canvas unavailable, using CPU backend");
+        pen_backend = PEN_BACKEND_CPU;
+    }
+    if (pen_backend == PEN_BACKEND_CPU) {
+        if (create_cpu_canvas(renderer)) {
+            log_info(std::string("Pen: CPU backend (") + pen_raster_isa() + ")");
+        } else {
+            log_error("Pen: could not create CPU canvas");
+        }
+    }
+
+    initialized = pen_canvas != nullptr;
 }
 
 void pen_shutdown() {
+    pen_queue.clear();
+    stamp_images.clear();
+    pen_raster_shutdown();
     if (pen_canvas) {
         SDL_DestroyTexture(pen_canvas);
         pen_canvas = nullptr;
@@ -35,13 +133,14 @@ void pen_shutdown() {
     initialized = false;
 }
 
-void pen_clear(SDL_Renderer* renderer) {
+void pen_clear() {
     if (!pen_canvas) return;
-    SDL_Texture* prev = SDL_GetRenderTarget(renderer);
-    SDL_SetRenderTarget(renderer, pen_canvas);
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
-    SDL_RenderClear(renderer);
-    SDL_SetRenderTarget(renderer, prev);
+
+    // Anything queued before a clear would be wiped anyway.
+    pen_queue.clear();
+    PenCommand cmd = {};
+    cmd.type = PEN_CMD_CLEAR;
+    pen_queue.push_back(cmd);
 }
 
 void pen_set_color(Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
@@ -57,48 +156,56 @@ void pen_set_size(int size) {
     pen_thickness = size;
 }
 
+static void pen_enqueue(SDL_Renderer* renderer, const PenCommand& cmd) {
+    pen_queue.push_back(cmd);
+    if (pen_queue.size() >= PEN_QUEUE_LIMIT) {
+        pen_flush(renderer);
+    }
+}
+
+static void pen_enqueue_line(SDL_Renderer* renderer, float x1, float y1, float x2, float y2,
+                             int thickness, Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
+    PenCommand cmd = {};
+    cmd.type = PEN_CMD_LINE;
+    // Canvas pixel centres, matching the integer endpoints SDL2_gfx used.
+    cmd.x1 = (int)(x1 - STAGE_X) + 0.5f;
+    cmd.y1 = (int)(y1 - STAGE_Y) + 0.5f;
+    cmd.x2 = (int)(x2 - STAGE_X) + 0.5f;
+    cmd.y2 = (int)(y2 - STAGE_Y) + 0.5f;
+    cmd.width = (float)(thickness < 1 ? 1 : thickness);
+    cmd.color = {r, g, b, a};
+    pen_enqueue(renderer, cmd);
+}
+
 void pen_stamp(SDL_Renderer* renderer, Sprite& sprite) {
     if (!pen_canvas || !sprite.texture) return;
 
-    SDL_Texture* prev = SDL_GetRenderTarget(renderer);
-    SDL_SetRenderTarget(renderer, pen_canvas);
-
     int draw_w = (int)(sprite.width * sprite.scale);
     int draw_h = (int)(sprite.height * sprite.scale);
     int sx = (int)(sprite.x - STAGE_X - draw_w / 2);
     int sy = (int)(sprite.y - STAGE_Y - draw_h / 2);
 
-    SDL_Rect dst = { sx, sy, draw_w, draw_h };
-    SDL_RenderCopyEx(renderer, sprite.texture, nullptr, &dst,
-                     sprite.direction, nullptr, SDL_FLIP_NONE);
+    // A sprite can show a texture that is not its current costume's, such
+    // as a placeholder; that has no image id and is read back uncached.
+    int idx = sprite.currentCostumeIndex;
+    bool own = idx >= 0 && idx < (int)sprite.costumes.size() &&
+               sprite.costumes[idx].texture == sprite.texture;
 
-    SDL_SetRenderTarget(renderer, prev);
+    PenCommand cmd = {};
+    cmd.type = PEN_CMD_STAMP;
+    cmd.texture = sprite.texture;
+    cmd.image_id = own ? sprite.costumes[idx].image_id : 0;
+    cmd.dst = { sx, sy, draw_w, draw_h };
+    cmd.angle = sprite.direction;
+    pen_enqueue(renderer, cmd);
 }
 
 void pen_draw_line(SDL_Renderer* renderer, float x1, float y1,
                    float x2, float y2, const Sprite& sprite) {
     if (!pen_canvas) return;
 
-    int cx1 = (int)(x1 - STAGE_X);
-    int cy1 = (int)(y1 - STAGE_Y);
-    int cx2 = (int)(x2 - STAGE_X);
-    int cy2 = (int)(y2 - STAGE_Y);
-
-    SDL_Texture* prev_target = SDL_GetRenderTarget(renderer);
-    SDL_SetRenderTarget(renderer, pen_canvas);
-
-    Uint8 r = sprite.penR;
-    Uint8 g = sprite.penG;
-    Uint8 b = sprite.penB;
-    int thickness = sprite.penSize;
-
-    if (thickness <= 1) {
-        aalineRGBA(renderer, cx1, cy1, cx2, cy2, r, g, b, 255);
-    } else {
-        thickLineRGBA(renderer, cx1, cy1, cx2, cy2, thickness, r, g, b, 255);
-    }
-
-    SDL_SetRenderTarget(renderer, prev_target);
+    pen_enqueue_line(renderer, x1, y1, x2, y2, sprite.penSize,
+                     sprite.penR, sprite.penG, sprite.penB, 255);
 }
 
 void pen_update(SDL_Renderer* renderer, Sprite& sprite) {
@@ -113,29 +220,135 @@ void pen_update(SDL_Renderer* renderer, Sprite& sprite) {
     float dy = cy - py;
     if (dx * dx + dy * dy < 0.5f) return;
 
+    pen_enqueue_line(renderer, px, py, cx, cy, pen_thickness,
+                     pen_r, pen_g, pen_b, pen_a);
+
+    sprite.prevPenX = cx;
+    sprite.prevPenY = cy;
+}
+
+static const StampImage* stamp_image(SDL_Renderer* renderer, SDL_Texture* texture, Uint32 image_id) {
+    if (stamp_unsupported) return nullptr;
+    if (image_id != 0) {
+        auto it = stamp_images.find(image_id);
+        if (it != stamp_images.end()) return &it->second;
+        if (stamp_images.size() >= STAMP_CACHE_LIMIT) stamp_images.clear();
+    }
+
+    int w, h;
+    if (SDL_QueryTexture(texture, nullptr, nullptr, &w, &h) != 0 || w <= 0 || h <= 0) return nullptr;
+
+    // Textures are GPU-only, so copy into a scratch target and read it back.
+    SDL_Texture* scratch = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32,
+                                             SDL_TEXTUREACCESS_TARGET, w, h);
+    if (!scratch) {
+        log_warning("Pen: stamps disabled - render targets unavailable: " + std::string(SDL_GetError()));
+        stamp_unsupported = true;
+        return nullptr;
+    }
+
+    StampImage img;
+    img.w = w;
+    img.h = h;
+    img.pixels.resize((size_t)w * h);
+
+    SDL_BlendMode prevBlend;
+    SDL_GetTextureBlendMode(texture, &prevBlend);
+    SDL_Texture* prev = SDL_GetRenderTarget(renderer);
+
+    SDL_SetRenderTarget(renderer, scratch);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+    SDL_RenderClear(renderer);
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_NONE);
+    SDL_RenderCopy(renderer, texture, nullptr, nullptr);
+    int ok = SDL_RenderReadPixels(renderer, nullptr, SDL_PIXELFORMAT_RGBA32,
+                                  img.pixels.data(), w * 4);
+    SDL_SetTextureBlendMode(texture, prevBlend);
+    SDL_SetRenderTarget(renderer, prev);
+    SDL_DestroyTexture(scratch);
+
+    if (ok != 0) return nullptr;
+    pen_raster_premultiply(img.pixels.data(), w * h);
+    if (image_id == 0) {
+        stamp_uncached = std::move(img);
+        return &stamp_uncached;
+    }
+    return &stamp_images.emplace(image_id, std::move(img)).first->second;
+}
+
+static void pen_flush_cpu(SDL_Renderer* renderer) {
+    for (const PenCommand& cmd : pen_queue) {
+        switch (cmd.type) {
+            case PEN_CMD_CLEAR:
+                pen_raster_clear();
+                break;
+
+            case PEN_CMD_LINE:
+                pen_raster_line(cmd.x1, cmd.y1, cmd.x2, cmd.y2, cmd.width, cmd.color);
+                break;
+
+            case PEN_CMD_STAMP: {
+                const StampImage* img = stamp_image(renderer, cmd.texture, cmd.image_id);
+                if (img) {
+                    pen_raster_stamp(img->pixels.data(), img->w, img->h, cmd.dst, cmd.angle);
+                }
+                break;
+            }
+        }
+    }
+    pen_queue.clear();
+}
+
+void pen_flush(SDL_Renderer* renderer) {
+    if (!pen_canvas || pen_queue.empty()) return;
+
+    if (pen_backend == PEN_BACKEND_CPU) {
+        pen_flush_cpu(renderer);
+        return;
+    }
+
+    geom_flush(renderer);
     SDL_Texture* prev_target = SDL_GetRenderTarget(renderer);
     SDL_SetRenderTarget(renderer, pen_canvas);
 
-    int x1 = (int)(px - STAGE_X);
-    int y1 = (int)(py - STAGE_Y);
-    int x2 = (int)(cx - STAGE_X);
-    int y2 = (int)(cy - STAGE_Y);
+    geom_begin(renderer);
+    for (const PenCommand& cmd : pen_queue) {
+        switch (cmd.type) {
+            case PEN_CMD_CLEAR:
+                geom_flush(renderer);
+                SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+                SDL_RenderClear(renderer);
+                break;
 
-    if (pen_thickness <= 1) {
-        aalineRGBA(renderer, x1, y1, x2, y2, pen_r, pen_g, pen_b, pen_a);
-    } else {
-        thickLineRGBA(renderer, x1, y1, x2, y2, pen_thickness,
-                      pen_r, pen_g, pen_b, pen_a);
+            case PEN_CMD_LINE:
+                geom_thick_line(renderer, cmd.x1, cmd.y1, cmd.x2, cmd.y2, cmd.width,
+                                cmd.color.r, cmd.color.g, cmd.color.b, cmd.color.a);
+                break;
+
+            case PEN_CMD_STAMP:
+                geom_flush(renderer);
+                SDL_RenderCopyEx(renderer, cmd.texture, nullptr, &cmd.dst,
+                                 cmd.angle, nullptr, SDL_FLIP_NONE);
+                break;
+        }
     }
+    geom_end(renderer);
 
     SDL_SetRenderTarget(renderer, prev_target);
-
-    sprite.prevPenX = cx;
-    sprite.prevPenY = cy;
+    pen_queue.clear();
 }
 
 void pen_render(SDL_Renderer* renderer) {
     if (!pen_canvas) return;
+    pen_flush(renderer);
+
+    SDL_Rect dirty;
+    if (pen_backend == PEN_BACKEND_CPU && pen_raster_take_dirty(&dirty)) {
+        const Uint8* base = (const Uint8*)pen_raster_pixels();
+        int pitch = pen_raster_pitch();
+        SDL_UpdateTexture(pen_canvas, &dirty, base + dirty.y * pitch + dirty.x * 4, pitch);
+    }
+
     SDL_Rect dst = { STAGE_X, STAGE_Y, STAGE_WIDTH, STAGE_HEIGHT };
     SDL_RenderCopy(renderer, pen_canvas, nullptr, &dst);
 }
@@ -3,12 +3,18 @@
 #include "../common/definitions.h"
 #include <SDL2/SDL.h>
 
+// GPU draws into a render target; CPU rasterizes into memory and uploads
+// the dirty rectangle once per frame. BLOCKY_PEN_BACKEND=cpu selects the
+// CPU backend, which is also the fallback without render targets. Stamps
+// on the CPU backend read costume pixels back through a render target, so
+// without one they are skipped.
 
 void pen_init(SDL_Renderer* renderer);
 void pen_shutdown();
-void pen_clear(SDL_Renderer* renderer);
+void pen_clear();
 void pen_stamp(SDL_Renderer* renderer, Sprite& sprite);
 void pen_update(SDL_Renderer* renderer, Sprite& sprite);
+void pen_flush(SDL_Renderer* renderer);
 void pen_render(SDL_Renderer* renderer);
 void pen_set_color(Uint8 r, Uint8 g, Uint8 b, Uint8 a = 255);
 void pen_set_size(int size);
@@ -0,0 +1,363 @@
+#include "pen_raster.h"
+#include "../utils/cpu_features.h"
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+static std::vector<Uint32> g_pixels;
+static std::vector<Uint32> g_row;
+static int g_w = 0;
+static int g_h = 0;
+
+static int g_dirty_x0, g_dirty_y0, g_dirty_x1, g_dirty_y1;
+static bool g_dirty = false;
+
+// dst = src + dst * inv / 255 on every channel (premultiplied "over").
+typedef void (*FillSpanFn)(Uint32* dst, int n, Uint32 src, int inv);
+typedef void (*BlendRowFn)(Uint32* dst, const Uint32* src, int n);
+
+static inline Uint8 mul_div255(int x, int y) {
+    int t = x * y + 128;
+    return (Uint8)((t + (t >> 8)) >> 8);
+}
+
+static inline Uint32 blend_pixel(Uint32 d, Uint32 s, int inv) {
+    Uint8 db[4], sb[4];
+    std::memcpy(db, &d, 4);
+    std::memcpy(sb, &s, 4);
+    for (int c = 0; c < 4; c++) {
+        int v = sb[c] + mul_div255(db[c], inv);
+        db[c] = (Uint8)(v > 255 ? 255 : v);
+    }
+    std::memcpy(&d, db, 4);
+    return d;
+}
+
+static inline int alpha_of(Uint32 p) {
+    Uint8 b[4];
+    std::memcpy(b, &p, 4);
+    return b[3];
+}
+
+static void fill_span_scalar(Uint32* dst, int n, Uint32 src, int inv) {
+    if (inv == 0) {
+        std::fill(dst, dst + n, src);
+        return;
+    }
+    for (int i = 0; i < n; i++) dst[i] = blend_pixel(dst[i], src, inv);
+}
+
+static void blend_row_scalar(Uint32* dst, const Uint32* src, int n) {
+    for (int i = 0; i < n; i++) {
+        int a = alpha_of(src[i]);
+        if (a == 0) continue;
+        dst[i] = (a == 255) ? src[i] : blend_pixel(dst[i], src[i], 255 - a);
+    }
+}
+
+#ifdef BLOCKY_X86
+
+// x * inv / 255 with rounding on eight 16-bit lanes.
+BLOCKY_TARGET("sse2")
+static inline __m128i mul_div255_sse2(__m128i x, __m128i inv) {
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(x, inv), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+BLOCKY_TARGET("sse2")
+static void fill_span_sse2(Uint32* dst, int n, Uint32 src, int inv) {
+    __m128i vsrc = _mm_set1_epi32((int)src);
+    int i = 0;
+    if (inv == 0) {
+        for (; i + 4 <= n; i += 4) _mm_storeu_si128((__m128i*)(dst + i), vsrc);
+    } else {
+        __m128i zero = _mm_setzero_si128();
+        __m128i vinv = _mm_set1_epi16((short)inv);
+        for (; i + 4 <= n; i += 4) {
+            __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+            __m128i lo = mul_div255_sse2(_mm_unpacklo_epi8(d, zero), vinv);
+            __m128i hi = mul_div255_sse2(_mm_unpackhi_epi8(d, zero), vinv);
+            __m128i out = _mm_adds_epu8(_mm_packus_epi16(lo, hi), vsrc);
+            _mm_storeu_si128((__m128i*)(dst + i), out);
+        }
+    }
+    fill_span_scalar(dst + i, n - i, src, inv);
+}
+
+BLOCKY_TARGET("sse2")
+static inline __m128i inv_alpha_sse2(__m128i px16) {
+    // Broadcast each pixel's alpha (lane 3 of 4) across its channels.
+    __m128i a = _mm_shufflelo_epi16(px16, _MM_SHUFFLE(3, 3, 3, 3));
+    a = _mm_shufflehi_epi16(a, _MM_SHUFFLE(3, 3, 3, 3));
+    return _mm_sub_epi16(_mm_set1_epi16(255), a);
+}
+
+BLOCKY_TARGET("sse2")
+static void blend_row_sse2(Uint32* dst, const Uint32* src, int n) {
+    __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i lo = mul_div255_sse2(_mm_unpacklo_epi8(d, zero),
+                                     inv_alpha_sse2(_mm_unpacklo_epi8(s, zero)));
+        __m128i hi = mul_div255_sse2(_mm_unpackhi_epi8(d, zero),
+                                     inv_alpha_sse2(_mm_unpackhi_epi8(s, zero)));
+        __m128i out = _mm_adds_epu8(_mm_packus_epi16(lo, hi), s);
+        _mm_storeu_si128((__m128i*)(dst + i), out);
+    }
+    blend_row_scalar(dst + i, src + i, n - i);
+}
+
+BLOCKY_TARGET("avx2")
+static inline __m256i mul_div255_avx2(__m256i x, __m256i inv) {
+    __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(x, inv), _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+// unpack/pack work per 128-bit lane, so the pixel order survives the
+// round trip without a cross-lane permute.
+BLOCKY_TARGET("avx2")
+static void fill_span_avx2(Uint32* dst, int n, Uint32 src, int inv) {
+    __m256i vsrc = _mm256_set1_epi32((int)src);
+    int i = 0;
+    if (inv == 0) {
+        for (; i + 8 <= n; i += 8) _mm256_storeu_si256((__m256i*)(dst + i), vsrc);
+    } else {
+        __m256i zero = _mm256_setzero_si256();
+        __m256i vinv = _mm256_set1_epi16((short)inv);
+        for (; i + 8 <= n; i += 8) {
+            __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+            __m256i lo = mul_div255_avx2(_mm256_unpacklo_epi8(d, zero), vinv);
+            __m256i hi = mul_div255_avx2(_mm256_unpackhi_epi8(d, zero), vinv);
+            __m256i out = _mm256_adds_epu8(_mm256_packus_epi16(lo, hi), vsrc);
+            _mm256_storeu_si256((__m256i*)(dst + i), out);
+        }
+    }
+    fill_span_scalar(dst + i, n - i, src, inv);
+}
+
+BLOCKY_TARGET("avx2")
+static inline __m256i inv_alpha_avx2(__m256i px16) {
+    __m256i a = _mm256_shufflelo_epi16(px16, _MM_SHUFFLE(3, 3, 3, 3));
+    a = _mm256_shufflehi_epi16(a, _MM_SHUFFLE(3, 3, 3, 3));
+    return _mm256_sub_epi16(_mm256_set1_epi16(255), a);
+}
+
+BLOCKY_TARGET("avx2")
+static void blend_row_avx2(Uint32* dst, const Uint32* src, int n) {
+    __m256i zero = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+        __m256i lo = mul_div255_avx2(_mm256_unpacklo_epi8(d, zero),
+                                     inv_alpha_avx2(_mm256_unpacklo_epi8(s, zero)));
+        __m256i hi = mul_div255_avx2(_mm256_unpackhi_epi8(d, zero),
+                                     inv_alpha_avx2(_mm256_unpackhi_epi8(s, zero)));
+        __m256i out = _mm256_adds_epu8(_mm256_packus_epi16(lo, hi), s);
+        _mm256_storeu_si256((__m256i*)(dst + i), out);
+    }
+    blend_row_sse2(dst + i, src + i, n - i);
+}
+
+#endif
+
+static FillSpanFn g_fill_span = fill_span_scalar;
+static BlendRowFn g_blend_row = blend_row_scalar;
+static const char* g_isa = "scalar";
+
+static void select_kernels() {
+    g_fill_span = fill_span_scalar;
+    g_blend_row = blend_row_scalar;
+    g_isa = cpu_level_name(CPU_SCALAR);
+#ifdef BLOCKY_X86
+    if (cpu_level() >= CPU_AVX2) {
+        g_fill_span = fill_span_avx2;
+        g_blend_row = blend_row_avx2;
+        g_isa = cpu_level_name(CPU_AVX2);
+    } else if (cpu_level() >= CPU_SSE2) {
+        g_fill_span = fill_span_sse2;
+        g_blend_row = blend_row_sse2;
+        g_isa = cpu_level_name(CPU_SSE2);
+    }
+#endif
+}
+
+static void mark_dirty(int x0, int y0, int x1, int y1) {
+    if (!g_dirty) {
+        g_dirty_x0 = x0; g_dirty_y0 = y0;
+        g_dirty_x1 = x1; g_dirty_y1 = y1;
+        g_dirty = true;
+        return;
+    }
+    g_dirty_x0 = std::min(g_dirty_x0, x0);
+    g_dirty_y0 = std::min(g_dirty_y0, y0);
+    g_dirty_x1 = std::max(g_dirty_x1, x1);
+    g_dirty_y1 = std::max(g_dirty_y1, y1);
+}
+
+static Uint32 pack_premultiplied(SDL_Color c) {
+    Uint8 b[4] = {mul_div255(c.r, c.a), mul_div255(c.g, c.a), mul_div255(c.b, c.a), c.a};
+    Uint32 p;
+    std::memcpy(&p, b, 4);
+    return p;
+}
+
+bool pen_raster_init(int w, int h) {
+    if (w <= 0 || h <= 0) return false;
+    select_kernels();
+    g_w = w;
+    g_h = h;
+    g_pixels.assign((size_t)w * h, 0);
+    g_row.resize(w);
+    mark_dirty(0, 0, w, h);
+    return true;
+}
+
+void pen_raster_shutdown() {
+    g_pixels.clear();
+    g_pixels.shrink_to_fit();
+    g_row.clear();
+    g_w = g_h = 0;
+    g_dirty = false;
+}
+
+void pen_raster_clear() {
+    if (g_pixels.empty()) return;
+    std::fill(g_pixels.begin(), g_pixels.end(), 0);
+    mark_dirty(0, 0, g_w, g_h);
+}
+
+// Scan-converts a convex polygon, sampling pixel centres.
+static void fill_convex(const float* xs, const float* ys, int n, Uint32 src, int inv) {
+    float ymin = ys[0], ymax = ys[0];
+    for (int i = 1; i < n; i++) {
+        ymin = std::min(ymin, ys[i]);
+        ymax = std::max(ymax, ys[i]);
+    }
+
+    int row0 = std::max(0, (int)std::ceil(ymin - 0.5f));
+    int row1 = std::min(g_h - 1, (int)std::floor(ymax - 0.5f));
+    int minX = g_w, maxX = -1;
+
+    for (int y = row0; y <= row1; y++) {
+        float yc = y + 0.5f;
+        float xl = 1e30f, xr = -1e30f;
+        for (int i = 0; i < n; i++) {
+            int j = (i + 1) % n;
+            float ya = ys[i], yb = ys[j];
+            if ((ya <= yc && yc < yb) || (yb <= yc && yc < ya)) {
+                float x = xs[i] + (yc - ya) * (xs[j] - xs[i]) / (yb - ya);
+                xl = std::min(xl, x);
+                xr = std::max(xr, x);
+            }
+        }
+        if (xl > xr) continue;
+
+        int x0 = std::max(0, (int)std::ceil(xl - 0.5f));
+        int x1 = std::min(g_w, (int)std::ceil(xr - 0.5f));
+        if (x1 <= x0) continue;
+
+        g_fill_span(&g_pixels[(size_t)y * g_w + x0], x1 - x0, src, inv);
+        minX = std::min(minX, x0);
+        maxX = std::max(maxX, x1);
+    }
+
+    if (maxX >= 0) mark_dirty(minX, row0, maxX, row1 + 1);
+}
+
+void pen_raster_line(float x1, float y1, float x2, float y2, float width, SDL_Color color) {
+    if (g_pixels.empty() || color.a == 0) return;
+
+    float dx = x2 - x1, dy = y2 - y1;
+    float len = std::sqrt(dx * dx + dy * dy);
+    if (len < 1e-4f) {
+        dx = 1.0f; dy = 0.0f; len = 1.0f;
+        x1 -= 0.5f; x2 += 0.5f;
+    }
+
+    float half = std::max(width, 1.0f) * 0.5f;
+    float nx = -dy / len * half;
+    float ny = dx / len * half;
+
+    float xs[4] = {x1 + nx, x2 + nx, x2 - nx, x1 - nx};
+    float ys[4] = {y1 + ny, y2 + ny, y2 - ny, y1 - ny};
+    fill_convex(xs, ys, 4, pack_premultiplied(color), 255 - color.a);
+}
+
+void pen_raster_stamp(const Uint32* pixels, int src_w, int src_h,
+                      const SDL_Rect& dst, double angle) {
+    if (g_pixels.empty() || !pixels || src_w <= 0 || src_h <= 0 || dst.w <= 0 || dst.h <= 0) return;
+
+    float cx = dst.x + dst.w * 0.5f;
+    float cy = dst.y + dst.h * 0.5f;
+    float rad = (float)(angle * 3.14159265358979 / 180.0);
+    float c = std::cos(rad), s = std::sin(rad);
+
+    float hw = dst.w * 0.5f, hh = dst.h * 0.5f;
+    float ex = std::fabs(hw * c) + std::fabs(hh * s);
+    float ey = std::fabs(hw * s) + std::fabs(hh * c);
+
+    int x0 = std::max(0, (int)std::floor(cx - ex));
+    int x1 = std::min(g_w, (int)std::ceil(cx + ex));
+    int y0 = std::max(0, (int)std::floor(cy - ey));
+    int y1 = std::min(g_h, (int)std::ceil(cy + ey));
+    if (x1 <= x0 || y1 <= y0) return;
+
+    float su = src_w / (float)dst.w;
+    float sv = src_h / (float)dst.h;
+
+    // Sample each row into a scratch buffer (nearest neighbour, inverse
+    // rotation), then blend the whole row with the SIMD kernel.
+    for (int y = y0; y < y1; y++) {
+        float py = y + 0.5f - cy;
+        for (int x = x0; x < x1; x++) {
+            float px = x + 0.5f - cx;
+            float ux = px * c + py * s + hw;
+            float uy = -px * s + py * c + hh;
+            int u = (int)std::floor(ux * su);
+            int v = (int)std::floor(uy * sv);
+            g_row[x - x0] = (u >= 0 && u < src_w && v >= 0 && v < src_h)
+                            ? pixels[(size_t)v * src_w + u] : 0;
+        }
+        g_blend_row(&g_pixels[(size_t)y * g_w + x0], g_row.data(), x1 - x0);
+    }
+
+    mark_dirty(x0, y0, x1, y1);
+}
+
+void pen_raster_premultiply(Uint32* pixels, int count) {
+    for (int i = 0; i < count; i++) {
+        Uint8 b[4];
+        std::memcpy(b, &pixels[i], 4);
+        b[0] = mul_div255(b[0], b[3]);
+        b[1] = mul_div255(b[1], b[3]);
+        b[2] = mul_div255(b[2], b[3]);
+        std::memcpy(&pixels[i], b, 4);
+    }
+}
+
+bool pen_raster_take_dirty(SDL_Rect* out) {
+    if (!g_dirty) return false;
+    out->x = g_dirty_x0;
+    out->y = g_dirty_y0;
+    out->w = g_dirty_x1 - g_dirty_x0;
+    out->h = g_dirty_y1 - g_dirty_y0;
+    g_dirty = false;
+    return out->w > 0 && out->h > 0;
+}
+
+const Uint32* pen_raster_pixels() {
+    return g_pixels.empty() ? nullptr : g_pixels.data();
+}
+
+int pen_raster_pitch() {
+    return g_w * 4;
+}
+
+
+const char* pen_raster_isa() {
+    return g_isa;
+}
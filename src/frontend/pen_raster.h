@@ -0,0 +1,32 @@
+#ifndef PEN_RASTER_H
+#define PEN_RASTER_H
+#include <SDL2/SDL.h>
+
+// CPU-side pen canvas. Pixels are premultiplied RGBA in memory byte order
+// (SDL_PIXELFORMAT_RGBA32). Span blending picks an SSE2 or AVX2 kernel at
+// init when the CPU has one, with a scalar fallback elsewhere.
+
+bool pen_raster_init(int w, int h);
+void pen_raster_shutdown();
+void pen_raster_clear();
+
+// Butt-capped line of the given width; endpoints are canvas coordinates.
+void pen_raster_line(float x1, float y1, float x2, float y2, float width, SDL_Color color);
+
+// Draws a premultiplied image into dst, rotated clockwise by angle degrees
+// around the centre of dst, as SDL_RenderCopyEx would.
+void pen_raster_stamp(const Uint32* pixels, int src_w, int src_h,
+                      const SDL_Rect& dst, double angle);
+
+// Premultiplies straight-alpha RGBA32 pixels in place.
+void pen_raster_premultiply(Uint32* pixels, int count);
+
+// Returns the region touched since the last call, if any.
+bool pen_raster_take_dirty(SDL_Rect* out);
+
+const Uint32* pen_raster_pixels();
+int pen_raster_pitch();
+
+const char* pen_raster_isa();
+
+#endif
@@ -1,8 +1,10 @@
 #include "sound_manager.h"
 #include "../backend/sound.h"
+#include "../backend/sound_waveform.h"
 #include "../utils/logger.h"
 #include "../gfx/SDL2_gfxPrimitives.h"
 #include <algorithm>
+#include <cstdio>
 #include <../common/globals.h>
 
 #ifdef _WIN32
@@ -10,6 +12,7 @@
 #include <commdlg.h>
 #endif
 #include "draw.h"
+#include "geom_batch.h"
 
 SoundManagerState g_sound_manager;
 
@@ -29,11 +32,72 @@ static const SDL_Color SM_MENU_BG = {50, 50, 70, 250};
 static const SDL_Color SM_MENU_HOVER = {70, 70, 100, 255};
 static const SDL_Color SM_CATEGORY_BG = {60, 60, 85, 255};
 static const SDL_Color SM_CATEGORY_SELECTED = {100, 80, 160, 255};
+static const SDL_Color SM_PROGRESS_BG = {35, 35, 50, 255};
+static const SDL_Color SM_PROGRESS_FILL = {120, 200, 120, 255};
+static const SDL_Color SM_WAVE = {150, 190, 255, 255};
+static const SDL_Color SM_WAVE_AXIS = {85, 85, 115, 255};
+
+// Room left of the delete button for the duration after a waveform.
+static const int SM_DURATION_WIDTH = 36;
+
+// Rows between the list and the add button. Priority applies to the
+// selected sound; the steal row picks which voice a new sound takes over
+// once the pool is full, and the loading row what a play does with a
+// sound that is still being decoded.
+enum SmFooterRow {
+    SM_ROW_PRIORITY,
+    SM_ROW_STEAL,
+    SM_ROW_LOADING,
+    SM_ROW_VOICES,
+    SM_ROW_COUNT
+};
+static const int SM_FOOTER_ROW_HEIGHT = 18;
+
+struct SmThumbnail {
+    int x, y, w, h;
+    const SoundWaveform* wave;
+};
 
 static bool sm_point_in_rect(int px, int py, int rx, int ry, int rw, int rh) {
     return px >= rx && px < rx + rw && py >= ry && py < ry + rh;
 }
 
+static int sm_content_height(int ph) {
+    return ph - 40 - SOUND_MANAGER_ADD_BTN_HEIGHT - 10 - SM_ROW_COUNT * SM_FOOTER_ROW_HEIGHT;
+}
+
+static int sm_footer_row_y(int py, int ph, int row) {
+    return py + 40 + sm_content_height(ph) + row * SM_FOOTER_ROW_HEIGHT;
+}
+
+static const char* sm_priority_name(int priority) {
+    if (priority <= VOICE_PRIORITY_LOW) return "Low";
+    if (priority >= VOICE_PRIORITY_HIGH) return "High";
+    return "Normal";
+}
+
+static void sm_render_footer(SDL_Renderer* renderer, int px, int py, int ph) {
+    int x = px + 12;
+    SoundItem* selected = sound_project_get(g_sound_manager.selected_index);
+    std::string priority = std::string("Priority: ") + (selected ? sm_priority_name(selected->priority) : "-");
+    draw_text(renderer, x, sm_footer_row_y(py, ph, SM_ROW_PRIORITY) + 2, priority,
+              selected ? COLOR_WHITE : SM_WAVE_AXIS);
+
+    bool quietest = voice_pool_steal_mode() == VOICE_STEAL_QUIETEST;
+    draw_text(renderer, x, sm_footer_row_y(py, ph, SM_ROW_STEAL) + 2,
+              quietest ? "Steal: quietest" : "Steal: oldest", COLOR_WHITE);
+
+    bool skip = sound_wait_policy() == SOUND_WAIT_SKIP;
+    draw_text(renderer, x, sm_footer_row_y(py, ph, SM_ROW_LOADING) + 2,
+              skip ? "If loading: skip" : "If loading: wait", COLOR_WHITE);
+
+    VoiceStats stats = voice_pool_stats();
+    std::string voices = "Voices " + std::to_string(stats.active) + "/" + std::to_string(stats.capacity);
+    if (stats.stolen > 0) voices += ", " + std::to_string(stats.stolen) + " stolen";
+    if (stats.dropped > 0) voices += ", " + std::to_string(stats.dropped) + " dropped";
+    draw_text(renderer, x, sm_footer_row_y(py, ph, SM_ROW_VOICES) + 2, voices, SM_PROGRESS_FILL);
+}
+
 void sound_manager_init(SDL_Renderer* renderer, int x, int y, int w, int h) {
     g_sound_manager.renderer = renderer;
     g_sound_manager.panel_x = x;
@@ -69,9 +133,14 @@ void sound_manager_open_library_dialog() {
     g_sound_manager.library_scroll_offset = 0;
 }
 
+static void sm_close_library_dialog() {
+    if (g_sound_manager.library_dialog_open) sound_end_library_preview();
+    g_sound_manager.library_dialog_open = false;
+}
+
 void sound_manager_open_file_dialog() {
     g_sound_manager.file_dialog_open = true;
-    g_sound_manager.library_dialog_open = false;
+    sm_close_library_dialog();
     g_sound_manager.add_menu_open = false;
     
 #ifdef _WIN32
@@ -93,12 +162,33 @@ void sound_manager_open_file_dialog() {
 }
 
 void sound_manager_close_dialogs() {
-    g_sound_manager.library_dialog_open = false;
+    sm_close_library_dialog();
     g_sound_manager.file_dialog_open = false;
     g_sound_manager.add_menu_open = false;
 }
 
 
+// Every thumbnail in the list goes out as one batch: a centre line and a
+// column per bucket from its smallest to its largest sample.
+static void sm_render_thumbnails(SDL_Renderer* renderer, const std::vector<SmThumbnail>& thumbs) {
+    if (thumbs.empty()) return;
+    geom_begin(renderer);
+    for (const SmThumbnail& t : thumbs) {
+        int mid = t.y + t.h / 2;
+        float half = t.h / 2.0f;
+        geom_hline(renderer, t.x, t.x + t.w - 1, mid, SM_WAVE_AXIS.r, SM_WAVE_AXIS.g, SM_WAVE_AXIS.b, 255);
+        for (int b = 0; b < SOUND_WAVEFORM_BUCKETS; b++) {
+            int x1 = t.x + b * t.w / SOUND_WAVEFORM_BUCKETS;
+            int x2 = std::max(x1, t.x + (b + 1) * t.w / SOUND_WAVEFORM_BUCKETS - 1);
+            int y1 = mid - (int)(t.wave->max[b] * half + 0.5f);
+            int y2 = mid - (int)(t.wave->min[b] * half - 0.5f);
+            if (y2 <= y1) continue;
+            geom_box(renderer, x1, y1, x2, y2, SM_WAVE.r, SM_WAVE.g, SM_WAVE.b, 255);
+        }
+    }
+    geom_end(renderer);
+}
+
 static void sm_render_panel(SDL_Renderer* renderer) {
     int px = g_sound_manager.panel_x;
     int py = g_sound_manager.panel_y;
@@ -113,13 +203,14 @@ static void sm_render_panel(SDL_Renderer* renderer) {
     draw_text(renderer, px + 40, py + 12, "Sounds", COLOR_WHITE);
     
     int content_y = py + 40;
-    int content_h = ph - 40 - SOUND_MANAGER_ADD_BTN_HEIGHT - 10;
+    int content_h = sm_content_height(ph);
     
     SDL_Rect clip_rect = {px + 5, content_y, pw - 10, content_h};
     SDL_RenderSetClipRect(renderer, &clip_rect);
     
     int item_y = content_y - g_sound_manager.scroll_offset;
     int count = sound_project_count();
+    std::vector<SmThumbnail> thumbs;
     
     for (int i = 0; i < count; i++) {
         SoundItem* item = sound_project_get(i);
@@ -146,12 +237,44 @@ static void sm_render_panel(SDL_Renderer* renderer) {
             thickLineRGBA(renderer, del_x + 8, play_y + 8, del_x + 20, play_y + 20, 2, 255, 255, 255, 255);
             thickLineRGBA(renderer, del_x + 20, play_y + 8, del_x + 8, play_y + 20, 2, 255, 255, 255, 255);
             
-            draw_text(renderer, play_x + SOUND_MANAGER_BUTTON_SIZE + 12, item_y + SOUND_MANAGER_ITEM_HEIGHT/2 - 4, item->name.c_str(), COLOR_WHITE);
+            int name_x = play_x + SOUND_MANAGER_BUTTON_SIZE + 12;
+            float progress = sound_load_progress(item->name);
+            if (progress >= 0.0f) {
+                draw_text(renderer, name_x, item_y + SOUND_MANAGER_ITEM_HEIGHT/2 - 10, item->name.c_str(), COLOR_WHITE);
+                int bar_y = item_y + SOUND_MANAGER_ITEM_HEIGHT/2 + 6;
+                int bar_w = del_x - 8 - name_x;
+                boxRGBA(renderer, name_x, bar_y, name_x + bar_w, bar_y + 4, SM_PROGRESS_BG.r, SM_PROGRESS_BG.g, SM_PROGRESS_BG.b, 255);
+                if (progress > 0.0f) {
+                    boxRGBA(renderer, name_x, bar_y, name_x + (int)(bar_w * progress), bar_y + 4, SM_PROGRESS_FILL.r, SM_PROGRESS_FILL.g, SM_PROGRESS_FILL.b, 255);
+                }
+            } else if (item->state == SOUND_FAILED) {
+                draw_text(renderer, name_x, item_y + SOUND_MANAGER_ITEM_HEIGHT/2 - 10, item->name.c_str(), COLOR_WHITE);
+                draw_text(renderer, name_x, item_y + SOUND_MANAGER_ITEM_HEIGHT/2 + 2, "failed to load", SM_BTN_DELETE);
+            } else {
+                // Only items on screen ask for a waveform, so a long list
+                // fills in from what is being looked at.
+                const SoundWaveform* wave = sound_waveform_get(item->filepath);
+                if (!wave) {
+                    draw_text(renderer, name_x, item_y + SOUND_MANAGER_ITEM_HEIGHT/2 - 4, item->name.c_str(), COLOR_WHITE);
+                } else {
+                    draw_text(renderer, name_x, item_y + SOUND_MANAGER_ITEM_HEIGHT/2 - 10, item->name.c_str(), COLOR_WHITE);
+                    int wave_w = del_x - 8 - name_x - SM_DURATION_WIDTH;
+                    SmThumbnail t = {name_x, item_y + SOUND_MANAGER_ITEM_HEIGHT/2 + 3, wave_w, 14, wave};
+                    thumbs.push_back(t);
+
+                    float duration = item->duration > 0.0f ? item->duration : wave->duration;
+                    char length[16];
+                    snprintf(length, sizeof(length), "%.1fs", duration);
+                    draw_text(renderer, name_x + wave_w + 4, item_y + SOUND_MANAGER_ITEM_HEIGHT/2 + 2, length, SM_PROGRESS_FILL);
+                }
+            }
         }
         item_y += SOUND_MANAGER_ITEM_HEIGHT + 5;
     }
+    sm_render_thumbnails(renderer, thumbs);
     
     SDL_RenderSetClipRect(renderer, NULL);
+    sm_render_footer(renderer, px, py, ph);
     
     int add_btn_y = py + ph - SOUND_MANAGER_ADD_BTN_HEIGHT - 5;
     roundedBoxRGBA(renderer, px + 10, add_btn_y, px + pw - 10, add_btn_y + SOUND_MANAGER_ADD_BTN_HEIGHT, 6, SM_BTN_ADD.r, SM_BTN_ADD.g, SM_BTN_ADD.b, 255);
@@ -199,7 +322,18 @@ static void sm_render_library_dialog(SDL_Renderer* renderer) {
         if (item_y + 35 > list_y && item_y < list_y + list_h) {
             SDL_Color item_bg = ((int)i == g_sound_manager.library_selected_index) ? SM_ITEM_SELECTED : SM_ITEM_BG;
             roundedBoxRGBA(renderer, list_x + 5, item_y, list_x + list_w - 5, item_y + 32, 4, item_bg.r, item_bg.g, item_bg.b, 255);
+            int play_x = list_x + 12;
+            int play_y = item_y + 4;
+            roundedBoxRGBA(renderer, play_x, play_y, play_x + 24, play_y + 24, 4, SM_BTN_PLAY.r, SM_BTN_PLAY.g, SM_BTN_PLAY.b, 255);
+            Sint16 tri_x[3] = {(Sint16)(play_x + 8), (Sint16)(play_x + 8), (Sint16)(play_x + 18)};
+            Sint16 tri_y[3] = {(Sint16)(play_y + 6), (Sint16)(play_y + 18), (Sint16)(play_y + 12)};
+            filledPolygonRGBA(renderer, tri_x, tri_y, 3, 255, 255, 255, 255);
             draw_text(renderer, list_x + 45, item_y + 10, filtered[i].name.c_str(), COLOR_WHITE);
+            if (filtered[i].duration > 0.0f) {
+                char length[16];
+                snprintf(length, sizeof(length), "%.1fs", filtered[i].duration);
+                draw_text(renderer, list_x + list_w - 55, item_y + 10, length, SM_PROGRESS_FILL);
+            }
         }
         item_y += 38;
     }
@@ -275,7 +409,7 @@ bool sound_manager_handle_event(SDL_Event* event) {
         g_sound_manager.hover_index = -1;
         
         int content_y = py + 40;
-        int content_h = ph - 40 - SOUND_MANAGER_ADD_BTN_HEIGHT - 10;
+        int content_h = sm_content_height(ph);
         
         g_sound_manager.hover_index = -1;
         if (sm_point_in_rect(mx, my, px+8, content_y, pw-16, content_h)) {
@@ -330,7 +464,10 @@ bool sound_manager_handle_event(SDL_Event* event) {
                     
                     for (size_t i = 0; i < filtered.size(); i++) {
                         if (my >= item_y && my < item_y + 32) {
-                                g_sound_manager.library_selected_index = (int)i;
+                            if (sm_point_in_rect(mx, my, list_x + 12, item_y + 4, 24, 24)) {
+                                sound_preview_library(filtered[i].name);
+                            }
+                            g_sound_manager.library_selected_index = (int)i;
                             return true;
                         }
                         item_y += 38;
@@ -344,14 +481,14 @@ bool sound_manager_handle_event(SDL_Event* event) {
                         std::vector<LibrarySound> filtered = sound_library_get_by_category(g_sound_manager.selected_category);
                         if (g_sound_manager.library_selected_index < (int)filtered.size()) {
                             sound_project_add_from_library(filtered[g_sound_manager.library_selected_index].name);
-                            g_sound_manager.library_dialog_open = false;
+                            sm_close_library_dialog();
                         }
                     }
                     return true;
                 }
             }
             else {
-                g_sound_manager.library_dialog_open = false;
+                sm_close_library_dialog();
                 return true;
             }
         }
@@ -384,9 +521,25 @@ bool sound_manager_handle_event(SDL_Event* event) {
                 g_sound_manager.add_menu_open = true;
                 return true;
             }
+
+            if (sm_point_in_rect(mx, my, px+8, sm_footer_row_y(py, ph, SM_ROW_PRIORITY), pw-16, SM_FOOTER_ROW_HEIGHT)) {
+                SoundItem* s = sound_project_get(g_sound_manager.selected_index);
+                if (s) s->priority = s->priority >= VOICE_PRIORITY_HIGH ? VOICE_PRIORITY_LOW : s->priority + 1;
+                return true;
+            }
+            if (sm_point_in_rect(mx, my, px+8, sm_footer_row_y(py, ph, SM_ROW_STEAL), pw-16, SM_FOOTER_ROW_HEIGHT)) {
+                bool quietest = voice_pool_steal_mode() == VOICE_STEAL_QUIETEST;
+                voice_pool_set_steal_mode(quietest ? VOICE_STEAL_OLDEST : VOICE_STEAL_QUIETEST);
+                return true;
+            }
+            if (sm_point_in_rect(mx, my, px+8, sm_footer_row_y(py, ph, SM_ROW_LOADING), pw-16, SM_FOOTER_ROW_HEIGHT)) {
+                bool skip = sound_wait_policy() == SOUND_WAIT_SKIP;
+                sound_set_wait_policy(skip ? SOUND_WAIT_QUEUE : SOUND_WAIT_SKIP);
+                return true;
+            }
             
             int content_y = py + 40;
-            int content_h = ph - 40 - SOUND_MANAGER_ADD_BTN_HEIGHT - 10;
+            int content_h = sm_content_height(ph);
             if (sm_point_in_rect(mx, my, px+8, content_y, pw-16, content_h)) {
                 int item_y = content_y - g_sound_manager.scroll_offset;
                 int count = sound_project_count();
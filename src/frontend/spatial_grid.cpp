@@ -0,0 +1,215 @@
+#include "spatial_grid.h"
+#include "block_utils.h"
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+
+struct CellRange {
+    int x0, y0, x1, y1;
+};
+
+static std::unordered_map<uint64_t, std::vector<Block*>> g_cells;
+static std::unordered_map<const Block*, CellRange> g_entries;
+
+static inline int cell_of(int v) {
+    return v >= 0 ? v / SPATIAL_CELL_SIZE : (v - SPATIAL_CELL_SIZE + 1) / SPATIAL_CELL_SIZE;
+}
+
+static inline uint64_t cell_key(int cx, int cy) {
+    return ((uint64_t)(uint32_t)cx << 32) | (uint32_t)cy;
+}
+
+static CellRange range_of(const SDL_Rect& r) {
+    CellRange c;
+    c.x0 = cell_of(r.x);
+    c.y0 = cell_of(r.y);
+    c.x1 = cell_of(r.x + r.w);
+    c.y1 = cell_of(r.y + r.h);
+    return c;
+}
+
+static void unlink(const Block* block, const CellRange& c) {
+    for (int cy = c.y0; cy <= c.y1; cy++) {
+        for (int cx = c.x0; cx <= c.x1; cx++) {
+            auto it = g_cells.find(cell_key(cx, cy));
+            if (it == g_cells.end()) continue;
+
+            std::vector<Block*>& bucket = it->second;
+            auto pos = std::find(bucket.begin(), bucket.end(), block);
+            if (pos != bucket.end()) {
+                *pos = bucket.back();
+                bucket.pop_back();
+            }
+            if (bucket.empty()) g_cells.erase(it);
+        }
+    }
+}
+
+static void link(Block* block, const CellRange& c) {
+    for (int cy = c.y0; cy <= c.y1; cy++) {
+        for (int cx = c.x0; cx <= c.x1; cx++) {
+            g_cells[cell_key(cx, cy)].push_back(block);
+        }
+    }
+}
+
+static void unite(SDL_Rect& acc, const SDL_Rect& r) {
+    int x0 = std::min(acc.x, r.x);
+    int y0 = std::min(acc.y, r.y);
+    int x1 = std::max(acc.x + acc.w, r.x + r.w);
+    int y1 = std::max(acc.y + acc.h, r.y + r.h);
+    acc = {x0, y0, x1 - x0, y1 - y0};
+}
+
+SDL_Rect spatial_grid_footprint(const Block& block) {
+    int h = std::max((int)block.layout->height, BLOCK_HEIGHT);
+    h = std::max(h, block.layout->total_height);
+
+    SDL_Rect acc = {(int)block.layout->x, (int)block.layout->y, (int)block.layout->width, h};
+
+    int count = get_arg_count(block.type);
+    for (int i = 0; i < count; i++) {
+        SDL_Rect r = get_arg_box_rect(block, i);
+        if (r.w == 0) continue;
+        unite(acc, r);
+    }
+    return acc;
+}
+
+static void file_block(Block* block, const SDL_Rect& footprint) {
+    CellRange next = range_of(footprint);
+
+    auto it = g_entries.find(block);
+    if (it != g_entries.end()) {
+        const CellRange& prev = it->second;
+        if (prev.x0 == next.x0 && prev.y0 == next.y0 &&
+            prev.x1 == next.x1 && prev.y1 == next.y1) {
+            return;
+        }
+        unlink(block, prev);
+        it->second = next;
+    } else {
+        g_entries[block] = next;
+    }
+    link(block, next);
+}
+
+static void layout_chain(Block* head);
+
+// Places the argument blocks and inner chain of a block that is already
+// positioned, then caches its height and bounds and files it.
+static void layout_block(Block* block) {
+    BlockLayout& layout = *block->layout;
+
+    int count = get_arg_count(block->type);
+    for (int i = 0; i < count && i < (int)block->argBlocks.size(); i++) {
+        Block* sub = block->argBlocks[i];
+        if (!sub) continue;
+        SDL_Rect box = get_arg_box_rect(*block, i);
+        sub->layout->x = (float)box.x;
+        sub->layout->y = (float)box.y;
+        layout_block(sub);
+    }
+
+    int inner_h = 0;
+    if (block->inner) {
+        block->inner->layout->x = layout.x + 15;
+        block->inner->layout->y = layout.y + BLOCK_HEIGHT + 5;
+        layout_chain(block->inner);
+        for (Block* child = block->inner; child; child = child->next) {
+            inner_h += child->layout->total_height;
+        }
+    }
+
+    if (is_reporter_block(block->type)) {
+        layout.total_height = 26;
+    } else {
+        layout.total_height = BLOCK_HEIGHT;
+        if (block->type == CMD_IF || block->type == CMD_REPEAT || block->type == CMD_DEFINE_BLOCK) {
+            if (block->inner) layout.total_height += 5 + inner_h;
+            layout.total_height += 15;
+        }
+    }
+
+    SDL_Rect footprint = spatial_grid_footprint(*block);
+    file_block(block, footprint);
+
+    layout.bounds = footprint;
+    for (int i = 0; i < count && i < (int)block->argBlocks.size(); i++) {
+        if (block->argBlocks[i]) unite(layout.bounds, block->argBlocks[i]->layout->bounds);
+    }
+    if (block->inner) unite(layout.bounds, block->inner->layout->bounds);
+}
+
+// Stacks a chain under its head, then folds each block's bounds into the
+// one before it so a head covers everything that follows.
+static void layout_chain(Block* head) {
+    std::vector<Block*> chain;
+    float y = head->layout->y;
+    for (Block* cur = head; cur; cur = cur->next) {
+        cur->layout->x = head->layout->x;
+        cur->layout->y = y;
+        layout_block(cur);
+        y += cur->layout->total_height;
+        chain.push_back(cur);
+    }
+    for (size_t i = chain.size() - 1; i > 0; i--) {
+        unite(chain[i - 1]->layout->bounds, chain[i]->layout->bounds);
+    }
+}
+
+void spatial_grid_layout_tree(Block* root) {
+    if (root) layout_chain(root);
+}
+
+void spatial_grid_remove(const Block* block) {
+    auto it = g_entries.find(block);
+    if (it == g_entries.end()) return;
+
+    unlink(block, it->second);
+    g_entries.erase(it);
+}
+
+void spatial_grid_remove_tree(Block* head) {
+    std::vector<Block*> stack;
+    if (head) stack.push_back(head);
+
+    while (!stack.empty()) {
+        Block* cur = stack.back();
+        stack.pop_back();
+        spatial_grid_remove(cur);
+
+        for (auto* sub : cur->argBlocks) {
+            if (sub) stack.push_back(sub);
+        }
+        if (cur->inner) stack.push_back(cur->inner);
+        if (cur->next) stack.push_back(cur->next);
+    }
+}
+
+void spatial_grid_clear() {
+    g_cells.clear();
+    g_entries.clear();
+}
+
+void spatial_grid_query_point(int x, int y, std::vector<Block*>& out) {
+    out.clear();
+    auto it = g_cells.find(cell_key(cell_of(x), cell_of(y)));
+    if (it == g_cells.end()) return;
+    out = it->second;
+}
+
+void spatial_grid_query_rect(const SDL_Rect& r, std::vector<Block*>& out) {
+    out.clear();
+    CellRange c = range_of(r);
+    for (int cy = c.y0; cy <= c.y1; cy++) {
+        for (int cx = c.x0; cx <= c.x1; cx++) {
+            auto it = g_cells.find(cell_key(cx, cy));
+            if (it == g_cells.end()) continue;
+            out.insert(out.end(), it->second.begin(), it->second.end());
+        }
+    }
+
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+}
@@ -0,0 +1,24 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+#include "../common/definitions.h"
+#include <SDL2/SDL.h>
+#include <vector>
+
+// Uniform grid over the coding area. Each block is filed under every cell
+// its footprint (body, C-shape and argument boxes) overlaps, so hit tests
+// and snap searches only look at blocks near the query. Scripts are laid
+// out and refiled when they move or change shape, never while drawing.
+
+const int SPATIAL_CELL_SIZE = 64;
+
+SDL_Rect spatial_grid_footprint(const Block& block);
+
+void spatial_grid_layout_tree(Block* root);
+void spatial_grid_remove(const Block* block);
+void spatial_grid_remove_tree(Block* head);
+void spatial_grid_clear();
+
+void spatial_grid_query_point(int x, int y, std::vector<Block*>& out);
+void spatial_grid_query_rect(const SDL_Rect& r, std::vector<Block*>& out);
+
+#endif
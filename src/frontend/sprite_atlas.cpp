@@ -0,0 +1,128 @@
+#include "sprite_atlas.h"
+#include "../utils/logger.h"
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+// Pages fill shelf by shelf, left to right; images are never removed, as
+// costumes live until shutdown.
+struct AtlasPage {
+    SDL_Texture* texture;
+    int cursor_x;
+    int shelf_y;
+    int shelf_h;
+};
+
+static std::vector<AtlasPage> g_pages;
+static std::unordered_map<SDL_Texture*, AtlasRegion> g_regions;
+static int g_page_size = 0;
+static bool g_unsupported = false;
+
+static int page_size(SDL_Renderer* renderer) {
+    if (g_page_size > 0) return g_page_size;
+
+    int size = SPRITE_ATLAS_PAGE_SIZE;
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(renderer, &info) == 0) {
+        if (info.max_texture_width > 0) size = std::min(size, info.max_texture_width);
+        if (info.max_texture_height > 0) size = std::min(size, info.max_texture_height);
+    }
+    g_page_size = size;
+    return size;
+}
+
+static bool place(AtlasPage& page, int size, int w, int h, int* x, int* y) {
+    if (page.cursor_x + w > size) {
+        page.shelf_y += page.shelf_h;
+        page.cursor_x = 0;
+        page.shelf_h = 0;
+    }
+    if (w > size || page.shelf_y + h > size) return false;
+
+    *x = page.cursor_x;
+    *y = page.shelf_y;
+    page.cursor_x += w;
+    page.shelf_h = std::max(page.shelf_h, h);
+    return true;
+}
+
+static AtlasPage* new_page(SDL_Renderer* renderer, int size) {
+    SDL_Texture* tex = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32,
+                                         SDL_TEXTUREACCESS_STATIC, size, size);
+    if (!tex) {
+        log_warning(std::string("Sprite atlas: cannot create page: ") + SDL_GetError());
+        g_unsupported = true;
+        return nullptr;
+    }
+    SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_BLEND);
+    g_pages.push_back({tex, 0, 0, 0});
+    return &g_pages.back();
+}
+
+bool sprite_atlas_add(SDL_Renderer* renderer, SDL_Texture* costume, SDL_Surface* surface) {
+    if (g_unsupported || !costume || !surface) return false;
+    if (g_regions.count(costume)) return true;
+
+    int w = surface->w;
+    int h = surface->h;
+    if (w <= 0 || h <= 0 || w > SPRITE_ATLAS_MAX_IMAGE || h > SPRITE_ATLAS_MAX_IMAGE) return false;
+
+    SDL_Surface* rgba = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA32, 0);
+    if (!rgba) return false;
+
+    // One pixel of gutter on each side repeats the image's edge, so
+    // filtering at the border samples the costume and not its neighbour.
+    int pw = w + 2;
+    int ph = h + 2;
+    std::vector<Uint32> padded((size_t)pw * ph);
+    SDL_LockSurface(rgba);
+    for (int y = 0; y < ph; y++) {
+        int sy = std::min(std::max(y - 1, 0), h - 1);
+        const Uint32* src = (const Uint32*)((const Uint8*)rgba->pixels + (size_t)sy * rgba->pitch);
+        Uint32* dst = &padded[(size_t)y * pw];
+        dst[0] = src[0];
+        std::memcpy(dst + 1, src, (size_t)w * sizeof(Uint32));
+        dst[pw - 1] = src[w - 1];
+    }
+    SDL_UnlockSurface(rgba);
+    SDL_FreeSurface(rgba);
+
+    int size = page_size(renderer);
+    int x = 0, y = 0;
+    AtlasPage* page = g_pages.empty() ? nullptr : &g_pages.back();
+    if (!page || !place(*page, size, pw, ph, &x, &y)) {
+        page = new_page(renderer, size);
+        if (!page || !place(*page, size, pw, ph, &x, &y)) return false;
+    }
+
+    SDL_Rect area = {x, y, pw, ph};
+    if (SDL_UpdateTexture(page->texture, &area, padded.data(), pw * (int)sizeof(Uint32)) != 0) {
+        log_warning(std::string("Sprite atlas: upload failed: ") + SDL_GetError());
+        return false;
+    }
+
+    AtlasRegion region;
+    region.page = page->texture;
+    region.uv.x = (float)(x + 1) / size;
+    region.uv.y = (float)(y + 1) / size;
+    region.uv.w = (float)w / size;
+    region.uv.h = (float)h / size;
+    region.w = w;
+    region.h = h;
+    g_regions[costume] = region;
+    return true;
+}
+
+const AtlasRegion* sprite_atlas_find(SDL_Texture* costume) {
+    auto it = g_regions.find(costume);
+    return it == g_regions.end() ? nullptr : &it->second;
+}
+
+void sprite_atlas_destroy() {
+    for (AtlasPage& page : g_pages) SDL_DestroyTexture(page.texture);
+    g_pages.clear();
+    g_regions.clear();
+    g_page_size = 0;
+    g_unsupported = false;
+}
@@ -0,0 +1,29 @@
+#ifndef SPRITE_ATLAS_H
+#define SPRITE_ATLAS_H
+#include <SDL2/SDL.h>
+
+// Costume images packed into a few large pages so the stage can draw every
+// sprite from one texture in a single geometry submission. Sprites keep
+// pointing at their own costume texture; the atlas maps that texture to
+// its copy on a page. Textures never added (the costume editor's output,
+// oversized images) are drawn from themselves.
+
+const int SPRITE_ATLAS_PAGE_SIZE = 2048;
+// Images larger than this on either side keep their own texture.
+const int SPRITE_ATLAS_MAX_IMAGE = 512;
+
+struct AtlasRegion {
+    SDL_Texture* page;
+    SDL_FRect uv;
+    int w, h;
+};
+
+// Copies the surface's pixels onto a page under the given costume texture.
+// Returns false, leaving the costume unpacked, when it does not fit.
+bool sprite_atlas_add(SDL_Renderer* renderer, SDL_Texture* costume, SDL_Surface* surface);
+
+const AtlasRegion* sprite_atlas_find(SDL_Texture* costume);
+
+void sprite_atlas_destroy();
+
+#endif
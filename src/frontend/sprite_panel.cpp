@@ -1,6 +1,8 @@
 #include "sprite_panel.h"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
+#include "text_cache.h"
+#include "geom_batch.h"
 #include <string>
 #include <cmath>
 #include <cstdio>
@@ -36,19 +38,13 @@ static const PanelColor COL_COORD_BG       = {28,  28,  32,  255};
 static const PanelColor COL_SEPARATOR      = {55,  55,  60,  255};
 static const PanelColor COL_BADGE_BG       = {50,  50,  55,  255};
 
-static void set_color(SDL_Renderer* r, PanelColor c) {
-    SDL_SetRenderDrawColor(r, c.r, c.g, c.b, c.a);
-}
-
 static void fill_rect(SDL_Renderer* r, int x, int y, int w, int h, PanelColor c) {
-    set_color(r, c);
-    SDL_Rect rc = {x, y, w, h};
-    SDL_RenderFillRect(r, &rc);
+    if (w <= 0 || h <= 0) return;
+    geom_box(r, x, y, x + w - 1, y + h - 1, c.r, c.g, c.b, c.a);
 }
 
 static void draw_horizontal_line(SDL_Renderer* r, int x1, int x2, int y, PanelColor c) {
-    set_color(r, c);
-    SDL_RenderDrawLine(r, x1, y, x2, y);
+    geom_hline(r, x1, x2, y, c.r, c.g, c.b, c.a);
 }
 
 static void fill_rounded_rect(SDL_Renderer* r, int x, int y, int w, int h, int rad, PanelColor c) {
@@ -56,63 +52,12 @@ static void fill_rounded_rect(SDL_Renderer* r, int x, int y, int w, int h, int r
         fill_rect(r, x, y, w, h, c);
         return;
     }
-    set_color(r, c);
-
-    SDL_Rect center = {x + rad, y, w - 2 * rad, h};
-    SDL_RenderFillRect(r, &center);
-    SDL_Rect left = {x, y + rad, rad, h - 2 * rad};
-    SDL_RenderFillRect(r, &left);
-    SDL_Rect right = {x + w - rad, y + rad, rad, h - 2 * rad};
-    SDL_RenderFillRect(r, &right);
-
-    for (int dy = 0; dy <= rad; dy++) {
-        int dx = (int)std::sqrt((float)(rad * rad - dy * dy));
-        SDL_RenderDrawLine(r, x + rad - dx, y + rad - dy, x + rad, y + rad - dy);
-        SDL_RenderDrawLine(r, x + w - rad, y + rad - dy, x + w - rad + dx, y + rad - dy);
-        SDL_RenderDrawLine(r, x + rad - dx, y + h - rad + dy, x + rad, y + h - rad + dy);
-        SDL_RenderDrawLine(r, x + w - rad, y + h - rad + dy, x + w - rad + dx, y + h - rad + dy);
-    }
+    geom_rounded_box(r, x, y, x + w - 1, y + h - 1, rad, c.r, c.g, c.b, c.a);
 }
 
 static void draw_rounded_rect_outline(SDL_Renderer* r, int x, int y, int w, int h, int rad, PanelColor c) {
-    if (rad < 1) {
-        set_color(r, c);
-        SDL_Rect rc = {x, y, w, h};
-        SDL_RenderDrawRect(r, &rc);
-        return;
-    }
-    set_color(r, c);
-
-    SDL_RenderDrawLine(r, x + rad, y, x + w - rad - 1, y);
-    SDL_RenderDrawLine(r, x + rad, y + h - 1, x + w - rad - 1, y + h - 1);
-    SDL_RenderDrawLine(r, x, y + rad, x, y + h - rad - 1);
-    SDL_RenderDrawLine(r, x + w - 1, y + rad, x + w - 1, y + h - rad - 1);
-
-    int segments = rad * 4;
-    if (segments < 16) segments = 16;
-    float step = (3.14159265f / 2.0f) / (float)segments;
-
-    for (int i = 0; i < segments; i++) {
-        float a1 = i * step;
-        float a2 = (i + 1) * step;
-        int cx, cy;
-
-        cx = x + rad; cy = y + rad;
-        SDL_RenderDrawLine(r, cx - (int)(rad * std::cos(a1)), cy - (int)(rad * std::sin(a1)),
-                              cx - (int)(rad * std::cos(a2)), cy - (int)(rad * std::sin(a2)));
-
-        cx = x + w - 1 - rad; cy = y + rad;
-        SDL_RenderDrawLine(r, cx + (int)(rad * std::cos(a1)), cy - (int)(rad * std::sin(a1)),
-                              cx + (int)(rad * std::cos(a2)), cy - (int)(rad * std::sin(a2)));
-
-        cx = x + rad; cy = y + h - 1 - rad;
-        SDL_RenderDrawLine(r, cx - (int)(rad * std::cos(a1)), cy + (int)(rad * std::sin(a1)),
-                              cx - (int)(rad * std::cos(a2)), cy + (int)(rad * std::sin(a2)));
-
-        cx = x + w - 1 - rad; cy = y + h - 1 - rad;
-        SDL_RenderDrawLine(r, cx + (int)(rad * std::cos(a1)), cy + (int)(rad * std::sin(a1)),
-                              cx + (int)(rad * std::cos(a2)), cy + (int)(rad * std::sin(a2)));
-    }
+    if (w <= 0 || h <= 0) return;
+    geom_rounded_rectangle(r, x, y, x + w - 1, y + h - 1, rad, c.r, c.g, c.b, c.a);
 }
 
 static void draw_gradient_v_rounded(SDL_Renderer* r, int x, int y, int w, int h, int rad,
@@ -132,17 +77,12 @@ static void draw_gradient_v_rounded(SDL_Renderer* r, int x, int y, int w, int h,
             inset = rad - (int)std::sqrt((float)(rad * rad - dy * dy));
         }
 
-        SDL_SetRenderDrawColor(r, cr, cg, cb, 255);
-        SDL_RenderDrawLine(r, x + inset, y + i, x + w - 1 - inset, y + i);
+        geom_hline(r, x + inset, x + w - 1 - inset, y + i, cr, cg, cb, 255);
     }
 }
 
 static void draw_circle_filled(SDL_Renderer* r, int cx, int cy, int radius, PanelColor c) {
-    set_color(r, c);
-    for (int dy = -radius; dy <= radius; dy++) {
-        int dx = (int)std::sqrt((float)(radius * radius - dy * dy));
-        SDL_RenderDrawLine(r, cx - dx, cy + dy, cx + dx, cy + dy);
-    }
+    geom_filled_circle(r, cx, cy, radius, c.r, c.g, c.b, c.a);
 }
 
 static void init_panel_fonts() {
@@ -184,18 +124,15 @@ static void init_panel_fonts() {
     }
 }
 
+// Returned texture is owned by the shared text cache; do not destroy it.
 static SDL_Texture* render_text_texture(SDL_Renderer* r, TTF_Font* font,
                                          const std::string& text, PanelColor color,
                                          int* outW, int* outH) {
-    if (!font || text.empty()) { *outW = 0; *outH = 0; return nullptr; }
     SDL_Color sc = {color.r, color.g, color.b, color.a};
-    SDL_Surface* surf = TTF_RenderUTF8_Blended(font, text.c_str(), sc);
-    if (!surf) { *outW = 0; *outH = 0; return nullptr; }
-    SDL_Texture* tex = SDL_CreateTextureFromSurface(r, surf);
-    *outW = surf->w;
-    *outH = surf->h;
-    SDL_FreeSurface(surf);
-    return tex;
+    CachedText t = text_cache_get(r, font, text, sc);
+    *outW = t.w;
+    *outH = t.h;
+    return t.texture;
 }
 
 static void draw_text(SDL_Renderer* r, TTF_Font* font, const std::string& text,
@@ -204,8 +141,7 @@ static void draw_text(SDL_Renderer* r, TTF_Font* font, const std::string& text,
     SDL_Texture* tex = render_text_texture(r, font, text, color, &w, &h);
     if (tex) {
         SDL_Rect dst = {x, y, w, h};
-        SDL_RenderCopy(r, tex, nullptr, &dst);
-        SDL_DestroyTexture(tex);
+        geom_texture(r, tex, nullptr, &dst);
     }
 }
 
@@ -215,8 +151,7 @@ static void draw_text_right(SDL_Renderer* r, TTF_Font* font, const std::string&
     SDL_Texture* tex = render_text_texture(r, font, text, color, &w, &h);
     if (tex) {
         SDL_Rect dst = {rightX - w, y, w, h};
-        SDL_RenderCopy(r, tex, nullptr, &dst);
-        SDL_DestroyTexture(tex);
+        geom_texture(r, tex, nullptr, &dst);
     }
 }
 
@@ -281,10 +216,12 @@ void render_sprite_panel(SDL_Renderer* renderer, const Sprite& sprite) {
     int panelX = STAGE_X;
     int panelY = STAGE_Y + STAGE_HEIGHT + 4;
     int panelW = STAGE_WIDTH;
-    int panelH = windowH - panelY - 4;
+    int panelH = windowH - panelY - 4 - SPRITE_LIST_HEIGHT;
 
     if (panelH < 60) return;
 
+    geom_begin(renderer);
+
     int mainRad = 8;
 
     fill_rounded_rect(renderer, panelX, panelY, panelW, panelH, mainRad, COL_BG_DARK);
@@ -327,7 +264,7 @@ void render_sprite_panel(SDL_Renderer* renderer, const Sprite& sprite) {
         int dw = (int)(srcW * fitScale);
         int dh = (int)(srcH * fitScale);
         SDL_Rect dst = {thumbX + (thumbSize - dw) / 2, thumbY + (thumbSize - dh) / 2, dw, dh};
-        SDL_RenderCopy(renderer, sprite.texture, nullptr, &dst);
+        geom_texture(renderer, sprite.texture, nullptr, &dst);
     }
 
     int infoX = thumbX + thumbSize + 12;
@@ -350,8 +287,7 @@ void render_sprite_panel(SDL_Renderer* renderer, const Sprite& sprite) {
         SDL_Texture* btex = render_text_texture(renderer, s_panelFontSmall, visText, visBadgeFg, &tw, &th);
         if (btex) {
             SDL_Rect bd = {infoX + (badgeW - tw) / 2, badgeY + (badgeH - th) / 2, tw, th};
-            SDL_RenderCopy(renderer, btex, nullptr, &bd);
-            SDL_DestroyTexture(btex);
+            geom_texture(renderer, btex, nullptr, &bd);
         }
     }
 
@@ -373,8 +309,7 @@ void render_sprite_panel(SDL_Renderer* renderer, const Sprite& sprite) {
         SDL_Texture* ptex = render_text_texture(renderer, s_panelFontSmall, penText, penBadgeFg, &tw2, &th2);
         if (ptex) {
             SDL_Rect pd = {penBadgeX + (penBadgeW - tw2) / 2, badgeY + (badgeH - th2) / 2, tw2, th2};
-            SDL_RenderCopy(renderer, ptex, nullptr, &pd);
-            SDL_DestroyTexture(ptex);
+            geom_texture(renderer, ptex, nullptr, &pd);
         }
     }
 
@@ -388,8 +323,8 @@ void render_sprite_panel(SDL_Renderer* renderer, const Sprite& sprite) {
     draw_rounded_rect_outline(renderer, cx, cy, cw, coordBoxH, innerRad, COL_BORDER);
 
     int halfW = cw / 2;
-    set_color(renderer, COL_SEPARATOR);
-    SDL_RenderDrawLine(renderer, cx + halfW, cy + 8, cx + halfW, cy + coordBoxH - 8);
+    geom_vline(renderer, cx + halfW, cy + 8, cy + coordBoxH - 8,
+               COL_SEPARATOR.r, COL_SEPARATOR.g, COL_SEPARATOR.b, COL_SEPARATOR.a);
 
     if (s_panelFontSmall && s_panelFontBold) {
         int leftCol = cx + 16;
@@ -534,4 +469,6 @@ void render_sprite_panel(SDL_Renderer* renderer, const Sprite& sprite) {
     draw_gradient_v_rounded(renderer, panelX, panelY + panelH - 4, panelW, 4, mainRad,
                     {COL_ACCENT_BLUE.r, COL_ACCENT_BLUE.g, COL_ACCENT_BLUE.b, 40},
                     {COL_ACCENT_BLUE.r, COL_ACCENT_BLUE.g, COL_ACCENT_BLUE.b, 160});
+
+    geom_end(renderer);
 }
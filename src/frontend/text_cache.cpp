@@ -0,0 +1,93 @@
+#include "text_cache.h"
+#include "geom_batch.h"
+#include <list>
+#include <unordered_map>
+#include <functional>
+
+struct TextKey {
+    TTF_Font* font;
+    Uint32 rgba;
+    std::string text;
+
+    bool operator==(const TextKey& o) const {
+        return font == o.font && rgba == o.rgba && text == o.text;
+    }
+};
+
+struct TextKeyHash {
+    size_t operator()(const TextKey& k) const {
+        size_t h = std::hash<std::string>()(k.text);
+        h ^= std::hash<const void*>()(k.font) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        h ^= std::hash<Uint32>()(k.rgba) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        return h;
+    }
+};
+
+struct TextEntry {
+    TextKey key;
+    CachedText value;
+    size_t bytes;
+};
+
+static std::list<TextEntry> g_lru;     // front = most recently used
+static std::unordered_map<TextKey, std::list<TextEntry>::iterator, TextKeyHash> g_lookup;
+static size_t g_bytes_used = 0;
+
+static void evict_to(size_t limit, size_t keep) {
+    while (g_bytes_used > limit && g_lru.size() > keep) {
+        TextEntry& victim = g_lru.back();
+        SDL_DestroyTexture(victim.value.texture);
+        g_bytes_used -= victim.bytes;
+        g_lookup.erase(victim.key);
+        g_lru.pop_back();
+    }
+}
+
+CachedText text_cache_get(SDL_Renderer* renderer, TTF_Font* font,
+                          const std::string& text, SDL_Color color) {
+    CachedText none = {nullptr, 0, 0};
+    if (!font || text.empty()) return none;
+
+    TextKey key = {font,
+                   ((Uint32)color.r << 24) | ((Uint32)color.g << 16) |
+                   ((Uint32)color.b << 8) | (Uint32)color.a,
+                   text};
+
+    auto found = g_lookup.find(key);
+    if (found != g_lookup.end()) {
+        g_lru.splice(g_lru.begin(), g_lru, found->second);
+        return found->second->value;
+    }
+
+    SDL_Surface* surface = TTF_RenderUTF8_Blended(font, text.c_str(), color);
+    if (!surface) return none;
+
+    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+    CachedText value = {texture, surface->w, surface->h};
+    SDL_FreeSurface(surface);
+    if (!texture) return none;
+
+    size_t bytes = (size_t)value.w * (size_t)value.h * 4;
+    g_lru.push_front({key, value, bytes});
+    g_lookup[key] = g_lru.begin();
+    g_bytes_used += bytes;
+
+    // The entry just inserted sits at the front, so keeping one entry
+    // means we never destroy the texture we are about to hand back.
+    evict_to(TEXT_CACHE_BUDGET, 1);
+
+    return value;
+}
+
+void text_cache_draw(SDL_Renderer* renderer, TTF_Font* font, int x, int y,
+                     const std::string& text, SDL_Color color) {
+    CachedText t = text_cache_get(renderer, font, text, color);
+    if (!t.texture) return;
+
+    SDL_Rect dst = {x, y, t.w, t.h};
+    geom_texture(renderer, t.texture, nullptr, &dst);
+}
+
+void text_cache_clear() {
+    evict_to(0, 0);
+}
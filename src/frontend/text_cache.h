@@ -0,0 +1,25 @@
+#ifndef TEXT_CACHE_H
+#define TEXT_CACHE_H
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <string>
+
+// Shared LRU cache of rasterized text. Entries are keyed by font handle
+// (which fixes face and point size), colour and string, and the least
+// recently drawn ones are destroyed once the texture budget is exceeded.
+
+const size_t TEXT_CACHE_BUDGET = 8 * 1024 * 1024;
+
+struct CachedText {
+    SDL_Texture* texture;
+    int w, h;
+};
+
+CachedText text_cache_get(SDL_Renderer* renderer, TTF_Font* font,
+                          const std::string& text, SDL_Color color);
+void text_cache_draw(SDL_Renderer* renderer, TTF_Font* font, int x, int y,
+                     const std::string& text, SDL_Color color);
+
+void text_cache_clear();
+
+#endif
@@ -16,13 +16,6 @@ int try_click_arg(const Block& block, int mx, int my) {
     return -1;
 }
 
-static Block* find_block_by_id(std::list<Block>& blocks, int id) {
-    for (auto& b : blocks) {
-        if (b.id == id) return &b;
-    }
-    return nullptr;
-}
-
 void begin_editing(TextInputState& state, Block& block, int arg_index) {
     state.active = true;
     state.block_id = block.id;
@@ -43,15 +36,15 @@ void begin_editing(TextInputState& state, Block& block, int arg_index) {
              " arg[" + std::to_string(arg_index) + "] = \"" + state.buffer + "\"");
 }
 
-void commit_editing(TextInputState& state, std::list<Block>& blocks) {
+void commit_editing(TextInputState& state, BlockPool& blocks) {
     if (!state.active) return;
 
-    Block* block = find_block_by_id(blocks, state.block_id);
+    Block* block = block_pool_find(blocks, state.block_id);
     if (block) {
         while ((int)block->args.size() <= state.arg_index) {
             block->args.push_back("");
         }
-        block->args[state.arg_index] = state.buffer;
+        block->args.set(state.arg_index, state.buffer);
 
         log_info("Committed block #" + std::to_string(block->id) +
                  " arg[" + std::to_string(state.arg_index) + "] = \"" + state.buffer + "\"");
@@ -89,7 +82,7 @@ void on_text_input(TextInputState& state, const char* text) {
     state.cursor_visible = true;
 }
 
-void on_key_input(TextInputState& state, SDL_Keycode key, std::list<Block>& blocks) {
+void on_key_input(TextInputState& state, SDL_Keycode key, BlockPool& blocks) {
     if (!state.active) return;
 
     switch (key) {
@@ -143,12 +136,14 @@ void on_key_input(TextInputState& state, SDL_Keycode key, std::list<Block>& bloc
     state.cursor_visible = true;
 }
 
-void tick_cursor(TextInputState& state) {
-    if (!state.active) return;
+bool tick_cursor(TextInputState& state) {
+    if (!state.active) return false;
 
     Uint32 now = SDL_GetTicks();
     if (now - state.blink_timer >= CURSOR_BLINK_MS) {
         state.cursor_visible = !state.cursor_visible;
         state.blink_timer = now;
+        return true;
     }
+    return false;
 }
@@ -4,19 +4,19 @@
 #include <SDL2/SDL.h>
 #include <vector>
 #include <string>
-#include <list>
+#include "../backend/block_pool.h"
 
 
 void begin_editing(TextInputState& state, Block& block, int arg_index);
 
-void commit_editing(TextInputState& state, std::list<Block>& blocks);
+void commit_editing(TextInputState& state, BlockPool& blocks);
 
 void cancel_editing(TextInputState& state);
 
 void on_text_input(TextInputState& state, const char* text);
 
-void on_key_input(TextInputState& state, SDL_Keycode key, std::list<Block>& blocks);
+void on_key_input(TextInputState& state, SDL_Keycode key, BlockPool& blocks);
 
-void tick_cursor(TextInputState& state);
+bool tick_cursor(TextInputState& state);
 
 #endif
@@ -0,0 +1,123 @@
+#include "texture_cache.h"
+#include "../utils/paths.h"
+#include <filesystem>
+#include <cstdio>
+#include <cstring>
+
+namespace fs = std::filesystem;
+
+// Set before loading starts; workers only read them.
+static std::string g_dir;
+static bool g_enabled = false;
+
+struct SourceStamp {
+    Uint64 size;
+    Sint64 mtime;
+};
+
+static bool source_stamp(const std::string& source, SourceStamp* out) {
+    std::error_code ec;
+    uintmax_t size = fs::file_size(source, ec);
+    if (ec) return false;
+    fs::file_time_type mtime = fs::last_write_time(source, ec);
+    if (ec) return false;
+
+    out->size = (Uint64)size;
+    out->mtime = (Sint64)mtime.time_since_epoch().count();
+    return true;
+}
+
+// Keyed by the absolute path: the cache is shared by every working
+// directory Blocky runs from, and sources are often given relative.
+static std::string entry_path(const std::string& source) {
+    std::error_code ec;
+    std::string key = fs::absolute(source, ec).lexically_normal().string();
+    if (ec) key = source;
+
+    Uint64 h = 14695981039346656037ULL;
+    for (unsigned char c : key) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.btx", (unsigned long long)h);
+    return g_dir + "/" + name;
+}
+
+void texture_cache_init() {
+    std::string base = user_cache_dir();
+    g_enabled = !base.empty();
+    g_dir = g_enabled ? base + "textures" : "";
+}
+
+SDL_Surface* texture_cache_load(const std::string& source, MappedFile* mapping) {
+    if (!g_enabled) return nullptr;
+
+    SourceStamp stamp;
+    if (!source_stamp(source, &stamp)) return nullptr;
+    if (!mapped_file_open(entry_path(source), mapping)) return nullptr;
+
+    TextureCacheHeader header;
+    bool valid = mapping->size >= sizeof(header);
+    if (valid) {
+        std::memcpy(&header, mapping->data, sizeof(header));
+        valid = std::memcmp(header.magic, "BTXC", 4) == 0 &&
+                header.version == TEXTURE_CACHE_VERSION &&
+                header.source_size == stamp.size &&
+                header.source_mtime == stamp.mtime &&
+                header.width > 0 && header.height > 0 &&
+                header.pitch >= header.width * 4 &&
+                mapping->size - sizeof(header) >= (size_t)header.pitch * header.height;
+    }
+
+    SDL_Surface* surface = nullptr;
+    if (valid) {
+        surface = SDL_CreateRGBSurfaceWithFormatFrom(mapping->data + sizeof(header),
+                                                     (int)header.width, (int)header.height,
+                                                     32, (int)header.pitch, header.format);
+    }
+    if (!surface) mapped_file_close(mapping);
+    return surface;
+}
+
+bool texture_cache_store(const std::string& source, SDL_Surface* surface) {
+    if (!g_enabled || !surface || surface->format->BytesPerPixel != 4) return false;
+
+    SourceStamp stamp;
+    if (!source_stamp(source, &stamp)) return false;
+
+    std::error_code ec;
+    fs::create_directories(g_dir, ec);
+
+    TextureCacheHeader header;
+    std::memcpy(header.magic, "BTXC", 4);
+    header.version = TEXTURE_CACHE_VERSION;
+    header.format = surface->format->format;
+    header.width = (Uint32)surface->w;
+    header.height = (Uint32)surface->h;
+    header.pitch = (Uint32)surface->w * 4;
+    header.source_size = stamp.size;
+    header.source_mtime = stamp.mtime;
+
+    std::string path = entry_path(source);
+    std::string tmp = path + "." + std::to_string((unsigned long)SDL_ThreadID()) + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if (!f) return false;
+
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+    SDL_LockSurface(surface);
+    for (int y = 0; ok && y < surface->h; y++) {
+        const Uint8* row = (const Uint8*)surface->pixels + (size_t)y * surface->pitch;
+        ok = fwrite(row, header.pitch, 1, f) == 1;
+    }
+    SDL_UnlockSurface(surface);
+    ok = (fclose(f) == 0) && ok;
+
+    // Readers see either the old entry or the complete new one.
+    if (ok) {
+        fs::rename(tmp, path, ec);
+        ok = !ec;
+    }
+    if (!ok) fs::remove(tmp, ec);
+    return ok;
+}
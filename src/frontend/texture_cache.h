@@ -0,0 +1,38 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+#include <SDL2/SDL.h>
+#include <string>
+#include "../utils/mapped_file.h"
+
+// Decoded images kept on disk as raw pixels in the format textures are
+// uploaded in, one file per source image. An entry is used only while
+// the source's size and modification time still match its header, so a
+// PNG is decoded again only after it changes. Entries live under the
+// user's cache directory, never beside the project.
+
+const Uint32 TEXTURE_CACHE_VERSION = 1;
+
+struct TextureCacheHeader {
+    char magic[4];            // "BTXC"
+    Uint32 version;
+    Uint32 format;            // SDL_PixelFormatEnum of the pixels
+    Uint32 width;
+    Uint32 height;
+    Uint32 pitch;
+    Uint64 source_size;
+    Sint64 source_mtime;
+};
+
+// Picks the cache directory. Call before any loads start; without it, or
+// without a user cache directory, loads and stores do nothing.
+void texture_cache_init();
+
+// Maps the cached pixels for source and wraps them in a surface without
+// copying. The mapping must stay open until the surface is freed.
+SDL_Surface* texture_cache_load(const std::string& source, MappedFile* mapping);
+
+// Writes the surface's pixels for source. Safe to call from several
+// threads: each entry is written to a temporary file and renamed.
+bool texture_cache_store(const std::string& source, SDL_Surface* surface);
+
+#endif
@@ -0,0 +1,106 @@
+#include "workspace.h"
+#include "geom_batch.h"
+#include <cmath>
+#include <algorithm>
+
+static float g_scroll_x = 0.0f;
+static float g_scroll_y = 0.0f;
+static float g_zoom = 1.0f;
+
+// Origin of the SDL viewport in logical (scaled) units. Drawing a block at
+// world (x, y) with this viewport and the zoom as render scale lands it at
+// screen ((origin.x + x) * zoom, (origin.y + y) * zoom).
+static SDL_Point view_origin() {
+    SDL_Point o;
+    o.x = (int)std::lround(CODING_AREA_X / g_zoom - CODING_AREA_X - g_scroll_x);
+    o.y = (int)std::lround(CODING_AREA_Y / g_zoom - CODING_AREA_Y - g_scroll_y);
+    return o;
+}
+
+// World coordinates never go negative: anything left of or above the
+// viewport origin would be clipped by SDL.
+static void clamp_scroll() {
+    if (g_scroll_x < 0.0f) g_scroll_x = 0.0f;
+    if (g_scroll_y < 0.0f) g_scroll_y = 0.0f;
+}
+
+void workspace_reset() {
+    g_scroll_x = 0.0f;
+    g_scroll_y = 0.0f;
+    g_zoom = 1.0f;
+}
+
+void workspace_scroll_by(float dx, float dy) {
+    g_scroll_x += dx / g_zoom;
+    g_scroll_y += dy / g_zoom;
+    clamp_scroll();
+}
+
+void workspace_zoom_at(int screen_x, int screen_y, float factor) {
+    int wx, wy;
+    workspace_screen_to_world(screen_x, screen_y, wx, wy);
+
+    float z = std::max(WORKSPACE_MIN_ZOOM, std::min(WORKSPACE_MAX_ZOOM, g_zoom * factor));
+    if (z == g_zoom) return;
+    g_zoom = z;
+
+    // Keep the world point under the cursor fixed.
+    float ox = screen_x / g_zoom - wx;
+    float oy = screen_y / g_zoom - wy;
+    g_scroll_x = CODING_AREA_X / g_zoom - CODING_AREA_X - ox;
+    g_scroll_y = CODING_AREA_Y / g_zoom - CODING_AREA_Y - oy;
+    clamp_scroll();
+}
+
+bool workspace_contains_screen(int screen_x, int screen_y) {
+    return screen_x >= CODING_AREA_X && screen_x < CODING_AREA_X + CODING_AREA_WIDTH &&
+           screen_y >= CODING_AREA_Y && screen_y < CODING_AREA_Y + CODING_AREA_HEIGHT;
+}
+
+void workspace_screen_to_world(int screen_x, int screen_y, int& world_x, int& world_y) {
+    SDL_Point o = view_origin();
+    world_x = (int)std::floor(screen_x / g_zoom) - o.x;
+    world_y = (int)std::floor(screen_y / g_zoom) - o.y;
+}
+
+void workspace_world_to_screen(float world_x, float world_y, int& screen_x, int& screen_y) {
+    SDL_Point o = view_origin();
+    screen_x = (int)std::lround((o.x + world_x) * g_zoom);
+    screen_y = (int)std::lround((o.y + world_y) * g_zoom);
+}
+
+SDL_Rect workspace_visible_world_rect() {
+    SDL_Point o = view_origin();
+    SDL_Rect r;
+    r.x = (int)std::floor(CODING_AREA_X / g_zoom) - o.x;
+    r.y = (int)std::floor(CODING_AREA_Y / g_zoom) - o.y;
+    r.w = (int)std::ceil(CODING_AREA_WIDTH / g_zoom) + 1;
+    r.h = (int)std::ceil(CODING_AREA_HEIGHT / g_zoom) + 1;
+    return r;
+}
+
+void workspace_begin_render(SDL_Renderer* renderer, bool clip_to_area) {
+    SDL_Point o = view_origin();
+
+    geom_flush(renderer);
+    SDL_RenderSetScale(renderer, g_zoom, g_zoom);
+
+    SDL_Rect viewport = {o.x, o.y,
+                         (int)std::ceil(WINDOW_WIDTH / g_zoom) - o.x + 1,
+                         (int)std::ceil(WINDOW_HEIGHT / g_zoom) - o.y + 1};
+    SDL_RenderSetViewport(renderer, &viewport);
+
+    if (clip_to_area) {
+        SDL_Rect clip = workspace_visible_world_rect();
+        SDL_RenderSetClipRect(renderer, &clip);
+    } else {
+        SDL_RenderSetClipRect(renderer, nullptr);
+    }
+}
+
+void workspace_end_render(SDL_Renderer* renderer) {
+    geom_flush(renderer);
+    SDL_RenderSetClipRect(renderer, nullptr);
+    SDL_RenderSetViewport(renderer, nullptr);
+    SDL_RenderSetScale(renderer, 1.0f, 1.0f);
+}
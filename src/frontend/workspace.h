@@ -0,0 +1,26 @@
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+#include "../common/definitions.h"
+#include <SDL2/SDL.h>
+
+// Scroll/zoom camera for the coding area. Blocks keep world coordinates;
+// at zoom 1 with no scroll, world and screen coordinates coincide.
+
+const float WORKSPACE_MIN_ZOOM = 0.5f;
+const float WORKSPACE_MAX_ZOOM = 2.0f;
+const int   WORKSPACE_SCROLL_STEP = 30;
+
+void workspace_reset();
+
+void workspace_scroll_by(float dx, float dy);
+void workspace_zoom_at(int screen_x, int screen_y, float factor);
+
+bool workspace_contains_screen(int screen_x, int screen_y);
+void workspace_screen_to_world(int screen_x, int screen_y, int& world_x, int& world_y);
+void workspace_world_to_screen(float world_x, float world_y, int& screen_x, int& screen_y);
+SDL_Rect workspace_visible_world_rect();
+
+void workspace_begin_render(SDL_Renderer* renderer, bool clip_to_area);
+void workspace_end_render(SDL_Renderer* renderer);
+
+#endif
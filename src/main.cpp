@@ -6,7 +6,6 @@
 #endif
 #include <iostream>
 #include <vector>
-#include <list>
 #include <cmath>
 #include <fstream>
 #include <cstdlib>
@@ -26,11 +25,17 @@
 #include "utils/system_logger.h"
 #include "backend/block_executor_looks.h"
 #include "backend/sound.h"
+#include "backend/audio_mixer.h"
 #include "backend/runtime.h"
+#include "backend/memory.h"
 #include "frontend/pen.h"
 #include <set>
 #include "backend/logic.h"
 #include "backend/file_io.h"
+#include "backend/collision.h"
+#include "backend/sprite_set.h"
+#include "backend/sprite_grid.h"
+#include "backend/clone_pool.h"
 #include "frontend/background_menu.h"
 #include "frontend/costume_editor.h"
 #include "frontend/character_panel.h"
@@ -40,73 +45,220 @@
 #include "frontend/sound_manager.h"
 #include "frontend/sound_manager_integration.h"
 #include "backend/custom_blocks.h"
+#include "backend/block_pool.h"
+#include "frontend/spatial_grid.h"
+#include "frontend/workspace.h"
+#include "frontend/text_cache.h"
+#include "frontend/panel_cache.h"
+#include "frontend/sprite_atlas.h"
+#include "frontend/asset_loader.h"
 
-Sprite sprite;
 Runtime gRuntime;
 Stage stage;
 TTF_Font* g_font = nullptr;
 ConfirmDialog g_dialog;
 MenuAction g_pending_action = MENU_ACTION_NONE;
 CostumeEditor g_costume_editor;
+CharacterPanel g_sprite_list;
+
+static int g_selected_sprite = 0;
+// Costumes every new or loaded sprite starts with. Sprites share the
+// textures, so they are destroyed once at shutdown.
+static std::vector<Costume> g_default_costumes;
+
+// Changes to the sprite list are queued and applied at the top of the next
+// frame, before the selected sprite and its scripts are bound for the loop.
+enum SpriteRequest {
+    SPRITE_REQ_NONE,
+    SPRITE_REQ_SELECT,
+    SPRITE_REQ_ADD,
+    SPRITE_REQ_REMOVE,
+    SPRITE_REQ_NEW_PROJECT,
+    SPRITE_REQ_LOAD
+};
+static SpriteRequest g_sprite_request = SPRITE_REQ_NONE;
+static int g_sprite_request_index = -1;
+
+// When nothing changed since the last frame, skip drawing and presenting
+// and sleep in SDL_WaitEventTimeout instead of spinning on vsync.
+static bool g_skip_idle_frames = true;
+const int IDLE_WAIT_MS = 50;
+
+// Everything render_sprite_panel reads from the sprite.
+static Uint64 sprite_panel_signature(const Sprite& s) {
+    Uint64 h = 14695981039346656037ULL;
+    h = panel_cache_hash(h, &s.texture, sizeof(s.texture));
+    h = panel_cache_hash(h, &s.width, sizeof(s.width));
+    h = panel_cache_hash(h, &s.height, sizeof(s.height));
+    h = panel_cache_hash(h, s.name);
+    h = panel_cache_hash(h, &s.visible, sizeof(s.visible));
+    h = panel_cache_hash(h, &s.x, sizeof(s.x));
+    h = panel_cache_hash(h, &s.y, sizeof(s.y));
+    h = panel_cache_hash(h, &s.angle, sizeof(s.angle));
+    h = panel_cache_hash(h, &s.scale, sizeof(s.scale));
+    h = panel_cache_hash(h, &s.isPenDown, sizeof(s.isPenDown));
+    h = panel_cache_hash(h, &s.penR, sizeof(s.penR));
+    h = panel_cache_hash(h, &s.penG, sizeof(s.penG));
+    h = panel_cache_hash(h, &s.penB, sizeof(s.penB));
+    h = panel_cache_hash(h, &s.penSize, sizeof(s.penSize));
+    h = panel_cache_hash(h, s.sayText);
+    h = panel_cache_hash(h, &s.currentCostumeIndex, sizeof(s.currentCostumeIndex));
+    for (const Costume& c : s.costumes) {
+        h = panel_cache_hash(h, c.name);
+        h = panel_cache_hash(h, &c.texture, sizeof(c.texture));
+        h = panel_cache_hash(h, &c.width, sizeof(c.width));
+        h = panel_cache_hash(h, &c.height, sizeof(c.height));
+    }
+    for (const Variable& v : s.variables) {
+        h = panel_cache_hash(h, v.name);
+        h = panel_cache_hash(h, v.value);
+    }
+    return h;
+}
 
-static void register_all_definitions(std::list<Block>& blocks) {
-    for (Block& b : blocks) {
-        if (b.type == CMD_DEFINE_BLOCK) {
-            if (!b.args.empty()) {
-                custom_blocks_register(b.args[0], &b);
+static Uint64 sprite_list_signature() {
+    Uint64 h = 14695981039346656037ULL;
+    h = panel_cache_hash(h, &g_selected_sprite, sizeof(g_selected_sprite));
+    for (int i = 0; i < sprite_set_count() && i < CPANEL_MAX_CHARS; i++) {
+        const Sprite& s = sprite_set_at(i)->sprite;
+        h = panel_cache_hash(h, s.name);
+        h = panel_cache_hash(h, &s.texture, sizeof(s.texture));
+        h = panel_cache_hash(h, &s.visible, sizeof(s.visible));
+    }
+    Uint64 count = (Uint64)sprite_set_count();
+    return panel_cache_hash(h, &count, sizeof(count));
+}
+
+static void sync_sprite_list() {
+    int count = std::min(sprite_set_count(), CPANEL_MAX_CHARS);
+    for (int i = 0; i < count; i++) {
+        const Sprite& s = sprite_set_at(i)->sprite;
+        CharPanelItem& item = g_sprite_list.items[i];
+        item.name = s.name;
+        item.thumbnail = s.texture;
+        item.is_visible = s.visible != 0;
+        item.is_selected = (i == g_selected_sprite);
+        item.pos_x = s.x;
+        item.pos_y = s.y;
+        item.angle = s.angle;
+    }
+    g_sprite_list.count = count;
+    g_sprite_list.selected_index = g_selected_sprite < count ? g_selected_sprite : -1;
+}
+
+static void register_all_definitions() {
+    for (int i = 0; i < sprite_set_count(); i++) {
+        for (Block& b : sprite_set_at(i)->blocks) {
+            if (b.type == CMD_DEFINE_BLOCK) {
+                if (!b.args.empty()) {
+                    custom_blocks_register(b.args[0], &b);
+                }
             }
         }
     }
 }
 
+static void dress_sprite(Sprite& s) {
+    if (g_default_costumes.empty()) return;
+    s.costumes = g_default_costumes;
+    if (s.currentCostumeIndex < 0 || s.currentCostumeIndex >= (int)s.costumes.size()) {
+        s.currentCostumeIndex = 0;
+    }
+    const Costume& c = s.costumes[s.currentCostumeIndex];
+    s.texture = c.texture;
+    s.width   = c.width;
+    s.height  = c.height;
+}
+
+static void swap_in_costume(Sprite& s, int index, SDL_Texture* placeholder, const Costume& c) {
+    if (index >= (int)s.costumes.size() || s.costumes[index].texture != placeholder) return;
+    s.costumes[index] = c;
+    if (s.currentCostumeIndex == index) {
+        s.texture = c.texture;
+        s.width   = c.width;
+        s.height  = c.height;
+    }
+}
+
+// Replaces a default costume's placeholder, in the defaults and in every
+// sprite and clone dressed from them, once its image has been decoded.
+static void install_default_costume(SDL_Renderer* renderer, int index, const LoadedImage& image) {
+    if (!image.texture || index >= (int)g_default_costumes.size()) return;
+
+    Costume& slot = g_default_costumes[index];
+    SDL_Texture* placeholder = slot.texture;
+    Costume c(slot.name, image.texture, image.surface->w, image.surface->h);
+    c.mask = image.mask;
+    sprite_atlas_add(renderer, image.texture, image.surface);
+    slot = c;
+
+    for (int i = 0; i < sprite_set_count(); i++) {
+        SpriteEntry* e = sprite_set_at(i);
+        swap_in_costume(e->sprite, index, placeholder, c);
+        for (Sprite* clone = clone_pool_first(e); clone; clone = clone_pool_next(clone)) {
+            swap_in_costume(*clone, index, placeholder, c);
+        }
+    }
+    log_info("Loaded costume: " + c.name);
+}
+
+// The block grid only indexes the scripts on screen.
+static void show_sprite_scripts(BlockPool& blocks) {
+    spatial_grid_clear();
+    for (Block& b : blocks) {
+        if (!b.parent) spatial_grid_layout_tree(&b);
+    }
+}
+
+static bool expire_say_text(Sprite& s) {
+    if (s.sayText.empty() || s.sayDuration <= 0) return false;
+    if ((float)(SDL_GetTicks() - s.sayStartTime) <= s.sayDuration * 1000.0f) return false;
+    s.sayText.clear();
+    return true;
+}
+
+static void start_scripts(std::vector<Runtime>& runtimes, BlockPool& blocks,
+                          Sprite* target, BlockType hat) {
+    for (Block& b : blocks) {
+        if (b.type == hat && b.next) {
+            Runtime rt;
+            runtime_init(&rt, b.next, target);
+            runtime_start(&rt);
+            runtimes.push_back(rt);
+        }
+    }
+}
+
 void init_program(SDL_Renderer& renderer) {
     syslog_init();
     menu_init();
     pen_init(&renderer);
     init_logger("debug.log");
     log_info("Application started");
-    sprite.texture = load_texture(&renderer, "../assets/cat.png");
-    if (!sprite.texture) {
-        log_warning("Failed to load cat.png - sprite will be invisible");
-    }
+    clone_pool_init();
+    asset_loader_init();
+    sprite_set_add("Cat");
     cdialog_init(&g_dialog, WINDOW_WIDTH, WINDOW_HEIGHT);
     ceditor_init(&g_costume_editor, &renderer, 50, 50);
     sound_manager_init(&renderer, WINDOW_WIDTH/2 - 100, WINDOW_HEIGHT/2 - 200, 200, 400);
+    cpanel_init(&g_sprite_list, STAGE_X, WINDOW_HEIGHT - SPRITE_LIST_HEIGHT,
+                STAGE_WIDTH, SPRITE_LIST_HEIGHT - 4);
     // sound_manager_set_visible(true);
 }
 
-static void new_project(std::list<Block>& blocks,
-                         Sprite& sprite,
-                         int& next_block_id,
-                         int& execution_index,
-                         bool& is_executing,
-                         SDL_Renderer* renderer)
+static void new_project(int& execution_index, bool& is_executing)
 {
-    blocks.clear();
-    next_block_id = 1;
+    spatial_grid_clear();
+    sprite_set_clear();
+    workspace_reset();
+    reset_block_counter(1);
     execution_index = -1;
     is_executing = false;
 
-    sprite.x = STAGE_X + STAGE_WIDTH / 2.0f;
-    sprite.y = STAGE_Y + STAGE_HEIGHT / 2.0f;
-    sprite.angle = 0.0f;
-    sprite.visible = true;
-    sprite.isPenDown = 0;
-    sprite.penR = 0;
-    sprite.penG = 0;
-    sprite.penB = 255;
-    sprite.penSize = 1;
-    sprite.prevPenX = sprite.x;
-    sprite.prevPenY = sprite.y;
-
-    if (!sprite.costumes.empty()) {
-        sprite.currentCostumeIndex = 0;
-        sprite.texture = sprite.costumes[0].texture;
-        sprite.width   = sprite.costumes[0].width;
-        sprite.height  = sprite.costumes[0].height;
-    }
+    dress_sprite(sprite_set_add("Cat")->sprite);
+    g_selected_sprite = 0;
 
-    pen_clear(renderer);
+    pen_clear();
 
     log_info("NEW: New project created");
 }
@@ -223,29 +375,23 @@ int main(int argc, char* argv[]) {
         };
         int num_costumes = COSTUME_COUNT;
 
+        // Sprites start on placeholders; each costume swaps in as soon as a
+        // worker has decoded it, so the first frame does not wait on disk.
+        SDL_Texture* placeholder = asset_placeholder(renderer);
         for (int i = 0; i < num_costumes; i++) {
-            SDL_Texture* tex = load_texture(renderer, costume_files[i]);
-            SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_BLEND);
-            if (tex) {
-                int w = 0, h = 0;
-                SDL_QueryTexture(tex, nullptr, nullptr, &w, &h);
-                sprite.costumes.push_back(Costume(costume_names[i], tex, w, h));
-                log_info("Loaded costume: " + std::string(costume_names[i]));
-            } else {
-                log_warning("Failed to load costume: " + std::string(costume_files[i]));
-            }
+            g_default_costumes.push_back(Costume(costume_names[i], placeholder,
+                                                 ASSET_PLACEHOLDER_SIZE, ASSET_PLACEHOLDER_SIZE));
+            asset_load_image(costume_files[i], true,
+                             [i](SDL_Renderer* r, const LoadedImage& image) {
+                                 install_default_costume(r, i, image);
+                             });
         }
 
         for (int i = 0; i < COSTUME_COUNT; i++) {
             free(costume_files[i]);
         }
 
-        if (!sprite.costumes.empty()) {
-            sprite.currentCostumeIndex = 0;
-            sprite.texture = sprite.costumes[0].texture;
-            sprite.width   = sprite.costumes[0].width;
-            sprite.height  = sprite.costumes[0].height;
-        }
+        dress_sprite(sprite_set_at(0)->sprite);
     }
 
     std::vector<PaletteItem> palette_items;
@@ -260,14 +406,9 @@ int main(int argc, char* argv[]) {
 
 
     Block* program_head = nullptr;
-    std::list<Block> blocks;
-    int next_block_id = 1;
 
     stage.renderer = renderer;
 
-    sprite.x = STAGE_X + STAGE_WIDTH / 2;
-    sprite.y = STAGE_Y + STAGE_HEIGHT / 2;
-
     TextInputState text_state;
 
     int  mouse_x   = 0, mouse_y   = 0;
@@ -279,26 +420,112 @@ int main(int argc, char* argv[]) {
     SDL_Event event;
 
     std::vector<Runtime> activeRuntimes;
+    std::vector<Sprite*> spawned_clones;
 
-    for (Block& b : blocks) {
-        if (b.type == CMD_DEFINE_BLOCK) {
-            if (!b.args.empty()) {
-                custom_blocks_register(b.args[0], &b);
-            }
-        }
-    }
+    register_all_definitions();
 
-    register_all_definitions(blocks);
+    bool idle = false;
 
     while (running) {
 
+        if (idle) {
+            SDL_WaitEventTimeout(nullptr, IDLE_WAIT_MS);
+        }
+        bool needs_redraw = !g_skip_idle_frames;
+
+        if (g_sprite_request != SPRITE_REQ_NONE) {
+            needs_redraw = true;
+            if (text_state.active) {
+                commit_editing(text_state, sprite_set_at(g_selected_sprite)->blocks);
+            }
+
+            int index = g_sprite_request_index;
+            switch (g_sprite_request) {
+                case SPRITE_REQ_SELECT:
+                    if (index >= 0 && index < sprite_set_count()) g_selected_sprite = index;
+                    break;
+
+                case SPRITE_REQ_ADD: {
+                    Sprite& added = sprite_set_add(sprite_set_unique_name("Sprite"))->sprite;
+                    dress_sprite(added);
+                    added.x = STAGE_X + 40 + (float)(rand() % (STAGE_WIDTH - 80));
+                    added.y = STAGE_Y + 40 + (float)(rand() % (STAGE_HEIGHT - 80));
+                    added.prevPenX = added.x;
+                    added.prevPenY = added.y;
+                    g_selected_sprite = sprite_set_count() - 1;
+                    break;
+                }
+
+                case SPRITE_REQ_REMOVE: {
+                    SpriteEntry* victim = sprite_set_at(index);
+                    if (!victim || sprite_set_count() <= 1) break;
+                    for (auto it = activeRuntimes.begin(); it != activeRuntimes.end(); ) {
+                        if (it->targetSprite == &victim->sprite ||
+                            clone_pool_owner(it->targetSprite) == victim) {
+                            it = activeRuntimes.erase(it);
+                        } else {
+                            ++it;
+                        }
+                    }
+                    spatial_grid_clear();
+                    sprite_set_remove(index);
+                    custom_blocks_clear();
+                    register_all_definitions();
+                    if (g_selected_sprite >= index && g_selected_sprite > 0) g_selected_sprite--;
+                    break;
+                }
+
+                case SPRITE_REQ_NEW_PROJECT:
+                    activeRuntimes.clear();
+                    new_project(g_execution_index, g_is_executing);
+                    break;
+
+                case SPRITE_REQ_LOAD: {
+                    activeRuntimes.clear();
+                    spatial_grid_clear();
+                    bool loaded = load_project("project.scratch");
+                    if (loaded) {
+                        for (int i = 0; i < sprite_set_count(); i++) {
+                            dress_sprite(sprite_set_at(i)->sprite);
+                        }
+                        g_selected_sprite = 0;
+                        g_execution_index = -1;
+                        g_is_executing = false;
+                        log_info("LOAD: Project loaded successfully");
+                    } else {
+                        log_error("LOAD: Failed to load project");
+                    }
+                    break;
+                }
+
+                case SPRITE_REQ_NONE:
+                    break;
+            }
+
+            show_sprite_scripts(sprite_set_at(g_selected_sprite)->blocks);
+            g_sprite_request = SPRITE_REQ_NONE;
+            g_sprite_request_index = -1;
+        }
+
+        SpriteEntry& current = *sprite_set_at(g_selected_sprite);
+        Sprite& sprite = current.sprite;
+        BlockPool& blocks = current.blocks;
+
         while (SDL_PollEvent(&event)) {
+            needs_redraw = true;
+
             if (sound_manager_handle_event(&event)) {
                 continue;
             }
             
             switch (event.type) {
 
+                case SDL_RENDER_TARGETS_RESET:
+                case SDL_RENDER_DEVICE_RESET:
+                    panel_cache_invalidate_all();
+                    draw_clear_block_skins();
+                    break;
+
                 case SDL_QUIT:
                     running = false;
                     break;
@@ -315,6 +542,16 @@ int main(int argc, char* argv[]) {
                             palette_scroll_offset = 0;
                         if (palette_scroll_offset > palette_max_scroll)
                             palette_scroll_offset = palette_max_scroll;
+                    } else if (workspace_contains_screen(mx, my)) {
+                        SDL_Keymod mods = SDL_GetModState();
+                        if (mods & KMOD_CTRL) {
+                            workspace_zoom_at(mx, my, event.wheel.y > 0 ? 1.1f : 1.0f / 1.1f);
+                        } else if (mods & KMOD_SHIFT) {
+                            workspace_scroll_by(-event.wheel.y * WORKSPACE_SCROLL_STEP, 0.0f);
+                        } else {
+                            workspace_scroll_by(event.wheel.x * WORKSPACE_SCROLL_STEP,
+                                                -event.wheel.y * WORKSPACE_SCROLL_STEP);
+                        }
                     }
                     break;
                 }
@@ -333,20 +570,11 @@ int main(int argc, char* argv[]) {
                             CDialogResult res = cdialog_handle_click(&g_dialog, mx, my);
                             if (res == CDLG_YES) {
                                 if (g_pending_action == MENU_ACTION_NEW) {
-                                    activeRuntimes.clear();
-                                    new_project(blocks, sprite, next_block_id, g_execution_index, g_is_executing, renderer);
+                                    g_sprite_request = SPRITE_REQ_NEW_PROJECT;
                                 } else if (g_pending_action == MENU_ACTION_EXIT) {
                                     running = false;
                                 } else if (g_pending_action == MENU_ACTION_LOAD) {
-                                    activeRuntimes.clear();
-                                    blocks.clear();
-                                    if (load_project("project.scratch", blocks, sprite, next_block_id)) {
-                                        g_execution_index = -1;
-                                        g_is_executing = false;
-                                        log_info("LOAD: Project loaded successfully");
-                                    } else {
-                                        log_error("LOAD: Failed to load project");
-                                    }
+                                    g_sprite_request = SPRITE_REQ_LOAD;
                                 }
                             }
                             g_pending_action = MENU_ACTION_NONE;
@@ -396,16 +624,15 @@ int main(int argc, char* argv[]) {
 
                                 if (!was_paused) {
                             activeRuntimes.clear();
+                            clone_pool_clear();
                             custom_blocks_clear();
-                            register_all_definitions(blocks);
-                            for (Block& b : blocks) {
-                                b.has_executed = false;
-                                if (b.type == CMD_START && b.next) {
-                                    Runtime rt;
-                                    runtime_init(&rt, b.next, &sprite);
-                                    runtime_start(&rt);
-                                    activeRuntimes.push_back(rt);
+                            register_all_definitions();
+                            for (int i = 0; i < sprite_set_count(); i++) {
+                                SpriteEntry* e = sprite_set_at(i);
+                                for (Block& b : e->blocks) {
+                                    b.has_executed = false;
                                 }
+                                start_scripts(activeRuntimes, e->blocks, &e->sprite, CMD_START);
                             }
                             log_info("RUN: Started " +
                                      std::to_string(activeRuntimes.size()) + " runtime(s)");
@@ -423,33 +650,42 @@ int main(int argc, char* argv[]) {
                                 runtime_stop(&rt);
                             }
                             activeRuntimes.clear();
+                            clone_pool_clear();
                             log_info("STOP: All runtimes stopped");
                             break;
                         }
 
-                        bool clicked_sprite = false;
-                        if (sprite.visible && sprite.texture) {
-                            float halfW = (sprite.width * sprite.scale) / 2.0f;
-                            float halfH = (sprite.height * sprite.scale) / 2.0f;
-                            
-                            if (mx >= sprite.x - halfW && mx <= sprite.x + halfW &&
-                                my >= sprite.y - halfH && my <= sprite.y + halfH) {
-                                clicked_sprite = true;
+                        if (mx >= g_sprite_list.panel_x && mx < g_sprite_list.panel_x + g_sprite_list.panel_w &&
+                            my >= g_sprite_list.panel_y && my < g_sprite_list.panel_y + g_sprite_list.panel_h) {
+                            int hit = cpanel_handle_click(&g_sprite_list, mx, my);
+                            if (hit == 300) {
+                                g_sprite_request = SPRITE_REQ_ADD;
+                            } else if (hit >= 200) {
+                                SpriteEntry* e = sprite_set_at(hit - 200);
+                                if (e) e->sprite.visible = !e->sprite.visible;
+                            } else if (hit >= 100) {
+                                g_sprite_request = SPRITE_REQ_REMOVE;
+                                g_sprite_request_index = hit - 100;
+                            } else if (hit >= 0) {
+                                g_sprite_request = SPRITE_REQ_SELECT;
+                                g_sprite_request_index = hit;
                             }
+                            break;
                         }
 
-                        if (clicked_sprite) {
-                            register_all_definitions(blocks);
-                            for (Block& b : blocks) {
-                                if (b.type == CMD_EVENT_CLICK) {
-                                    if (b.next) {
-                                        Runtime rt;
-                                        runtime_init(&rt, b.next, &sprite);
-                                        runtime_start(&rt);
-                                        activeRuntimes.push_back(rt);
-                                        log_info("EVENT: Started script from CMD_EVENT_CLICK");
-                                    }
-                                }
+                        Sprite* clicked = nullptr;
+                        SpriteEntry* clicked_owner = nullptr;
+                        if (mx >= STAGE_X && mx < STAGE_X + STAGE_WIDTH &&
+                            my >= STAGE_Y && my < STAGE_Y + STAGE_HEIGHT) {
+                            clicked = sprite_set_pick(mx, my, &clicked_owner);
+                        }
+
+                        if (clicked) {
+                            register_all_definitions();
+                            size_t before = activeRuntimes.size();
+                            start_scripts(activeRuntimes, clicked_owner->blocks, clicked, CMD_EVENT_CLICK);
+                            if (activeRuntimes.size() > before) {
+                                log_info("EVENT: Started script from CMD_EVENT_CLICK");
                             }
                         }
 
@@ -475,8 +711,14 @@ int main(int argc, char* argv[]) {
                         }
 
                         bool clicked_arg = false;
-                        for (auto& block : blocks) {
-                            if (try_click_arg(block, mx, my, text_state)) {
+                        std::vector<Block*> under_mouse;
+                        int wx = 0, wy = 0;
+                        if (workspace_contains_screen(mx, my)) {
+                            workspace_screen_to_world(mx, my, wx, wy);
+                            spatial_grid_query_point(wx, wy, under_mouse);
+                        }
+                        for (Block* block : under_mouse) {
+                            if (try_click_arg(*block, wx, wy, text_state)) {
                                 clicked_arg = true;
                                 break;
                             }
@@ -487,7 +729,7 @@ int main(int argc, char* argv[]) {
                                 commit_editing(text_state, blocks);
                             }
                             handle_mouse_down(event, blocks, palette_items,
-                                              next_block_id, palette_scroll_offset, text_state);
+                                              palette_scroll_offset, text_state);
                         }
                     }
                     
@@ -550,38 +792,46 @@ int main(int argc, char* argv[]) {
                             
                             for (auto & c: keyStr) c = tolower(c);
                             
-                            register_all_definitions(blocks);
+                            register_all_definitions();
                             
-                            for (Block& b : blocks) {
-                                if (b.type == CMD_EVENT_KEY) {
-                                    bool match = false;
+                            for (int si = 0; si < sprite_set_count(); si++) {
+                                SpriteEntry* owner = sprite_set_at(si);
+                                for (Block& b : owner->blocks) {
+                                    if (b.type == CMD_EVENT_KEY) {
+                                        bool match = false;
                                     
-                                    if (!b.args.empty()) {
-                                        std::string target = b.args[0];
-                                        for (auto & c: target) c = tolower(c); 
+                                        if (!b.args.empty()) {
+                                            std::string target = b.args[0];
+                                            for (auto & c: target) c = tolower(c); 
                                         
-                                        if (target == "any") {
-                                            match = true;
+                                            if (target == "any") {
+                                                match = true;
+                                            }
+                                            else if (target == "space" && keycode == SDLK_SPACE) {
+                                                match = true;
+                                            }
+                                            else if (target == "up arrow" && keycode == SDLK_UP) match = true;
+                                            else if (target == "down arrow" && keycode == SDLK_DOWN) match = true;
+                                            else if (target == "left arrow" && keycode == SDLK_LEFT) match = true;
+                                            else if (target == "right arrow" && keycode == SDLK_RIGHT) match = true;
+                                            else if (keyStr == target) {
+                                                match = true;
+                                            }
                                         }
-                                        else if (target == "space" && keycode == SDLK_SPACE) {
-                                            match = true;
-                                        }
-                                        else if (target == "up arrow" && keycode == SDLK_UP) match = true;
-                                        else if (target == "down arrow" && keycode == SDLK_DOWN) match = true;
-                                        else if (target == "left arrow" && keycode == SDLK_LEFT) match = true;
-                                        else if (target == "right arrow" && keycode == SDLK_RIGHT) match = true;
-                                        else if (keyStr == target) {
-                                            match = true;
-                                        }
-                                    }
                                     
-                                    if (match) {
-                                        if (b.next) {
-                                            Runtime rt;
-                                            runtime_init(&rt, b.next, &sprite);
-                                            runtime_start(&rt);
-                                            activeRuntimes.push_back(rt);
-                                            log_info("EVENT: Started script from CMD_EVENT_KEY (" + b.args[0] + ")");
+                                        if (match) {
+                                            if (b.next) {
+                                                Runtime rt;
+                                                runtime_init(&rt, b.next, &owner->sprite);
+                                                runtime_start(&rt);
+                                                activeRuntimes.push_back(rt);
+                                                for (Sprite* c = clone_pool_first(owner); c; c = clone_pool_next(c)) {
+                                                    if (clone_pool_is_dying(c)) continue;
+                                                    rt.targetSprite = c;
+                                                    activeRuntimes.push_back(rt);
+                                                }
+                                                log_info("EVENT: Started script from CMD_EVENT_KEY (" + b.args[0] + ")");
+                                            }
                                         }
                                     }
                                 }
@@ -626,17 +876,23 @@ int main(int argc, char* argv[]) {
             }
         }
 
-        if (!sprite.sayText.empty() && sprite.sayDuration > 0) {
-            if ((float)(SDL_GetTicks() - sprite.sayStartTime) > (sprite.sayDuration * 1000.0f)) {
-                sprite.sayText.clear();
+        for (int i = 0; i < sprite_set_count(); i++) {
+            SpriteEntry* e = sprite_set_at(i);
+            if (expire_say_text(e->sprite)) needs_redraw = true;
+            for (Sprite* c = clone_pool_first(e); c; c = clone_pool_next(c)) {
+                if (expire_say_text(*c)) needs_redraw = true;
             }
         }
         
         if (!g_costume_editor.is_open && g_costume_editor.target_costume_index != -1) {
+            needs_redraw = true;
             SDL_Texture* result = ceditor_get_result(&g_costume_editor);
             if (result) {
                 if (g_costume_editor.target_costume_index >= 0 && g_costume_editor.target_costume_index < (int)sprite.costumes.size()) {
-                    sprite.costumes[g_costume_editor.target_costume_index].texture = result;
+                    Costume& edited = sprite.costumes[g_costume_editor.target_costume_index];
+                    edited.texture = result;
+                    edited.image_id = costume_next_image_id();
+                    edited.mask = collision_mask_from_texture(renderer, result);
                     sprite.texture = result;
                 }
             }
@@ -644,19 +900,25 @@ int main(int argc, char* argv[]) {
         }
 
         MenuAction action = menu_consume_action();
+        if (action != MENU_ACTION_NONE) needs_redraw = true;
         switch (action) {
             case MENU_ACTION_NEW:
                 g_pending_action = MENU_ACTION_NEW;
                 cdialog_show(&g_dialog, "New Project", "Create new project?");
                 break;
 
-                case MENU_ACTION_SAVE:
-                    if (!blocks.empty()) {
-                        save_project("project.scratch", blocks, sprite);
+                case MENU_ACTION_SAVE: {
+                    bool has_blocks = false;
+                    for (int i = 0; i < sprite_set_count() && !has_blocks; i++) {
+                        has_blocks = !sprite_set_at(i)->blocks.empty();
+                    }
+                    if (has_blocks) {
+                        save_project("project.scratch");
                     } else {
                         log_warning("SAVE: No blocks to save");
                     }
                     break;
+                }
 
                 case MENU_ACTION_LOAD:
                     g_pending_action = MENU_ACTION_LOAD;
@@ -679,6 +941,10 @@ int main(int argc, char* argv[]) {
                       << " X=" << (int)sprite.x 
                       << " Y=" << (int)sprite.y
                       << " Angle=" << (int)sprite.angle;
+                AudioTiming audio = audio_mixer_timing();
+                debug << " Audio=" << audio.buffer_frames << "f"
+                      << " Latency=" << (int)(audio.latency_ms + 0.5f) << "ms"
+                      << " Jitter=" << (int)(audio.jitter_ms + 0.5f) << "ms";
                 
                 syslog_log(0, "DEBUG: " + debug.str());
 
@@ -688,6 +954,16 @@ int main(int argc, char* argv[]) {
                 break;
             }
 
+            case MENU_ACTION_LOW_LATENCY_AUDIO: {
+                bool on = !sound_low_latency();
+                if (sound_set_low_latency(on)) {
+                    syslog_log(0, std::string("AUDIO: Low latency ") + (on ? "on" : "off"));
+                } else {
+                    syslog_log(0, "AUDIO: Device refused the buffer size");
+                }
+                break;
+            }
+
             case MENU_ACTION_ABOUT: {
                 std::string msg = "Blocky v1.0 - SDL2 Clone";
 
@@ -704,21 +980,60 @@ int main(int argc, char* argv[]) {
                 break;
         }
 
-        tick_cursor(text_state);
+        if (tick_cursor(text_state)) needs_redraw = true;
         logger_tick();
+        if (asset_loader_pump(renderer) > 0) needs_redraw = true;
+        if (sound_update() > 0) needs_redraw = true;
+
+        if (!activeRuntimes.empty() || g_costume_editor.is_open || sound_manager_is_visible()) {
+            needs_redraw = true;
+        }
 
         int mouseX, mouseY;
         SDL_GetMouseState(&mouseX, &mouseY);
 
-        for (auto it = activeRuntimes.begin(); it != activeRuntimes.end(); ) {
-            runtime_tick(&(*it), &stage, mouseX, mouseY);
-            if (it->state == RUNTIME_FINISHED || it->state == RUNTIME_STOPPED) {
-                it = activeRuntimes.erase(it);
-            } else {
-                ++it;
+        // Touch queries see every sprite where it is now: all are refiled
+        // before the tick and each runtime's sprite again after it moves.
+        for (int i = 0; i < sprite_set_count(); i++) {
+            SpriteEntry* e = sprite_set_at(i);
+            sprite_grid_update(&e->sprite);
+            for (Sprite* c = clone_pool_first(e); c; c = clone_pool_next(c)) {
+                if (!clone_pool_is_dying(c)) sprite_grid_update(c);
             }
         }
 
+        sound_begin_tick();
+        for (Runtime& rt : activeRuntimes) {
+            if (clone_pool_is_dying(rt.targetSprite)) continue;
+            runtime_tick(&rt, &stage, mouseX, mouseY);
+            if (!clone_pool_is_dying(rt.targetSprite)) sprite_grid_update(rt.targetSprite);
+        }
+
+        // Finished scripts and every script of a deleted clone leave in one
+        // pass; only then can the clone's slot go back to the pool.
+        size_t kept = 0;
+        for (size_t i = 0; i < activeRuntimes.size(); i++) {
+            Runtime& rt = activeRuntimes[i];
+            if (rt.state == RUNTIME_FINISHED || rt.state == RUNTIME_STOPPED ||
+                clone_pool_is_dying(rt.targetSprite)) {
+                if (rt.lastExecutedBlock) rt.lastExecutedBlock->is_running = false;
+                continue;
+            }
+            if (kept != i) activeRuntimes[kept] = std::move(rt);
+            kept++;
+        }
+        activeRuntimes.erase(activeRuntimes.begin() + kept, activeRuntimes.end());
+        clone_pool_collect();
+
+        spawned_clones.clear();
+        clone_pool_take_spawned(spawned_clones);
+        for (Sprite* clone : spawned_clones) {
+            start_scripts(activeRuntimes, clone_pool_owner(clone)->blocks, clone, CMD_CLONE_START);
+        }
+
+        idle = !needs_redraw;
+        if (idle) continue;
+
         SDL_SetRenderDrawColor(renderer, 30, 30, 30, 255);
         SDL_RenderClear(renderer);
 
@@ -730,8 +1045,6 @@ int main(int argc, char* argv[]) {
             }
         }
 
-        draw_toolbar(renderer, is_program_running);
-
         const auto& cats = get_categories();
         int selected_cat_index = 0;
         for (size_t i = 0; i < cats.size(); i++) {
@@ -740,15 +1053,55 @@ int main(int argc, char* argv[]) {
             }
         }
 
-        draw_category_bar(renderer, cats, selected_cat_index);
-        draw_palette(renderer, palette_items, palette_scroll_offset);
-        draw_coding_area(renderer);
-        draw_stage(renderer, sprite);
-        render_sprite_panel(renderer, sprite);
+        SDL_Rect toolbar_rect = {TOOLBAR_X, TOOLBAR_Y, TOOLBAR_WIDTH, TOOLBAR_HEIGHT};
+        if (panel_cache_begin(renderer, PANEL_TOOLBAR, toolbar_rect, is_program_running)) {
+            draw_toolbar(renderer, is_program_running);
+            panel_cache_end(renderer);
+        }
+
+        SDL_Rect category_rect = {PALETTE_X, CATEGORY_BAR_Y, STAGE_X - PALETTE_X, CATEGORY_BAR_HEIGHT};
+        if (panel_cache_begin(renderer, PANEL_CATEGORY_BAR, category_rect, selected_cat_index)) {
+            draw_category_bar(renderer, cats, selected_cat_index);
+            panel_cache_end(renderer);
+        }
+
+        SDL_Rect palette_rect = {PALETTE_X, PALETTE_Y, PALETTE_WIDTH, PALETTE_HEIGHT};
+        if (panel_cache_begin(renderer, PANEL_PALETTE, palette_rect, palette_scroll_offset)) {
+            draw_palette(renderer, palette_items, palette_scroll_offset);
+            panel_cache_end(renderer);
+        }
+
+        SDL_Rect coding_rect = {CODING_AREA_X, CODING_AREA_Y, CODING_AREA_WIDTH, CODING_AREA_HEIGHT};
+        if (panel_cache_begin(renderer, PANEL_CODING_AREA, coding_rect, 0)) {
+            draw_coding_area(renderer);
+            panel_cache_end(renderer);
+        }
+
+        int sprite_panel_y = STAGE_Y + STAGE_HEIGHT;
+        SDL_Rect sprite_panel_rect = {STAGE_X, sprite_panel_y, STAGE_WIDTH,
+                                      WINDOW_HEIGHT - sprite_panel_y - SPRITE_LIST_HEIGHT};
+        if (panel_cache_begin(renderer, PANEL_SPRITE_PANEL, sprite_panel_rect,
+                              sprite_panel_signature(sprite))) {
+            render_sprite_panel(renderer, sprite);
+            panel_cache_end(renderer);
+        }
+
+        SDL_Rect sprite_list_rect = {STAGE_X, WINDOW_HEIGHT - SPRITE_LIST_HEIGHT,
+                                     STAGE_WIDTH, SPRITE_LIST_HEIGHT};
+        if (panel_cache_begin(renderer, PANEL_SPRITE_LIST, sprite_list_rect,
+                              sprite_list_signature())) {
+            sync_sprite_list();
+            cpanel_render(&g_sprite_list, renderer);
+            panel_cache_end(renderer);
+        }
+
+        panel_cache_blit(renderer);
+
+        draw_stage(renderer);
         pen_render(renderer);
         draw_variables(renderer, sprite);
 
-        draw_all_blocks(renderer, blocks, text_state);
+        draw_all_blocks(renderer, blocks, get_dragged_block(blocks), text_state);
 
         SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
 
@@ -797,19 +1150,27 @@ int main(int argc, char* argv[]) {
     ceditor_destroy(&g_costume_editor);
     pen_shutdown();
 
-    for (auto& c : sprite.costumes) {
-        if (c.texture) {
-            SDL_DestroyTexture(c.texture);
-            c.texture = nullptr;
-        }
+    std::set<SDL_Texture*> costume_textures;
+    for (const Costume& c : g_default_costumes) costume_textures.insert(c.texture);
+    for (int i = 0; i < sprite_set_count(); i++) {
+        for (const Costume& c : sprite_set_at(i)->sprite.costumes) costume_textures.insert(c.texture);
     }
-    sprite.costumes.clear();
-
-    sprite.texture = nullptr;
+    // The loader owns the placeholder some costumes may still be showing.
+    costume_textures.erase(asset_placeholder(renderer));
+    for (SDL_Texture* tex : costume_textures) {
+        if (tex) SDL_DestroyTexture(tex);
+    }
+    asset_loader_shutdown();
+    g_default_costumes.clear();
+    sprite_set_clear();
+    sprite_atlas_destroy();
 
     close_logger();
     sound_cleanup();
     
+    text_cache_clear();
+    draw_clear_block_skins();
+    panel_cache_destroy();
     if (g_font) TTF_CloseFont(g_font);
     TTF_Quit();
 
@@ -0,0 +1,23 @@
+#include "cpu_features.h"
+#include <SDL2/SDL.h>
+
+static CpuLevel detect() {
+#ifdef BLOCKY_X86
+    if (SDL_HasAVX2()) return CPU_AVX2;
+    if (SDL_HasSSE2()) return CPU_SSE2;
+#endif
+    return CPU_SCALAR;
+}
+
+CpuLevel cpu_level() {
+    static CpuLevel level = detect();
+    return level;
+}
+
+const char* cpu_level_name(CpuLevel level) {
+    switch (level) {
+        case CPU_AVX2: return "AVX2";
+        case CPU_SSE2: return "SSE2";
+        default: return "scalar";
+    }
+}
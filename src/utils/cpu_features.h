@@ -0,0 +1,27 @@
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+// On x86, SIMD kernels are built next to the scalar ones with
+// BLOCKY_TARGET, so the binary runs anywhere and picks them at startup
+// from cpu_level. Other targets only build the scalar code.
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define BLOCKY_X86 1
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define BLOCKY_TARGET(isa) __attribute__((target(isa)))
+#else
+#define BLOCKY_TARGET(isa)
+#endif
+#endif
+
+enum CpuLevel {
+    CPU_SCALAR,
+    CPU_SSE2,
+    CPU_AVX2
+};
+
+// The widest kernels this machine runs. Asked once, then remembered.
+CpuLevel cpu_level();
+const char* cpu_level_name(CpuLevel level);
+
+#endif
@@ -125,7 +125,7 @@ void log_block_info(const Block* block, const std::string& prefix) {
     std::stringstream ss;
     ss << prefix << "Block #" << block->id
        << " [" << blocktype_to_string(block->type) << "]"
-       << " at (" << block->x << ", " << block->y << ")";
+       << " at (" << block->layout->x << ", " << block->layout->y << ")";
     log_info(ss.str());
 
     if (!block->args.empty()) {
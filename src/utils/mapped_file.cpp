@@ -0,0 +1,68 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#include <windows.h>
+
+bool mapped_file_open(const std::string& path, MappedFile* out) {
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping) return false;
+
+    // The view keeps the mapping alive after its handle is closed.
+    void* view = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!view) return false;
+
+    out->data = (unsigned char*)view;
+    out->size = (size_t)size.QuadPart;
+    return true;
+}
+
+void mapped_file_close(MappedFile* file) {
+    if (file->data) UnmapViewOfFile(file->data);
+    file->data = nullptr;
+    file->size = 0;
+}
+
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+bool mapped_file_open(const std::string& path, MappedFile* out) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+
+    void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED) return false;
+
+    out->data = (unsigned char*)view;
+    out->size = (size_t)st.st_size;
+    return true;
+}
+
+void mapped_file_close(MappedFile* file) {
+    if (file->data) munmap(file->data, file->size);
+    file->data = nullptr;
+    file->size = 0;
+}
+
+#endif
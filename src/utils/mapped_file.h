@@ -0,0 +1,18 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+#include <cstddef>
+#include <string>
+
+// Read-only view of a whole file through the OS page cache. Pages are
+// mapped copy-on-write, so a stray write never reaches the file.
+struct MappedFile {
+    unsigned char* data;
+    size_t size;
+
+    MappedFile() : data(nullptr), size(0) {}
+};
+
+bool mapped_file_open(const std::string& path, MappedFile* out);
+void mapped_file_close(MappedFile* file);
+
+#endif
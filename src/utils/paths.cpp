@@ -0,0 +1,14 @@
+#include "paths.h"
+#include "logger.h"
+#include <SDL2/SDL.h>
+
+std::string user_cache_dir() {
+    char* pref = SDL_GetPrefPath("Blocky", "Blocky");
+    if (!pref) {
+        log_warning(std::string("No user data directory: ") + SDL_GetError());
+        return "";
+    }
+    std::string dir = std::string(pref) + "cache/";
+    SDL_free(pref);
+    return dir;
+}
@@ -0,0 +1,10 @@
+#ifndef PATHS_H
+#define PATHS_H
+#include <string>
+
+// Per-user writable directory for data Blocky can rebuild, such as decoded
+// textures, with a trailing separator. Empty if the platform has none; the
+// caller then goes without its cache. Created on first use.
+std::string user_cache_dir();
+
+#endif